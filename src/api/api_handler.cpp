@@ -1,18 +1,30 @@
 #include "api_handler.h"
+#include "concurrency_limiter.h"
 #include <set>
 #include <iostream>
 #include <chrono>
 #include <random>
 #include <sstream>
 #include <map>
-#include <deque>
-
-// --- Rate Limiting Configuration ---
-static const int MAX_REQUESTS_PER_WINDOW = 100;
-static const std::chrono::seconds RATE_LIMIT_WINDOW(60);
+#include <mutex>
+
+// --- Load Shedding ---
+// Requests beyond the adaptive concurrency limit are rejected up front
+// instead of queueing behind a slow backend.
+static ConcurrencyLimiter concurrency_limiter;
+
+namespace {
+
+// Releases the concurrency permit on every exit path of a request. A
+// request that ends any way other than the ones it marks - an exception
+// thrown while processing it - failed under load, and backs the limit off.
+struct PermitGuard {
+    ConcurrencyLimiter::Permit permit;
+    ConcurrencyLimiter::Outcome outcome = ConcurrencyLimiter::Outcome::DROPPED;
+    ~PermitGuard() { concurrency_limiter.release(permit, outcome); }
+};
 
-// --- Rate Limiting State ---
-static std::deque<std::chrono::steady_clock::time_point> request_timestamps;
+} // namespace
 
 // --- Caching Configuration ---
 static const std::set<std::string> CACHEABLE_ENDPOINTS = {
@@ -26,6 +38,7 @@ static const std::chrono::seconds CACHE_TTL(300); // 5 minutes
 // Value: Pair of (JSON Response, Expiration Time)
 using CacheEntry = std::pair<JsonValue, std::chrono::steady_clock::time_point>;
 static std::map<std::string, CacheEntry> api_cache;
+static std::mutex api_cache_mutex;
 
 // Endpoints that require at least one search parameter
 static const std::set<std::string> BROAD_SEARCH_ENDPOINTS = {
@@ -37,16 +50,26 @@ static const std::set<std::string> BROAD_SEARCH_ENDPOINTS = {
 // Forward declaration
 JsonValue create_error_response(const std::string& message, const std::string& request_id, int error_code = 400);
 
+bool is_broad_search_endpoint(const std::string& endpoint) {
+    return BROAD_SEARCH_ENDPOINTS.count(endpoint) > 0;
+}
+
 // Helper function to generate a unique request ID
 std::string generate_request_id() {
     auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::system_clock::now().time_since_epoch()
     ).count();
     static std::mt19937 gen(std::random_device{}());
+    static std::mutex gen_mutex;
     std::uniform_int_distribution<> distrib(1000, 9999);
+    int suffix;
+    {
+        std::lock_guard<std::mutex> lock(gen_mutex);
+        suffix = distrib(gen);
+    }
 
     std::stringstream ss;
-    ss << "req_" << timestamp << "_" << distrib(gen);
+    ss << "req_" << timestamp << "_" << suffix;
     return ss.str();
 }
 
@@ -59,26 +82,20 @@ JsonValue process_api_request(const std::string& endpoint, const JsonValue& requ
     const std::string request_id = generate_request_id();
     const auto start_time = std::chrono::high_resolution_clock::now();
 
-    // --- Rate Limiting Check ---
-    const auto now = std::chrono::steady_clock::now();
-    while (!request_timestamps.empty() && now - request_timestamps.front() > RATE_LIMIT_WINDOW) {
-        request_timestamps.pop_front();
-    }
-
-    if (request_timestamps.size() >= MAX_REQUESTS_PER_WINDOW) {
+    // --- Concurrency Limit Check ---
+    PermitGuard guard{concurrency_limiter.try_acquire()};
+    if (!guard.permit.granted) {
         auto end_time = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double, std::milli> duration = end_time - start_time;
-        std::string err_msg = "Too many requests. Please try again later.";
+        std::string err_msg = "Server is at capacity. Please try again later.";
         std::cout << "[ERROR] Request ID: " << request_id
-                  << " | Status: Rate Limited"
+                  << " | Status: Load Shed"
+                  << " | Limit: " << concurrency_limiter.limit()
                   << " | Duration: " << duration.count() << "ms"
                   << " | Message: " << err_msg << std::endl;
-        return create_error_response(err_msg, request_id, 429);
+        return create_error_response(err_msg, request_id, 503);
     }
 
-    request_timestamps.push_back(now);
-
-
     std::cout << "[INFO] Request ID: " << request_id
               << " | Timestamp: " << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()
               << " | Endpoint: " << endpoint
@@ -87,6 +104,7 @@ JsonValue process_api_request(const std::string& endpoint, const JsonValue& requ
     // --- Cache Check ---
     if (CACHEABLE_ENDPOINTS.count(endpoint)) {
         std::string cache_key = generate_cache_key(endpoint, request);
+        std::lock_guard<std::mutex> cache_lock(api_cache_mutex);
         auto it = api_cache.find(cache_key);
         if (it != api_cache.end()) {
             // Check if expired
@@ -96,6 +114,7 @@ JsonValue process_api_request(const std::string& endpoint, const JsonValue& requ
                 std::cout << "[INFO] Request ID: " << request_id
                           << " | Status: Cache Hit"
                           << " | Duration: " << duration.count() << "ms" << std::endl;
+                guard.outcome = ConcurrencyLimiter::Outcome::IGNORED;
                 return it->second.first; // Return cached value
             }
         }
@@ -108,11 +127,12 @@ JsonValue process_api_request(const std::string& endpoint, const JsonValue& requ
                   << " | Status: Failure"
                   << " | Duration: " << duration.count() << "ms"
                   << " | Message: " << message << std::endl;
+        guard.outcome = ConcurrencyLimiter::Outcome::IGNORED;
         return create_error_response(message, request_id, error_code);
     };
 
     // Check if this is a broad search endpoint that requires parameters
-    if (BROAD_SEARCH_ENDPOINTS.find(endpoint) != BROAD_SEARCH_ENDPOINTS.end()) {
+    if (is_broad_search_endpoint(endpoint)) {
         if (request.object_value.find("parameters") == request.object_value.end()) {
             return log_and_return_error("Missing parameters object for endpoint: " + endpoint);
         }
@@ -161,11 +181,13 @@ JsonValue process_api_request(const std::string& endpoint, const JsonValue& requ
               << " | Duration: " << duration.count() << "ms" << std::endl;
 
     JsonValue success_response = create_success_response("Request processed successfully for endpoint: " + endpoint);
+    guard.outcome = ConcurrencyLimiter::Outcome::SUCCESS;
 
     // --- Cache Store ---
     if (CACHEABLE_ENDPOINTS.count(endpoint)) {
         std::string cache_key = generate_cache_key(endpoint, request);
         auto expiration_time = std::chrono::steady_clock::now() + CACHE_TTL;
+        std::lock_guard<std::mutex> cache_lock(api_cache_mutex);
         api_cache[cache_key] = std::make_pair(success_response, expiration_time);
         std::cout << "[INFO] Request ID: " << request_id << " | Status: Stored in cache" << std::endl;
     }
@@ -187,6 +209,10 @@ JsonValue create_error_response(const std::string& message, const std::string& r
     return error_response;
 }
 
+JsonValue create_error_response(const std::string& message, int error_code) {
+    return create_error_response(message, generate_request_id(), error_code);
+}
+
 JsonValue create_success_response(const std::string& message) {
     JsonValue success_response = JsonValue::makeObject();
     
@@ -7,6 +7,9 @@
 // Process API requests with validation for mandatory search parameters
 JsonValue process_api_request(const std::string& endpoint, const JsonValue& request);
 
+// True for endpoints whose searches are expensive and require parameters
+bool is_broad_search_endpoint(const std::string& endpoint);
+
 // Helper function to create standardized error responses
 JsonValue create_error_response(const std::string& message, int error_code = 400);
 
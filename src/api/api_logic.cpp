@@ -1,5 +1,9 @@
 #include "api_logic.h"
-#include <fstream>
+#include "api_handler.h"
+#include "prefix_cache.h"
+#include "../io/file_io.h"
+#include <algorithm>
+#include <cctype>
 
 JsonValue build_request(const ApiConfig& cfg) {
     JsonValue root = JsonValue::makeObject();
@@ -9,30 +13,137 @@ JsonValue build_request(const ApiConfig& cfg) {
     root.object_value["max_tokens"] = JsonValue::makeNumber(cfg.max_tokens);
     root.object_value["top_p"] = JsonValue::makeNumber(cfg.top_p);
     root.object_value["repeat_penalty"] = JsonValue::makeNumber(cfg.repeat_penalty);
+    if (!cfg.context.empty()) {
+        JsonValue context = JsonValue::makeArray();
+        for (const auto& msg : cfg.context) {
+            JsonValue entry = JsonValue::makeObject();
+            entry.object_value["role"] = JsonValue::makeString(msg.role);
+            entry.object_value["content"] = JsonValue::makeString(msg.content);
+            context.array_value.push_back(entry);
+        }
+        root.object_value["context"] = context;
+    }
     return root;
 }
 
 JsonValue simulate_api_call(const JsonValue& request) {
-    // Dummy response: echo prompt and add a result string
-    JsonValue resp = JsonValue::makeObject();
-    resp.object_value["success"] = JsonValue::makeBool(true);
-    auto req_prompt = request.object_value.at("prompt").string_value;
-    resp.object_value["response"] = JsonValue::makeString(
-        "[SIMULATED RESPONSE] Based on prompt: " + req_prompt
-    );
-    return resp;
+    return simulate_api_call(request, nullptr);
 }
 
-bool save_to_file(const std::string& filename, const JsonValue& value) {
-    std::ofstream ofs(filename);
-    if(!ofs) return false;
-    ofs << value.serialize();
-    return true;
+JsonValue simulate_api_call(const JsonValue& request, PrefixCache* prefix_cache) {
+    return simulate_api_batch({request}, prefix_cache).front();
+}
+
+// Context messages of a request, empty when it carries none
+static const std::vector<JsonValue>& context_messages(const JsonValue& request) {
+    static const std::vector<JsonValue> none;
+    auto it = request.object_value.find("context");
+    if (it == request.object_value.end() || it->second.type != JsonValue::ARRAY) return none;
+    return it->second.array_value;
+}
+
+static JsonValue empty_prefix_state() {
+    JsonValue state = JsonValue::makeObject();
+    state.object_value["messages"] = JsonValue::makeNumber(0);
+    state.object_value["tokens"] = JsonValue::makeNumber(0);
+    return state;
+}
+
+JsonValue simulate_context_step(const JsonValue& prefix_state, const JsonValue& message) {
+    // Dummy prompt processing: count whitespace separated tokens
+    size_t tokens = 0;
+    auto content = message.object_value.find("content");
+    if (content != message.object_value.end()) {
+        bool in_token = false;
+        for (char c : content->second.string_value) {
+            bool space = std::isspace(static_cast<unsigned char>(c));
+            if (!space && !in_token) tokens++;
+            in_token = !space;
+        }
+    }
+    JsonValue state = prefix_state.type == JsonValue::NIL ? empty_prefix_state() : prefix_state;
+    state.object_value["messages"].number_value += 1;
+    state.object_value["tokens"].number_value += tokens;
+    return state;
+}
+
+std::vector<JsonValue> simulate_api_batch(const std::vector<JsonValue>& requests) {
+    return simulate_api_batch(requests, nullptr);
+}
+
+// Why the backend cannot take the request; empty when it can
+static std::string request_problem(const JsonValue& request) {
+    if (request.type != JsonValue::OBJECT) return "Request must be a JSON object";
+    auto prompt = request.object_value.find("prompt");
+    if (prompt == request.object_value.end() || prompt->second.type != JsonValue::STRING) {
+        return "Request requires a string 'prompt'";
+    }
+    return "";
+}
+
+std::vector<JsonValue> simulate_api_batch(const std::vector<JsonValue>& requests, PrefixCache* prefix_cache) {
+    // A malformed request gets its own 400 and leaves the rest of the batch alone
+    std::vector<JsonValue> responses(requests.size());
+    std::vector<size_t> valid;
+    for (size_t r = 0; r < requests.size(); ++r) {
+        std::string problem = request_problem(requests[r]);
+        if (problem.empty()) valid.push_back(r);
+        else responses[r] = create_error_response(problem, 400);
+    }
+    if (valid.empty()) return responses;
+
+    // Length of the context prefix shared by every valid request in the batch
+    const auto& first = context_messages(requests[valid.front()]);
+    size_t shared = first.size();
+    for (size_t v = 1; v < valid.size() && shared > 0; ++v) {
+        const auto& ctx = context_messages(requests[valid[v]]);
+        size_t n = std::min(shared, ctx.size());
+        size_t i = 0;
+        while (i < n && ctx[i].serialize() == first[i].serialize()) i++;
+        shared = i;
+    }
+
+    // The shared prefix is processed once for the whole batch. With a cache,
+    // the first context keeps it on the way through and the rest pick it
+    // up, so each context costs exactly one cache lookup.
+    JsonValue shared_state = empty_prefix_state();
+    if (!prefix_cache) {
+        for (size_t i = 0; i < shared; ++i) {
+            shared_state = simulate_context_step(shared_state, first[i]);
+        }
+    }
+
+    for (size_t r : valid) {
+        const JsonValue& request = requests[r];
+        const auto& ctx = context_messages(request);
+        JsonValue state = shared_state;
+        if (prefix_cache) {
+            if (!ctx.empty()) state = prefix_cache->process(ctx, ctx.size(), shared);
+        } else {
+            for (size_t i = shared; i < ctx.size(); ++i) {
+                state = simulate_context_step(state, ctx[i]);
+            }
+        }
+
+        // Dummy response: echo prompt and add a result string
+        JsonValue resp = JsonValue::makeObject();
+        resp.object_value["success"] = JsonValue::makeBool(true);
+        auto req_prompt = request.object_value.at("prompt").string_value;
+        resp.object_value["response"] = JsonValue::makeString(
+            "[SIMULATED RESPONSE] Based on prompt: " + req_prompt
+        );
+        resp.object_value["context_tokens"] = state.object_value["tokens"];
+        responses[r] = resp;
+    }
+    return responses;
+}
+
+bool save_to_file(const std::string& filename, const JsonValue& value, bool durable) {
+    return qc::io::FileIO::write_atomic(filename, value.serialize(), durable);
 }
 
 JsonValue load_from_file(const std::string& filename) {
-    std::ifstream ifs(filename);
-    if(!ifs) return JsonValue::makeNull();
-    std::string content((std::istreambuf_iterator<char>(ifs)), {});
-    return JsonValue::parse(content);
-}
\ No newline at end of file
+    auto file = qc::io::MappedFile::open(filename);
+    if (!file) return JsonValue::makeNull();
+    return JsonValue::parse(file->data(), file->size());
+}
@@ -1,8 +1,17 @@
 #ifndef API_LOGIC_H
 #define API_LOGIC_H
 #include <string>
+#include <vector>
 #include "../core/json_logic.h"
 
+class PrefixCache;
+
+// One turn of conversation context sent ahead of the prompt
+struct ContextMessage {
+    std::string role;
+    std::string content;
+};
+
 // Configuration for the API call
 struct ApiConfig {
     std::string model;
@@ -11,14 +20,23 @@ struct ApiConfig {
     int max_tokens;
     double top_p;
     double repeat_penalty;
+    std::vector<ContextMessage> context;
 };
 
 // Build JSON request from config
 JsonValue build_request(const ApiConfig& cfg);
 // Simulate API call and produce a dummy JSON response
 JsonValue simulate_api_call(const JsonValue& request);
-// Save JSON value to file
-bool save_to_file(const std::string& filename, const JsonValue& value);
+JsonValue simulate_api_call(const JsonValue& request, PrefixCache* prefix_cache);
+// Simulate one batched call; requests share the processing of their common context prefix
+std::vector<JsonValue> simulate_api_batch(const std::vector<JsonValue>& requests);
+// Same, reusing processed context prefixes from the cache when one is given
+std::vector<JsonValue> simulate_api_batch(const std::vector<JsonValue>& requests, PrefixCache* prefix_cache);
+// Simulate processing one context message on top of an already processed prefix
+// (a null prefix_state means nothing has been processed yet)
+JsonValue simulate_context_step(const JsonValue& prefix_state, const JsonValue& message);
+// Atomically replace a file with the JSON value; `durable` also syncs it to disk
+bool save_to_file(const std::string& filename, const JsonValue& value, bool durable = false);
 // Load JSON value from file
 JsonValue load_from_file(const std::string& filename);
 
@@ -0,0 +1,80 @@
+#include "concurrency_limiter.h"
+#include <algorithm>
+#include <cmath>
+
+ConcurrencyLimiter::ConcurrencyLimiter() : ConcurrencyLimiter(Config{}) {}
+
+ConcurrencyLimiter::ConcurrencyLimiter(const Config& config)
+    : config_(config), limit_(config.initial_limit) {}
+
+ConcurrencyLimiter::Permit ConcurrencyLimiter::try_acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Permit permit;
+    if (in_flight_ >= static_cast<int>(limit_)) {
+        return permit;
+    }
+    permit.granted = true;
+    permit.in_flight = ++in_flight_;
+    permit.start = std::chrono::steady_clock::now();
+    return permit;
+}
+
+void ConcurrencyLimiter::release(const Permit& permit, Outcome outcome) {
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - permit.start;
+    release(permit, outcome, elapsed.count());
+}
+
+void ConcurrencyLimiter::release(const Permit& permit, Outcome outcome, double latency_ms) {
+    if (!permit.granted) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_flight_--;
+
+    switch (outcome) {
+        case Outcome::SUCCESS:
+            on_sample(latency_ms, permit.in_flight);
+            break;
+        case Outcome::DROPPED:
+            limit_ = std::max(config_.min_limit, limit_ * config_.backoff_ratio);
+            break;
+        case Outcome::IGNORED:
+            break;
+    }
+}
+
+int ConcurrencyLimiter::limit() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(limit_);
+}
+
+int ConcurrencyLimiter::in_flight() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return in_flight_;
+}
+
+// Caller must hold mutex_
+void ConcurrencyLimiter::on_sample(double latency_ms, int in_flight_at_start) {
+    if (latency_ms <= 0) latency_ms = 1e-3;
+
+    // Baseline latency is a slow moving average of the samples
+    if (long_rtt_ms_ == 0) {
+        long_rtt_ms_ = latency_ms;
+    } else {
+        long_rtt_ms_ += (latency_ms - long_rtt_ms_) / config_.long_window;
+    }
+
+    // Once the backend recovers, pull the inflated baseline down quickly so the
+    // limit is not held open by latency measured during the overload.
+    if (long_rtt_ms_ / latency_ms > 2.0) {
+        long_rtt_ms_ *= 0.95;
+    }
+
+    // Traffic that never came near the limit says nothing about capacity
+    if (in_flight_at_start < limit_ / 2) return;
+
+    double gradient = std::clamp(config_.rtt_tolerance * long_rtt_ms_ / latency_ms, 0.5, 1.0);
+    double queue_allowance = std::sqrt(limit_);
+    double new_limit = limit_ * gradient + queue_allowance;
+    new_limit = limit_ * (1.0 - config_.smoothing) + new_limit * config_.smoothing;
+    limit_ = std::clamp(new_limit, config_.min_limit, config_.max_limit);
+}
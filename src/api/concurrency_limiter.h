@@ -0,0 +1,60 @@
+#ifndef CONCURRENCY_LIMITER_H
+#define CONCURRENCY_LIMITER_H
+
+#include <chrono>
+#include <mutex>
+
+// Adaptive concurrency limit modelled on the gradient limiter from Netflix's
+// concurrency-limits. The limit tracks how many requests may be in flight at
+// once: it grows while sampled latency stays close to the long-term baseline
+// and shrinks as soon as queueing inflates latency or requests are dropped.
+class ConcurrencyLimiter {
+public:
+    struct Config {
+        double initial_limit = 20;
+        double min_limit = 1;
+        double max_limit = 200;
+        double smoothing = 0.2;       // Weight of each new limit estimate
+        double rtt_tolerance = 1.5;   // Sample/baseline latency ratio tolerated before backing off
+        double long_window = 600;     // Samples averaged into the baseline latency
+        double backoff_ratio = 0.9;   // Multiplicative decrease applied on drops
+    };
+
+    enum class Outcome {
+        SUCCESS,  // Request completed; latency is sampled
+        DROPPED,  // Request timed out or failed under load; limit backs off
+        IGNORED   // Request finished without exercising the backend (e.g. validation error)
+    };
+
+    // Handed out by try_acquire and passed back to release
+    struct Permit {
+        bool granted = false;
+        int in_flight = 0; // In-flight count when the permit was granted
+        std::chrono::steady_clock::time_point start;
+    };
+
+    ConcurrencyLimiter();
+    explicit ConcurrencyLimiter(const Config& config);
+
+    // Returns a granted permit if another request fits under the current limit
+    Permit try_acquire();
+
+    // Releases a permit, sampling latency measured since acquisition
+    void release(const Permit& permit, Outcome outcome);
+    // Releases a permit with an explicitly measured latency
+    void release(const Permit& permit, Outcome outcome, double latency_ms);
+
+    int limit() const;
+    int in_flight() const;
+
+private:
+    Config config_;
+    double limit_;
+    double long_rtt_ms_ = 0;
+    int in_flight_ = 0;
+    mutable std::mutex mutex_;
+
+    void on_sample(double latency_ms, int in_flight_at_start);
+};
+
+#endif // CONCURRENCY_LIMITER_H
@@ -0,0 +1,125 @@
+#include "micro_batcher.h"
+#include "api_logic.h"
+#include "request_scheduler.h"
+#include <map>
+#include <stdexcept>
+
+MicroBatcher::MicroBatcher() : MicroBatcher(Config{}) {}
+
+MicroBatcher::MicroBatcher(const Config& config, BatchHandler handler)
+    : config_(config), handler_(std::move(handler)) {
+    if (config_.max_batch_size == 0) config_.max_batch_size = 1;
+    if (!handler_) {
+        PrefixCache* prefix_cache = config_.prefix_cache;
+        RequestScheduler* scheduler = config_.scheduler;
+        handler_ = [prefix_cache, scheduler](const std::vector<JsonValue>& requests) {
+            if (!scheduler) return simulate_api_batch(requests, prefix_cache);
+            // The batch is one job; a full queue answers every request in it
+            JsonValue responses = scheduler->submit(RequestClass::INTERACTIVE, [&requests, prefix_cache] {
+                JsonValue batch = JsonValue::makeArray();
+                batch.array_value = simulate_api_batch(requests, prefix_cache);
+                return batch;
+            }).get();
+            if (responses.type != JsonValue::ARRAY) return std::vector<JsonValue>(requests.size(), responses);
+            return std::move(responses.array_value);
+        };
+    }
+    dispatcher_ = std::thread(&MicroBatcher::dispatch_loop, this);
+}
+
+MicroBatcher::~MicroBatcher() {
+    shutdown();
+}
+
+std::future<JsonValue> MicroBatcher::submit(const JsonValue& request) {
+    Pending entry{request, std::promise<JsonValue>()};
+    std::future<JsonValue> result = entry.result.get_future();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+        entry.result.set_exception(std::make_exception_ptr(std::runtime_error("MicroBatcher is shut down")));
+        return result;
+    }
+    if (pending_.empty()) oldest_ = std::chrono::steady_clock::now();
+    pending_.push_back(std::move(entry));
+    stats_.requests++;
+    if (pending_.size() == 1 || pending_.size() >= config_.max_batch_size) {
+        cv_.notify_one();
+    }
+    return result;
+}
+
+void MicroBatcher::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    if (dispatcher_.joinable()) dispatcher_.join();
+}
+
+MicroBatcher::Stats MicroBatcher::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void MicroBatcher::dispatch_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [&] { return stopping_ || !pending_.empty(); });
+        if (pending_.empty()) return;
+
+        // Hold the window open until it expires or the batch is full
+        auto deadline = oldest_ + config_.max_wait;
+        cv_.wait_until(lock, deadline, [&] {
+            return stopping_ || pending_.size() >= config_.max_batch_size;
+        });
+
+        std::vector<Pending> batch;
+        batch.swap(pending_);
+        lock.unlock();
+        dispatch(batch);
+        lock.lock();
+    }
+}
+
+void MicroBatcher::dispatch(std::vector<Pending>& batch) {
+    // Requests are only batched with others for the same model
+    std::map<std::string, std::vector<Pending*>> groups;
+    for (auto& entry : batch) {
+        std::string model;
+        auto it = entry.request.object_value.find("model");
+        if (it != entry.request.object_value.end()) model = it->second.string_value;
+        groups[model].push_back(&entry);
+    }
+
+    for (auto& group : groups) {
+        auto& members = group.second;
+        for (size_t begin = 0; begin < members.size(); begin += config_.max_batch_size) {
+            size_t end = std::min(members.size(), begin + config_.max_batch_size);
+            std::vector<JsonValue> requests;
+            requests.reserve(end - begin);
+            for (size_t i = begin; i < end; ++i) requests.push_back(members[i]->request);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stats_.batches++;
+            }
+
+            try {
+                std::vector<JsonValue> responses = handler_(requests);
+                if (responses.size() != requests.size()) {
+                    throw std::runtime_error("Batch handler returned " + std::to_string(responses.size()) +
+                                             " results for " + std::to_string(requests.size()) + " requests");
+                }
+                for (size_t i = begin; i < end; ++i) {
+                    members[i]->result.set_value(std::move(responses[i - begin]));
+                }
+            } catch (...) {
+                for (size_t i = begin; i < end; ++i) {
+                    members[i]->result.set_exception(std::current_exception());
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef MICRO_BATCHER_H
+#define MICRO_BATCHER_H
+
+#include "../core/json_logic.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class PrefixCache;
+class RequestScheduler;
+
+// Collects model requests that arrive within a short window (or until the
+// size cap is reached), groups them by "model" and dispatches each group as
+// one batch. Callers receive their own result through a future.
+class MicroBatcher {
+public:
+    using BatchHandler = std::function<std::vector<JsonValue>(const std::vector<JsonValue>&)>;
+
+    struct Config {
+        size_t max_batch_size = 16;
+        std::chrono::microseconds max_wait{2000}; // Window measured from the oldest pending request
+        PrefixCache* prefix_cache = nullptr;      // Used by the default handler when set
+        RequestScheduler* scheduler = nullptr;    // Default handler runs each batch there, as interactive work
+    };
+
+    struct Stats {
+        size_t requests = 0;
+        size_t batches = 0;
+    };
+
+    MicroBatcher();
+    explicit MicroBatcher(const Config& config, BatchHandler handler = nullptr);
+    ~MicroBatcher();
+
+    MicroBatcher(const MicroBatcher&) = delete;
+    MicroBatcher& operator=(const MicroBatcher&) = delete;
+
+    std::future<JsonValue> submit(const JsonValue& request);
+
+    // Dispatch whatever is pending and stop the batching thread
+    void shutdown();
+
+    Stats stats() const;
+
+private:
+    struct Pending {
+        JsonValue request;
+        std::promise<JsonValue> result;
+    };
+
+    Config config_;
+    BatchHandler handler_;
+    std::vector<Pending> pending_;
+    std::chrono::steady_clock::time_point oldest_;
+    Stats stats_;
+    bool stopping_ = false;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread dispatcher_;
+
+    void dispatch_loop();
+    void dispatch(std::vector<Pending>& batch);
+};
+
+#endif // MICRO_BATCHER_H
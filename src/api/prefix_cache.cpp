@@ -0,0 +1,134 @@
+#include "prefix_cache.h"
+#include "api_logic.h"
+
+namespace {
+
+const uint64_t FNV_PRIME = 1099511628211ULL;
+
+uint64_t fnv1a(const std::string& data, uint64_t hash) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// Folds a message hash into the running prefix hash
+uint64_t mix(uint64_t prefix, uint64_t message) {
+    uint64_t x = prefix ^ (message + 0x9e3779b97f4a7c15ULL + (prefix << 6) + (prefix >> 2));
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x;
+}
+
+} // namespace
+
+PrefixCache::PrefixCache(size_t byte_budget) : byte_budget_(byte_budget) {}
+
+PrefixCache::Key PrefixCache::extend_key(const Key& prefix, const JsonValue& message) {
+    std::string bytes = message.serialize();
+    return {mix(prefix.primary, fnv1a(bytes, 14695981039346656037ULL)),
+            mix(prefix.check, fnv1a(bytes, 0x84222325cbf29ce4ULL))};
+}
+
+JsonValue PrefixCache::process(const std::vector<JsonValue>& messages) {
+    return process(messages, messages.size());
+}
+
+JsonValue PrefixCache::process(const std::vector<JsonValue>& messages, size_t count) {
+    return process(messages, count, count);
+}
+
+JsonValue PrefixCache::process(const std::vector<JsonValue>& messages, size_t count, size_t keep) {
+    if (count > messages.size()) count = messages.size();
+    if (count == 0) return JsonValue();
+
+    std::vector<Key> keys(count + 1);
+    keys[0] = {0, 0};
+    for (size_t i = 0; i < count; ++i) {
+        keys[i + 1] = extend_key(keys[i], messages[i]);
+    }
+
+    // Find the longest cached prefix
+    JsonValue state;
+    size_t cached = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t len = count; len > 0; --len) {
+            auto it = index_.find(keys[len]);
+            if (it == index_.end()) continue;
+            lru_.splice(lru_.begin(), lru_, it->second);
+            state = it->second->artifact;
+            cached = len;
+            break;
+        }
+        if (cached == count) stats_.hits++;
+        else if (cached > 0) stats_.partial_hits++;
+        else stats_.misses++;
+    }
+    if (cached == count) return state;
+
+    for (size_t i = cached; i < count; ++i) {
+        state = simulate_context_step(state, messages[i]);
+        if (i + 1 == keep && keep < count) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            insert(keys[keep], state);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    insert(keys[count], state);
+    return state;
+}
+
+// Caller must hold mutex_
+void PrefixCache::insert(const Key& key, const JsonValue& artifact) {
+    auto existing = index_.find(key);
+    if (existing != index_.end()) {
+        lru_.splice(lru_.begin(), lru_, existing->second);
+        return;
+    }
+
+    size_t bytes = sizeof(Entry) + artifact.serialize().size();
+    if (bytes > byte_budget_) return;
+
+    while (!lru_.empty() && stats_.bytes + bytes > byte_budget_) {
+        const Entry& victim = lru_.back();
+        stats_.bytes -= victim.bytes;
+        index_.erase(victim.key);
+        lru_.pop_back();
+        stats_.evictions++;
+    }
+
+    lru_.push_front({key, artifact, bytes});
+    index_[key] = lru_.begin();
+    stats_.bytes += bytes;
+    stats_.entries = lru_.size();
+}
+
+PrefixCache::Stats PrefixCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats snapshot = stats_;
+    snapshot.entries = lru_.size();
+    return snapshot;
+}
+
+JsonValue PrefixCache::stats_json() const {
+    Stats s = stats();
+    JsonValue out = JsonValue::makeObject();
+    out.object_value["hits"] = JsonValue::makeNumber(s.hits);
+    out.object_value["partial_hits"] = JsonValue::makeNumber(s.partial_hits);
+    out.object_value["misses"] = JsonValue::makeNumber(s.misses);
+    out.object_value["evictions"] = JsonValue::makeNumber(s.evictions);
+    out.object_value["entries"] = JsonValue::makeNumber(s.entries);
+    out.object_value["bytes"] = JsonValue::makeNumber(s.bytes);
+    return out;
+}
+
+void PrefixCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    index_.clear();
+    stats_ = Stats{};
+}
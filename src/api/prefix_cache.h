@@ -0,0 +1,68 @@
+#ifndef PREFIX_CACHE_H
+#define PREFIX_CACHE_H
+
+#include "../core/json_logic.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Caches the backend's processed-prefix artifact for conversation context.
+// Entries are keyed by a rolling hash over the context messages, so a
+// request whose context extends a cached one only pays for the new
+// messages. Least recently used entries are evicted under a byte budget.
+class PrefixCache {
+public:
+    struct Stats {
+        size_t hits = 0;          // Whole context was cached
+        size_t partial_hits = 0;  // A shorter prefix of the context was cached
+        size_t misses = 0;        // Nothing reusable was cached
+        size_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    explicit PrefixCache(size_t byte_budget = 64 * 1024 * 1024);
+
+    // Processed-prefix artifact for the messages, computing only the
+    // part that is not already cached and caching the result
+    JsonValue process(const std::vector<JsonValue>& messages);
+    // Same, for the first `count` messages
+    JsonValue process(const std::vector<JsonValue>& messages, size_t count);
+    // Same, also caching the artifact of the first `keep` messages when it
+    // is computed on the way, so contexts sharing that prefix reuse it
+    JsonValue process(const std::vector<JsonValue>& messages, size_t count, size_t keep);
+
+    Stats stats() const;
+    JsonValue stats_json() const;
+    void clear();
+
+private:
+    // Two independent rolling hashes; together they make collisions negligible
+    struct Key {
+        uint64_t primary;
+        uint64_t check;
+        bool operator==(const Key& other) const { return primary == other.primary && check == other.check; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const { return static_cast<size_t>(k.primary); }
+    };
+    struct Entry {
+        Key key;
+        JsonValue artifact;
+        size_t bytes;
+    };
+
+    size_t byte_budget_;
+    std::list<Entry> lru_; // Most recently used at the front
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+    Stats stats_;
+    mutable std::mutex mutex_;
+
+    static Key extend_key(const Key& prefix, const JsonValue& message);
+    void insert(const Key& key, const JsonValue& artifact);
+};
+
+#endif // PREFIX_CACHE_H
@@ -0,0 +1,130 @@
+#include "request_scheduler.h"
+#include "api_handler.h"
+#include <algorithm>
+
+RequestClass classify_request(const std::string& endpoint) {
+    return is_broad_search_endpoint(endpoint) ? RequestClass::BULK : RequestClass::INTERACTIVE;
+}
+
+RequestScheduler::RequestScheduler() : RequestScheduler(Config{}) {}
+
+RequestScheduler::RequestScheduler(const Config& config, Handler handler)
+    : config_(config), handler_(handler ? std::move(handler) : Handler(process_api_request)) {
+    int interactive = static_cast<int>(RequestClass::INTERACTIVE);
+    int bulk = static_cast<int>(RequestClass::BULK);
+    capacity_[interactive] = config_.interactive_capacity;
+    capacity_[bulk] = config_.bulk_capacity;
+    weight_[interactive] = std::max(1, config_.interactive_weight);
+    weight_[bulk] = std::max(1, config_.bulk_weight);
+
+    // Bulk jobs leave at least one worker free, so there must be two
+    int worker_count = std::max(2, config_.worker_count);
+    if (config_.max_bulk_workers <= 0 || config_.max_bulk_workers > worker_count - 1) {
+        config_.max_bulk_workers = worker_count - 1;
+    }
+
+    for (int i = 0; i < worker_count; ++i) {
+        workers_.emplace_back(&RequestScheduler::worker_loop, this);
+    }
+}
+
+RequestScheduler::~RequestScheduler() {
+    shutdown();
+}
+
+std::future<JsonValue> RequestScheduler::submit(const std::string& endpoint, const JsonValue& request) {
+    return submit(classify_request(endpoint), [this, endpoint, request] { return handler_(endpoint, request); });
+}
+
+std::future<JsonValue> RequestScheduler::submit(RequestClass request_class, Work work) {
+    int cls = static_cast<int>(request_class);
+    Job job{std::move(work), std::promise<JsonValue>()};
+    std::future<JsonValue> result = job.result.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!stopping_ && queues_[cls].size() < capacity_[cls]) {
+            queues_[cls].push_back(std::move(job));
+            work_available_.notify_one();
+            return result;
+        }
+    }
+
+    job.result.set_value(create_error_response("Request queue is full. Please try again later.", 503));
+    return result;
+}
+
+void RequestScheduler::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ && workers_.empty()) return;
+        stopping_ = true;
+    }
+    work_available_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) worker.join();
+    }
+    workers_.clear();
+}
+
+size_t RequestScheduler::queued(RequestClass cls) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queues_[static_cast<int>(cls)].size();
+}
+
+// Smooth weighted round-robin over the classes that can run right now.
+// Caller must hold mutex_. Returns -1 when nothing is runnable.
+int RequestScheduler::pick_class() {
+    int bulk = static_cast<int>(RequestClass::BULK);
+    bool runnable[CLASS_COUNT];
+    int total_weight = 0;
+    for (int c = 0; c < CLASS_COUNT; ++c) {
+        runnable[c] = !queues_[c].empty() && (c != bulk || bulk_running_ < config_.max_bulk_workers);
+        if (runnable[c]) total_weight += weight_[c];
+    }
+
+    int best = -1;
+    for (int c = 0; c < CLASS_COUNT; ++c) {
+        if (!runnable[c]) continue;
+        current_weight_[c] += weight_[c];
+        if (best < 0 || current_weight_[c] > current_weight_[best]) best = c;
+    }
+    if (best >= 0) current_weight_[best] -= total_weight;
+    return best;
+}
+
+void RequestScheduler::worker_loop() {
+    const int bulk = static_cast<int>(RequestClass::BULK);
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        int cls = -1;
+        work_available_.wait(lock, [&] {
+            cls = pick_class();
+            return cls >= 0 || (stopping_ && queues_[0].empty() && queues_[1].empty());
+        });
+        if (cls < 0) return;
+
+        Job job = std::move(queues_[cls].front());
+        queues_[cls].pop_front();
+        if (cls == bulk) bulk_running_++;
+
+        lock.unlock();
+        try {
+            job.result.set_value(job.work());
+        } catch (...) {
+            job.result.set_exception(std::current_exception());
+        }
+        lock.lock();
+
+        if (cls == bulk) {
+            bulk_running_--;
+            // A bulk slot opened up; another worker may be waiting on it
+            work_available_.notify_all();
+        }
+    }
+}
+
+std::future<JsonValue> schedule_api_request(const std::string& endpoint, const JsonValue& request) {
+    static RequestScheduler scheduler;
+    return scheduler.submit(endpoint, request);
+}
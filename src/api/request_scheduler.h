@@ -0,0 +1,85 @@
+#ifndef REQUEST_SCHEDULER_H
+#define REQUEST_SCHEDULER_H
+
+#include "../core/json_logic.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Cheap point lookups are scheduled separately from expensive broad searches
+enum class RequestClass { INTERACTIVE = 0, BULK = 1 };
+
+// Map an endpoint to its scheduling class
+RequestClass classify_request(const std::string& endpoint);
+
+// Worker pool fed from one bounded queue per request class. Queues are
+// drained by smooth weighted round-robin, and bulk jobs may never occupy
+// every worker, so interactive lookups keep a low latency while heavy
+// searches drain in the background.
+class RequestScheduler {
+public:
+    using Handler = std::function<JsonValue(const std::string&, const JsonValue&)>;
+    using Work = std::function<JsonValue()>;
+
+    struct Config {
+        int worker_count = 4;         // At least 2: one is always left for interactive jobs
+        size_t interactive_capacity = 256;
+        size_t bulk_capacity = 64;
+        int interactive_weight = 4;
+        int bulk_weight = 1;
+        int max_bulk_workers = 0;     // 0 means worker_count - 1; never more than that
+    };
+
+    RequestScheduler();
+    explicit RequestScheduler(const Config& config, Handler handler = nullptr);
+    ~RequestScheduler();
+
+    RequestScheduler(const RequestScheduler&) = delete;
+    RequestScheduler& operator=(const RequestScheduler&) = delete;
+
+    // Queue a request; a full queue resolves immediately to a 503 error response
+    std::future<JsonValue> submit(const std::string& endpoint, const JsonValue& request);
+    // Same, for work that is not an endpoint request
+    std::future<JsonValue> submit(RequestClass cls, Work work);
+
+    // Finish queued work and stop the workers
+    void shutdown();
+
+    size_t queued(RequestClass cls) const;
+
+private:
+    struct Job {
+        Work work;
+        std::promise<JsonValue> result;
+    };
+
+    static constexpr int CLASS_COUNT = 2;
+
+    Config config_;
+    Handler handler_;
+    std::deque<Job> queues_[CLASS_COUNT];
+    size_t capacity_[CLASS_COUNT];
+    int weight_[CLASS_COUNT];
+    int current_weight_[CLASS_COUNT] = {0, 0};
+    int bulk_running_ = 0;
+    bool stopping_ = false;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_available_;
+    std::vector<std::thread> workers_;
+
+    void worker_loop();
+    int pick_class();
+};
+
+// Runs an API request through a process-wide scheduler over
+// process_api_request, with the default config
+std::future<JsonValue> schedule_api_request(const std::string& endpoint, const JsonValue& request);
+
+#endif // REQUEST_SCHEDULER_H
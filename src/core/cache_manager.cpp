@@ -1,43 +1,299 @@
 #include "cache_manager.h"
-#include <fstream>
-#include <sstream>
+#include "../io/json_emitter.h"
+#include <cctype>
+#include <cstdlib>
 
 namespace qc::core {
 
-CacheManager::CacheManager(const std::string& cache_dir) : cache_dir(cache_dir) {
-    std::filesystem::create_directories(cache_dir);
+namespace {
+
+int64_t read_clock(const std::function<int64_t()>& clock) {
+    if (clock) return clock();
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool is_expired(int64_t expires_at, int64_t now) {
+    return expires_at != 0 && expires_at <= now;
+}
+
+} // namespace
+
+CacheManager::CacheManager(const std::string& cache_dir) : CacheManager(cache_dir, Options{}) {}
+
+CacheManager::CacheManager(const std::string& cache_dir, const Options& options)
+    : cache_dir(cache_dir),
+      options(options),
+      store(std::make_unique<ContentStore>(cache_dir, options.store)),
+      memory(options.memory_budget_bytes, options.memory_shards),
+      lru(options.memory_shards),
+      wheel(read_clock(options.clock), options.expiry_wheel_slots) {
+    // Rebuild eviction and expiry state from the store's index; entries that
+    // expired while closed land in the first sweep
+    store->for_each_entry([this](const std::string& key, uint64_t value_size, int64_t expires_at) {
+        lru.track(key, key.size() + value_size);
+        if (expires_at != 0) wheel.schedule(key, expires_at);
+    });
+    writer = std::thread(&CacheManager::writer_loop, this);
+}
+
+CacheManager::~CacheManager() {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        stopping = true;
+    }
+    pending_cv.notify_all();
+    flushed_cv.notify_all();
+    if (writer.joinable()) writer.join(); // The writer drains pending writes first
+}
+
+int64_t CacheManager::now() const {
+    return read_clock(options.clock);
 }
 
 void CacheManager::set(const std::string& key, const io::JsonValue& value) {
-    std::ofstream f(get_path(key));
-    // Simple serialization (placeholder until io::JsonEmitter implemented)
-    // For now, we'll just write a message or use a basic string builder
-    // TODO: Implement JsonEmitter
-    f << "{ \"status\": \"cached\" }"; 
+    set(key, value, options.ttl);
+}
+
+void CacheManager::set(const std::string& key, const io::JsonValue& value, std::chrono::seconds ttl) {
+    int64_t expires_at = ttl.count() > 0 ? now() + ttl.count() : 0;
+    enqueue(key, std::make_shared<const io::JsonValue>(value), expires_at);
+}
+
+bool CacheManager::remove(const std::string& key) {
+    bool existed = contains(key);
+    enqueue(key, nullptr, 0);
+    return existed;
+}
+
+void CacheManager::enqueue(const std::string& key, ValuePtr value, int64_t expires_at) {
+    PendingWrite write{std::move(value), expires_at};
+    if (!options.write_behind) {
+        std::lock_guard<std::mutex> write_lock(store_write_mutex);
+        apply_write(key, write, now());
+    }
+
+    std::unique_lock<std::mutex> lock(pending_mutex);
+    if (write.value) memory.put(key, write.value, expires_at);
+    else memory.erase(key);
+    ++enqueued_seq;
+    if (!options.write_behind) {
+        flushed_seq = enqueued_seq;
+        return;
+    }
+
+    flushed_cv.wait(lock, [&] { return stopping || pending.size() < options.max_pending || pending.count(key); });
+    auto [it, inserted] = pending.insert_or_assign(key, std::move(write));
+    (void)it;
+    if (!inserted) coalesced++;
+    if (pending.size() >= options.flush_batch_size) pending_cv.notify_one();
 }
 
 std::optional<io::JsonValue> CacheManager::get(const std::string& key) const {
-    std::string path = get_path(key);
-    if (!std::filesystem::exists(path)) return std::nullopt;
-    
-    std::ifstream f(path);
-    std::stringstream buffer;
-    buffer << f.rdbuf();
-    
-    auto res = io::JsonParser::parse(buffer.str());
-    if (std::holds_alternative<io::JsonValue>(res)) {
-        return std::get<io::JsonValue>(res);
+    int64_t now = this->now();
+    if (auto hit = memory.get(key, now)) {
+        lru.touch(key);
+        return *hit;
     }
-    return std::nullopt;
+
+    uint64_t seq;
+    uint64_t invalidated;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        for (const auto* queue : {&pending, &in_flight}) {
+            auto it = queue->find(key);
+            if (it != queue->end()) {
+                const PendingWrite& write = it->second;
+                if (!write.value || is_expired(write.expires_at, now)) return std::nullopt;
+                return *write.value;
+            }
+        }
+        seq = enqueued_seq;
+        invalidated = invalidations;
+    }
+
+    int64_t expires_at = 0;
+    auto bytes = store->get(key, now, &expires_at);
+    if (!bytes) return std::nullopt;
+    auto res = io::JsonParser::parse(*bytes);
+    if (!std::holds_alternative<io::JsonValue>(res)) return std::nullopt;
+    auto value = std::make_shared<const io::JsonValue>(std::move(std::get<io::JsonValue>(res)));
+    lru.touch(key);
+
+    // Only promote into L1 if no write, expiry or eviction raced with the disk read
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        if (enqueued_seq == seq && invalidations == invalidated) memory.put(key, value, expires_at);
+    }
+    return *value;
+}
+
+// What get() would find, from L1, the pending writes and the disk index,
+// without reading, decoding or promoting the value
+bool CacheManager::contains(const std::string& key) const {
+    int64_t now = this->now();
+    if (memory.contains(key, now)) return true;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        for (const auto* queue : {&pending, &in_flight}) {
+            auto it = queue->find(key);
+            if (it != queue->end()) return it->second.value && !is_expired(it->second.expires_at, now);
+        }
+    }
+    return store->contains(key, now);
 }
 
 void CacheManager::clear() {
-    std::filesystem::remove_all(cache_dir);
-    std::filesystem::create_directories(cache_dir);
+    std::lock_guard<std::mutex> write_lock(store_write_mutex);
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        pending.clear();
+        in_flight.clear();
+        memory.clear();
+        store->clear();
+        lru.clear();
+        wheel.clear();
+        ++enqueued_seq;
+        flushed_seq = enqueued_seq;
+    }
+    flushed_cv.notify_all();
+}
+
+void CacheManager::flush(bool durable) {
+    if (options.write_behind) {
+        std::unique_lock<std::mutex> lock(pending_mutex);
+        uint64_t target = enqueued_seq;
+        if (target > flush_requested) flush_requested = target;
+        pending_cv.notify_one();
+        flushed_cv.wait(lock, [&] { return flushed_seq >= target; });
+    }
+    if (durable) store->sync();
+}
+
+void CacheManager::sweep() {
+    std::lock_guard<std::mutex> write_lock(store_write_mutex);
+    maintain(now());
+}
+
+CacheManager::Stats CacheManager::stats() const {
+    Stats stats;
+    stats.disk = store->stats();
+    stats.memory = memory.stats();
+    stats.expired_entries = expired;
+    stats.evicted_entries = evicted;
+    stats.tracked_bytes = stats.disk.stored_bytes;
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    stats.pending_writes = pending.size();
+    stats.coalesced_writes = coalesced;
+    return stats;
+}
+
+std::optional<uint64_t> CacheManager::parse_size(const std::string& text) {
+    const char* begin = text.c_str();
+    char* end = nullptr;
+    double number = std::strtod(begin, &end);
+    if (end == begin || number < 0) return std::nullopt;
+
+    std::string unit;
+    for (const char* c = end; *c; ++c) {
+        unsigned char ch = static_cast<unsigned char>(*c);
+        if (!std::isspace(ch)) unit += static_cast<char>(std::toupper(ch));
+    }
+    static const std::pair<const char*, uint64_t> units[] = {
+        {"", 1}, {"B", 1}, {"K", 1ull << 10}, {"KB", 1ull << 10}, {"M", 1ull << 20}, {"MB", 1ull << 20},
+        {"G", 1ull << 30}, {"GB", 1ull << 30}, {"T", 1ull << 40}, {"TB", 1ull << 40},
+    };
+    for (const auto& [name, multiplier] : units) {
+        if (unit == name) return static_cast<uint64_t>(number * static_cast<double>(multiplier));
+    }
+    return std::nullopt;
 }
 
-std::string CacheManager::get_path(const std::string& key) const {
-    return cache_dir + "/" + key + ".json";
+// Caller must hold store_write_mutex
+void CacheManager::apply_write(const std::string& key, const PendingWrite& write, int64_t now) {
+    if (write.value && !is_expired(write.expires_at, now)) {
+        std::string bytes = io::JsonEmitter::emit(*write.value);
+        if (store->put(key, bytes, write.expires_at)) {
+            lru.track(key, key.size() + bytes.size());
+            if (write.expires_at != 0) wheel.schedule(key, write.expires_at);
+        }
+    } else {
+        store->remove(key);
+        lru.forget(key);
+    }
+}
+
+// Caller must hold store_write_mutex
+void CacheManager::maintain(int64_t now) {
+    std::vector<std::string> dropped = store->expire(wheel.advance(now, options.sweep_batch), now);
+    for (const auto& key : dropped) lru.forget(key);
+    expired += dropped.size();
+
+    // Victims are sized by their uncompressed values, while shared and
+    // compressed blobs free less, so keep going until the budget holds
+    while (options.max_disk_bytes != 0 && store->stored_bytes() > options.max_disk_bytes) {
+        std::vector<std::string> victims = lru.victims(store->stored_bytes() - options.max_disk_bytes);
+        if (victims.empty()) break;
+        for (const auto& key : victims) {
+            store->remove(key);
+            lru.forget(key);
+        }
+        evicted += victims.size();
+        dropped.insert(dropped.end(), victims.begin(), victims.end());
+    }
+    if (dropped.empty()) return;
+
+    // Newer values for these keys, if any, are still pending and served from there
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    for (const auto& key : dropped) memory.erase(key);
+    ++invalidations;
+}
+
+void CacheManager::writer_loop() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(pending_mutex);
+            pending_cv.wait_for(lock, options.flush_interval, [&] {
+                return stopping || pending.size() >= options.flush_batch_size || flush_requested > flushed_seq;
+            });
+            if (pending.empty()) {
+                flushed_seq = enqueued_seq;
+                flushed_cv.notify_all();
+                if (stopping) return;
+            }
+        }
+
+        // store_write_mutex is taken before pending_mutex, matching clear()
+        std::lock_guard<std::mutex> write_lock(store_write_mutex);
+        uint64_t seq = 0;
+        bool has_batch;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            has_batch = !pending.empty();
+            if (has_batch) {
+                in_flight.swap(pending);
+                seq = enqueued_seq;
+            }
+        }
+
+        if (has_batch) {
+            flushed_cv.notify_all(); // Room for writers blocked on max_pending
+
+            // in_flight is only replaced by this thread, and clear() waits on
+            // store_write_mutex, so it can be read here without pending_mutex
+            int64_t now = this->now();
+            for (const auto& [key, write] : in_flight) apply_write(key, write, now);
+
+            {
+                std::lock_guard<std::mutex> lock(pending_mutex);
+                in_flight.clear();
+                if (seq > flushed_seq) flushed_seq = seq;
+            }
+            flushed_cv.notify_all();
+        }
+
+        maintain(now());
+    }
 }
 
 } // namespace qc::core
@@ -2,22 +2,123 @@
 #define CACHE_MANAGER_V2_H
 
 #include "../io/json_parser.h"
+#include "content_store.h"
+#include "lru_index.h"
+#include "memory_cache.h"
+#include "timer_wheel.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <filesystem>
 
 namespace qc::core {
 
+// Cached JSON values in two tiers: decoded values in a sharded in-memory LRU
+// (L1) in front of a content-addressed, compressed store under cache_dir (L2),
+// where identical values share one copy on disk.
+// Writes land in L1 immediately and reach disk asynchronously: a background
+// thread coalesces pending writes per key and applies them in batches.
+//
+// Entries may carry a TTL, stored with the record on disk. Expired entries
+// read as missing straight away and are reclaimed a batch at a time from a
+// timer wheel. With a disk budget, least recently used entries are evicted
+// once the tracked key and value bytes exceed it.
 class CacheManager {
 public:
+    struct Options {
+        ContentStore::Options store;
+        size_t memory_budget_bytes = 64 * 1024 * 1024;
+        size_t memory_shards = 16;
+        bool write_behind = true;
+        std::chrono::milliseconds flush_interval{50}; // Also the expiry and eviction tick
+        size_t flush_batch_size = 256;  // Pending keys that wake the writer early
+        size_t max_pending = 8192;      // Writers block beyond this many pending keys
+        std::chrono::seconds ttl{0};    // Default entry lifetime; 0 = entries never expire
+        uint64_t max_disk_bytes = 0;    // Budget for stored keys and compressed values; 0 = unbounded
+        size_t sweep_batch = 1024;      // Most expired keys reclaimed per background tick
+        size_t expiry_wheel_slots = 4096;
+        std::function<int64_t()> clock; // Unix seconds; the system clock when empty
+    };
+
+    struct Stats {
+        ContentStore::Stats disk;
+        MemoryCache::Stats memory;
+        size_t pending_writes = 0;
+        size_t coalesced_writes = 0; // Writes superseded before reaching disk
+        size_t expired_entries = 0;  // Reclaimed by the expiry sweep
+        size_t evicted_entries = 0;  // Evicted to stay within max_disk_bytes
+        uint64_t tracked_bytes = 0;  // Stored bytes counted against max_disk_bytes
+    };
+
     CacheManager(const std::string& cache_dir = "./cache");
-    
+    CacheManager(const std::string& cache_dir, const Options& options);
+    ~CacheManager();
+
     void set(const std::string& key, const io::JsonValue& value);
+    void set(const std::string& key, const io::JsonValue& value, std::chrono::seconds ttl);
     std::optional<io::JsonValue> get(const std::string& key) const;
+    bool remove(const std::string& key);
     void clear();
 
+    // Barrier: returns once every write issued before the call is in the disk
+    // store; with `durable` the store is also synced to stable storage
+    void flush(bool durable = false);
+
+    // Run one expiry and eviction pass now instead of waiting for the
+    // background tick
+    void sweep();
+
+    Stats stats() const;
+
+    // Parses sizes such as "1GB", "500MB" or "4096" (binary units)
+    static std::optional<uint64_t> parse_size(const std::string& text);
+
 private:
+    using ValuePtr = std::shared_ptr<const io::JsonValue>;
+
+    struct PendingWrite {
+        ValuePtr value;         // nullptr marks a removal
+        int64_t expires_at = 0; // Unix seconds; 0 = never
+    };
+
     std::string cache_dir;
-    std::string get_path(const std::string& key) const;
+    Options options;
+    std::unique_ptr<ContentStore> store;
+    mutable MemoryCache memory;
+    mutable LruIndex lru;
+    TimerWheel wheel; // Guarded by store_write_mutex
+    std::atomic<size_t> expired{0};
+    std::atomic<size_t> evicted{0};
+
+    // Latest not-yet-persisted write per key
+    std::unordered_map<std::string, PendingWrite> pending;
+    std::unordered_map<std::string, PendingWrite> in_flight; // Batch being written by the writer
+    uint64_t enqueued_seq = 0;
+    uint64_t invalidations = 0; // Bumped when expiry or eviction drops L1 entries
+    uint64_t flushed_seq = 0;
+    uint64_t flush_requested = 0;
+    size_t coalesced = 0;
+    bool stopping = false;
+    mutable std::mutex pending_mutex;
+    std::condition_variable pending_cv;  // Wakes the writer
+    std::condition_variable flushed_cv;  // Wakes flush() and blocked writers
+    std::mutex store_write_mutex;        // Orders store writes, expiry and eviction against clear()
+    std::thread writer;                  // Also runs expiry and eviction, even without write-behind
+
+    int64_t now() const;
+    bool contains(const std::string& key) const;
+    void enqueue(const std::string& key, ValuePtr value, int64_t expires_at);
+    void apply_write(const std::string& key, const PendingWrite& write, int64_t now);
+    void maintain(int64_t now);
+    void writer_loop();
 };
 
 } // namespace qc::core
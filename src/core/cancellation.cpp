@@ -0,0 +1,69 @@
+#include "cancellation.h"
+
+namespace qc::core {
+
+bool CancellationToken::cancelled() const {
+    return state_ && state_->cancelled.load(std::memory_order_acquire);
+}
+
+std::string CancellationToken::reason() const {
+    if (!state_) return "";
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->reason;
+}
+
+uint64_t CancellationToken::on_cancel(std::function<void()> callback) const {
+    if (!state_) return 0;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (!state_->cancelled.load(std::memory_order_relaxed)) {
+            uint64_t id = state_->next_id++;
+            state_->callbacks.emplace(id, std::move(callback));
+            return id;
+        }
+    }
+    callback();
+    return 0;
+}
+
+void CancellationToken::remove_callback(uint64_t id) const {
+    if (!state_ || id == 0) return;
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->callbacks.erase(id);
+}
+
+CancellationSource::CancellationSource() : state_(std::make_shared<CancellationToken::State>()) {}
+
+CancellationSource::CancellationSource(const CancellationToken& parent)
+    : state_(std::make_shared<CancellationToken::State>()), parent_(parent) {
+    // The callback holds the state, not this source, so it stays safe to run
+    // while the source is being destroyed on another thread
+    std::weak_ptr<CancellationToken::State> weak = state_;
+    CancellationToken::State* parent_state = parent_.state_.get();
+    parent_callback_ = parent_.on_cancel([weak, parent_state] {
+        if (auto state = weak.lock()) cancel_state(*state, parent_state ? parent_state->reason : "");
+    });
+}
+
+CancellationSource::~CancellationSource() {
+    parent_.remove_callback(parent_callback_);
+}
+
+bool CancellationSource::cancel(const std::string& reason) {
+    return cancel_state(*state_, reason);
+}
+
+bool CancellationSource::cancel_state(CancellationToken::State& state, const std::string& reason) {
+    std::map<uint64_t, std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.cancelled.load(std::memory_order_relaxed)) return false;
+        state.reason = reason;
+        state.cancelled.store(true, std::memory_order_release);
+        callbacks.swap(state.callbacks);
+    }
+    for (auto& [id, callback] : callbacks) callback();
+    return true;
+}
+
+} // namespace qc::core
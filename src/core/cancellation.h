@@ -0,0 +1,72 @@
+#ifndef CANCELLATION_H
+#define CANCELLATION_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace qc::core {
+
+// Read side of a cooperative cancellation signal. Long-running work polls
+// cancelled() or registers a callback; nothing is interrupted by force. A
+// default-constructed token is never cancelled.
+class CancellationToken {
+public:
+    CancellationToken() = default;
+
+    bool cancelled() const;
+    std::string reason() const;
+
+    // Runs `callback` once when the token is cancelled, on the cancelling
+    // thread, or right away if it already is. Returns an id for
+    // remove_callback(); 0 when the callback already ran or never can.
+    uint64_t on_cancel(std::function<void()> callback) const;
+    void remove_callback(uint64_t id) const;
+
+private:
+    friend class CancellationSource;
+
+    struct State {
+        std::atomic<bool> cancelled{false};
+        std::mutex mutex;
+        std::string reason;
+        std::map<uint64_t, std::function<void()>> callbacks;
+        uint64_t next_id = 1;
+    };
+
+    explicit CancellationToken(std::shared_ptr<State> state) : state_(std::move(state)) {}
+
+    std::shared_ptr<State> state_;
+};
+
+// Write side. A source made from a parent token is cancelled along with it,
+// which is how a workflow-wide cancel reaches every operation in flight.
+class CancellationSource {
+public:
+    CancellationSource();
+    explicit CancellationSource(const CancellationToken& parent);
+    ~CancellationSource();
+
+    CancellationSource(const CancellationSource&) = delete;
+    CancellationSource& operator=(const CancellationSource&) = delete;
+
+    CancellationToken token() const { return CancellationToken(state_); }
+
+    // True for the call that actually cancelled; callbacks run before it returns
+    bool cancel(const std::string& reason);
+
+private:
+    std::shared_ptr<CancellationToken::State> state_;
+    CancellationToken parent_;
+    uint64_t parent_callback_ = 0;
+
+    static bool cancel_state(CancellationToken::State& state, const std::string& reason);
+};
+
+} // namespace qc::core
+
+#endif // CANCELLATION_H
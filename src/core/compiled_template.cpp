@@ -0,0 +1,173 @@
+#include "compiled_template.h"
+#include "expression.h"
+#include <cstdlib>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace qc::core {
+
+namespace {
+
+// Templates come from configuration, so there are few distinct ones; the
+// bound only matters if callers build template strings from data
+constexpr size_t kMaxCachedTemplates = 4096;
+
+struct Registry {
+    std::shared_mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<const CompiledTemplate>> templates;
+    std::mutex environment_mutex;
+    std::unordered_map<std::string, std::optional<std::string>> environment;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+} // namespace
+
+CompiledTemplate::CompiledTemplate(std::string_view text) {
+    auto literal = [&](std::string_view part) {
+        if (part.empty()) return;
+        if (segments_.empty() || segments_.back().kind != Kind::LITERAL) segments_.push_back(Segment{});
+        segments_.back().text.append(part);
+        literal_size_ += part.size();
+    };
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t open = text.find("${", pos);
+        size_t close = open == std::string_view::npos ? open : text.find('}', open + 2);
+        if (close == std::string_view::npos) {
+            literal(text.substr(pos));
+            break;
+        }
+        std::string_view inner = text.substr(open + 2, close - open - 2);
+        size_t colon = inner.find(':');
+        if (colon == std::string_view::npos) {
+            literal(text.substr(pos, close + 1 - pos));
+            pos = close + 1;
+            continue;
+        }
+        literal(text.substr(pos, open - pos));
+
+        Segment segment;
+        segment.text = std::string(inner);
+        std::string_view kind = inner.substr(0, colon);
+        std::string_view argument = inner.substr(colon + 1);
+        segment.name = std::string(argument);
+        if (kind == "ENV") {
+            segment.kind = Kind::ENV;
+            if (auto value = environment(segment.name)) segment.fallback = std::move(*value);
+        } else if (kind == "CONFIG") {
+            segment.kind = Kind::CONFIG;
+            size_t pipe = argument.find('|');
+            if (pipe != std::string_view::npos) {
+                segment.name = std::string(argument.substr(0, pipe));
+                segment.fallback = std::string(argument.substr(pipe + 1));
+            }
+        } else if (kind == "INPUT") {
+            segment.kind = Kind::INPUT;
+        } else if (kind == "CALC") {
+            segment.kind = Kind::CALC;
+        } else {
+            segment.kind = Kind::OTHER;
+        }
+        segments_.push_back(std::move(segment));
+        ++placeholders_;
+        pos = close + 1;
+    }
+}
+
+std::shared_ptr<const CompiledTemplate> CompiledTemplate::get(const std::string& text) {
+    Registry& cache = registry();
+    {
+        std::shared_lock<std::shared_mutex> lock(cache.mutex);
+        auto it = cache.templates.find(text);
+        if (it != cache.templates.end()) return it->second;
+    }
+    auto compiled = std::make_shared<const CompiledTemplate>(text);
+    std::unique_lock<std::shared_mutex> lock(cache.mutex);
+    if (cache.templates.size() >= kMaxCachedTemplates) cache.templates.clear();
+    return cache.templates.emplace(text, std::move(compiled)).first->second;
+}
+
+void CompiledTemplate::clear_cache() {
+    Registry& cache = registry();
+    {
+        std::unique_lock<std::shared_mutex> lock(cache.mutex);
+        cache.templates.clear();
+    }
+    std::lock_guard<std::mutex> lock(cache.environment_mutex);
+    cache.environment.clear();
+}
+
+size_t CompiledTemplate::cached_templates() {
+    Registry& cache = registry();
+    std::shared_lock<std::shared_mutex> lock(cache.mutex);
+    return cache.templates.size();
+}
+
+std::optional<std::string> CompiledTemplate::environment(const std::string& name) {
+    Registry& cache = registry();
+    std::lock_guard<std::mutex> lock(cache.environment_mutex);
+    auto it = cache.environment.find(name);
+    if (it == cache.environment.end()) {
+        const char* value = std::getenv(name.c_str());
+        it = cache.environment.emplace(name, value ? std::optional<std::string>(value) : std::nullopt).first;
+    }
+    return it->second;
+}
+
+std::string CompiledTemplate::render(const std::map<std::string, std::string>& context) const {
+    // Look every placeholder up once, then append into a buffer of the exact size
+    std::vector<const std::string*> values(segments_.size(), nullptr);
+    std::vector<std::string> calculated;
+    size_t size = literal_size_;
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        const Segment& segment = segments_[i];
+        const std::string* value = nullptr;
+        switch (segment.kind) {
+            case Kind::LITERAL:
+                continue;
+            case Kind::ENV:
+                value = &segment.fallback;
+                break;
+            case Kind::CONFIG: {
+                auto it = context.find(segment.name);
+                value = it != context.end() ? &it->second : &segment.fallback;
+                break;
+            }
+            case Kind::INPUT: {
+                auto it = context.find(segment.name);
+                if (it != context.end()) value = &it->second;
+                break;
+            }
+            case Kind::CALC: {
+                static const std::map<std::string, SharedJson> nothing;
+                if (calculated.empty()) calculated.reserve(segments_.size());
+                calculated.push_back(Expression::get(segment.name)->calculate(Expression::MapScope(nothing)));
+                value = &calculated.back();
+                break;
+            }
+            case Kind::OTHER:
+                break;
+        }
+        values[i] = value;
+        if (value) size += value->size();
+    }
+
+    std::string result;
+    result.reserve(size);
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        if (segments_[i].kind == Kind::LITERAL) {
+            result += segments_[i].text;
+        } else if (values[i]) {
+            result += *values[i];
+        }
+    }
+    return result;
+}
+
+} // namespace qc::core
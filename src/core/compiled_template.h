@@ -0,0 +1,61 @@
+#ifndef COMPILED_TEMPLATE_H
+#define COMPILED_TEMPLATE_H
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qc::core {
+
+// A "${KIND:argument}" template string split once into literal text and
+// placeholders, so resolving it is a single pass that appends each segment
+// into a buffer sized up front. Compiled templates are shared through a
+// process-wide cache keyed by the template text.
+//
+// ENV placeholders are looked up when the template is compiled, through a
+// cache of the environment; clear_cache() picks up later setenv() calls.
+// A placeholder without a ':' is not one and stays literal text.
+class CompiledTemplate {
+public:
+    enum class Kind { LITERAL, ENV, CONFIG, INPUT, CALC, OTHER };
+
+    struct Segment {
+        Kind kind = Kind::LITERAL;
+        std::string text;     // Literal text, or the placeholder between "${" and "}"
+        std::string name;     // Text after the first ':'; for CONFIG, up to the '|'
+        std::string fallback; // CONFIG default after the '|', or the ENV variable's value
+    };
+
+    explicit CompiledTemplate(std::string_view text);
+
+    // The compiled form of `text`, compiled on first use
+    static std::shared_ptr<const CompiledTemplate> get(const std::string& text);
+    // Forget compiled templates and cached environment variables
+    static void clear_cache();
+    static size_t cached_templates();
+
+    // CONFIG and INPUT names are looked up in `context`; CONFIG falls back
+    // to its default. CALC sees only the clock values, and other kinds
+    // render empty.
+    std::string render(const std::map<std::string, std::string>& context) const;
+
+    const std::vector<Segment>& segments() const { return segments_; }
+    bool has_placeholders() const { return placeholders_ > 0; }
+    // The whole text is one placeholder, so it can resolve to a non-string
+    bool is_single_placeholder() const { return placeholders_ == 1 && segments_.size() == 1; }
+
+private:
+    std::vector<Segment> segments_;
+    size_t literal_size_ = 0;
+    size_t placeholders_ = 0;
+
+    static std::optional<std::string> environment(const std::string& name);
+};
+
+} // namespace qc::core
+
+#endif // COMPILED_TEMPLATE_H
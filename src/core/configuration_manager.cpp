@@ -0,0 +1,342 @@
+#include "flexible_json_logic.h"
+#include "expression.h"
+#include "json_bridge.h"
+#include "parameter_plan.h"
+#include "workflow_plan.h"
+#include "../io/file_io.h"
+#include <set>
+
+namespace {
+
+const JsonValue* member(const JsonValue& object, const std::string& name) {
+    if (object.type != JsonValue::OBJECT) return nullptr;
+    auto it = object.object_value.find(name);
+    return it == object.object_value.end() ? nullptr : &it->second;
+}
+
+std::string string_member(const JsonValue& object, const std::string& name, const std::string& fallback = "") {
+    const JsonValue* value = member(object, name);
+    return value && value->type == JsonValue::STRING ? value->string_value : fallback;
+}
+
+bool parse_operation_type(const std::string& name, OperationType& type) {
+    if (name.empty() || name == "endpoint") type = OperationType::ENDPOINT_CALL;
+    else if (name == "custom" || name == "processor") type = OperationType::CUSTOM_PROCESSOR;
+    else if (name == "merge") type = OperationType::MERGE;
+    else if (name == "filter") type = OperationType::FILTER;
+    else if (name == "transform") type = OperationType::TRANSFORM;
+    else return false;
+    return true;
+}
+
+JsonValue output_reference(const std::string& output_key) {
+    return JsonValue::makeString("${REF:" + output_key + "}");
+}
+
+bool parse_operation(const JsonValue& def, WorkflowOperation& operation) {
+    if (def.type != JsonValue::OBJECT) return false;
+    operation.name = string_member(def, "name");
+    if (!parse_operation_type(string_member(def, "type"), operation.type)) return false;
+    operation.endpoint = string_member(def, "endpoint");
+    operation.data_source = string_member(def, "data_source");
+    operation.processor = string_member(def, "processor");
+    operation.output_key = string_member(def, "output_key");
+    operation.condition = string_member(def, "condition");
+
+    const JsonValue* parameters = member(def, "parameters");
+    operation.parameters = parameters ? *parameters : JsonValue::makeObject();
+    if (const JsonValue* cache = member(def, "cache")) operation.cache_config = *cache;
+    if (const JsonValue* fallback = member(def, "fallback")) operation.fallback_config = *fallback;
+    const JsonValue* timeout = member(def, "timeout_seconds");
+    if (!timeout) timeout = member(def, "timeout");
+    if (timeout && timeout->type == JsonValue::NUMBER) operation.timeout_seconds = timeout->number_value;
+
+    // Filter and merge name their inputs outside "parameters"; fold them in as
+    // output references so they resolve, and order the plan, like any other
+    if (operation.parameters.type != JsonValue::OBJECT) return false;
+    auto& params = operation.parameters.object_value;
+    if (operation.type == OperationType::FILTER) {
+        std::string input = string_member(def, "input");
+        if (!input.empty()) params["input"] = output_reference(input);
+        if (const JsonValue* criteria = member(def, "criteria")) params["criteria"] = *criteria;
+    } else if (operation.type == OperationType::MERGE) {
+        if (const JsonValue* inputs = member(def, "inputs")) {
+            if (inputs->type != JsonValue::ARRAY) return false;
+            JsonValue references = JsonValue::makeObject();
+            for (const auto& input : inputs->array_value) {
+                if (input.type != JsonValue::STRING) return false;
+                references.object_value[input.string_value] = output_reference(input.string_value);
+            }
+            params["inputs"] = references;
+        }
+        std::string strategy = string_member(def, "merge_strategy");
+        if (!strategy.empty()) params["strategy"] = JsonValue::makeString(strategy);
+    }
+    return true;
+}
+
+} // namespace
+
+ConfigurationManager::ConfigurationManager()
+    : config_(JsonValue::makeObject()),
+      parameter_templates_(JsonValue::makeObject()),
+      validation_rules_(JsonValue::makeObject()) {}
+
+// Blocking calls a run left behind when it timed out must not outlive
+// their source
+ConfigurationManager::~ConfigurationManager() {
+    for (auto& [name, source] : data_sources_) source->closeBlockingCalls();
+}
+
+bool ConfigurationManager::loadConfiguration(const std::string& config_path) {
+    auto file = qc::io::MappedFile::open(config_path);
+    if (!file) return false;
+    // The legacy parser has no arrays, so read with the io parser and convert
+    auto parsed = qc::io::JsonParser::parse(std::string(file->view()));
+    if (!std::holds_alternative<qc::io::JsonValue>(parsed)) return false;
+    return loadConfigurationFromJson(qc::core::from_io(std::get<qc::io::JsonValue>(parsed)));
+}
+
+bool ConfigurationManager::loadConfigurationFromJson(const JsonValue& config) {
+    if (config.type != JsonValue::OBJECT) return false;
+    config_ = config;
+    if (const JsonValue* templates = member(config, "parameter_templates")) parameter_templates_ = *templates;
+    if (const JsonValue* rules = member(config, "validation_rules")) validation_rules_ = *rules;
+    initializeDataSources();
+    compileParameterPlans();
+
+    bool loaded = true;
+    if (const JsonValue* workflows = member(config, "workflows")) {
+        for (const auto& [name, def] : workflows->object_value) loaded = loadWorkflow(name, def) && loaded;
+    }
+    return loaded;
+}
+
+// Sources registered by the application take precedence over the config.
+// Only the cache source can be built from the config alone; the other types
+// are left for the application to register, the database source with its
+// driver's connector.
+void ConfigurationManager::initializeDataSources() {
+    const JsonValue* sources = member(config_, "data_sources");
+    if (!sources) return;
+    for (const auto& [name, def] : sources->object_value) {
+        if (data_sources_.count(name)) continue;
+        if (string_member(def, "type") == "cache") data_sources_[name] = std::make_unique<CacheDataSource>(def);
+    }
+}
+
+bool ConfigurationManager::registerDataSource(const std::string& name, std::unique_ptr<DataSource> source) {
+    if (name.empty() || !source) return false;
+    auto& slot = data_sources_[name];
+    if (slot) slot->closeBlockingCalls();
+    slot = std::move(source);
+    return true;
+}
+
+DataSource* ConfigurationManager::getDataSource(const std::string& name) const {
+    auto it = data_sources_.find(name);
+    return it == data_sources_.end() ? nullptr : it->second.get();
+}
+
+std::vector<std::string> ConfigurationManager::getAvailableDataSources() const {
+    std::vector<std::string> names;
+    for (const auto& [name, source] : data_sources_) {
+        if (source->isAvailable()) names.push_back(name);
+    }
+    return names;
+}
+
+bool ConfigurationManager::registerProcessor(const std::string& name, std::unique_ptr<DataProcessor> processor) {
+    if (name.empty() || !processor) return false;
+    processors_[name] = std::move(processor);
+    return true;
+}
+
+DataProcessor* ConfigurationManager::getProcessor(const std::string& name) const {
+    auto it = processors_.find(name);
+    return it == processors_.end() ? nullptr : it->second.get();
+}
+
+JsonValue ConfigurationManager::getProcessorConfig(const std::string& name) const {
+    if (const JsonValue* processors = member(config_, "data_processors")) {
+        if (const JsonValue* config = member(*processors, name)) return *config;
+    }
+    return JsonValue::makeObject();
+}
+
+JsonValue ConfigurationManager::getCachingConfig() const {
+    const JsonValue* caching = member(config_, "caching");
+    return caching ? *caching : JsonValue::makeObject();
+}
+
+// Each endpoint's plan covers the parameters its definitions name: the
+// "parameters" of the workflow operations that call it and of the database
+// query it runs. A parameter named by a parameter template, or by one of its
+// aliases, takes that template; so "gene" accepts "geneId", "gene_ids" or
+// "symbols" too, and "evidence_level" maps "moderate" to "medium".
+//
+// "endpoints" can give schemas outright, as an object of them or the way
+// the API description lists them: [{"name": ..., "parameters": ...}]. They
+// replace the derived plans.
+void ConfigurationManager::compileParameterPlans() {
+    parameter_plans_.clear();
+    std::map<std::string, std::string> values = configValues();
+
+    // Template name, by every name that refers to it
+    std::map<std::string, std::string> templates;
+    for (const auto& [name, definition] : parameter_templates_.object_value) {
+        if (const JsonValue* aliases = member(definition, "aliases")) {
+            for (const auto& alias : aliases->array_value) {
+                if (alias.type == JsonValue::STRING) templates.emplace(alias.string_value, name);
+            }
+        }
+    }
+    std::map<std::string, JsonValue> schemas;
+    auto take = [&](const std::string& endpoint, const std::string& parameter) {
+        auto found = templates.find(parameter);
+        if (endpoint.empty() || found == templates.end()) return;
+        auto schema = schemas.try_emplace(endpoint, JsonValue::makeObject()).first;
+        JsonValue property = JsonValue::makeObject();
+        property.object_value["$ref"] = JsonValue::makeString("#/parameter_templates/" + found->second);
+        schema->second.object_value.emplace(parameter, std::move(property));
+    };
+    auto take_operation = [&](const JsonValue& operation) {
+        const JsonValue* parameters = member(operation, "parameters");
+        if (!parameters) return;
+        std::string endpoint = string_member(operation, "endpoint");
+        for (const auto& [parameter, value] : parameters->object_value) take(endpoint, parameter);
+    };
+    if (const JsonValue* workflows = member(config_, "workflows")) {
+        for (const auto& [name, workflow] : workflows->object_value) {
+            const JsonValue* steps = member(workflow, "steps");
+            if (!steps) continue;
+            for (const auto& step : steps->array_value) {
+                const JsonValue* operations = member(step, "operations");
+                if (!operations) take_operation(step);
+                else for (const auto& operation : operations->array_value) take_operation(operation);
+            }
+        }
+    }
+    if (const JsonValue* sources = member(config_, "data_sources")) {
+        for (const auto& [name, source] : sources->object_value) {
+            const JsonValue* queries = member(source, "queries");
+            if (!queries) continue;
+            for (const auto& [endpoint, query] : queries->object_value) {
+                const JsonValue* parameters = member(query, "parameters");
+                if (!parameters) continue;
+                for (const auto& parameter : parameters->array_value) {
+                    if (parameter.type == JsonValue::STRING) take(endpoint, parameter.string_value);
+                }
+            }
+        }
+    }
+
+    auto compile = [&](const std::string& name, const JsonValue& schema) {
+        if (!name.empty()) parameter_plans_[name] = qc::core::ParameterPlan::compile(schema, parameter_templates_, values);
+    };
+    for (const auto& [name, schema] : schemas) compile(name, schema);
+    const JsonValue* endpoints = member(config_, "endpoints");
+    if (!endpoints) return;
+    for (const auto& endpoint : endpoints->array_value) {
+        const JsonValue* parameters = member(endpoint, "parameters");
+        compile(string_member(endpoint, "name"), parameters ? *parameters : endpoint);
+    }
+    for (const auto& [name, schema] : endpoints->object_value) compile(name, schema);
+}
+
+// Top-level settings, for ${CONFIG:} placeholders in parameter defaults
+std::map<std::string, std::string> ConfigurationManager::configValues() const {
+    std::map<std::string, std::string> values;
+    for (const auto& [key, value] : config_.object_value) {
+        if (value.type == JsonValue::STRING) {
+            values[key] = value.string_value;
+        } else if (value.type == JsonValue::NUMBER || value.type == JsonValue::BOOL) {
+            values[key] = value.serialize();
+        }
+    }
+    return values;
+}
+
+JsonValue ConfigurationManager::resolveParameters(const std::string& endpoint, JsonValue input_params) const {
+    auto plan = parameter_plans_.find(endpoint);
+    if (plan == parameter_plans_.end()) return input_params;
+    return plan->second->apply(std::move(input_params));
+}
+
+JsonValue ConfigurationManager::transformParameters(const JsonValue& params, const JsonValue& template_def) const {
+    return qc::core::ParameterPlan::compile(template_def, parameter_templates_, configValues())->apply(params);
+}
+
+// A step without "operations" is a single operation, as in quick lookups
+bool ConfigurationManager::loadWorkflow(const std::string& name, const JsonValue& workflow_def) {
+    if (workflow_def.type != JsonValue::OBJECT) return false;
+    Workflow workflow;
+    workflow.name = name;
+    workflow.description = string_member(workflow_def, "description");
+    if (const JsonValue* schema = member(workflow_def, "input_schema")) workflow.input_schema = *schema;
+    if (const JsonValue* schema = member(workflow_def, "output_schema")) workflow.output_schema = *schema;
+    if (const JsonValue* handling = member(workflow_def, "error_handling")) workflow.error_handling = *handling;
+
+    const JsonValue* timeout = member(workflow.error_handling, "global_timeout");
+    if (!timeout) timeout = member(workflow_def, "timeout");
+    if (timeout && timeout->type == JsonValue::NUMBER) workflow.global_timeout = timeout->number_value;
+
+    const JsonValue* steps = member(workflow_def, "steps");
+    if (!steps || steps->type != JsonValue::ARRAY) return false;
+    for (const auto& step_def : steps->array_value) {
+        WorkflowStep step;
+        step.name = string_member(step_def, "name");
+        step.execution_type = string_member(step_def, "type", string_member(step_def, "execution_type", "sequential"));
+        if (const JsonValue* handling = member(step_def, "error_handling")) step.error_handling = *handling;
+
+        const JsonValue* operations = member(step_def, "operations");
+        if (operations) {
+            if (operations->type != JsonValue::ARRAY) return false;
+            step.condition = string_member(step_def, "condition");
+            for (const auto& operation_def : operations->array_value) {
+                WorkflowOperation operation;
+                if (!parse_operation(operation_def, operation)) return false;
+                step.operations.push_back(std::move(operation));
+            }
+        } else {
+            WorkflowOperation operation;
+            if (!parse_operation(step_def, operation)) return false;
+            step.operations.push_back(std::move(operation));
+        }
+        workflow.steps.push_back(std::move(step));
+    }
+
+    if (!validateWorkflow(workflow)) return false;
+    workflow.plan = qc::core::WorkflowPlan::build(workflow);
+    workflows_[name] = std::move(workflow);
+    return true;
+}
+
+Workflow ConfigurationManager::getWorkflow(const std::string& name) const {
+    auto it = workflows_.find(name);
+    return it == workflows_.end() ? Workflow() : it->second;
+}
+
+std::vector<std::string> ConfigurationManager::getAvailableWorkflows() const {
+    std::vector<std::string> names;
+    for (const auto& [name, workflow] : workflows_) names.push_back(name);
+    return names;
+}
+
+bool ConfigurationManager::validateWorkflow(const Workflow& workflow) const {
+    if (workflow.steps.empty()) return false;
+    std::set<std::string> names;
+    auto parses = [](const std::string& condition) {
+        return condition.empty() || qc::core::Expression::get(condition)->valid();
+    };
+    for (const auto& step : workflow.steps) {
+        if (step.operations.empty() || !parses(step.condition)) return false;
+        for (const auto& operation : step.operations) {
+            if (!parses(operation.condition)) return false;
+            if (operation.name.empty() || !names.insert(operation.name).second) return false;
+            if (operation.type == OperationType::ENDPOINT_CALL && operation.endpoint.empty()) return false;
+            if (operation.type == OperationType::CUSTOM_PROCESSOR && operation.processor.empty()) return false;
+        }
+    }
+    return qc::core::WorkflowPlan::build(workflow) != nullptr;
+}
@@ -0,0 +1,199 @@
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace qc::core {
+
+// A bounded set of open connections, lent out one caller at a time. Up to
+// max_connections are open at once; min_connections are opened up front.
+// A caller finding none idle opens another while under the bound, and
+// otherwise waits up to acquire_timeout for one to come back.
+//
+// Idle connections are reused most recently returned first, so the warm
+// ones stay warm. One that sat idle for check_after or longer is checked
+// before it is lent again, and replaced if the check fails; one a caller
+// found broken is closed rather than returned.
+template <typename Connection>
+class ConnectionPool {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Open = std::function<std::unique_ptr<Connection>()>; // Null when it cannot connect
+    using Check = std::function<bool(Connection&)>;
+
+    struct Options {
+        size_t min_connections = 1;
+        size_t max_connections = 4;
+        Clock::duration acquire_timeout = std::chrono::seconds(30);
+        Clock::duration check_after = std::chrono::seconds(5);
+    };
+
+    struct Stats {
+        size_t open = 0;      // Lent out or idle
+        size_t idle = 0;
+        size_t opened = 0;    // Over the pool's lifetime
+        size_t discarded = 0; // Failed a check or came back broken
+        Clock::time_point last_active{}; // A connection last lent out or returned
+    };
+
+    // A connection on loan, returned when the lease goes
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept
+            : pool_(std::exchange(other.pool_, nullptr)), connection_(std::move(other.connection_)) {}
+        Lease& operator=(Lease&& other) noexcept {
+            if (this != &other) {
+                release(false);
+                pool_ = std::exchange(other.pool_, nullptr);
+                connection_ = std::move(other.connection_);
+            }
+            return *this;
+        }
+        ~Lease() { release(false); }
+
+        explicit operator bool() const { return connection_ != nullptr; }
+        Connection& operator*() const { return *connection_; }
+        Connection* operator->() const { return connection_.get(); }
+
+        // Closes the connection instead of returning it
+        void discard() { release(true); }
+
+    private:
+        friend class ConnectionPool;
+        Lease(ConnectionPool* pool, std::unique_ptr<Connection> connection)
+            : pool_(pool), connection_(std::move(connection)) {}
+
+        void release(bool broken) {
+            if (pool_ && connection_) pool_->give_back(std::move(connection_), broken);
+            pool_ = nullptr;
+            connection_.reset();
+        }
+
+        ConnectionPool* pool_ = nullptr;
+        std::unique_ptr<Connection> connection_;
+    };
+
+    ConnectionPool(Open open, Check check, Options options)
+        : open_(std::move(open)), check_(std::move(check)), options_(options) {
+        if (options_.max_connections == 0) options_.max_connections = 1;
+        size_t warm = std::min(options_.min_connections, options_.max_connections);
+        for (size_t i = 0; i < warm; ++i) {
+            std::unique_ptr<Connection> connection = open_();
+            if (!connection) break;
+            idle_.push_back(Idle{std::move(connection), Clock::now()});
+            ++open_count_;
+            ++opened_;
+        }
+    }
+    // Every lease must have been returned
+    ~ConnectionPool() = default;
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Empty when no connection could be opened, or none came back in time
+    Lease acquire() { return lend(true); }
+    // Never waits: empty when every connection is lent out at the bound
+    Lease try_acquire() { return lend(false); }
+
+    const Options& options() const { return options_; }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats stats;
+        stats.open = open_count_;
+        stats.idle = idle_.size();
+        stats.opened = opened_;
+        stats.discarded = discarded_;
+        stats.last_active = last_active_;
+        return stats;
+    }
+
+private:
+    struct Idle {
+        std::unique_ptr<Connection> connection;
+        Clock::time_point since;
+    };
+
+    Lease lend(bool wait) {
+        Clock::time_point deadline = Clock::now() + options_.acquire_timeout;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            while (!idle_.empty()) {
+                Idle entry = std::move(idle_.back());
+                idle_.pop_back();
+                if (Clock::now() - entry.since < options_.check_after) return lent(std::move(entry.connection));
+
+                lock.unlock();
+                bool healthy = !check_ || check_(*entry.connection);
+                if (!healthy) entry.connection.reset();
+                lock.lock();
+                if (healthy) return lent(std::move(entry.connection));
+                --open_count_;
+                ++discarded_;
+            }
+
+            if (open_count_ < options_.max_connections) {
+                ++open_count_;
+                lock.unlock();
+                std::unique_ptr<Connection> connection = open_();
+                lock.lock();
+                if (connection) {
+                    ++opened_;
+                    return lent(std::move(connection));
+                }
+                --open_count_;
+                available_.notify_one();
+                return Lease();
+            }
+
+            if (!wait) return Lease();
+            if (available_.wait_until(lock, deadline) == std::cv_status::timeout && idle_.empty() &&
+                open_count_ >= options_.max_connections) {
+                return Lease();
+            }
+        }
+    }
+
+    // Called with the lock held
+    Lease lent(std::unique_ptr<Connection> connection) {
+        last_active_ = Clock::now();
+        return Lease(this, std::move(connection));
+    }
+
+    void give_back(std::unique_ptr<Connection> connection, bool broken) {
+        if (broken) connection.reset(); // Closed outside the lock
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (broken) {
+            --open_count_;
+            ++discarded_;
+        } else {
+            last_active_ = Clock::now();
+            idle_.push_back(Idle{std::move(connection), last_active_});
+        }
+        available_.notify_one();
+    }
+
+    Open open_;
+    Check check_;
+    Options options_;
+    mutable std::mutex mutex_;
+    std::condition_variable available_;
+    std::vector<Idle> idle_; // Most recently returned at the back
+    size_t open_count_ = 0;
+    size_t opened_ = 0;
+    size_t discarded_ = 0;
+    Clock::time_point last_active_{};
+};
+
+} // namespace qc::core
+
+#endif // CONNECTION_POOL_H
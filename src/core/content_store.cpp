@@ -0,0 +1,267 @@
+#include "content_store.h"
+#include "digest.h"
+#include "../io/lz_codec.h"
+#include <mutex>
+
+namespace qc::core {
+
+namespace {
+
+// Record keys: "k/" + user key -> digest; "b/" + digest -> codec byte + payload
+const char* KEY_PREFIX = "k/";
+const char* BLOB_PREFIX = "b/";
+const size_t PREFIX_SIZE = 2;
+const char CODEC_RAW = 0;
+const char CODEC_LZ = 1;
+
+std::string key_record(const std::string& key) { return KEY_PREFIX + key; }
+std::string blob_record(const std::string& digest) { return BLOB_PREFIX + digest; }
+
+} // namespace
+
+ContentStore::ContentStore(const std::string& dir) : ContentStore(dir, Options{}) {}
+
+ContentStore::ContentStore(const std::string& dir, const Options& options)
+    : options_(options) {
+    if (options.backend == Options::Backend::FILE_PER_KEY) {
+        records_ = std::make_unique<FileStore>(dir, options.files);
+    } else {
+        records_ = std::make_unique<LogStore>(dir, options.log);
+    }
+    rebuild();
+}
+
+std::string ContentStore::digest(std::string_view data) {
+    return digest128(data);
+}
+
+std::string ContentStore::encode_blob(const std::string& value) const {
+    if (options_.compress) {
+        std::string packed = io::LzCodec::compress(value);
+        if (packed.size() < value.size()) return CODEC_LZ + packed;
+    }
+    return CODEC_RAW + value;
+}
+
+std::optional<std::string> ContentStore::decode_blob(std::string_view blob) {
+    if (blob.empty()) return std::nullopt;
+    if (blob[0] == CODEC_RAW) return std::string(blob.substr(1));
+    if (blob[0] == CODEC_LZ) return io::LzCodec::decompress(blob.substr(1));
+    return std::nullopt;
+}
+
+std::optional<uint64_t> ContentStore::blob_raw_size(std::string_view blob) {
+    if (blob.empty()) return std::nullopt;
+    if (blob[0] == CODEC_RAW) return blob.size() - 1;
+    if (blob[0] == CODEC_LZ) return io::LzCodec::decompressed_size(blob.substr(1));
+    return std::nullopt;
+}
+
+void ContentStore::rebuild() {
+    std::vector<std::string> dangling;
+    records_->scan([&](const std::string& record, std::string_view value, int64_t expires_at) {
+        if (record.compare(0, PREFIX_SIZE, KEY_PREFIX) == 0 && value.size() == DIGEST_SIZE) {
+            keys_[record.substr(PREFIX_SIZE)] = {std::string(value), expires_at};
+            return;
+        }
+        if (record.compare(0, PREFIX_SIZE, BLOB_PREFIX) == 0 && record.size() == PREFIX_SIZE + DIGEST_SIZE) {
+            if (auto raw_size = blob_raw_size(value)) {
+                blobs_[record.substr(PREFIX_SIZE)] = {0, value.size(), *raw_size};
+                return;
+            }
+        }
+        dangling.push_back(record); // Malformed, or written before values were content-addressed
+    });
+
+    for (auto it = keys_.begin(); it != keys_.end();) {
+        auto blob = blobs_.find(it->second.digest);
+        if (blob == blobs_.end()) {
+            dangling.push_back(key_record(it->first));
+            it = keys_.erase(it);
+            continue;
+        }
+        blob->second.refs++;
+        logical_bytes_ += it->first.size() + blob->second.raw_size;
+        stored_bytes_ += it->first.size() + DIGEST_SIZE;
+        ++it;
+    }
+    for (auto it = blobs_.begin(); it != blobs_.end();) {
+        if (it->second.refs == 0) {
+            dangling.push_back(blob_record(it->first));
+            it = blobs_.erase(it);
+        } else {
+            stored_bytes_ += DIGEST_SIZE + it->second.stored_size;
+            ++it;
+        }
+    }
+    for (const auto& record : dangling) records_->remove(record);
+}
+
+bool ContentStore::put(const std::string& key, const std::string& value, int64_t expires_at) {
+    // Hash and compress before taking the lock; compression only matters if
+    // the blob turns out to be new, which is the common case for a fresh key
+    std::string id = digest(value);
+    std::string blob;
+    bool verified = false;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto found = blobs_.find(id);
+        if (found == blobs_.end()) {
+            blob = encode_blob(value);
+        } else if (!holds(found->first, found->second, value)) {
+            return false; // A different value with the same digest; it cannot be stored
+        } else {
+            verified = true;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto found = blobs_.find(id);
+    // Stored since the check above
+    if (found != blobs_.end() && !verified && !holds(found->first, found->second, value)) return false;
+
+    auto existing = keys_.find(key);
+    if (existing != keys_.end() && existing->second.digest == id && existing->second.expires_at == expires_at) {
+        deduplicated_++;
+        return true; // Nothing to write
+    }
+
+    if (found == blobs_.end()) {
+        if (blob.empty()) blob = encode_blob(value); // Removed since the check above
+        if (!records_->put(blob_record(id), blob)) return false;
+        found = blobs_.emplace(id, Blob{0, blob.size(), value.size()}).first;
+        stored_bytes_ += DIGEST_SIZE + blob.size();
+    } else {
+        deduplicated_++;
+    }
+
+    // The blob is written before any key refers to it
+    if (!records_->put(key_record(key), id, expires_at)) {
+        if (found->second.refs == 0) release(id);
+        return false;
+    }
+    found->second.refs++;
+    logical_bytes_ += key.size() + value.size();
+
+    if (existing != keys_.end()) {
+        std::string old_digest = existing->second.digest;
+        existing->second = {id, expires_at};
+        logical_bytes_ -= key.size() + blobs_.at(old_digest).raw_size;
+        release(old_digest);
+    } else {
+        keys_.emplace(key, KeyEntry{id, expires_at});
+        stored_bytes_ += key.size() + DIGEST_SIZE;
+    }
+    return true;
+}
+
+std::optional<std::string> ContentStore::get(const std::string& key, int64_t now, int64_t* expires_at) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = keys_.find(key);
+    if (it == keys_.end()) return std::nullopt;
+    if (it->second.expires_at != 0 && it->second.expires_at <= now) return std::nullopt;
+
+    auto blob = records_->get(blob_record(it->second.digest), now);
+    if (!blob) return std::nullopt;
+    if (expires_at) *expires_at = it->second.expires_at;
+    return decode_blob(*blob);
+}
+
+bool ContentStore::contains(const std::string& key, int64_t now) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = keys_.find(key);
+    return it != keys_.end() && (it->second.expires_at == 0 || it->second.expires_at > now);
+}
+
+bool ContentStore::remove(const std::string& key) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = keys_.find(key);
+    if (it == keys_.end()) return false;
+    if (!records_->remove(key_record(key))) return false;
+
+    std::string id = it->second.digest;
+    logical_bytes_ -= key.size() + blobs_.at(id).raw_size;
+    stored_bytes_ -= key.size() + DIGEST_SIZE;
+    keys_.erase(it);
+    release(id);
+    return true;
+}
+
+std::vector<std::string> ContentStore::expire(const std::vector<std::string>& keys, int64_t now) {
+    std::vector<std::string> records;
+    records.reserve(keys.size());
+    for (const auto& key : keys) records.push_back(key_record(key));
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    std::vector<std::string> dropped = records_->expire(records, now);
+    for (auto& record : dropped) {
+        record.erase(0, PREFIX_SIZE);
+        auto it = keys_.find(record);
+        if (it == keys_.end()) continue;
+        std::string id = it->second.digest;
+        logical_bytes_ -= record.size() + blobs_.at(id).raw_size;
+        stored_bytes_ -= record.size() + DIGEST_SIZE;
+        keys_.erase(it);
+        release(id);
+    }
+    return dropped;
+}
+
+// Caller holds mutex_. A digest match alone is not trusted: the stored
+// value must have the same size and bytes.
+bool ContentStore::holds(const std::string& digest, const Blob& blob, const std::string& value) const {
+    if (blob.raw_size != value.size()) return false;
+    auto stored = records_->get(blob_record(digest), 0);
+    if (!stored) return false;
+    auto raw = decode_blob(*stored);
+    return raw && *raw == value;
+}
+
+// Caller holds mutex_ exclusively
+void ContentStore::release(const std::string& digest) {
+    auto it = blobs_.find(digest);
+    if (it == blobs_.end()) return;
+    if (it->second.refs > 0) it->second.refs--;
+    if (it->second.refs > 0) return;
+    // A failed removal leaves an unreferenced blob, which the next open drops
+    records_->remove(blob_record(digest));
+    stored_bytes_ -= DIGEST_SIZE + it->second.stored_size;
+    blobs_.erase(it);
+}
+
+void ContentStore::for_each_entry(const std::function<void(const std::string& key, uint64_t value_size,
+                                                           int64_t expires_at)>& visit) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (const auto& [key, entry] : keys_) visit(key, blobs_.at(entry.digest).raw_size, entry.expires_at);
+}
+
+void ContentStore::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    records_->clear();
+    keys_.clear();
+    blobs_.clear();
+    logical_bytes_ = 0;
+    stored_bytes_ = 0;
+}
+
+void ContentStore::sync() {
+    records_->sync();
+}
+
+uint64_t ContentStore::stored_bytes() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return stored_bytes_;
+}
+
+ContentStore::Stats ContentStore::stats() const {
+    Stats stats;
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    stats.keys = keys_.size();
+    stats.blobs = blobs_.size();
+    stats.logical_bytes = logical_bytes_;
+    stats.stored_bytes = stored_bytes_;
+    stats.deduplicated_writes = deduplicated_;
+    return stats;
+}
+
+} // namespace qc::core
@@ -0,0 +1,108 @@
+#ifndef CONTENT_STORE_H
+#define CONTENT_STORE_H
+
+#include "file_store.h"
+#include "log_store.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace qc::core {
+
+// Content-addressed key-value store on top of a KeyValueStore: the segment
+// log by default, or one file per record. Each key maps to the
+// 128-bit digest of its value, and each distinct value is stored once,
+// LZ-compressed, as a blob with a reference count. Writing a value that is
+// already stored appends only the small key record, once the stored bytes
+// are confirmed to match. Blobs are removed when their last key goes.
+//
+// Key -> digest and digest -> reference count live in memory and are rebuilt
+// from the records on open. Records that a crash left dangling are dropped then:
+// keys without a blob, and blobs without keys.
+class ContentStore {
+public:
+    struct Options {
+        enum class Backend { LOG_SEGMENTS, FILE_PER_KEY };
+        Backend backend = Backend::LOG_SEGMENTS;
+        LogStore::Options log;
+        FileStore::Options files;
+        bool compress = true;
+    };
+
+    struct Stats {
+        size_t keys = 0;
+        size_t blobs = 0;
+        uint64_t logical_bytes = 0;    // Keys plus uncompressed values, as if stored per key
+        uint64_t stored_bytes = 0;     // Key records plus compressed blobs, headers excluded
+        size_t deduplicated_writes = 0; // Puts that found their value already stored
+    };
+
+    static const size_t DIGEST_SIZE = 16;
+
+    explicit ContentStore(const std::string& dir);
+    ContentStore(const std::string& dir, const Options& options);
+
+    // expires_at (unix seconds, 0 = never) is kept with the key, not the blob
+    bool put(const std::string& key, const std::string& value, int64_t expires_at = 0);
+    std::optional<std::string> get(const std::string& key, int64_t now, int64_t* expires_at = nullptr) const;
+    bool remove(const std::string& key);
+    // Whether get() would find `key`, without reading its blob
+    bool contains(const std::string& key, int64_t now) const;
+
+    // Drop those of `keys` that have expired by `now` and return them
+    std::vector<std::string> expire(const std::vector<std::string>& keys, int64_t now);
+
+    // Visit every key with its uncompressed value size
+    void for_each_entry(const std::function<void(const std::string& key, uint64_t value_size,
+                                                 int64_t expires_at)>& visit) const;
+
+    void clear();
+    void sync();
+
+    uint64_t stored_bytes() const;
+    Stats stats() const;
+
+    // Raw 16-byte content digest; fast and well mixed, not cryptographic
+    static std::string digest(std::string_view data);
+
+private:
+    struct KeyEntry {
+        std::string digest;
+        int64_t expires_at;
+    };
+
+    struct Blob {
+        size_t refs = 0;
+        uint64_t stored_size = 0; // Blob record value, codec byte included
+        uint64_t raw_size = 0;
+    };
+
+    Options options_;
+    std::unique_ptr<KeyValueStore> records_;
+    // Guards the maps below; writers hold it exclusively across their record
+    // writes so readers never see a key whose blob is missing
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, KeyEntry> keys_;
+    std::unordered_map<std::string, Blob> blobs_;
+    uint64_t logical_bytes_ = 0;
+    uint64_t stored_bytes_ = 0;
+    size_t deduplicated_ = 0;
+
+    void rebuild();
+    void release(const std::string& digest); // Caller holds mutex_ exclusively
+    bool holds(const std::string& digest, const Blob& blob, const std::string& value) const;
+    std::string encode_blob(const std::string& value) const;
+    static std::optional<std::string> decode_blob(std::string_view blob);
+    static std::optional<uint64_t> blob_raw_size(std::string_view blob);
+};
+
+} // namespace qc::core
+
+#endif // CONTENT_STORE_H
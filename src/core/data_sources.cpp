@@ -0,0 +1,399 @@
+#include "flexible_json_logic.h"
+#include "cache_manager.h"
+#include "cancellation.h"
+#include "connection_pool.h"
+#include "database.h"
+#include "json_bridge.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <thread>
+
+namespace {
+
+using qc::core::from_io;
+using qc::core::to_io;
+using Binding = qc::core::DatabaseConnection::Statement::Value;
+
+const JsonValue* field(const JsonValue& object, const std::string& name, JsonValue::Type type) {
+    auto it = object.object_value.find(name);
+    if (it == object.object_value.end() || it->second.type != type) return nullptr;
+    return &it->second;
+}
+
+JsonValue error_result(const std::string& message) {
+    JsonValue result = JsonValue::makeObject();
+    result.object_value["error"] = JsonValue::makeString(message);
+    return result;
+}
+
+// Drivers bind text or NULL; whole numbers lose their ".0"
+Binding bind_text(const JsonValue& value) {
+    switch (value.type) {
+        case JsonValue::STRING:
+            return value.string_value;
+        case JsonValue::NUMBER: {
+            char text[32];
+            double number = value.number_value;
+            bool whole = std::isfinite(number) && number == std::floor(number) && std::fabs(number) < 1e15;
+            std::snprintf(text, sizeof(text), whole ? "%.0f" : "%.15g", number);
+            return text;
+        }
+        case JsonValue::BOOL:
+            return value.bool_value ? "true" : "false";
+        case JsonValue::NIL:
+            return std::nullopt;
+        default:
+            return value.serialize();
+    }
+}
+
+// Threads for sources that only implement the blocking execute(). A call
+// that never returns keeps its thread for good, so a fixed set would stall
+// every source once enough calls hung. Instead a call that finds no idle
+// thread starts one, up to MAX_THREADS running at once; past that, calls
+// queue until a thread frees up. A thread idle for IDLE_EXIT exits.
+class BlockingCallThreads {
+public:
+    static constexpr size_t MAX_THREADS = 256;
+    static constexpr std::chrono::seconds IDLE_EXIT{30};
+
+    void submit(std::function<void()> call) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        calls_.push_back(std::move(call));
+        if (calls_.size() > idle_ && threads_ < MAX_THREADS) {
+            ++threads_;
+            std::thread([this] { run(); }).detach();
+        } else {
+            ready_.notify_one();
+        }
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            ++idle_;
+            bool woken = ready_.wait_for(lock, IDLE_EXIT, [&] { return !calls_.empty(); });
+            --idle_;
+            if (!woken) {
+                --threads_;
+                return;
+            }
+            std::function<void()> call = std::move(calls_.front());
+            calls_.pop_front();
+            lock.unlock();
+            try {
+                call();
+            } catch (...) {
+            }
+            call = nullptr; // Releases what it captured outside the lock
+            lock.lock();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<std::function<void()>> calls_;
+    size_t threads_ = 0;
+    size_t idle_ = 0;
+};
+
+// Never destroyed: its detached threads may still be in a call at exit
+BlockingCallThreads& blocking_calls() {
+    static BlockingCallThreads* threads = new BlockingCallThreads;
+    return *threads;
+}
+
+} // namespace
+
+void DataSource::executeAsync(const std::string& operation, const JsonValue& parameters,
+                              const qc::core::CancellationToken& cancel, Completion done) {
+    blocking_calls().submit([this, calls = blocking_, operation, parameters, cancel, done = std::move(done)] {
+        bool closed;
+        {
+            std::lock_guard<std::mutex> lock(calls->mutex);
+            closed = calls->closed;
+            if (!closed) calls->running++;
+        }
+        if (closed) {
+            done(error_result("Data source closed"));
+            return;
+        }
+        JsonValue result;
+        if (cancel.cancelled()) {
+            result = error_result("Cancelled: " + cancel.reason());
+        } else {
+            try {
+                result = execute(operation, parameters);
+            } catch (const std::exception& e) {
+                result = error_result(e.what());
+            } catch (...) {
+                result = error_result("unknown exception");
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(calls->mutex);
+            if (--calls->running == 0) calls->idle.notify_all();
+        }
+        done(std::move(result));
+    });
+}
+
+void DataSource::closeBlockingCalls() {
+    std::unique_lock<std::mutex> lock(blocking_->mutex);
+    blocking_->closed = true;
+    blocking_->idle.wait(lock, [&] { return blocking_->running == 0; });
+}
+
+// Database data source implementation
+DatabaseDataSource::DatabaseDataSource(const JsonValue& config, Connector connect)
+    : connection_timeout_(30), query_timeout_(0), statement_cache_size_(64), queries_(JsonValue::makeObject()) {
+    if (const JsonValue* text = field(config, "connection_string", JsonValue::STRING)) connection_string_ = text->string_value;
+    if (const JsonValue* timeout = field(config, "query_timeout", JsonValue::NUMBER)) {
+        query_timeout_ = static_cast<int>(timeout->number_value);
+    }
+    if (const JsonValue* size = field(config, "statement_cache_size", JsonValue::NUMBER)) {
+        statement_cache_size_ = static_cast<size_t>(std::max(1.0, size->number_value));
+    }
+    if (const JsonValue* queries = field(config, "queries", JsonValue::OBJECT)) queries_ = *queries;
+
+    qc::core::ConnectionPool<qc::core::DatabaseSession>::Options options;
+    if (const JsonValue* pool = field(config, "connection_pool", JsonValue::OBJECT)) {
+        if (const JsonValue* min = field(*pool, "min_connections", JsonValue::NUMBER)) {
+            options.min_connections = static_cast<size_t>(std::max(0.0, min->number_value));
+        }
+        if (const JsonValue* max = field(*pool, "max_connections", JsonValue::NUMBER)) {
+            options.max_connections = static_cast<size_t>(std::max(1.0, max->number_value));
+        }
+        if (const JsonValue* timeout = field(*pool, "connection_timeout", JsonValue::NUMBER)) {
+            connection_timeout_ = static_cast<int>(timeout->number_value);
+        }
+    }
+    options.acquire_timeout = std::chrono::seconds(connection_timeout_);
+    if (!connect) return;
+
+    std::string target = connection_string_;
+    size_t statements = statement_cache_size_;
+    pool_ = std::make_unique<qc::core::ConnectionPool<qc::core::DatabaseSession>>(
+        [connect, target, statements]() -> std::unique_ptr<qc::core::DatabaseSession> {
+            std::unique_ptr<qc::core::DatabaseConnection> connection;
+            try {
+                connection = connect(target);
+            } catch (const std::exception&) {
+                return nullptr;
+            }
+            if (!connection) return nullptr;
+            return std::make_unique<qc::core::DatabaseSession>(std::move(connection), statements);
+        },
+        [](qc::core::DatabaseSession& session) { return session.connection->ping(); }, options);
+}
+
+DatabaseDataSource::~DatabaseDataSource() = default;
+
+// Every declared parameter must be given. Arrays bind one element per run
+// and must agree in length; every other value binds the same to each run
+JsonValue DatabaseDataSource::execute(const std::string& operation, const JsonValue& parameters) {
+    auto query = queries_.object_value.find(operation);
+    if (query == queries_.object_value.end()) return error_result("Unknown query '" + operation + "'");
+
+    std::string sql;
+    std::vector<std::string> names;
+    if (query->second.type == JsonValue::STRING) {
+        sql = query->second.string_value;
+    } else if (const JsonValue* text = field(query->second, "sql", JsonValue::STRING)) {
+        sql = text->string_value;
+        if (const JsonValue* list = field(query->second, "parameters", JsonValue::ARRAY)) {
+            for (const auto& name : list->array_value) {
+                if (name.type == JsonValue::STRING) names.push_back(name.string_value);
+            }
+        }
+    }
+    if (sql.empty()) return error_result("Query '" + operation + "' has no SQL");
+
+    std::vector<const JsonValue*> values;
+    size_t runs = 1;
+    bool batched = false;
+    for (const auto& name : names) {
+        auto it = parameters.object_value.find(name);
+        if (it == parameters.object_value.end()) {
+            return error_result("Missing parameter '" + name + "' for query '" + operation + "'");
+        }
+        const JsonValue* value = &it->second;
+        values.push_back(value);
+        if (value->type != JsonValue::ARRAY) continue;
+        if (batched && value->array_value.size() != runs) {
+            return error_result("Array parameters of '" + operation + "' differ in length");
+        }
+        runs = value->array_value.size();
+        batched = true;
+    }
+
+    std::vector<std::vector<Binding>> batch(runs, std::vector<Binding>(names.size()));
+    for (size_t column = 0; column < names.size(); ++column) {
+        const JsonValue* value = values[column];
+        for (size_t run = 0; run < runs; ++run) {
+            batch[run][column] = bind_text(value->type == JsonValue::ARRAY ? value->array_value[run] : *value);
+        }
+    }
+    if (batch.empty()) return JsonValue::makeArray();
+    return executeQuery(sql, batch);
+}
+
+bool DatabaseDataSource::isAvailable() const {
+    return pool_ != nullptr;
+}
+
+// Never waits for a connection. With every one lent out, the source is
+// healthy if one was lent or came back within the pool's check interval.
+bool DatabaseDataSource::healthCheck() const {
+    if (!pool_) return false;
+    auto session = pool_->try_acquire();
+    if (!session) {
+        auto stats = pool_->stats();
+        return stats.open > 0 && stats.idle == 0 &&
+               std::chrono::steady_clock::now() - stats.last_active < pool_->options().check_after;
+    }
+    if (session->connection->ping()) return true;
+    session.discard();
+    return false;
+}
+
+std::string DatabaseDataSource::getName() const {
+    return "database:" + connection_string_;
+}
+
+JsonValue DatabaseDataSource::getConnectionInfo() const {
+    JsonValue info = JsonValue::makeObject();
+    info.object_value["type"] = JsonValue::makeString(getType());
+    info.object_value["connection_string"] = JsonValue::makeString(connection_string_);
+    info.object_value["connection_timeout"] = JsonValue::makeNumber(connection_timeout_);
+    info.object_value["query_timeout"] = JsonValue::makeNumber(query_timeout_);
+    info.object_value["statement_cache_size"] = JsonValue::makeNumber(static_cast<double>(statement_cache_size_));
+    if (pool_) {
+        auto stats = pool_->stats();
+        info.object_value["open_connections"] = JsonValue::makeNumber(static_cast<double>(stats.open));
+        info.object_value["idle_connections"] = JsonValue::makeNumber(static_cast<double>(stats.idle));
+        info.object_value["opened_connections"] = JsonValue::makeNumber(static_cast<double>(stats.opened));
+        info.object_value["discarded_connections"] = JsonValue::makeNumber(static_cast<double>(stats.discarded));
+    }
+    return info;
+}
+
+// A failed statement is prepared afresh next time, and a connection the
+// failure broke leaves the pool
+JsonValue DatabaseDataSource::executeQuery(const std::string& query,
+                                           const std::vector<std::vector<Binding>>& batch) const {
+    if (!pool_) return error_result("No database driver for '" + connection_string_ + "'");
+    auto session = pool_->acquire();
+    if (!session) {
+        return error_result("No database connection to '" + connection_string_ + "' within " +
+                            std::to_string(connection_timeout_) + "s");
+    }
+    try {
+        auto& statement = session->statements.get(*session->connection, query);
+        return statement.execute(batch, std::chrono::seconds(query_timeout_));
+    } catch (const std::exception& e) {
+        session->statements.erase(query);
+        if (!session->connection->ping()) session.discard();
+        return error_result(e.what());
+    }
+}
+
+// Cache data source implementation
+CacheDataSource::CacheDataSource(const JsonValue& config)
+    : cache_path_("./cache"), ttl_seconds_(0), max_size_bytes_(0) {
+    if (const JsonValue* path = field(config, "cache_path", JsonValue::STRING)) cache_path_ = path->string_value;
+    if (const JsonValue* ttl = field(config, "ttl", JsonValue::NUMBER)) ttl_seconds_ = static_cast<int>(ttl->number_value);
+    if (const JsonValue* size = field(config, "max_size", JsonValue::STRING)) {
+        max_size_bytes_ = qc::core::CacheManager::parse_size(size->string_value).value_or(0);
+    } else if (const JsonValue* bytes = field(config, "max_size", JsonValue::NUMBER)) {
+        max_size_bytes_ = static_cast<size_t>(bytes->number_value);
+    }
+
+    qc::core::CacheManager::Options options;
+    options.ttl = std::chrono::seconds(ttl_seconds_ > 0 ? ttl_seconds_ : 0);
+    options.max_disk_bytes = max_size_bytes_;
+    cache_ = std::make_shared<qc::core::CacheManager>(cache_path_, options);
+}
+
+// Operations: get {key}, set {key, value[, ttl]}, remove {key}, cleanup, stats
+JsonValue CacheDataSource::execute(const std::string& operation, const JsonValue& parameters) {
+    JsonValue result = JsonValue::makeObject();
+    if (operation == "cleanup") {
+        cleanupExpiredEntries();
+        return getConnectionInfo();
+    }
+    if (operation == "stats") return getConnectionInfo();
+
+    const JsonValue* key = field(parameters, "key", JsonValue::STRING);
+    if (!key) return error_result("Missing 'key' parameter for cache operation '" + operation + "'.");
+
+    if (operation == "get") {
+        auto hit = cache_->get(key->string_value);
+        result.object_value["hit"] = JsonValue::makeBool(hit.has_value());
+        result.object_value["value"] = hit ? from_io(*hit) : JsonValue::makeNull();
+    } else if (operation == "set") {
+        auto value = parameters.object_value.find("value");
+        if (value == parameters.object_value.end()) return error_result("Missing 'value' parameter for cache set.");
+        if (const JsonValue* ttl = field(parameters, "ttl", JsonValue::NUMBER)) {
+            cache_->set(key->string_value, to_io(value->second),
+                        std::chrono::seconds(static_cast<long long>(ttl->number_value)));
+        } else {
+            cache_->set(key->string_value, to_io(value->second));
+        }
+        result.object_value["stored"] = JsonValue::makeBool(true);
+    } else if (operation == "remove") {
+        result.object_value["removed"] = JsonValue::makeBool(cache_->remove(key->string_value));
+    } else {
+        return error_result("Unknown cache operation '" + operation + "'.");
+    }
+    return result;
+}
+
+// Cache lookups are quick enough to answer on the caller's thread
+void CacheDataSource::executeAsync(const std::string& operation, const JsonValue& parameters,
+                                   const qc::core::CancellationToken& cancel, Completion done) {
+    if (cancel.cancelled()) {
+        done(error_result("Cancelled: " + cancel.reason()));
+        return;
+    }
+    done(execute(operation, parameters));
+}
+
+bool CacheDataSource::isAvailable() const {
+    return cache_ != nullptr;
+}
+
+std::string CacheDataSource::getName() const {
+    return "cache:" + cache_path_;
+}
+
+JsonValue CacheDataSource::getConnectionInfo() const {
+    qc::core::CacheManager::Stats stats = cache_->stats();
+    JsonValue info = JsonValue::makeObject();
+    info.object_value["type"] = JsonValue::makeString(getType());
+    info.object_value["cache_path"] = JsonValue::makeString(cache_path_);
+    info.object_value["ttl"] = JsonValue::makeNumber(ttl_seconds_);
+    info.object_value["max_size_bytes"] = JsonValue::makeNumber(static_cast<double>(max_size_bytes_));
+    info.object_value["entries"] = JsonValue::makeNumber(static_cast<double>(stats.disk.keys));
+    info.object_value["size_bytes"] = JsonValue::makeNumber(static_cast<double>(stats.tracked_bytes));
+    info.object_value["expired_entries"] = JsonValue::makeNumber(static_cast<double>(stats.expired_entries));
+    info.object_value["evicted_entries"] = JsonValue::makeNumber(static_cast<double>(stats.evicted_entries));
+    return info;
+}
+
+std::string CacheDataSource::generateCacheKey(const std::string& operation, const JsonValue& parameters) const {
+    return operation + ":" + parameters.serialize();
+}
+
+bool CacheDataSource::isCacheValid(const std::string& cache_file) const {
+    return cache_->get(cache_file).has_value();
+}
+
+// Expiry and the size budget are enforced in the background; this forces a pass
+void CacheDataSource::cleanupExpiredEntries() const {
+    cache_->sweep();
+}
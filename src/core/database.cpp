@@ -0,0 +1,30 @@
+#include "database.h"
+
+namespace qc::core {
+
+DatabaseConnection::Statement& StatementCache::get(DatabaseConnection& connection, const std::string& sql) {
+    auto it = index_.find(sql);
+    if (it != index_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return *it->second->second;
+    }
+
+    std::unique_ptr<DatabaseConnection::Statement> statement = connection.prepare(sql);
+    ++prepared_;
+    if (index_.size() >= capacity_) {
+        index_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+    lru_.emplace_front(sql, std::move(statement));
+    index_[sql] = lru_.begin();
+    return *lru_.front().second;
+}
+
+void StatementCache::erase(const std::string& sql) {
+    auto it = index_.find(sql);
+    if (it == index_.end()) return;
+    lru_.erase(it->second);
+    index_.erase(it);
+}
+
+} // namespace qc::core
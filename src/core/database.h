@@ -0,0 +1,75 @@
+#ifndef DATABASE_H
+#define DATABASE_H
+
+#include "json_logic.h"
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace qc::core {
+
+// What DatabaseDataSource needs from a database driver. A connection is
+// used by one caller at a time.
+class DatabaseConnection {
+public:
+    class Statement {
+    public:
+        using Value = std::optional<std::string>; // Bound as text, or SQL NULL when empty
+
+        virtual ~Statement() = default;
+        // Runs once for each parameter set in `batch`, in one go where the
+        // driver can, and returns the rows of every run in order as an
+        // array of objects. A zero timeout waits indefinitely. Throws on
+        // failure.
+        virtual ::JsonValue execute(const std::vector<std::vector<Value>>& batch,
+                                    std::chrono::milliseconds timeout) = 0;
+    };
+
+    virtual ~DatabaseConnection() = default;
+    // Throws when the database rejects `sql`
+    virtual std::unique_ptr<Statement> prepare(const std::string& sql) = 0;
+    // Whether the connection still works
+    virtual bool ping() = 0;
+};
+
+// The statements one connection has prepared, keyed by their SQL. Past
+// `capacity` the least recently used is closed. Not synchronized: it goes
+// with its connection, which has one user at a time.
+class StatementCache {
+public:
+    explicit StatementCache(size_t capacity = 64) : capacity_(capacity > 0 ? capacity : 1) {}
+
+    // Prepared through `connection` on first use
+    DatabaseConnection::Statement& get(DatabaseConnection& connection, const std::string& sql);
+    void erase(const std::string& sql);
+
+    size_t size() const { return index_.size(); }
+    size_t prepared() const { return prepared_; } // Over the cache's lifetime
+
+private:
+    using Entry = std::pair<std::string, std::unique_ptr<DatabaseConnection::Statement>>;
+
+    size_t capacity_;
+    size_t prepared_ = 0;
+    std::list<Entry> lru_; // Most recently used at the front
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
+
+// A pooled connection and its prepared statements
+struct DatabaseSession {
+    explicit DatabaseSession(std::unique_ptr<DatabaseConnection> connection, size_t statements = 64)
+        : connection(std::move(connection)), statements(statements) {}
+
+    std::unique_ptr<DatabaseConnection> connection;
+    StatementCache statements;
+};
+
+} // namespace qc::core
+
+#endif // DATABASE_H
@@ -0,0 +1,98 @@
+#include "digest.h"
+
+namespace qc::core {
+
+namespace {
+
+uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+uint64_t fmix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+// Little endian whatever the host, so digests written on one machine match
+// those computed on another
+uint64_t get_u64(const char* in, size_t size = 8) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < size; ++i) v |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    return v;
+}
+
+void put_u64(char* out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) out[i] = static_cast<char>(v >> (8 * i));
+}
+
+} // namespace
+
+uint32_t crc32(const char* data, size_t size) {
+    static uint32_t table[256];
+    static bool initialized = [] {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        return true;
+    }();
+    (void)initialized;
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+std::string digest128(std::string_view data) {
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    uint64_t h1 = 0x9e3779b97f4a7c15ULL ^ data.size();
+    uint64_t h2 = 0xc2b2ae3d27d4eb4fULL;
+
+    size_t pos = 0;
+    for (; pos + 16 <= data.size(); pos += 16) {
+        uint64_t k1 = get_u64(data.data() + pos);
+        uint64_t k2 = get_u64(data.data() + pos + 8);
+        h1 ^= rotl(k1 * c1, 31) * c2;
+        h1 = (rotl(h1, 27) + h2) * 5 + 0x52dce729;
+        h2 ^= rotl(k2 * c2, 33) * c1;
+        h2 = (rotl(h2, 31) + h1) * 5 + 0x38495ab5;
+    }
+    uint64_t k1 = 0, k2 = 0;
+    size_t tail = data.size() - pos;
+    if (tail > 0) k1 = get_u64(data.data() + pos, tail < 8 ? tail : 8);
+    if (tail > 8) k2 = get_u64(data.data() + pos + 8, tail - 8);
+    h1 ^= rotl(k1 * c1, 31) * c2;
+    h2 ^= rotl(k2 * c2, 33) * c1;
+
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix(h1);
+    h2 = fmix(h2);
+    h1 += h2;
+    h2 += h1;
+
+    std::string out(16, '\0');
+    put_u64(&out[0], h1);
+    put_u64(&out[8], h2);
+    return out;
+}
+
+std::string hex_encode(std::string_view bytes) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    out.reserve(bytes.size() * 2);
+    for (char c : bytes) {
+        unsigned char b = static_cast<unsigned char>(c);
+        out += digits[b >> 4];
+        out += digits[b & 0x0F];
+    }
+    return out;
+}
+
+} // namespace qc::core
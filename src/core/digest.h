@@ -0,0 +1,25 @@
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace qc::core {
+
+// Checksums and content hashes shared by the on-disk stores. None of them is
+// cryptographic.
+
+// CRC-32 (IEEE), for detecting torn or corrupt records
+uint32_t crc32(const char* data, size_t size);
+
+// Raw 16-byte hash in the style of MurmurHash3 x64/128, for content addressing
+std::string digest128(std::string_view data);
+
+// Lowercase hex of raw bytes
+std::string hex_encode(std::string_view bytes);
+
+} // namespace qc::core
+
+#endif // DIGEST_H
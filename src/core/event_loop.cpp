@@ -0,0 +1,88 @@
+#include "event_loop.h"
+
+namespace qc::core {
+
+EventLoop::EventLoop() : thread_([this] { run(); }) {}
+
+EventLoop::~EventLoop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void EventLoop::post(Callback callback) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        posted_.push_back(std::move(callback));
+    }
+    wake_.notify_one();
+}
+
+EventLoop::TimerId EventLoop::schedule_at(Clock::time_point when, Callback callback) {
+    TimerId id;
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = next_id_++;
+        earliest = timers_.empty() || when < timers_.top().when;
+        timers_.push(Timer{when, id});
+        callbacks_.emplace(id, std::move(callback));
+    }
+    if (earliest) wake_.notify_one();
+    return id;
+}
+
+EventLoop::TimerId EventLoop::schedule_after(Clock::duration delay, Callback callback) {
+    return schedule_at(Clock::now() + delay, std::move(callback));
+}
+
+bool EventLoop::cancel(TimerId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return callbacks_.erase(id) > 0;
+}
+
+size_t EventLoop::pending_timers() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return callbacks_.size();
+}
+
+void EventLoop::run() {
+    std::vector<Callback> batch;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        Clock::time_point now = Clock::now();
+        while (!timers_.empty() && timers_.top().when <= now) {
+            auto it = callbacks_.find(timers_.top().id);
+            if (it != callbacks_.end()) {
+                batch.push_back(std::move(it->second));
+                callbacks_.erase(it);
+            }
+            timers_.pop();
+        }
+        for (auto& callback : posted_) batch.push_back(std::move(callback));
+        posted_.clear();
+
+        if (!batch.empty()) {
+            lock.unlock();
+            for (auto& callback : batch) callback();
+            batch.clear();
+            lock.lock();
+            continue;
+        }
+        if (stopping_) return;
+
+        // Drop cancelled timers from the top so they do not cause early wakeups
+        while (!timers_.empty() && !callbacks_.count(timers_.top().id)) timers_.pop();
+        if (timers_.empty()) {
+            wake_.wait(lock);
+        } else {
+            Clock::time_point next = timers_.top().when; // The heap may reallocate while we wait
+            wake_.wait_until(lock, next);
+        }
+    }
+}
+
+} // namespace qc::core
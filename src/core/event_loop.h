@@ -0,0 +1,65 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace qc::core {
+
+// One thread running posted callbacks and timers in deadline order. Meant
+// for short continuations (completing a request, firing a deadline), so a
+// single loop can keep thousands of pending operations waiting without a
+// thread each. Timers are a binary heap; cancelled ones are dropped lazily.
+class EventLoop {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void()>;
+    using TimerId = uint64_t;
+
+    EventLoop();
+    ~EventLoop(); // Runs what was already posted; pending timers are dropped
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    void post(Callback callback);
+    TimerId schedule_at(Clock::time_point when, Callback callback);
+    TimerId schedule_after(Clock::duration delay, Callback callback);
+
+    // False once the timer has fired or been cancelled
+    bool cancel(TimerId id);
+
+    size_t pending_timers() const;
+
+private:
+    struct Timer {
+        Clock::time_point when;
+        TimerId id;
+        bool operator>(const Timer& other) const {
+            return when != other.when ? when > other.when : id > other.id;
+        }
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::vector<Callback> posted_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    std::unordered_map<TimerId, Callback> callbacks_;
+    TimerId next_id_ = 1;
+    bool stopping_ = false;
+    std::thread thread_;
+
+    void run();
+};
+
+} // namespace qc::core
+
+#endif // EVENT_LOOP_H
@@ -0,0 +1,815 @@
+#include "expression.h"
+#include "compiled_template.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace qc::core {
+
+namespace {
+
+constexpr size_t kMaxStack = 64;
+constexpr size_t kMaxNesting = 128;
+constexpr size_t kMaxCachedExpressions = 4096;
+
+enum Clock : uint32_t { CURRENT_YEAR, CURRENT_MONTH, CURRENT_DAY, NOW };
+
+bool identifier_char(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool same_word(std::string_view text, std::string_view word) {
+    return text.size() == word.size() &&
+           std::equal(text.begin(), text.end(), word.begin(), [](char a, char b) {
+               return std::tolower(static_cast<unsigned char>(a)) == b;
+           });
+}
+
+} // namespace
+
+enum class Expression::Op : uint8_t {
+    CONSTANT, // Push constants_[arg]
+    PATH,     // Push the value at paths_[arg]
+    CLOCK,    // Push a Clock value
+    LENGTH,   // Unary, replacing the top of the stack
+    EXISTS,
+    NOT,
+    NEGATE,
+    TO_BOOL,
+    ADD,      // Binary, replacing the two topmost values
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    MODULO,
+    EQUAL,
+    NOT_EQUAL,
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    IN,
+    IN_LIST,       // Whether the value below the topmost `arg` equals any of them
+    JUMP_IF_FALSE, // If the top is falsy, make it false and jump to `arg`; otherwise pop it
+    JUMP_IF_TRUE,
+};
+
+struct Expression::Node {
+    enum Kind { CONSTANT, PATH, CLOCK, LIST, UNARY, BINARY, IN_LIST, AND, OR };
+    Kind kind = CONSTANT;
+    Op op = Op::CONSTANT;
+    size_t index = 0; // Into constants_ or paths_, or a Clock value
+    std::vector<std::unique_ptr<Node>> children;
+};
+
+class Expression::Machine {
+public:
+    struct Value {
+        enum Kind : uint8_t { NIL, BOOL, NUMBER, STRING, JSON };
+        Kind kind = NIL;
+        bool boolean = false;
+        double number = 0;
+        std::string_view text;              // Views a std::string, so it is null-terminated
+        const SharedJson* json = nullptr;   // Arrays and objects
+    };
+    using Scratch = std::vector<std::unique_ptr<SharedJson>>;
+
+    static Value of(const SharedJson& json) {
+        Value value;
+        switch (json.type()) {
+            case ::JsonValue::BOOL:
+                value.kind = Value::BOOL;
+                value.boolean = json.as_bool();
+                break;
+            case ::JsonValue::NUMBER:
+                value.kind = Value::NUMBER;
+                value.number = json.as_number();
+                break;
+            case ::JsonValue::STRING:
+                value.kind = Value::STRING;
+                value.text = json.as_string();
+                break;
+            case ::JsonValue::ARRAY:
+            case ::JsonValue::OBJECT:
+                value.kind = Value::JSON;
+                value.json = &json;
+                break;
+            default:
+                break;
+        }
+        return value;
+    }
+
+    static Value boolean(bool b) {
+        Value value;
+        value.kind = Value::BOOL;
+        value.boolean = b;
+        return value;
+    }
+
+    static Value number(double n) {
+        Value value;
+        value.kind = Value::NUMBER;
+        value.number = n;
+        return value;
+    }
+
+    static SharedJson to_json(const Value& value) {
+        switch (value.kind) {
+            case Value::BOOL: return SharedJson::boolean(value.boolean);
+            case Value::NUMBER: return SharedJson::number(value.number);
+            case Value::STRING: return SharedJson::string(std::string(value.text));
+            case Value::JSON: return *value.json;
+            default: return SharedJson();
+        }
+    }
+
+    static bool truthy(const Value& value) {
+        switch (value.kind) {
+            case Value::BOOL: return value.boolean;
+            case Value::NUMBER: return value.number != 0 && !std::isnan(value.number);
+            case Value::STRING: return !value.text.empty();
+            case Value::JSON: return value.json->size() > 0;
+            default: return false;
+        }
+    }
+
+    // Numbers, and strings that spell one
+    static bool numeric(const Value& value, double& out) {
+        if (value.kind == Value::NUMBER) {
+            out = value.number;
+            return true;
+        }
+        if (value.kind != Value::STRING || value.text.empty()) return false;
+        char* end = nullptr;
+        out = std::strtod(value.text.data(), &end);
+        return end == value.text.data() + value.text.size();
+    }
+
+    static bool equal(const Value& a, const Value& b) {
+        if (a.kind != b.kind) {
+            double x = 0, y = 0;
+            bool mixed_number = (a.kind == Value::NUMBER && b.kind == Value::STRING) ||
+                                (a.kind == Value::STRING && b.kind == Value::NUMBER);
+            return mixed_number && numeric(a, x) && numeric(b, y) && x == y;
+        }
+        switch (a.kind) {
+            case Value::BOOL: return a.boolean == b.boolean;
+            case Value::NUMBER: return a.number == b.number;
+            case Value::STRING: return a.text == b.text;
+            case Value::JSON: return *a.json == *b.json;
+            default: return true;
+        }
+    }
+
+    static bool contains(const Value& collection, const Value& item) {
+        if (collection.kind == Value::STRING) {
+            return item.kind == Value::STRING && collection.text.find(item.text) != std::string_view::npos;
+        }
+        if (collection.kind != Value::JSON) return false;
+        if (collection.json->type() == ::JsonValue::ARRAY) {
+            for (const auto& element : collection.json->items()) {
+                if (equal(of(element), item)) return true;
+            }
+            return false;
+        }
+        if (item.kind != Value::STRING) return false;
+        for (const auto& field : collection.json->members()) {
+            if (field.first == item.text) return true;
+        }
+        return false;
+    }
+
+    static Value unary(Op op, const Value& value) {
+        double n;
+        switch (op) {
+            case Op::LENGTH:
+                if (value.kind == Value::STRING) return number(static_cast<double>(value.text.size()));
+                return number(value.kind == Value::JSON ? static_cast<double>(value.json->size()) : 0);
+            case Op::EXISTS: return boolean(value.kind != Value::NIL);
+            case Op::NOT: return boolean(!truthy(value));
+            case Op::TO_BOOL: return boolean(truthy(value));
+            case Op::NEGATE: return numeric(value, n) ? number(-n) : Value();
+            default: return Value();
+        }
+    }
+
+    static Value binary(Op op, const Value& a, const Value& b) {
+        switch (op) {
+            case Op::EQUAL: return boolean(equal(a, b));
+            case Op::NOT_EQUAL: return boolean(!equal(a, b));
+            case Op::IN: return boolean(contains(b, a));
+            default: break;
+        }
+
+        double x, y;
+        if (op == Op::LESS || op == Op::LESS_EQUAL || op == Op::GREATER || op == Op::GREATER_EQUAL) {
+            int order;
+            if (a.kind == Value::STRING && b.kind == Value::STRING) {
+                order = a.text.compare(b.text);
+            } else if (numeric(a, x) && numeric(b, y)) {
+                order = x < y ? -1 : x > y ? 1 : 0;
+            } else {
+                return boolean(false);
+            }
+            switch (op) {
+                case Op::LESS: return boolean(order < 0);
+                case Op::LESS_EQUAL: return boolean(order <= 0);
+                case Op::GREATER: return boolean(order > 0);
+                default: return boolean(order >= 0);
+            }
+        }
+
+        if (!numeric(a, x) || !numeric(b, y)) return Value();
+        switch (op) {
+            case Op::ADD: return number(x + y);
+            case Op::SUBTRACT: return number(x - y);
+            case Op::MULTIPLY: return number(x * y);
+            case Op::DIVIDE: return y == 0 ? Value() : number(x / y);
+            case Op::MODULO: return y == 0 ? Value() : number(std::fmod(x, y));
+            default: return Value();
+        }
+    }
+
+    static Value clock(uint32_t which) {
+        auto now = std::chrono::system_clock::now();
+        if (which == NOW) {
+            return number(static_cast<double>(std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count()));
+        }
+        std::time_t seconds = std::chrono::system_clock::to_time_t(now);
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &seconds);
+#else
+        localtime_r(&seconds, &local);
+#endif
+        if (which == CURRENT_YEAR) return number(local.tm_year + 1900);
+        if (which == CURRENT_MONTH) return number(local.tm_mon + 1);
+        return number(local.tm_mday);
+    }
+
+    // A field of an array is the list of that field across its elements,
+    // which has to be built, though only out of handles; everything else
+    // points into the scope
+    static const SharedJson* descend(const SharedJson* value, const std::vector<Path::Step>& steps, size_t i,
+                                     Scratch& scratch) {
+        for (; value && i < steps.size(); ++i) {
+            const Path::Step& step = steps[i];
+            if (step.field.empty()) {
+                value = value->at(step.index);
+            } else if (value->type() == ::JsonValue::ARRAY) {
+                SharedJson::Array mapped;
+                for (const auto& item : value->items()) {
+                    const SharedJson* found = descend(&item, steps, i, scratch);
+                    if (found && !found->is_null()) mapped.push_back(*found);
+                }
+                scratch.push_back(std::make_unique<SharedJson>(SharedJson::array(std::move(mapped))));
+                return scratch.back().get();
+            } else {
+                value = value->find(step.field);
+            }
+        }
+        return value;
+    }
+
+    static Value run(const Expression& expression, const Scope& scope, Scratch& scratch) {
+        Value stack[kMaxStack];
+        size_t top = 0;
+        const auto& code = expression.code_;
+        size_t pc = 0;
+        while (pc < code.size()) {
+            const Instruction& instruction = code[pc++];
+            switch (instruction.op) {
+                case Op::CONSTANT:
+                    stack[top++] = of(expression.constants_[instruction.arg]);
+                    break;
+                case Op::PATH: {
+                    const Path& path = expression.paths_[instruction.arg];
+                    const SharedJson* found = descend(scope.find(path.root), path.steps, 0, scratch);
+                    stack[top++] = found ? of(*found) : Value();
+                    break;
+                }
+                case Op::CLOCK:
+                    stack[top++] = clock(instruction.arg);
+                    break;
+                case Op::LENGTH:
+                case Op::EXISTS:
+                case Op::NOT:
+                case Op::NEGATE:
+                case Op::TO_BOOL:
+                    stack[top - 1] = unary(instruction.op, stack[top - 1]);
+                    break;
+                case Op::IN_LIST: {
+                    size_t first = top - instruction.arg;
+                    bool found = false;
+                    for (size_t i = first; i < top && !found; ++i) found = equal(stack[first - 1], stack[i]);
+                    top = first;
+                    stack[top - 1] = boolean(found);
+                    break;
+                }
+                case Op::JUMP_IF_FALSE:
+                case Op::JUMP_IF_TRUE:
+                    if (truthy(stack[top - 1]) == (instruction.op == Op::JUMP_IF_TRUE)) {
+                        stack[top - 1] = boolean(instruction.op == Op::JUMP_IF_TRUE);
+                        pc = instruction.arg;
+                    } else {
+                        --top;
+                    }
+                    break;
+                default:
+                    stack[top - 2] = binary(instruction.op, stack[top - 2], stack[top - 1]);
+                    --top;
+                    break;
+            }
+        }
+        return top > 0 ? stack[top - 1] : Value();
+    }
+};
+
+class Expression::Compiler {
+public:
+    Compiler(Expression& out, std::string_view text) : out_(out), text_(text) {}
+
+    std::unique_ptr<Node> parse() {
+        auto node = parse_or();
+        skip_space();
+        if (node && pos_ < text_.size()) return fail("unexpected '" + std::string(text_.substr(pos_, 10)) + "'");
+        return node;
+    }
+
+    void emit(const Node& node, size_t depth) {
+        out_.max_depth_ = std::max(out_.max_depth_, depth + 1);
+        switch (node.kind) {
+            case Node::CONSTANT:
+            case Node::PATH:
+            case Node::CLOCK:
+                out_.code_.push_back({node.kind == Node::CONSTANT ? Op::CONSTANT
+                                      : node.kind == Node::PATH   ? Op::PATH
+                                                                  : Op::CLOCK,
+                                      static_cast<uint32_t>(node.index)});
+                break;
+            case Node::LIST:
+                fail("a list with paths in it can only follow 'in'");
+                break;
+            case Node::UNARY:
+                emit(*node.children[0], depth);
+                out_.code_.push_back({node.op, 0});
+                break;
+            case Node::BINARY:
+            case Node::IN_LIST:
+                for (size_t i = 0; i < node.children.size(); ++i) emit(*node.children[i], depth + i);
+                out_.code_.push_back({node.op, static_cast<uint32_t>(node.children.size() - 1)});
+                break;
+            case Node::AND:
+            case Node::OR: {
+                emit(*node.children[0], depth);
+                size_t jump = out_.code_.size();
+                out_.code_.push_back({node.kind == Node::AND ? Op::JUMP_IF_FALSE : Op::JUMP_IF_TRUE, 0});
+                emit(*node.children[1], depth);
+                out_.code_.push_back({Op::TO_BOOL, 0});
+                out_.code_[jump].arg = static_cast<uint32_t>(out_.code_.size());
+                break;
+            }
+        }
+    }
+
+private:
+    Expression& out_;
+    std::string_view text_;
+    size_t pos_ = 0;
+    size_t nesting_ = 0;
+
+    std::unique_ptr<Node> fail(const std::string& message) {
+        if (out_.error_.empty()) out_.error_ = message;
+        return nullptr;
+    }
+
+    void skip_space() {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) ++pos_;
+    }
+
+    bool eat(std::string_view symbol) {
+        skip_space();
+        if (text_.substr(pos_, symbol.size()) != symbol) return false;
+        pos_ += symbol.size();
+        return true;
+    }
+
+    // Keywords match in any case, as whole words
+    bool eat_word(std::string_view word) {
+        skip_space();
+        size_t end = pos_ + word.size();
+        if (end > text_.size() || !same_word(text_.substr(pos_, word.size()), word)) return false;
+        if (end < text_.size() && identifier_char(text_[end])) return false;
+        pos_ = end;
+        return true;
+    }
+
+    std::unique_ptr<Node> constant(SharedJson value) {
+        auto node = std::make_unique<Node>();
+        node->index = out_.constants_.size();
+        out_.constants_.push_back(std::move(value));
+        return node;
+    }
+
+    bool is_constant(const std::unique_ptr<Node>& node) const { return node->kind == Node::CONSTANT; }
+
+    Machine::Value constant_value(const Node& node) const { return Machine::of(out_.constants_[node.index]); }
+
+    std::unique_ptr<Node> unary(Op op, std::unique_ptr<Node> child) {
+        if (!child) return nullptr;
+        if (is_constant(child)) return constant(Machine::to_json(Machine::unary(op, constant_value(*child))));
+        auto node = std::make_unique<Node>();
+        node->kind = Node::UNARY;
+        node->op = op;
+        node->children.push_back(std::move(child));
+        return node;
+    }
+
+    std::unique_ptr<Node> binary(Op op, std::unique_ptr<Node> left, std::unique_ptr<Node> right) {
+        if (!left || !right) return nullptr;
+        if (left->kind == Node::LIST || (right->kind == Node::LIST && op != Op::IN)) {
+            return fail("a list with paths in it can only follow 'in'");
+        }
+        if (right->kind == Node::LIST) {
+            right->kind = Node::IN_LIST;
+            right->op = Op::IN_LIST;
+            right->children.insert(right->children.begin(), std::move(left));
+            return right;
+        }
+        if (is_constant(left) && is_constant(right)) {
+            return constant(Machine::to_json(Machine::binary(op, constant_value(*left), constant_value(*right))));
+        }
+        auto node = std::make_unique<Node>();
+        node->kind = Node::BINARY;
+        node->op = op;
+        node->children.push_back(std::move(left));
+        node->children.push_back(std::move(right));
+        return node;
+    }
+
+    // A constant left side decides the result or hands it to the right side
+    std::unique_ptr<Node> logical(Node::Kind kind, std::unique_ptr<Node> left, std::unique_ptr<Node> right) {
+        if (!left || !right) return nullptr;
+        if (is_constant(left)) {
+            bool value = Machine::truthy(constant_value(*left));
+            if (value == (kind == Node::OR)) return constant(SharedJson::boolean(value));
+            return unary(Op::TO_BOOL, std::move(right));
+        }
+        auto node = std::make_unique<Node>();
+        node->kind = kind;
+        node->children.push_back(std::move(left));
+        node->children.push_back(std::move(right));
+        return node;
+    }
+
+    std::unique_ptr<Node> parse_or() {
+        if (++nesting_ > kMaxNesting) return fail("expression is nested too deeply");
+        auto left = parse_and();
+        while (left && (eat("||") || eat_word("or"))) left = logical(Node::OR, std::move(left), parse_and());
+        --nesting_;
+        return left;
+    }
+
+    std::unique_ptr<Node> parse_and() {
+        auto left = parse_not();
+        while (left && (eat("&&") || eat_word("and"))) left = logical(Node::AND, std::move(left), parse_not());
+        return left;
+    }
+
+    std::unique_ptr<Node> parse_not() {
+        skip_space();
+        if (eat_word("not") || (text_.substr(pos_, 1) == "!" && text_.substr(pos_, 2) != "!=" && eat("!"))) {
+            if (++nesting_ > kMaxNesting) return fail("expression is nested too deeply");
+            auto node = unary(Op::NOT, parse_not());
+            --nesting_;
+            return node;
+        }
+        return parse_comparison();
+    }
+
+    std::unique_ptr<Node> parse_comparison() {
+        auto left = parse_additive();
+        if (!left) return nullptr;
+        static const std::pair<std::string_view, Op> symbols[] = {
+            {"==", Op::EQUAL}, {"!=", Op::NOT_EQUAL}, {"<=", Op::LESS_EQUAL},
+            {">=", Op::GREATER_EQUAL}, {"<", Op::LESS}, {">", Op::GREATER},
+        };
+        for (const auto& [symbol, op] : symbols) {
+            if (eat(symbol)) return binary(op, std::move(left), parse_additive());
+        }
+        if (eat_word("in")) return binary(Op::IN, std::move(left), parse_additive());
+        size_t before = pos_;
+        if (eat_word("not")) {
+            if (!eat_word("in")) {
+                pos_ = before;
+                return fail("expected 'in' after 'not'");
+            }
+            return unary(Op::NOT, binary(Op::IN, std::move(left), parse_additive()));
+        }
+        return left;
+    }
+
+    std::unique_ptr<Node> parse_additive() {
+        auto left = parse_multiplicative();
+        while (left) {
+            if (eat("+")) {
+                left = binary(Op::ADD, std::move(left), parse_multiplicative());
+            } else if (eat("-")) {
+                left = binary(Op::SUBTRACT, std::move(left), parse_multiplicative());
+            } else {
+                break;
+            }
+        }
+        return left;
+    }
+
+    std::unique_ptr<Node> parse_multiplicative() {
+        auto left = parse_unary();
+        while (left) {
+            if (eat("*")) {
+                left = binary(Op::MULTIPLY, std::move(left), parse_unary());
+            } else if (eat("/")) {
+                left = binary(Op::DIVIDE, std::move(left), parse_unary());
+            } else if (eat("%")) {
+                left = binary(Op::MODULO, std::move(left), parse_unary());
+            } else {
+                break;
+            }
+        }
+        return left;
+    }
+
+    std::unique_ptr<Node> parse_unary() {
+        if (eat("-")) {
+            if (++nesting_ > kMaxNesting) return fail("expression is nested too deeply");
+            auto node = unary(Op::NEGATE, parse_unary());
+            --nesting_;
+            return node;
+        }
+        if (eat("+")) return parse_unary();
+        return parse_primary();
+    }
+
+    std::unique_ptr<Node> parse_primary() {
+        skip_space();
+        if (pos_ >= text_.size()) return fail("expected a value at the end");
+        char c = text_[pos_];
+
+        if (eat("(")) {
+            auto node = parse_or();
+            if (node && !eat(")")) return fail("expected ')'");
+            return node;
+        }
+        if (eat("[")) return parse_list();
+        if (eat("${")) {
+            size_t close = text_.find('}', pos_);
+            if (close == std::string_view::npos) return fail("unterminated placeholder");
+            std::string_view inner = text_.substr(pos_, close - pos_);
+            pos_ = close + 1;
+            return placeholder(inner);
+        }
+        if (c == '\'' || c == '"') return parse_string(c);
+        if (std::isdigit(static_cast<unsigned char>(c)) ||
+            (c == '.' && pos_ + 1 < text_.size() && std::isdigit(static_cast<unsigned char>(text_[pos_ + 1])))) {
+            std::string digits(text_.substr(pos_, 64));
+            char* end = nullptr;
+            double value = std::strtod(digits.c_str(), &end);
+            pos_ += static_cast<size_t>(end - digits.c_str());
+            return constant(SharedJson::number(value));
+        }
+        if (identifier_char(c)) return parse_identifier();
+        return fail("unexpected '" + std::string(1, c) + "'");
+    }
+
+    std::unique_ptr<Node> parse_list() {
+        std::vector<std::unique_ptr<Node>> items;
+        if (!eat("]")) {
+            do {
+                auto item = parse_or();
+                if (!item) return nullptr;
+                items.push_back(std::move(item));
+            } while (eat(","));
+            if (!eat("]")) return fail("expected ']'");
+        }
+        if (std::all_of(items.begin(), items.end(), [&](const auto& item) { return is_constant(item); })) {
+            SharedJson::Array list;
+            for (const auto& item : items) list.push_back(out_.constants_[item->index]);
+            return constant(SharedJson::array(std::move(list)));
+        }
+        auto node = std::make_unique<Node>();
+        node->kind = Node::LIST;
+        node->children = std::move(items);
+        return node;
+    }
+
+    std::unique_ptr<Node> parse_string(char quote) {
+        std::string text;
+        for (++pos_; pos_ < text_.size(); ++pos_) {
+            char c = text_[pos_];
+            if (c == quote) {
+                ++pos_;
+                return constant(SharedJson::string(std::move(text)));
+            }
+            if (c == '\\' && pos_ + 1 < text_.size()) c = text_[++pos_];
+            text += c;
+        }
+        return fail("unterminated string");
+    }
+
+    std::unique_ptr<Node> parse_identifier() {
+        size_t start = pos_;
+        while (pos_ < text_.size() && identifier_char(text_[pos_])) ++pos_;
+        std::string_view word = text_.substr(start, pos_ - start);
+
+        if (same_word(word, "true")) return constant(SharedJson::boolean(true));
+        if (same_word(word, "false")) return constant(SharedJson::boolean(false));
+        if (same_word(word, "null")) return constant(SharedJson());
+        if (word == "len" || word == "exists") {
+            if (!eat("(")) return fail("expected '(' after " + std::string(word));
+            auto argument = parse_or();
+            if (argument && !eat(")")) return fail("expected ')'");
+            return unary(word == "len" ? Op::LENGTH : Op::EXISTS, std::move(argument));
+        }
+        static const std::pair<std::string_view, Clock> clocks[] = {
+            {"current_year", CURRENT_YEAR}, {"current_month", CURRENT_MONTH},
+            {"current_day", CURRENT_DAY}, {"now", NOW},
+        };
+        for (const auto& [name, which] : clocks) {
+            if (word != name) continue;
+            auto node = std::make_unique<Node>();
+            node->kind = Node::CLOCK;
+            node->index = which;
+            return node;
+        }
+
+        // The rest of a path: .field and [index] with no spaces in between
+        size_t end = pos_;
+        while (end < text_.size()) {
+            if (text_[end] == '.' && end + 1 < text_.size() && identifier_char(text_[end + 1])) {
+                for (++end; end < text_.size() && identifier_char(text_[end]); ++end) {}
+            } else if (text_[end] == '[' && end + 1 < text_.size() && std::isdigit(static_cast<unsigned char>(text_[end + 1]))) {
+                size_t close = text_.find(']', end);
+                if (close == std::string_view::npos) break;
+                end = close + 1;
+            } else {
+                break;
+            }
+        }
+        std::string_view rest = text_.substr(pos_, end - pos_);
+        pos_ = end;
+        return path(std::string(word), rest);
+    }
+
+    std::unique_ptr<Node> path(std::string root, std::string_view rest) {
+        Path parsed;
+        parsed.root = std::move(root);
+        size_t pos = 0;
+        while (pos < rest.size()) {
+            if (rest[pos] == '.') {
+                ++pos;
+            } else if (rest[pos] == '[') {
+                size_t close = rest.find(']', pos);
+                std::string_view digits = rest.substr(pos + 1, close == std::string_view::npos ? 0 : close - pos - 1);
+                bool number = !digits.empty() && std::all_of(digits.begin(), digits.end(), [](char c) {
+                    return std::isdigit(static_cast<unsigned char>(c));
+                });
+                if (!number) {
+                    return fail("bad index in path '" + parsed.root + std::string(rest) + "'");
+                }
+                Path::Step step;
+                step.index = std::strtoul(std::string(digits).c_str(), nullptr, 10);
+                parsed.steps.push_back(std::move(step));
+                pos = close + 1;
+            } else {
+                size_t end = rest.find_first_of(".[", pos);
+                if (end == std::string_view::npos) end = rest.size();
+                Path::Step step;
+                step.field = std::string(rest.substr(pos, end - pos));
+                parsed.steps.push_back(std::move(step));
+                pos = end;
+            }
+        }
+        if (parsed.root.empty()) return fail("empty path");
+        if (parsed.root != "INPUT" &&
+            std::find(out_.references_.begin(), out_.references_.end(), parsed.root) == out_.references_.end()) {
+            out_.references_.push_back(parsed.root);
+        }
+        auto node = std::make_unique<Node>();
+        node->kind = Node::PATH;
+        node->index = out_.paths_.size();
+        out_.paths_.push_back(std::move(parsed));
+        return node;
+    }
+
+    // "known_genes.gene_id" or "INPUT.variants[0]"
+    std::unique_ptr<Node> path(std::string_view text) {
+        size_t end = text.find_first_of(".[");
+        if (end == std::string_view::npos) end = text.size();
+        return path(std::string(text.substr(0, end)), text.substr(end));
+    }
+
+    std::unique_ptr<Node> placeholder(std::string_view inner) {
+        size_t colon = inner.find(':');
+        if (colon == std::string_view::npos) return fail("placeholder ${" + std::string(inner) + "} names no kind");
+        std::string_view kind = inner.substr(0, colon);
+        std::string_view argument = inner.substr(colon + 1);
+
+        if (kind == "INPUT") return path("INPUT", argument);
+        if (kind == "REF" || kind == "OUTPUT" || kind == "EXTRACT") return path(argument);
+        if (kind == "LENGTH") return unary(Op::LENGTH, path(argument));
+        if (kind == "EXISTS") return unary(Op::EXISTS, path(argument));
+        if (kind == "CALC") {
+            if (++nesting_ > kMaxNesting) return fail("expression is nested too deeply");
+            Compiler nested(out_, argument);
+            nested.nesting_ = nesting_;
+            auto node = nested.parse();
+            --nesting_;
+            return node;
+        }
+        if (kind == "ENV" || kind == "CONFIG") {
+            std::string text = "${" + std::string(inner) + "}";
+            return constant(SharedJson::string(CompiledTemplate::get(text)->render({})));
+        }
+        return fail("unsupported placeholder ${" + std::string(inner) + "}");
+    }
+};
+
+Expression::Expression(std::string_view text) {
+    Compiler compiler(*this, text);
+    auto root = compiler.parse();
+    if (root) compiler.emit(*root, 0);
+    if (error_.empty() && max_depth_ > kMaxStack) error_ = "expression needs too deep a stack";
+    if (!error_.empty()) {
+        code_.clear();
+        references_.clear();
+    }
+}
+
+std::shared_ptr<const Expression> Expression::get(const std::string& text) {
+    static std::shared_mutex mutex;
+    static std::unordered_map<std::string, std::shared_ptr<const Expression>> cache;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = cache.find(text);
+        if (it != cache.end()) return it->second;
+    }
+    auto compiled = std::make_shared<const Expression>(text);
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (cache.size() >= kMaxCachedExpressions) cache.clear();
+    return cache.emplace(text, std::move(compiled)).first->second;
+}
+
+bool Expression::test(const Scope& scope) const {
+    if (!valid()) return false;
+    Machine::Scratch scratch;
+    return Machine::truthy(Machine::run(*this, scope, scratch));
+}
+
+::JsonValue Expression::evaluate(const Scope& scope) const {
+    if (!valid()) return ::JsonValue::makeNull();
+    Machine::Scratch scratch;
+    return Machine::to_json(Machine::run(*this, scope, scratch)).to_json();
+}
+
+std::string Expression::calculate(const Scope& scope) const {
+    if (!valid()) return "";
+    Machine::Scratch scratch;
+    Machine::Value value = Machine::run(*this, scope, scratch);
+    switch (value.kind) {
+        case Machine::Value::NUMBER: {
+            char text[32];
+            double n = value.number;
+            if (std::isfinite(n) && n == std::floor(n) && std::fabs(n) < 1e15) {
+                std::snprintf(text, sizeof(text), "%.0f", n);
+            } else {
+                std::snprintf(text, sizeof(text), "%.15g", n);
+            }
+            return text;
+        }
+        case Machine::Value::BOOL: return value.boolean ? "true" : "false";
+        case Machine::Value::STRING: return std::string(value.text);
+        case Machine::Value::JSON: return value.json->to_json().serialize();
+        default: return "";
+    }
+}
+
+Expression::MapScope::MapScope(const std::map<std::string, ::JsonValue>& values, const ::JsonValue* input)
+    : values_(&owned_), input_(input ? &owned_input_ : nullptr) {
+    for (const auto& [key, value] : values) owned_.emplace_hint(owned_.end(), key, SharedJson(value));
+    if (input) owned_input_ = SharedJson(*input);
+}
+
+const SharedJson* Expression::MapScope::find(const std::string& root) const {
+    if (input_ && root == "INPUT") return input_;
+    auto it = values_->find(root);
+    return it == values_->end() ? nullptr : &it->second;
+}
+
+} // namespace qc::core
@@ -0,0 +1,108 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include "json_logic.h"
+#include "shared_json.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qc::core {
+
+// Conditions and calculations over workflow data, such as
+//   ${LENGTH:known_genes} > 5 AND INPUT.analysis_depth in ['deep', 'research']
+//   current_year - 3
+//
+// Operands are numbers, 'strings' or "strings", true, false, null, [lists],
+// paths (INPUT.variants[0].gene, or an output key and its fields), and the
+// INPUT, REF, OUTPUT, EXTRACT, LENGTH, EXISTS, CALC, ENV and CONFIG
+// placeholders. Operators, loosest first: OR (||), AND (&&), NOT (!),
+// comparisons (== != < <= > >= in, not in), + -, * / %, unary minus. len(x),
+// exists(x) and the clock values current_year, current_month, current_day
+// and now are built in. A field taken from an array is taken from each of
+// its elements, as in templates.
+//
+// Text is parsed once, constant-folded and compiled to flat bytecode run on
+// a fixed-size stack. Evaluation allocates nothing except when a field is
+// mapped over an array.
+class Expression {
+public:
+    // Where paths start: "INPUT" or an output key
+    class Scope {
+    public:
+        virtual ~Scope() = default;
+        virtual const SharedJson* find(const std::string& root) const = 0;
+    };
+
+    // Roots are keys of `values`; "INPUT" is `input` when given. ::JsonValue
+    // maps are copied in, SharedJson ones are only referenced.
+    class MapScope : public Scope {
+    public:
+        explicit MapScope(const std::map<std::string, SharedJson>& values, const SharedJson* input = nullptr)
+            : values_(&values), input_(input) {}
+        explicit MapScope(const std::map<std::string, ::JsonValue>& values, const ::JsonValue* input = nullptr);
+        MapScope(const MapScope&) = delete;
+        MapScope& operator=(const MapScope&) = delete;
+        const SharedJson* find(const std::string& root) const override;
+
+    private:
+        std::map<std::string, SharedJson> owned_;
+        SharedJson owned_input_;
+        const std::map<std::string, SharedJson>* values_;
+        const SharedJson* input_;
+    };
+
+    explicit Expression(std::string_view text);
+
+    // The compiled form of `text`, compiled on first use
+    static std::shared_ptr<const Expression> get(const std::string& text);
+
+    bool valid() const { return error_.empty(); }
+    const std::string& error() const { return error_; }
+
+    // Whether the result is truthy: false, null, 0, "" and empty collections
+    // are not. Invalid expressions are false.
+    bool test(const Scope& scope) const;
+    // The result as JSON; null for invalid expressions
+    ::JsonValue evaluate(const Scope& scope) const;
+    // The result as text, with integral numbers printed without a fraction
+    std::string calculate(const Scope& scope) const;
+
+    // Roots of the paths read, "INPUT" excluded: the outputs it depends on
+    const std::vector<std::string>& references() const { return references_; }
+    // Instructions left after constant folding
+    size_t size() const { return code_.size(); }
+
+private:
+    enum class Op : uint8_t;
+    struct Instruction {
+        Op op;
+        uint32_t arg;
+    };
+    struct Path {
+        struct Step {
+            std::string field; // Empty for an index
+            size_t index = 0;
+        };
+        std::string root;
+        std::vector<Step> steps;
+    };
+    struct Node;
+    class Compiler; // Parses, folds constants and emits the bytecode
+    class Machine;  // Runs it
+
+    std::vector<Instruction> code_;
+    std::vector<SharedJson> constants_;
+    std::vector<Path> paths_;
+    std::vector<std::string> references_;
+    size_t max_depth_ = 0;
+    std::string error_;
+};
+
+} // namespace qc::core
+
+#endif // EXPRESSION_H
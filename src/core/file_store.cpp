@@ -0,0 +1,191 @@
+#include "file_store.h"
+#include "digest.h"
+#include "../io/file_io.h"
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#ifndef _WIN32
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+namespace qc::core {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// File layout (little endian):
+//   4 bytes magic "QCF1"
+//   u32 crc32 of everything after it
+//   u32 key length
+//   i64 expiry (unix seconds, 0 = never)
+//   key bytes, value bytes
+const char MAGIC[4] = {'Q', 'C', 'F', '1'};
+const size_t HEADER_SIZE = 20;
+const size_t CHECKED_OFFSET = 8;
+const char* ENTRY_SUFFIX = ".entry";
+const char* TEMP_MARKER = ".tmp.";
+
+void put_u32(char* out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out[i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+
+uint32_t get_u32(const char* in) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    return v;
+}
+
+bool is_expired(int64_t expires_at, int64_t now) {
+    return expires_at != 0 && expires_at <= now;
+}
+
+bool is_shard_name(const std::string& name) {
+    return name.size() == 2 && std::isxdigit(static_cast<unsigned char>(name[0])) &&
+           std::isxdigit(static_cast<unsigned char>(name[1]));
+}
+
+// Whether process `pid` may still be running; unknown counts as running
+bool process_alive(long pid) {
+#ifdef _WIN32
+    (void)pid;
+    return true;
+#else
+    if (pid <= 0) return true;
+    if (pid == static_cast<long>(::getpid())) return true;
+    return ::kill(static_cast<pid_t>(pid), 0) == 0 || errno != ESRCH;
+#endif
+}
+
+// A temp file ("<entry>.tmp.<pid>.<n>") belongs to a write that never
+// finished once its writer has exited, or once it is older than any write
+// takes. Until then another process may still be writing it.
+bool is_stale_temp(const fs::path& path, std::chrono::seconds stale_after) {
+    std::string name = path.filename().string();
+    size_t marker = name.rfind(TEMP_MARKER);
+    if (marker == std::string::npos) return false;
+
+    const char* digits = name.c_str() + marker + std::strlen(TEMP_MARKER);
+    char* end = nullptr;
+    long pid = std::strtol(digits, &end, 10);
+    if (end != digits && *end == '.' && !process_alive(pid)) return true;
+
+    std::error_code ec;
+    auto modified = fs::last_write_time(path, ec);
+    return !ec && fs::file_time_type::clock::now() - modified > stale_after;
+}
+
+} // namespace
+
+FileStore::FileStore(const std::string& dir) : FileStore(dir, Options{}) {}
+
+FileStore::FileStore(const std::string& dir, const Options& options) : dir_(dir), options_(options) {
+    fs::create_directories(dir_);
+}
+
+std::string FileStore::path_for(const std::string& key) const {
+    std::string name = hex_encode(digest128(key));
+    return dir_ + "/" + name.substr(0, 2) + "/" + name.substr(2, 2) + "/" + name + ENTRY_SUFFIX;
+}
+
+std::optional<FileStore::Entry> FileStore::read_entry(const std::string& path) {
+    auto file = io::MappedFile::open(path);
+    if (!file || file->size() < HEADER_SIZE || std::memcmp(file->data(), MAGIC, 4) != 0) return std::nullopt;
+
+    const char* data = file->data();
+    if (crc32(data + CHECKED_OFFSET, file->size() - CHECKED_OFFSET) != get_u32(data + 4)) return std::nullopt;
+    uint32_t key_length = get_u32(data + 8);
+    if (key_length > file->size() - HEADER_SIZE) return std::nullopt;
+    uint64_t expiry = static_cast<uint64_t>(get_u32(data + 12)) | static_cast<uint64_t>(get_u32(data + 16)) << 32;
+
+    Entry entry;
+    entry.key.assign(data + HEADER_SIZE, key_length);
+    entry.value.assign(data + HEADER_SIZE + key_length, file->size() - HEADER_SIZE - key_length);
+    entry.expires_at = static_cast<int64_t>(expiry);
+    return entry;
+}
+
+bool FileStore::put(const std::string& key, const std::string& value, int64_t expires_at) {
+    std::string record(HEADER_SIZE, '\0');
+    record.reserve(HEADER_SIZE + key.size() + value.size());
+    std::memcpy(&record[0], MAGIC, 4);
+    put_u32(&record[8], static_cast<uint32_t>(key.size()));
+    put_u32(&record[12], static_cast<uint32_t>(static_cast<uint64_t>(expires_at)));
+    put_u32(&record[16], static_cast<uint32_t>(static_cast<uint64_t>(expires_at) >> 32));
+    record += key;
+    record += value;
+    put_u32(&record[4], crc32(record.data() + CHECKED_OFFSET, record.size() - CHECKED_OFFSET));
+
+    std::string path = path_for(key);
+    std::vector<std::string_view> chunks = {record};
+    if (io::FileIO::write_atomic(path, chunks, options_.durable)) return true;
+
+    // Shard directories are created on first use
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    return !ec && io::FileIO::write_atomic(path, chunks, options_.durable);
+}
+
+std::optional<std::string> FileStore::get(const std::string& key, int64_t now, int64_t* expires_at) const {
+    auto entry = read_entry(path_for(key));
+    // A different key here would mean a digest collision; treat it as a miss
+    if (!entry || entry->key != key || is_expired(entry->expires_at, now)) return std::nullopt;
+    if (expires_at) *expires_at = entry->expires_at;
+    return std::move(entry->value);
+}
+
+bool FileStore::remove(const std::string& key) {
+    std::string path = path_for(key);
+    auto entry = read_entry(path);
+    if (!entry || entry->key != key) return false;
+    std::error_code ec;
+    return fs::remove(path, ec);
+}
+
+std::vector<std::string> FileStore::expire(const std::vector<std::string>& keys, int64_t now) {
+    std::vector<std::string> dropped;
+    for (const auto& key : keys) {
+        std::string path = path_for(key);
+        auto entry = read_entry(path);
+        if (!entry || entry->key != key || !is_expired(entry->expires_at, now)) continue;
+        std::error_code ec;
+        if (fs::remove(path, ec)) dropped.push_back(key);
+    }
+    return dropped;
+}
+
+void FileStore::scan(const std::function<void(const std::string& key, std::string_view value,
+                                              int64_t expires_at)>& visit) const {
+    std::error_code ec;
+    for (const auto& outer : fs::directory_iterator(dir_, ec)) {
+        if (!outer.is_directory() || !is_shard_name(outer.path().filename().string())) continue;
+        for (const auto& inner : fs::directory_iterator(outer.path(), ec)) {
+            if (!inner.is_directory() || !is_shard_name(inner.path().filename().string())) continue;
+            for (const auto& file : fs::directory_iterator(inner.path(), ec)) {
+                const fs::path& path = file.path();
+                if (path.extension() != ENTRY_SUFFIX) {
+                    if (is_stale_temp(path, options_.stale_temp_after)) fs::remove(path, ec);
+                    continue;
+                }
+                auto entry = read_entry(path.string());
+                if (entry && path_for(entry->key) == path.string()) {
+                    visit(entry->key, entry->value, entry->expires_at);
+                }
+            }
+        }
+    }
+}
+
+void FileStore::clear() {
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir_, ec)) {
+        if (entry.is_directory() && is_shard_name(entry.path().filename().string())) {
+            fs::remove_all(entry.path(), ec);
+        }
+    }
+}
+
+} // namespace qc::core
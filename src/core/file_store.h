@@ -0,0 +1,61 @@
+#ifndef FILE_STORE_H
+#define FILE_STORE_H
+
+#include "key_value_store.h"
+#include <chrono>
+#include <string>
+
+namespace qc::core {
+
+// One file per key. File names are the hex digest of the key, fanned out over
+// two levels of 256 shard directories (dir/ab/cd/abcd....entry), so names are
+// fixed-length and safe whatever the key contains, and no directory grows
+// large enough for lookups to slow down. Each file starts with a header that
+// carries the original key, checked on every read, the expiry time and a
+// checksum over all of it. Files are replaced atomically, so readers never
+// see a partial one.
+class FileStore : public KeyValueStore {
+public:
+    struct Options {
+        bool durable = false; // fdatasync each file before it replaces the old one
+        // Temp files of another live process are left alone until this old
+        std::chrono::seconds stale_temp_after = std::chrono::hours(1);
+    };
+
+    explicit FileStore(const std::string& dir);
+    FileStore(const std::string& dir, const Options& options);
+
+    bool put(const std::string& key, const std::string& value, int64_t expires_at = 0) override;
+    std::optional<std::string> get(const std::string& key, int64_t now,
+                                   int64_t* expires_at = nullptr) const override;
+    bool remove(const std::string& key) override;
+    std::vector<std::string> expire(const std::vector<std::string>& keys, int64_t now) override;
+
+    // Walks every shard directory; also removes temp files of writes that
+    // were interrupted, leaving those still in flight
+    void scan(const std::function<void(const std::string& key, std::string_view value,
+                                       int64_t expires_at)>& visit) const override;
+
+    void clear() override;
+    // Each put is already complete on return; with Options::durable it is also synced
+    void sync() override {}
+
+    // Path of the file holding `key`, whether or not it exists
+    std::string path_for(const std::string& key) const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::string value;
+        int64_t expires_at = 0;
+    };
+
+    std::string dir_;
+    Options options_;
+
+    static std::optional<Entry> read_entry(const std::string& path);
+};
+
+} // namespace qc::core
+
+#endif // FILE_STORE_H
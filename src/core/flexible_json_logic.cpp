@@ -1,56 +1,13 @@
 #include "flexible_json_logic.h"
-#include <cstdlib>
-#include <regex>
+#include "compiled_template.h"
+#include "expression.h"
+#include "parameter_plan.h"
 
 // Enhanced JSON value with template resolution and validation
 std::string FlexibleJsonValue::resolveTemplate(const std::string& template_str,
                                const std::map<std::string, std::string>& context) const {
-    std::string result = template_str;
-    std::regex re("\\$\\{([^}]+)\\}");
-    std::smatch match;
-
-    while (std::regex_search(result, match, re)) {
-        std::string full_match = match[0].str();
-        std::string inner_content = match[1].str();
-
-        size_t colon_pos = inner_content.find(':');
-        if (colon_pos != std::string::npos) {
-            std::string type = inner_content.substr(0, colon_pos);
-            std::string key = inner_content.substr(colon_pos + 1);
-            std::string replacement = "";
-
-            if (type == "ENV") {
-                const char* env_val = std::getenv(key.c_str());
-                if (env_val) {
-                    replacement = env_val;
-                }
-            } else if (type == "CONFIG") {
-                size_t pipe_pos = key.find('|');
-                std::string var_name = key;
-                std::string default_val = "";
-                if (pipe_pos != std::string::npos) {
-                    var_name = key.substr(0, pipe_pos);
-                    default_val = key.substr(pipe_pos + 1);
-                }
-
-                auto it = context.find(var_name);
-                if (it != context.end()) {
-                    replacement = it->second;
-                } else {
-                    replacement = default_val;
-                }
-            } else if (type == "INPUT") {
-                 auto it = context.find(key);
-                if (it != context.end()) {
-                    replacement = it->second;
-                }
-            }
-            // Other types like CALC, EXTRACT to be implemented
-
-            result.replace(result.find(full_match), full_match.length(), replacement);
-        }
-    }
-    return result;
+    // Other kinds like EXTRACT resolve to nothing here
+    return qc::core::CompiledTemplate::get(template_str)->render(context);
 }
 
 bool FlexibleJsonValue::validateAgainstSchema(const JsonValue& schema) const {
@@ -58,15 +15,14 @@ bool FlexibleJsonValue::validateAgainstSchema(const JsonValue& schema) const {
     return true;
 }
 
+// The rules are a parameter schema; see ParameterPlan
 JsonValue FlexibleJsonValue::transformParameters(const JsonValue& transformation_rules) const {
-    // TODO: Implementation
-    return JsonValue();
+    return qc::core::ParameterPlan::compile(transformation_rules)->apply(JsonValue(*this));
 }
 
 bool FlexibleJsonValue::evaluateCondition(const std::string& condition,
                           const std::map<std::string, JsonValue>& context) const {
-    // TODO: Implementation
-    return true;
+    return qc::core::Expression::get(condition)->test(qc::core::Expression::MapScope(context));
 }
 
 std::vector<JsonValue> FlexibleJsonValue::extractValues(const std::string& path) const {
@@ -74,13 +30,51 @@ std::vector<JsonValue> FlexibleJsonValue::extractValues(const std::string& path)
     return std::vector<JsonValue>();
 }
 
+// See SharedJson::merge for the strategies
 JsonValue FlexibleJsonValue::merge(const std::vector<JsonValue>& values,
                           const std::string& strategy) {
-    // TODO: Implementation
-    return JsonValue();
+    std::vector<qc::core::SharedJson> shared;
+    shared.reserve(values.size());
+    for (const auto& value : values) shared.emplace_back(value);
+    return qc::core::SharedJson::merge(shared, strategy).to_json();
 }
 
+// {"genes": ["gene", "gene_ids"], "condition": "disorder"} renames the
+// aliases to their canonical keys
 JsonValue FlexibleJsonValue::resolveAliases(const JsonValue& alias_map) const {
-    // TODO: Implementation
-    return JsonValue();
+    JsonValue properties = JsonValue::makeObject();
+    for (const auto& [canonical, aliases] : alias_map.object_value) {
+        JsonValue list = aliases;
+        if (aliases.type == JsonValue::STRING) {
+            list = JsonValue::makeArray();
+            list.array_value.push_back(aliases);
+        }
+        JsonValue property = JsonValue::makeObject();
+        property.object_value["aliases"] = std::move(list);
+        properties.object_value[canonical] = std::move(property);
+    }
+    return qc::core::ParameterPlan::compile(properties)->apply(JsonValue(*this));
+}
+
+// Utility functions for template resolution
+std::string TemplateUtils::resolveCalculation(const std::string& expression) {
+    static const std::map<std::string, qc::core::SharedJson> nothing;
+    return qc::core::Expression::get(expression)->calculate(qc::core::Expression::MapScope(nothing));
+}
+
+std::vector<std::string> TemplateUtils::extractTemplateVariables(const std::string& template_str) {
+    std::vector<std::string> variables;
+    size_t pos = 0;
+    while ((pos = template_str.find("${", pos)) != std::string::npos) {
+        size_t end = template_str.find('}', pos + 2);
+        if (end == std::string::npos) break;
+        variables.push_back(template_str.substr(pos + 2, end - pos - 2));
+        pos = end + 1;
+    }
+    return variables;
+}
+
+bool TemplateUtils::isTemplateString(const std::string& str) {
+    size_t pos = str.find("${");
+    return pos != std::string::npos && str.find('}', pos + 2) != std::string::npos;
 }
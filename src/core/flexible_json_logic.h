@@ -2,17 +2,37 @@
 #define FLEXIBLE_JSON_LOGIC_H
 
 #include "json_logic.h"
+#include "shared_json.h"
+#include "thread_buffers.h"
 #include <map>
 #include <vector>
 #include <functional>
 #include <memory>
-#include <regex>
+#include <optional>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <unordered_map>
 #include <cstddef>
+#include <cstdint>
 
 // Forward declarations
 class DataSource;
 class ConfigurationManager;
 class WorkflowEngine;
+namespace qc::core {
+class CacheManager;
+class ParameterPlan;
+class CancellationToken;
+template <typename Connection>
+class ConnectionPool;
+class DatabaseConnection;
+struct DatabaseSession;
+class EventLoop;
+class TraceRecorder;
+class WorkflowPlan;
+class WorkStealingPool;
+}
 
 // Enhanced JSON value with template resolution and validation
 class FlexibleJsonValue : public JsonValue {
@@ -45,18 +65,54 @@ public:
 // Abstract base class for data sources
 class DataSource {
 public:
+    // Receives the result, or an {"error": ...} object
+    using Completion = std::function<void(JsonValue result)>;
+    
     virtual ~DataSource() = default;
     virtual JsonValue execute(const std::string& operation, 
                              const JsonValue& parameters) = 0;
+    
+    // Asynchronous execute. `done` runs exactly once, on any thread; a
+    // cancelled call may complete with an error early. Sources doing
+    // non-blocking I/O override this to return immediately, and must
+    // outlive every call they accepted. The default runs execute() on a
+    // shared pool of blocking-call threads, which grows past calls that
+    // hang up to 256 running at once; see closeBlockingCalls().
+    virtual void executeAsync(const std::string& operation,
+                              const JsonValue& parameters,
+                              const qc::core::CancellationToken& cancel,
+                              Completion done);
+    
+    // Waits for the default executeAsync's calls already running, and makes
+    // the queued and later ones complete with an error without touching
+    // the source. Call it before destroying a source; ConfigurationManager
+    // does for the sources it owns. A deadline or cancellation completes
+    // a call early, so the run that issued it may already be over.
+    void closeBlockingCalls();
     virtual bool isAvailable() const = 0;
     virtual std::string getType() const = 0;
     virtual std::string getName() const = 0;
     
+    // Changes whenever the data behind the source does, so results memoized
+    // under an older version are not reused. Empty when the source cannot
+    // tell; then only cache TTLs bound how stale a reused result gets.
+    virtual std::string getVersion() const { return ""; }
+    
     // Health check
     virtual bool healthCheck() const { return isAvailable(); }
     
     // Get connection info
     virtual JsonValue getConnectionInfo() const = 0;
+    
+private:
+    struct BlockingCalls {
+        std::mutex mutex;
+        std::condition_variable idle;
+        size_t running = 0;
+        bool closed = false;
+    };
+    // Shared with the queued calls, which may outlive the source
+    std::shared_ptr<BlockingCalls> blocking_ = std::make_shared<BlockingCalls>();
 };
 
 // REST API data source implementation
@@ -85,26 +141,43 @@ private:
     void applyRateLimiting() const;
 };
 
-// Database data source implementation
+// Database data source implementation. Endpoints name queries in the
+// config's "queries": {"getGene": {"sql": "SELECT ... WHERE symbol = ?",
+// "parameters": ["gene"]}}, whose parameters bind in the order listed. An
+// array parameter binds one element per run, so a gene list runs the
+// statement once per gene, all in one batch.
+//
+// Connections come from a pool bounded by "connection_pool" and opened
+// through the driver's connector; each keeps its prepared statements, so a
+// repeated query costs only its execution.
 class DatabaseDataSource : public DataSource {
+public:
+    // Opens a connection to `connection_string`; null when it cannot
+    using Connector = std::function<std::unique_ptr<qc::core::DatabaseConnection>(const std::string& connection_string)>;
+    
 private:
     std::string connection_string_;
     int connection_timeout_;
     int query_timeout_;
+    size_t statement_cache_size_;
+    JsonValue queries_;
+    std::unique_ptr<qc::core::ConnectionPool<qc::core::DatabaseSession>> pool_; // Null without a connector
     
 public:
-    DatabaseDataSource(const JsonValue& config);
+    DatabaseDataSource(const JsonValue& config, Connector connect = nullptr);
+    ~DatabaseDataSource() override;
     
     JsonValue execute(const std::string& operation, 
                      const JsonValue& parameters) override;
     bool isAvailable() const override;
+    bool healthCheck() const override;
     std::string getType() const override { return "database"; }
     std::string getName() const override;
     JsonValue getConnectionInfo() const override;
     
 private:
     JsonValue executeQuery(const std::string& query, 
-                          const std::vector<std::string>& params) const;
+                          const std::vector<std::vector<std::optional<std::string>>>& batch) const;
 };
 
 // File system data source implementation
@@ -135,12 +208,17 @@ private:
     std::string cache_path_;
     int ttl_seconds_;
     size_t max_size_bytes_;
+    std::shared_ptr<qc::core::CacheManager> cache_;
     
 public:
     CacheDataSource(const JsonValue& config);
     
     JsonValue execute(const std::string& operation, 
                      const JsonValue& parameters) override;
+    void executeAsync(const std::string& operation,
+                      const JsonValue& parameters,
+                      const qc::core::CancellationToken& cancel,
+                      Completion done) override;
     bool isAvailable() const override;
     std::string getType() const override { return "cache"; }
     std::string getName() const override;
@@ -211,7 +289,7 @@ struct WorkflowOperation {
     JsonValue cache_config;
     JsonValue fallback_config;
     std::string condition;
-    int timeout_seconds;
+    double timeout_seconds; // Deadline for data source calls; 0 waits indefinitely
     
     WorkflowOperation() : type(OperationType::ENDPOINT_CALL), timeout_seconds(30) {}
 };
@@ -233,41 +311,98 @@ struct Workflow {
     JsonValue output_schema;
     std::vector<WorkflowStep> steps;
     JsonValue error_handling;
-    int global_timeout;
+    double global_timeout; // Seconds; 0 waits indefinitely
+    std::shared_ptr<const qc::core::WorkflowPlan> plan; // Built by ConfigurationManager::loadWorkflow
     
     Workflow() : global_timeout(300) {}
 };
 
-// Workflow execution context
+// Workflow execution context, shared by the operations of a run. The input
+// and outputs are kept as SharedJson, so input(), output() and outputs()
+// hand out handles in O(1); getInput(), getOutput() and getAllOutputs()
+// deep-copy into JsonValue for callers that need one.
+//
+// Concurrent operations write without sharing a lock. Every output_key the
+// plan names gets its own slot when the context is made: a write publishes
+// the new value with one atomic exchange and a read is one atomic load.
+// Values a slot replaces are kept until the context goes, so a reader never
+// holds one that was freed. Keys the plan did not name get a slot on first
+// write, under a lock. Errors and warnings go to a buffer per thread and
+// are merged, in the order they were added, at step boundaries and
+// whenever they are read.
 class WorkflowContext {
 private:
+    struct Cell {
+        qc::core::SharedJson value;
+        Cell* previous; // The value it replaced
+    };
+    struct Slot {
+        std::atomic<Cell*> head{nullptr};
+    };
+    struct Message {
+        uint64_t sequence;
+        bool error;
+        std::string text;
+    };
+    
+    Slot input_;
+    std::unordered_map<std::string, Slot> planned_; // Fixed once constructed
+    mutable std::mutex mutex_;
+    std::map<std::string, Slot> unplanned_;
     std::map<std::string, JsonValue> variables_;
-    std::map<std::string, JsonValue> outputs_;
-    JsonValue input_;
-    std::vector<std::string> errors_;
-    std::vector<std::string> warnings_;
+    
+    mutable qc::core::ThreadBuffers<std::vector<Message>> pending_;
+    mutable std::mutex messages_mutex_;
+    mutable std::vector<std::string> errors_;
+    mutable std::vector<std::string> warnings_;
+    std::atomic<uint64_t> sequence_{0};
+    std::atomic<size_t> errors_added_{0};
+    
+    static void publish(Slot& slot, qc::core::SharedJson value);
+    static const qc::core::SharedJson* current(const Slot& slot);
+    static void release(Slot& slot);
+    const Slot* findSlot(const std::string& key) const;
+    void addMessage(bool error, const std::string& text);
     
 public:
-    void setInput(const JsonValue& input) { input_ = input; }
-    JsonValue getInput() const { return input_; }
+    explicit WorkflowContext(const std::vector<std::string>& output_keys = {});
+    ~WorkflowContext();
+    WorkflowContext(const WorkflowContext&) = delete;
+    WorkflowContext& operator=(const WorkflowContext&) = delete;
+    
+    void setInput(const JsonValue& input) { publish(input_, qc::core::SharedJson(input)); }
+    qc::core::SharedJson input() const;
+    JsonValue getInput() const { return input().to_json(); }
     
     void setVariable(const std::string& key, const JsonValue& value) {
+        std::lock_guard<std::mutex> lock(mutex_);
         variables_[key] = value;
     }
     JsonValue getVariable(const std::string& key) const;
     
     void setOutput(const std::string& key, const JsonValue& value) {
-        outputs_[key] = value;
+        setOutput(key, qc::core::SharedJson(value));
     }
+    void setOutput(const std::string& key, qc::core::SharedJson value);
+    qc::core::SharedJson output(const std::string& key) const; // Null when missing
+    std::map<std::string, qc::core::SharedJson> outputs() const;
     JsonValue getOutput(const std::string& key) const;
+    bool hasOutput(const std::string& key) const;
     JsonValue getAllOutputs() const;
     
-    void addError(const std::string& error) { errors_.push_back(error); }
-    void addWarning(const std::string& warning) { warnings_.push_back(warning); }
+    // The current value, or nullptr; valid for as long as the context is
+    const qc::core::SharedJson* findInput() const { return current(input_); }
+    const qc::core::SharedJson* findOutput(const std::string& key) const;
     
-    std::vector<std::string> getErrors() const { return errors_; }
-    std::vector<std::string> getWarnings() const { return warnings_; }
-    bool hasErrors() const { return !errors_.empty(); }
+    void addError(const std::string& error) { addMessage(true, error); }
+    void addWarning(const std::string& warning) { addMessage(false, warning); }
+    // Folds the per-thread buffers into the lists getErrors() and
+    // getWarnings() return
+    void mergeMessages() const;
+    
+    std::vector<std::string> getErrors() const;
+    std::vector<std::string> getWarnings() const;
+    bool hasErrors() const { return errors_added_ > 0; }
 };
 
 // Main configuration manager
@@ -279,6 +414,8 @@ private:
     std::map<std::string, Workflow> workflows_;
     JsonValue parameter_templates_;
     JsonValue validation_rules_;
+    // Compiled from each endpoint's parameter schema when the config loads
+    std::map<std::string, std::shared_ptr<const qc::core::ParameterPlan>> parameter_plans_;
     
 public:
     ConfigurationManager();
@@ -298,10 +435,13 @@ public:
     bool registerProcessor(const std::string& name, 
                           std::unique_ptr<DataProcessor> processor);
     DataProcessor* getProcessor(const std::string& name) const;
+    JsonValue getProcessorConfig(const std::string& name) const;
+    JsonValue getCachingConfig() const;
     
-    // Parameter resolution and validation
+    // Parameter resolution and validation. Parameters of endpoints without
+    // a schema come back as they are.
     JsonValue resolveParameters(const std::string& endpoint, 
-                               const JsonValue& input_params) const;
+                               JsonValue input_params) const;
     bool validateRequest(const std::string& endpoint, 
                         const JsonValue& parameters) const;
     JsonValue transformParameters(const JsonValue& params, 
@@ -320,21 +460,46 @@ public:
 private:
     void initializeBuiltinProcessors();
     void initializeDataSources();
+    void compileParameterPlans();
+    std::map<std::string, std::string> configValues() const;
     bool validateParameterTemplate(const JsonValue& template_def) const;
 };
 
-// Workflow execution engine
+// Workflow execution engine. Operations start on a work-stealing pool as
+// soon as the outputs they reference are available, longest remaining
+// dependency chain first, so a workflow takes about as long as its critical
+// path. Data source calls go through executeAsync and hold no worker while
+// in flight; an event loop enforces their deadlines and the workflow's
+// global timeout by cancelling them.
 class WorkflowEngine {
 private:
+    struct Run; // One execution of a plan, shared with the callbacks it issues
+    
     ConfigurationManager* config_manager_;
-    std::map<std::string, JsonValue> cache_;
+    // Memoized operation results, shared across runs and processes
+    mutable std::shared_ptr<qc::core::CacheManager> results_;
+    mutable std::mutex results_mutex_;
+    std::unique_ptr<qc::core::WorkStealingPool> pool_;
+    std::unique_ptr<qc::core::EventLoop> loop_;
+    std::map<std::string, double> operation_costs_; // Smoothed wall time per operation, ms
+    mutable std::mutex costs_mutex_;
     
 public:
-    WorkflowEngine(ConfigurationManager* config_manager);
+    // Workers only resolve parameters and route results; 0 picks one per
+    // hardware thread
+    WorkflowEngine(ConfigurationManager* config_manager, size_t worker_threads = 0);
+    ~WorkflowEngine();
     
     // Workflow execution
     JsonValue executeWorkflow(const std::string& workflow_name, 
                              const JsonValue& input);
+    // Stops early once `cancel` fires, cancelling the operations in flight.
+    // With a `trace`, the run records its spans there and the result gains
+    // a "trace_summary".
+    JsonValue executeWorkflow(const std::string& workflow_name,
+                             const JsonValue& input,
+                             const qc::core::CancellationToken& cancel,
+                             qc::core::TraceRecorder* trace = nullptr);
     JsonValue executeWorkflowStep(const WorkflowStep& step, 
                                  WorkflowContext& context);
     JsonValue executeOperation(const WorkflowOperation& operation, 
@@ -354,7 +519,12 @@ public:
                                   const std::string& error,
                                   WorkflowContext& context);
     
-    // Caching
+    // Caching. Results of operations with "cache": {"enabled": true} are
+    // stored under a digest of the operation, its resolved parameters and
+    // the data source version, for the operation's "ttl" (default: the
+    // config's caching.default_ttl). Without a store set here, one is opened
+    // under the config's file-system cache_dir on first use.
+    void setResultCache(std::shared_ptr<qc::core::CacheManager> cache);
     void setCacheValue(const std::string& key, const JsonValue& value);
     JsonValue getCacheValue(const std::string& key) const;
     bool hasCacheValue(const std::string& key) const;
@@ -364,8 +534,35 @@ private:
     std::string generateCacheKey(const WorkflowOperation& operation,
                                 const JsonValue& resolved_params) const;
     bool shouldUseCache(const WorkflowOperation& operation) const;
+    qc::core::CacheManager& resultCache() const;
+    void memoizeResult(const WorkflowOperation& operation, const std::string& key,
+                       const qc::core::SharedJson& value);
     JsonValue applyFallback(const WorkflowOperation& operation,
                            WorkflowContext& context) const;
+    
+    std::vector<qc::core::SharedJson> runPlan(const Workflow& workflow,
+                                              std::shared_ptr<const qc::core::WorkflowPlan> plan,
+                                              WorkflowContext& context,
+                                              const qc::core::CancellationToken& cancel,
+                                              qc::core::TraceRecorder* trace = nullptr);
+    std::vector<JsonValue> runOperations(const std::vector<WorkflowOperation>& operations,
+                                         const std::string& execution_type,
+                                         WorkflowContext& context);
+    void scheduleOperation(const std::shared_ptr<Run>& run, size_t index);
+    void startOperation(const std::shared_ptr<Run>& run, size_t index);
+    void finishOperation(const std::shared_ptr<Run>& run, size_t index, qc::core::SharedJson result,
+                         const std::string& error, bool allow_fallback);
+    JsonValue invokeOperation(const WorkflowOperation& operation,
+                              const JsonValue& resolved_params) const;
+    qc::core::SharedJson mergeInputs(const WorkflowOperation& operation,
+                                     const WorkflowContext& context) const;
+    JsonValue resolveValue(const JsonValue& value, const WorkflowContext& context) const;
+    qc::core::SharedJson resolveShared(const JsonValue& value, const WorkflowContext& context) const;
+    qc::core::SharedJson resolvePlaceholder(const std::string& placeholder,
+                                            const WorkflowContext& context) const;
+    bool conditionHolds(const std::string& condition, const WorkflowContext& context) const;
+    double operationCost(const std::string& key) const;
+    void recordOperationCost(const std::string& key, double milliseconds);
 };
 
 // Utility functions for template resolution
@@ -0,0 +1,62 @@
+#include "json_bridge.h"
+
+namespace qc::core {
+
+io::JsonValue to_io(const ::JsonValue& value) {
+    switch (value.type) {
+        case ::JsonValue::STRING: return io::JsonValue{value.string_value};
+        case ::JsonValue::NUMBER: return io::JsonValue{value.number_value};
+        case ::JsonValue::BOOL: return io::JsonValue{value.bool_value};
+        case ::JsonValue::NIL: return io::JsonValue{};
+        case ::JsonValue::ARRAY: {
+            io::JsonArray items;
+            for (const auto& item : value.array_value) items.push_back(to_io(item));
+            return io::JsonValue{items};
+        }
+        case ::JsonValue::OBJECT: {
+            io::JsonObject fields;
+            for (const auto& [key, item] : value.object_value) fields[key] = to_io(item);
+            return io::JsonValue{fields};
+        }
+    }
+    return io::JsonValue{};
+}
+
+io::JsonValue to_io(const SharedJson& value) {
+    switch (value.type()) {
+        case ::JsonValue::STRING: return io::JsonValue{value.as_string()};
+        case ::JsonValue::NUMBER: return io::JsonValue{value.as_number()};
+        case ::JsonValue::BOOL: return io::JsonValue{value.as_bool()};
+        case ::JsonValue::NIL: return io::JsonValue{};
+        case ::JsonValue::ARRAY: {
+            io::JsonArray items;
+            for (const auto& item : value.items()) items.push_back(to_io(item));
+            return io::JsonValue{items};
+        }
+        case ::JsonValue::OBJECT: {
+            io::JsonObject fields;
+            for (const auto& [key, item] : value.members()) fields[key] = to_io(item);
+            return io::JsonValue{fields};
+        }
+    }
+    return io::JsonValue{};
+}
+
+::JsonValue from_io(const io::JsonValue& value) {
+    if (value.is_string()) return ::JsonValue::makeString(value.as_string());
+    if (value.is_number()) return ::JsonValue::makeNumber(value.as_number());
+    if (value.is_bool()) return ::JsonValue::makeBool(value.as_bool());
+    if (value.is_array()) {
+        ::JsonValue items = ::JsonValue::makeArray();
+        for (const auto& item : value.as_array()) items.array_value.push_back(from_io(item));
+        return items;
+    }
+    if (value.is_object()) {
+        ::JsonValue fields = ::JsonValue::makeObject();
+        for (const auto& [key, item] : value.as_object()) fields.object_value[key] = from_io(item);
+        return fields;
+    }
+    return ::JsonValue::makeNull();
+}
+
+} // namespace qc::core
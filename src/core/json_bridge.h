@@ -0,0 +1,18 @@
+#ifndef JSON_BRIDGE_H
+#define JSON_BRIDGE_H
+
+#include "json_logic.h"
+#include "shared_json.h"
+#include "../io/json_parser.h"
+
+namespace qc::core {
+
+// Conversions between the legacy ::JsonValue used by the configuration and
+// workflow classes and the qc::io::JsonValue used by the parsers and stores
+io::JsonValue to_io(const ::JsonValue& value);
+io::JsonValue to_io(const SharedJson& value);
+::JsonValue from_io(const io::JsonValue& value);
+
+} // namespace qc::core
+
+#endif // JSON_BRIDGE_H
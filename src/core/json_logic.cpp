@@ -2,6 +2,7 @@
 #include <cctype>
 #include <sstream>
 #include <cstddef>
+#include <string_view>
 
 // Constructors and factory methods
 JsonValue::JsonValue() : type(NIL), number_value(0), bool_value(false) {}
@@ -61,30 +62,30 @@ std::string JsonValue::serialize() const {
 }
 
 // Forward declaration for recursive parsing
-static JsonValue parse_value(const std::string& s, size_t& i);
+static JsonValue parse_value(std::string_view s, size_t& i);
 
 // Helper to skip whitespace
-static void skip_space(const std::string& s, size_t& i) {
+static void skip_space(std::string_view s, size_t& i) {
     while (i < s.size() && isspace(s[i])) {
         i++;
     }
 }
 
 // Helper to parse a string
-static std::string parse_string(const std::string& s, size_t& i) {
+static std::string parse_string(std::string_view s, size_t& i) {
     i++; // Skip leading '"'
     size_t start = i;
     while (i < s.size() && s[i] != '"') {
         // This parser doesn't handle escaped quotes, for simplicity
         i++;
     }
-    std::string str = s.substr(start, i - start);
+    std::string str(s.substr(start, i - start));
     i++; // Skip trailing '"'
     return str;
 }
 
 // Helper to parse an object
-static JsonValue parse_object(const std::string& s, size_t& i) {
+static JsonValue parse_object(std::string_view s, size_t& i) {
     JsonValue obj = JsonValue::makeObject();
     i++; // Skip '{'
     skip_space(s, i);
@@ -95,7 +96,7 @@ static JsonValue parse_object(const std::string& s, size_t& i) {
         skip_space(s, i);
         obj.object_value[key] = parse_value(s, i);
         skip_space(s, i);
-        if (s[i] == ',') {
+        if (i < s.size() && s[i] == ',') {
             i++;
             skip_space(s, i);
         }
@@ -105,8 +106,9 @@ static JsonValue parse_object(const std::string& s, size_t& i) {
 }
 
 // Main recursive value parser
-static JsonValue parse_value(const std::string& s, size_t& i) {
+static JsonValue parse_value(std::string_view s, size_t& i) {
     skip_space(s, i);
+    if (i >= s.size()) return JsonValue::makeNull();
     switch (s[i]) {
         case '"':
             return JsonValue::makeString(parse_string(s, i));
@@ -126,12 +128,16 @@ static JsonValue parse_value(const std::string& s, size_t& i) {
             while (i < s.size() && (isdigit(s[i]) || s[i] == '.' || s[i] == '-')) {
                 i++;
             }
-            double num = std::stod(s.substr(start, i - start));
+            double num = std::stod(std::string(s.substr(start, i - start)));
             return JsonValue::makeNumber(num);
     }
 }
 
 JsonValue JsonValue::parse(const std::string& s) {
+    return parse(s.data(), s.size());
+}
+
+JsonValue JsonValue::parse(const char* data, size_t size) {
     size_t i = 0;
-    return parse_value(s, i);
+    return parse_value(std::string_view(data, size), i);
 }
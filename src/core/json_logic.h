@@ -1,5 +1,6 @@
 #ifndef JSON_LOGIC_H
 #define JSON_LOGIC_H
+#include <cstddef>
 #include <string>
 #include <map>
 #include <vector>
@@ -16,6 +17,11 @@ public:
     std::vector<JsonValue> array_value;
 
     JsonValue();
+    // Spelled out because the virtual destructor would otherwise turn every move into a copy
+    JsonValue(const JsonValue&) = default;
+    JsonValue(JsonValue&&) = default;
+    JsonValue& operator=(const JsonValue&) = default;
+    JsonValue& operator=(JsonValue&&) = default;
     virtual ~JsonValue() = default;
     static JsonValue makeString(const std::string&);
     static JsonValue makeNumber(double);
@@ -26,6 +32,7 @@ public:
 
     std::string serialize() const;
     static JsonValue parse(const std::string&);
+    static JsonValue parse(const char* data, size_t size);
 };
 
 #endif // JSON_LOGIC_H
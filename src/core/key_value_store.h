@@ -0,0 +1,38 @@
+#ifndef KEY_VALUE_STORE_H
+#define KEY_VALUE_STORE_H
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qc::core {
+
+// Durable string-to-string map with optional per-entry expiry, as used by
+// ContentStore. Expiry times are unix seconds; 0 means never. Expired entries
+// read as missing until expire() reclaims them.
+class KeyValueStore {
+public:
+    virtual ~KeyValueStore() = default;
+
+    virtual bool put(const std::string& key, const std::string& value, int64_t expires_at = 0) = 0;
+    virtual std::optional<std::string> get(const std::string& key, int64_t now,
+                                           int64_t* expires_at = nullptr) const = 0;
+    virtual bool remove(const std::string& key) = 0;
+
+    // Drop those of `keys` that have expired by `now` and return them
+    virtual std::vector<std::string> expire(const std::vector<std::string>& keys, int64_t now) = 0;
+
+    // Visit every live entry with its value; used to rebuild state on open
+    virtual void scan(const std::function<void(const std::string& key, std::string_view value,
+                                               int64_t expires_at)>& visit) const = 0;
+
+    virtual void clear() = 0;
+    virtual void sync() = 0;
+};
+
+} // namespace qc::core
+
+#endif // KEY_VALUE_STORE_H
@@ -0,0 +1,507 @@
+#include "log_store.h"
+#include "digest.h"
+#include "../io/file_io.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+namespace qc::core {
+
+namespace {
+
+// Record layout (little endian):
+//   u32 crc32 of everything after this field
+//   u8  type
+//   u32 key length
+//   u32 value length
+//   key bytes, value bytes
+// An expiring put stores a u64 expiry (unix seconds) between key and value,
+// counted in the value length.
+const size_t HEADER_SIZE = 13;
+const size_t EXPIRY_SIZE = 8;
+const uint8_t RECORD_PUT = 1;
+const uint8_t RECORD_DELETE = 2;
+const uint8_t RECORD_PUT_EXPIRING = 3;
+
+const char* SEGMENT_PREFIX = "segment-";
+const char* SEGMENT_SUFFIX = ".log";
+
+void put_u32(char* out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out[i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+
+uint32_t get_u32(const char* in) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    return v;
+}
+
+void put_u64(char* out, uint64_t v) {
+    put_u32(out, static_cast<uint32_t>(v));
+    put_u32(out + 4, static_cast<uint32_t>(v >> 32));
+}
+
+uint64_t get_u64(const char* in) {
+    return static_cast<uint64_t>(get_u32(in)) | static_cast<uint64_t>(get_u32(in + 4)) << 32;
+}
+
+int64_t unix_now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool is_expired(int64_t expires_at, int64_t now) {
+    return expires_at != 0 && expires_at <= now;
+}
+
+std::string encode_record(uint8_t type, const std::string& key, const std::string& value, int64_t expires_at) {
+    size_t extra = type == RECORD_PUT_EXPIRING ? EXPIRY_SIZE : 0;
+    std::string record(HEADER_SIZE + key.size() + extra + value.size(), '\0');
+    record[4] = static_cast<char>(type);
+    put_u32(&record[5], static_cast<uint32_t>(key.size()));
+    put_u32(&record[9], static_cast<uint32_t>(extra + value.size()));
+    std::memcpy(&record[HEADER_SIZE], key.data(), key.size());
+    if (extra) put_u64(&record[HEADER_SIZE + key.size()], static_cast<uint64_t>(expires_at));
+    std::memcpy(&record[HEADER_SIZE + key.size() + extra], value.data(), value.size());
+    put_u32(&record[0], crc32(record.data() + 4, record.size() - 4));
+    return record;
+}
+
+// Length of the whole record at `pos`, or 0 when no intact record starts there
+uint64_t record_length_at(const char* data, uint64_t size, uint64_t pos) {
+    if (pos + HEADER_SIZE > size) return 0;
+    uint64_t length = HEADER_SIZE + static_cast<uint64_t>(get_u32(data + pos + 5)) + get_u32(data + pos + 9);
+    if (length > size - pos || crc32(data + pos + 4, length - 4) != get_u32(data + pos)) return 0;
+    return length;
+}
+
+// Visits each intact record of a segment as (offset, length) and returns
+// where the last one ends. A corrupt stretch is stepped over to the next
+// offset where an intact record starts, so one bad record does not hide
+// those after it; `corrupt` counts the stretches.
+template <typename Visit>
+uint64_t walk_records(const char* data, uint64_t size, size_t& corrupt, Visit visit) {
+    uint64_t pos = 0;
+    uint64_t end = 0;
+    while (pos + HEADER_SIZE <= size) {
+        uint64_t length = record_length_at(data, size, pos);
+        if (length > 0) {
+            visit(pos, length);
+            pos += length;
+            end = pos;
+            continue;
+        }
+        ++corrupt;
+        do {
+            ++pos;
+        } while (pos + HEADER_SIZE <= size && record_length_at(data, size, pos) == 0);
+    }
+    if (pos == end && pos < size) ++corrupt; // Trailing bytes too short to hold a record
+    return end;
+}
+
+} // namespace
+
+LogStore::LogStore(const std::string& dir) : LogStore(dir, Options{}) {}
+
+LogStore::LogStore(const std::string& dir, const Options& options) : dir_(dir), options_(options) {
+    std::filesystem::create_directories(dir_);
+    open_existing();
+    if (options_.background_compaction) {
+        compactor_ = std::thread(&LogStore::compactor_loop, this);
+    }
+}
+
+LogStore::~LogStore() {
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    compactor_cv_.notify_all();
+    if (compactor_.joinable()) compactor_.join();
+    close_all();
+}
+
+std::string LogStore::segment_path(uint64_t id) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%010llu", static_cast<unsigned long long>(id));
+    return dir_ + "/" + SEGMENT_PREFIX + name + SEGMENT_SUFFIX;
+}
+
+void LogStore::open_existing() {
+    std::vector<uint64_t> ids;
+    for (const auto& entry : std::filesystem::directory_iterator(dir_)) {
+        std::string name = entry.path().filename().string();
+        const std::string prefix = SEGMENT_PREFIX;
+        const std::string suffix = SEGMENT_SUFFIX;
+        if (name.rfind(prefix, 0) != 0) continue;
+        if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            std::string digits = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+            if (!digits.empty() && digits.find_first_not_of("0123456789") == std::string::npos) {
+                ids.push_back(std::stoull(digits));
+            }
+        } else {
+            // Leftover of a compaction interrupted before its rename
+            std::filesystem::remove(entry.path());
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+
+    for (uint64_t id : ids) {
+        Segment segment;
+        segment.fd = io::FileIO::open_fd(segment_path(id), io::FileIO::Open::EXISTING);
+        if (segment.fd < 0) continue;
+        replay_segment(id, segment, id == ids.back());
+        segments_[id] = segment;
+        next_id_ = id + 1;
+    }
+
+    if (segments_.empty() || segments_.rbegin()->second.size >= options_.max_segment_bytes) {
+        roll_segment();
+    } else {
+        active_id_ = segments_.rbegin()->first;
+    }
+}
+
+void LogStore::replay_segment(uint64_t id, Segment& segment, bool last) {
+    auto file = io::MappedFile::open(segment_path(id));
+    if (!file) return;
+
+    const char* data = file->data();
+    size_t corrupt = 0;
+    uint64_t end = walk_records(data, file->size(), corrupt, [&](uint64_t pos, uint64_t length) {
+        uint32_t key_len = get_u32(data + pos + 5);
+        uint32_t value_len = get_u32(data + pos + 9);
+        std::string key(data + pos + HEADER_SIZE, key_len);
+        auto existing = index_.find(key);
+        if (existing != index_.end()) {
+            live_bytes_ -= existing->second.length;
+            index_.erase(existing);
+        }
+        uint8_t type = static_cast<uint8_t>(data[pos + 4]);
+        if (type == RECORD_PUT) {
+            index_[key] = {id, pos, static_cast<uint32_t>(length), value_len, 0};
+            live_bytes_ += length;
+        } else if (type == RECORD_PUT_EXPIRING && value_len >= EXPIRY_SIZE) {
+            int64_t expires_at = static_cast<int64_t>(get_u64(data + pos + HEADER_SIZE + key_len));
+            index_[key] = {id, pos, static_cast<uint32_t>(length), static_cast<uint32_t>(value_len - EXPIRY_SIZE),
+                           expires_at};
+            live_bytes_ += length;
+        }
+    });
+    corrupt_records_ += corrupt;
+    segment.size = file->size();
+
+    // Only the last segment was being appended to, so only it can end in a
+    // record torn by a crash; cut that off so appends resume cleanly. Sealed
+    // segments stay as they are, their bad records never indexed.
+    if (last && end < segment.size && io::FileIO::truncate_fd(segment.fd, end)) segment.size = end;
+}
+
+// Caller must hold mutex_ exclusively
+bool LogStore::roll_segment() {
+    uint64_t id = next_id_++;
+    Segment segment;
+    segment.fd = io::FileIO::open_fd(segment_path(id), io::FileIO::Open::CREATE);
+    if (segment.fd < 0) return false;
+    segments_[id] = segment;
+    active_id_ = id;
+    return true;
+}
+
+// Caller must hold mutex_ exclusively
+bool LogStore::append_record(uint8_t type, const std::string& key, const std::string& value, int64_t expires_at,
+                             Location& location) {
+    std::string record = encode_record(type, key, value, expires_at);
+
+    auto active = segments_.find(active_id_);
+    if (active == segments_.end() ||
+        (active->second.size > 0 && active->second.size + record.size() > options_.max_segment_bytes)) {
+        if (!roll_segment()) return false;
+        active = segments_.find(active_id_);
+    }
+
+    Segment& segment = active->second;
+    if (!io::FileIO::write_at(segment.fd, record.data(), record.size(), segment.size)) return false;
+
+    location = {active_id_, segment.size, static_cast<uint32_t>(record.size()), static_cast<uint32_t>(value.size()),
+                expires_at};
+    segment.size += record.size();
+    return true;
+}
+
+bool LogStore::read_record(int fd, const Location& location, std::string& record) const {
+    record.resize(location.length);
+    if (!io::FileIO::read_at(fd, &record[0], location.length, location.offset)) return false;
+    if (crc32(record.data() + 4, record.size() - 4) != get_u32(record.data())) {
+        corrupt_records_++;
+        return false;
+    }
+    return true;
+}
+
+bool LogStore::put(const std::string& key, const std::string& value, int64_t expires_at) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    Location location;
+    uint8_t type = expires_at != 0 ? RECORD_PUT_EXPIRING : RECORD_PUT;
+    if (!append_record(type, key, value, expires_at, location)) return false;
+
+    auto existing = index_.find(key);
+    if (existing != index_.end()) live_bytes_ -= existing->second.length;
+    index_[key] = location;
+    live_bytes_ += location.length;
+    maybe_request_compaction();
+    return true;
+}
+
+std::optional<std::string> LogStore::get(const std::string& key) const {
+    return get(key, unix_now());
+}
+
+std::optional<std::string> LogStore::get(const std::string& key, int64_t now, int64_t* expires_at) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end() || is_expired(it->second.expires_at, now)) return std::nullopt;
+    const Location& location = it->second;
+
+    std::string record;
+    if (!read_record(segments_.at(location.segment).fd, location, record)) return std::nullopt;
+    if (expires_at) *expires_at = location.expires_at;
+    return record.substr(location.length - location.value_length);
+}
+
+bool LogStore::contains(const std::string& key) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = index_.find(key);
+    return it != index_.end() && !is_expired(it->second.expires_at, unix_now());
+}
+
+bool LogStore::remove(const std::string& key) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto existing = index_.find(key);
+    if (existing == index_.end()) return false;
+
+    Location tombstone;
+    if (!append_record(RECORD_DELETE, key, std::string(), 0, tombstone)) return false;
+    live_bytes_ -= existing->second.length;
+    index_.erase(existing);
+    maybe_request_compaction();
+    return true;
+}
+
+std::vector<std::string> LogStore::expire(const std::vector<std::string>& keys, int64_t now) {
+    std::vector<std::string> dropped;
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (const auto& key : keys) {
+        auto it = index_.find(key);
+        if (it == index_.end() || !is_expired(it->second.expires_at, now)) continue;
+        live_bytes_ -= it->second.length;
+        index_.erase(it);
+        dropped.push_back(key);
+    }
+    if (!dropped.empty()) maybe_request_compaction();
+    return dropped;
+}
+
+void LogStore::scan(const std::function<void(const std::string& key, std::string_view value,
+                                             int64_t expires_at)>& visit) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    std::map<uint64_t, std::vector<std::pair<const std::string*, const Location*>>> by_segment;
+    for (const auto& [key, location] : index_) by_segment[location.segment].emplace_back(&key, &location);
+
+    for (auto& [id, entries] : by_segment) {
+        auto file = io::MappedFile::open(segment_path(id));
+        if (!file) continue;
+        std::sort(entries.begin(), entries.end(),
+                  [](const auto& a, const auto& b) { return a.second->offset < b.second->offset; });
+        for (const auto& [key, location] : entries) {
+            if (location->offset + location->length > file->size()) continue;
+            const char* record = file->data() + location->offset;
+            if (crc32(record + 4, location->length - 4) != get_u32(record)) {
+                corrupt_records_++;
+                continue;
+            }
+            std::string_view value(record + location->length - location->value_length, location->value_length);
+            visit(*key, value, location->expires_at);
+        }
+    }
+}
+
+void LogStore::clear() {
+    std::lock_guard<std::mutex> compaction_lock(compaction_mutex_);
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    close_all();
+    for (const auto& entry : std::filesystem::directory_iterator(dir_)) {
+        if (entry.path().filename().string().rfind(SEGMENT_PREFIX, 0) == 0) {
+            std::filesystem::remove(entry.path());
+        }
+    }
+    index_.clear();
+    live_bytes_ = 0;
+    roll_segment();
+}
+
+void LogStore::sync() {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto active = segments_.find(active_id_);
+    if (active != segments_.end()) io::FileIO::sync_fd(active->second.fd);
+}
+
+LogStore::Stats LogStore::stats() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    Stats stats;
+    stats.keys = index_.size();
+    stats.segments = segments_.size();
+    stats.live_bytes = live_bytes_;
+    for (const auto& [id, segment] : segments_) stats.total_bytes += segment.size;
+    stats.compactions = compactions_;
+    stats.corrupt_records = corrupt_records_;
+    return stats;
+}
+
+// Caller must hold mutex_ exclusively
+void LogStore::maybe_request_compaction() {
+    if (!options_.background_compaction) return;
+    uint64_t total = 0;
+    for (const auto& [id, segment] : segments_) total += segment.size;
+    uint64_t garbage = total - live_bytes_;
+    if (garbage >= options_.compaction_min_bytes &&
+        garbage >= options_.compaction_garbage_ratio * static_cast<double>(total)) {
+        compaction_requested_ = true;
+        compactor_cv_.notify_one();
+    }
+}
+
+void LogStore::compactor_loop() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    while (true) {
+        compactor_cv_.wait(lock, [&] { return stopping_ || compaction_requested_; });
+        if (stopping_) return;
+        compaction_requested_ = false;
+        lock.unlock();
+        compact();
+        lock.lock();
+    }
+}
+
+void LogStore::compact() {
+    std::lock_guard<std::mutex> compaction_lock(compaction_mutex_);
+
+    // Seal the active segment; everything below the compacted id gets rewritten,
+    // and the new active segment sorts after the compacted one on replay.
+    uint64_t compacted_id;
+    std::vector<std::pair<std::string, Location>> live;
+    std::map<uint64_t, int> sealed_fds;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        uint64_t total = 0;
+        for (const auto& [id, segment] : segments_) total += segment.size;
+        if (total == live_bytes_ && segments_.size() <= 1) return;
+
+        compacted_id = next_id_++;
+        if (!roll_segment()) return;
+        for (const auto& [id, segment] : segments_) {
+            if (id < compacted_id) sealed_fds[id] = segment.fd;
+        }
+        live.reserve(index_.size());
+        for (const auto& [key, location] : index_) {
+            if (location.segment < compacted_id) live.emplace_back(key, location);
+        }
+    }
+
+    // Copy live records without blocking readers or writers. Sealed segments
+    // are immutable and only this function (or clear, excluded above) closes them.
+    const std::string final_path = segment_path(compacted_id);
+    const std::string tmp_path = final_path + ".tmp";
+    int fd = io::FileIO::open_fd(tmp_path, io::FileIO::Open::CREATE);
+    if (fd < 0) return;
+
+    std::vector<Location> moved(live.size());
+    uint64_t offset = 0;
+    bool ok = true;
+    std::string record;
+    for (size_t i = 0; i < live.size() && ok; ++i) {
+        const Location& from = live[i].second;
+        if (!read_record(sealed_fds[from.segment], from, record)) {
+            moved[i].length = 0; // Corrupt; leave the index pointing at the old record
+            continue;
+        }
+        ok = io::FileIO::write_at(fd, record.data(), record.size(), offset);
+        moved[i] = {compacted_id, offset, from.length, from.value_length, from.expires_at};
+        offset += record.size();
+    }
+    std::set<uint64_t> pinned; // Segments still holding records that could not be copied
+    for (size_t i = 0; i < live.size(); ++i) {
+        if (moved[i].length == 0) pinned.insert(live[i].second.segment);
+    }
+    // The tombstones of the dropped segments go with them. A pinned segment
+    // replays before this one, so re-delete here each key it holds that is no
+    // longer live, or the key would come back on the next open.
+    if (ok && !pinned.empty()) {
+        std::unordered_set<std::string> live_keys;
+        for (const auto& entry : live) live_keys.insert(entry.first);
+        std::set<std::string> deleted;
+        for (uint64_t id : pinned) {
+            auto file = io::MappedFile::open(segment_path(id));
+            if (!file) continue;
+            const char* data = file->data();
+            size_t corrupt = 0;
+            walk_records(data, file->size(), corrupt, [&](uint64_t pos, uint64_t) {
+                std::string key(data + pos + HEADER_SIZE, get_u32(data + pos + 5));
+                if (static_cast<uint8_t>(data[pos + 4]) != RECORD_DELETE && !live_keys.count(key)) {
+                    deleted.insert(std::move(key));
+                }
+            });
+        }
+        for (const auto& key : deleted) {
+            record = encode_record(RECORD_DELETE, key, std::string(), 0);
+            ok = ok && io::FileIO::write_at(fd, record.data(), record.size(), offset);
+            offset += record.size();
+        }
+    }
+    // Windows cannot rename an open file, so the copy is reopened after
+    std::error_code ec;
+    if (ok) ok = io::FileIO::sync_fd(fd);
+    io::FileIO::close_fd(fd);
+    if (ok) std::filesystem::rename(tmp_path, final_path, ec);
+    fd = ok && !ec ? io::FileIO::open_fd(final_path, io::FileIO::Open::EXISTING) : -1;
+    if (fd < 0) {
+        std::filesystem::remove(ok && !ec ? final_path : tmp_path, ec);
+        return;
+    }
+
+    // Swap the index over to the compacted copies and drop the old segments
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    segments_[compacted_id] = {fd, offset};
+    for (size_t i = 0; i < live.size(); ++i) {
+        if (moved[i].length == 0) continue;
+        auto it = index_.find(live[i].first);
+        if (it != index_.end() && it->second.segment == live[i].second.segment &&
+            it->second.offset == live[i].second.offset) {
+            it->second = moved[i];
+        }
+    }
+    for (const auto& [id, sealed_fd] : sealed_fds) {
+        if (pinned.count(id)) continue;
+        io::FileIO::close_fd(sealed_fd);
+        std::error_code ec;
+        std::filesystem::remove(segment_path(id), ec);
+        segments_.erase(id);
+    }
+    compactions_++;
+}
+
+// Caller must hold mutex_ exclusively
+void LogStore::close_all() {
+    for (auto& [id, segment] : segments_) {
+        io::FileIO::close_fd(segment.fd);
+    }
+    segments_.clear();
+}
+
+} // namespace qc::core
@@ -0,0 +1,131 @@
+#ifndef LOG_STORE_H
+#define LOG_STORE_H
+
+#include "key_value_store.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace qc::core {
+
+// Append-only key-value store kept in a handful of segment files.
+//
+// Every put or remove appends a CRC-checked record to the active segment and
+// updates an in-memory index (key -> segment and offset), so a lookup is one
+// pread of the record. Overwritten and deleted records are reclaimed by
+// compaction, which copies the live records of sealed segments into a fresh
+// segment and drops the old files. A put may carry an expiry time (unix
+// seconds) that is kept in the index; expired entries read as missing until
+// expire() drops them. A corrupt record is skipped on open without losing
+// those after it; only a torn tail of the last segment is cut off.
+class LogStore : public KeyValueStore {
+public:
+    struct Options {
+        uint64_t max_segment_bytes = 64ull * 1024 * 1024;
+        double compaction_garbage_ratio = 0.5; // Dead bytes / total bytes that triggers compaction
+        uint64_t compaction_min_bytes = 4ull * 1024 * 1024; // Don't bother below this much garbage
+        bool background_compaction = true;
+    };
+
+    struct Stats {
+        size_t keys = 0;
+        size_t segments = 0;
+        uint64_t live_bytes = 0;
+        uint64_t total_bytes = 0;
+        size_t compactions = 0;
+        size_t corrupt_records = 0; // Torn or corrupt records skipped on open or read
+    };
+
+    explicit LogStore(const std::string& dir);
+    LogStore(const std::string& dir, const Options& options);
+    ~LogStore() override;
+
+    LogStore(const LogStore&) = delete;
+    LogStore& operator=(const LogStore&) = delete;
+
+    // expires_at == 0 means the entry never expires
+    bool put(const std::string& key, const std::string& value, int64_t expires_at = 0) override;
+    std::optional<std::string> get(const std::string& key) const;
+    std::optional<std::string> get(const std::string& key, int64_t now, int64_t* expires_at = nullptr) const override;
+    bool contains(const std::string& key) const;
+    bool remove(const std::string& key) override;
+
+    // Drop those of `keys` that have expired by `now` and return them. No
+    // tombstone is written: the record stays expired if it is replayed.
+    std::vector<std::string> expire(const std::vector<std::string>& keys, int64_t now) override;
+
+    // Visit every live entry with its value, reading each segment once
+    // through a mapping; used to rebuild state kept beside the store on open
+    void scan(const std::function<void(const std::string& key, std::string_view value,
+                                       int64_t expires_at)>& visit) const override;
+
+    // Drop every segment and start over with an empty one
+    void clear() override;
+
+    // Rewrite live records of sealed segments; normally run in the background
+    void compact();
+
+    // Flush the active segment to stable storage
+    void sync() override;
+
+    Stats stats() const;
+
+private:
+    struct Location {
+        uint64_t segment;
+        uint64_t offset; // Start of the record
+        uint32_t length; // Whole record, header included
+        uint32_t value_length;
+        int64_t expires_at; // 0 = never
+    };
+
+    struct Segment {
+        int fd = -1;
+        uint64_t size = 0;
+    };
+
+    std::string dir_;
+    Options options_;
+    std::unordered_map<std::string, Location> index_;
+    std::map<uint64_t, Segment> segments_; // Ordered by id; replay order on open
+    uint64_t active_id_ = 0;
+    uint64_t next_id_ = 1;
+    uint64_t live_bytes_ = 0;
+    size_t compactions_ = 0;
+    mutable std::atomic<size_t> corrupt_records_{0};
+    // Readers share the lock for the index lookup and the pread; appends,
+    // clear() and the compaction swap take it exclusively
+    mutable std::shared_mutex mutex_;
+    std::mutex compaction_mutex_; // Serializes compaction against itself and clear()
+
+    std::thread compactor_;
+    std::condition_variable_any compactor_cv_;
+    bool compaction_requested_ = false;
+    bool stopping_ = false;
+
+    std::string segment_path(uint64_t id) const;
+    void open_existing();
+    void replay_segment(uint64_t id, Segment& segment, bool last);
+    bool append_record(uint8_t type, const std::string& key, const std::string& value, int64_t expires_at,
+                       Location& location);
+    bool roll_segment();
+    bool read_record(int fd, const Location& location, std::string& record) const;
+    void maybe_request_compaction();
+    void compactor_loop();
+    void close_all();
+};
+
+} // namespace qc::core
+
+#endif // LOG_STORE_H
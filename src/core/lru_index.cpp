@@ -0,0 +1,98 @@
+#include "lru_index.h"
+#include <functional>
+
+namespace qc::core {
+
+LruIndex::LruIndex(size_t shard_count) {
+    if (shard_count == 0) shard_count = 1;
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+LruIndex::Shard& LruIndex::shard_for(const std::string& key) const {
+    return *shards_[std::hash<std::string>{}(key) % shards_.size()];
+}
+
+void LruIndex::track(const std::string& key, uint64_t bytes) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    uint64_t now = ++clock_;
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        bytes_ -= it->second->bytes;
+        it->second->bytes = bytes;
+        it->second->last_use = now;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    } else {
+        shard.lru.push_front({key, bytes, now});
+        shard.index[key] = shard.lru.begin();
+    }
+    bytes_ += bytes;
+}
+
+void LruIndex::touch(const std::string& key) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) return;
+    it->second->last_use = ++clock_;
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+}
+
+void LruIndex::forget(const std::string& key) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) return;
+    bytes_ -= it->second->bytes;
+    shard.lru.erase(it->second);
+    shard.index.erase(it);
+}
+
+void LruIndex::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (const auto& entry : shard->lru) bytes_ -= entry.bytes;
+        shard->lru.clear();
+        shard->index.clear();
+    }
+}
+
+std::vector<std::string> LruIndex::victims(uint64_t bytes_needed) const {
+    // Shards are locked in a fixed order; each list is oldest at the back, so
+    // repeatedly taking the oldest tail is a k-way merge in global LRU order
+    std::vector<std::unique_lock<std::mutex>> locks;
+    std::vector<std::list<Entry>::const_reverse_iterator> tails;
+    for (const auto& shard : shards_) {
+        locks.emplace_back(shard->mutex);
+        tails.push_back(shard->lru.crbegin());
+    }
+
+    std::vector<std::string> keys;
+    uint64_t freed = 0;
+    while (freed < bytes_needed) {
+        size_t oldest = shards_.size();
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            if (tails[i] == shards_[i]->lru.crend()) continue;
+            if (oldest == shards_.size() || tails[i]->last_use < tails[oldest]->last_use) oldest = i;
+        }
+        if (oldest == shards_.size()) break;
+        keys.push_back(tails[oldest]->key);
+        freed += tails[oldest]->bytes;
+        ++tails[oldest];
+    }
+    return keys;
+}
+
+size_t LruIndex::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->lru.size();
+    }
+    return total;
+}
+
+} // namespace qc::core
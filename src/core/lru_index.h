@@ -0,0 +1,59 @@
+#ifndef LRU_INDEX_H
+#define LRU_INDEX_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace qc::core {
+
+// Recency order and byte size of every key in a store, used to choose what to
+// evict when the store is over budget. Keys are sharded like MemoryCache so a
+// touch on every read rarely contends; victims are merged across shards by a
+// global use counter, which keeps the order exact.
+class LruIndex {
+public:
+    explicit LruIndex(size_t shard_count = 16);
+
+    // Insert or resize a key and mark it most recently used
+    void track(const std::string& key, uint64_t bytes);
+    // Mark a tracked key most recently used; untracked keys are ignored
+    void touch(const std::string& key);
+    void forget(const std::string& key);
+    void clear();
+
+    // Least recently used keys whose sizes add up to at least `bytes_needed`
+    std::vector<std::string> victims(uint64_t bytes_needed) const;
+
+    uint64_t bytes() const { return bytes_.load(); }
+    size_t size() const;
+
+private:
+    struct Entry {
+        std::string key;
+        uint64_t bytes;
+        uint64_t last_use;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru; // Most recently used at the front
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<uint64_t> clock_{0};
+    std::atomic<uint64_t> bytes_{0};
+
+    Shard& shard_for(const std::string& key) const;
+};
+
+} // namespace qc::core
+
+#endif // LRU_INDEX_H
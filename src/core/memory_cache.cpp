@@ -0,0 +1,118 @@
+#include "memory_cache.h"
+#include <functional>
+
+namespace qc::core {
+
+MemoryCache::MemoryCache(size_t byte_budget, size_t shard_count) {
+    if (shard_count == 0) shard_count = 1;
+    shard_budget_ = byte_budget / shard_count;
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+MemoryCache::Shard& MemoryCache::shard_for(const std::string& key) const {
+    return *shards_[std::hash<std::string>{}(key) % shards_.size()];
+}
+
+std::shared_ptr<const io::JsonValue> MemoryCache::get(const std::string& key, int64_t now) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end() && it->second->expires_at != 0 && it->second->expires_at <= now) {
+        shard.bytes -= it->second->bytes;
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+        it = shard.index.end();
+    }
+    if (it == shard.index.end()) {
+        shard.misses++;
+        return nullptr;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    shard.hits++;
+    return it->second->value;
+}
+
+bool MemoryCache::contains(const std::string& key, int64_t now) const {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    return it != shard.index.end() && (it->second->expires_at == 0 || it->second->expires_at > now);
+}
+
+void MemoryCache::put(const std::string& key, std::shared_ptr<const io::JsonValue> value, int64_t expires_at) {
+    size_t bytes = key.size() + sizeof(Entry) + estimate_size(*value);
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        shard.bytes -= it->second->bytes;
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+    if (bytes > shard_budget_) return; // Would evict the whole shard; leave it to the disk tier
+
+    while (!shard.lru.empty() && shard.bytes + bytes > shard_budget_) {
+        Entry& victim = shard.lru.back();
+        shard.bytes -= victim.bytes;
+        shard.index.erase(victim.key);
+        shard.lru.pop_back();
+        shard.evictions++;
+    }
+
+    shard.lru.push_front({key, std::move(value), bytes, expires_at});
+    shard.index[key] = shard.lru.begin();
+    shard.bytes += bytes;
+}
+
+void MemoryCache::erase(const std::string& key) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) return;
+    shard.bytes -= it->second->bytes;
+    shard.lru.erase(it->second);
+    shard.index.erase(it);
+}
+
+void MemoryCache::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->lru.clear();
+        shard->index.clear();
+        shard->bytes = 0;
+    }
+}
+
+MemoryCache::Stats MemoryCache::stats() const {
+    Stats stats;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        stats.hits += shard->hits;
+        stats.misses += shard->misses;
+        stats.evictions += shard->evictions;
+        stats.entries += shard->lru.size();
+        stats.bytes += shard->bytes;
+    }
+    return stats;
+}
+
+size_t MemoryCache::estimate_size(const io::JsonValue& value) {
+    size_t bytes = sizeof(io::JsonValue);
+    if (value.is_string()) {
+        bytes += value.as_string().capacity();
+    } else if (value.is_array()) {
+        for (const auto& item : value.as_array()) bytes += estimate_size(item);
+    } else if (value.is_object()) {
+        // Map nodes carry three pointers and a color on top of the pair
+        for (const auto& [key, item] : value.as_object()) {
+            bytes += 4 * sizeof(void*) + sizeof(std::string) + key.capacity() + estimate_size(item);
+        }
+    }
+    return bytes;
+}
+
+} // namespace qc::core
@@ -0,0 +1,71 @@
+#ifndef MEMORY_CACHE_H
+#define MEMORY_CACHE_H
+
+#include "../io/json_parser.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace qc::core {
+
+// Byte-bounded LRU of decoded JSON values. Keys are spread over independently
+// locked shards so concurrent readers rarely contend; each shard evicts its own
+// least recently used entries once it exceeds its share of the budget.
+class MemoryCache {
+public:
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    explicit MemoryCache(size_t byte_budget, size_t shard_count = 16);
+
+    // Entries whose expiry (unix seconds, 0 = never) is at or before `now`
+    // count as misses
+    std::shared_ptr<const io::JsonValue> get(const std::string& key, int64_t now = 0);
+    // Whether get() would hit, without promoting the entry or counting it
+    bool contains(const std::string& key, int64_t now = 0) const;
+    void put(const std::string& key, std::shared_ptr<const io::JsonValue> value, int64_t expires_at = 0);
+    void erase(const std::string& key);
+    void clear();
+
+    Stats stats() const;
+
+    // Approximate heap footprint of a value, used for budget accounting
+    static size_t estimate_size(const io::JsonValue& value);
+
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const io::JsonValue> value;
+        size_t bytes;
+        int64_t expires_at;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru; // Most recently used at the front
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        size_t bytes = 0;
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+    };
+
+    size_t shard_budget_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    Shard& shard_for(const std::string& key) const;
+};
+
+} // namespace qc::core
+
+#endif // MEMORY_CACHE_H
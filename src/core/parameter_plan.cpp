@@ -0,0 +1,235 @@
+#include "parameter_plan.h"
+#include "compiled_template.h"
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace qc::core {
+
+namespace {
+
+const ::JsonValue* member(const ::JsonValue& object, const std::string& name) {
+    if (object.type != ::JsonValue::OBJECT) return nullptr;
+    auto it = object.object_value.find(name);
+    return it == object.object_value.end() ? nullptr : &it->second;
+}
+
+std::string string_member(const ::JsonValue& object, const std::string& name) {
+    const ::JsonValue* value = member(object, name);
+    return value && value->type == ::JsonValue::STRING ? value->string_value : "";
+}
+
+ParameterPlan::Type parse_type(const std::string& name) {
+    if (name == "string") return ParameterPlan::Type::STRING;
+    if (name == "number") return ParameterPlan::Type::NUMBER;
+    if (name == "integer") return ParameterPlan::Type::INTEGER;
+    if (name == "boolean") return ParameterPlan::Type::BOOLEAN;
+    if (name == "array") return ParameterPlan::Type::ARRAY;
+    if (name == "object") return ParameterPlan::Type::OBJECT;
+    return ParameterPlan::Type::ANY;
+}
+
+ParameterPlan::Case parse_case(const std::string& name) {
+    if (name == "upper" || name == "uppercase") return ParameterPlan::Case::UPPER;
+    if (name == "lower" || name == "lowercase") return ParameterPlan::Case::LOWER;
+    return ParameterPlan::Case::KEEP;
+}
+
+// A property with its template's fields underneath its own
+::JsonValue with_template(const ::JsonValue& property, const ::JsonValue& templates) {
+    std::string ref = string_member(property, "$ref");
+    const ::JsonValue* base = ref.empty() ? nullptr : member(templates, ref.substr(ref.rfind('/') + 1));
+    if (!base || base->type != ::JsonValue::OBJECT) return property;
+    ::JsonValue merged = *base;
+    for (const auto& [key, value] : property.object_value) {
+        if (key != "$ref") merged.object_value[key] = value;
+    }
+    return merged;
+}
+
+std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return "";
+    return text.substr(begin, text.find_last_not_of(" \t\r\n") + 1 - begin);
+}
+
+std::string format_number(double value) {
+    char text[32];
+    if (std::isfinite(value) && value == std::floor(value) && std::fabs(value) < 1e15) {
+        std::snprintf(text, sizeof(text), "%.0f", value);
+    } else {
+        std::snprintf(text, sizeof(text), "%.15g", value);
+    }
+    return text;
+}
+
+} // namespace
+
+std::shared_ptr<const ParameterPlan> ParameterPlan::compile(const ::JsonValue& schema, const ::JsonValue& templates,
+                                                            const std::map<std::string, std::string>& config) {
+    auto plan = std::make_shared<ParameterPlan>();
+    const ::JsonValue* properties = member(schema, "properties");
+    if (!properties) properties = &schema;
+    if (properties->type != ::JsonValue::OBJECT) return plan;
+
+    std::vector<std::vector<std::string>> aliases;
+    for (const auto& [name, property] : properties->object_value) {
+        ::JsonValue definition = with_template(property, templates);
+        Field field;
+        field.name = name;
+        field.type = parse_type(string_member(definition, "type"));
+        if (const ::JsonValue* items = member(definition, "items")) field.item_type = parse_type(string_member(*items, "type"));
+        if (const ::JsonValue* transformation = member(definition, "transformation")) {
+            std::string normalize = string_member(*transformation, "normalize_case");
+            field.normalize = parse_case(normalize.empty() ? string_member(*transformation, "normalize") : normalize);
+        }
+        if (const ::JsonValue* mapping = member(definition, "mapping")) {
+            for (const auto& [from, to] : mapping->object_value) {
+                if (to.type == ::JsonValue::STRING) field.mapping[from] = to.string_value;
+            }
+        }
+
+        std::vector<std::string> names;
+        if (const ::JsonValue* list = member(definition, "aliases")) {
+            for (const auto& alias : list->array_value) {
+                if (alias.type == ::JsonValue::STRING) names.push_back(alias.string_value);
+            }
+        }
+        aliases.push_back(std::move(names));
+
+        plan->keys_[name] = Key{plan->fields_.size(), true};
+        if (const ::JsonValue* fallback = member(definition, "default")) {
+            ::JsonValue value = *fallback;
+            if (value.type == ::JsonValue::STRING) {
+                value.string_value = CompiledTemplate::get(value.string_value)->render(config);
+            }
+            if (value.type != ::JsonValue::NIL) field.default_value = plan->coerce(field, std::move(value));
+        }
+        plan->fields_.push_back(std::move(field));
+    }
+
+    // After every canonical key, so an alias never shadows one; the first
+    // property to claim an alias keeps it
+    for (size_t index = 0; index < aliases.size(); ++index) {
+        for (const auto& alias : aliases[index]) plan->keys_.emplace(alias, Key{index, false});
+    }
+    return plan;
+}
+
+size_t ParameterPlan::find(const std::string& key) const {
+    auto it = keys_.find(key);
+    return it == keys_.end() ? npos : it->second.field;
+}
+
+::JsonValue ParameterPlan::apply(::JsonValue parameters) const {
+    if (parameters.type != ::JsonValue::OBJECT) return parameters;
+    ::JsonValue result = ::JsonValue::makeObject();
+    auto& output = result.object_value;
+    // 0: unset, 1: set from an alias, 2: set from the canonical key
+    std::vector<unsigned char> filled(fields_.size(), 0);
+
+    auto& input = parameters.object_value;
+    while (!input.empty()) {
+        auto node = input.extract(input.begin());
+        auto key = keys_.find(node.key());
+        if (key == keys_.end()) {
+            output.insert(std::move(node));
+            continue;
+        }
+        size_t index = key->second.field;
+        unsigned char rank = key->second.canonical ? 2 : 1;
+        if (node.mapped().type == ::JsonValue::NIL || filled[index] >= rank) continue;
+
+        const Field& field = fields_[index];
+        node.mapped() = coerce(field, std::move(node.mapped()));
+        node.key() = field.name;
+        auto inserted = output.insert(std::move(node));
+        if (!inserted.inserted) inserted.position->second = std::move(inserted.node.mapped());
+        filled[index] = rank;
+    }
+
+    for (size_t index = 0; index < fields_.size(); ++index) {
+        const Field& field = fields_[index];
+        if (!filled[index] && field.default_value.type != ::JsonValue::NIL) output.emplace(field.name, field.default_value);
+    }
+    return result;
+}
+
+::JsonValue ParameterPlan::coerce(const Field& field, ::JsonValue value) const {
+    if (field.type != Type::ARRAY) return coerce(field.type, field, std::move(value));
+
+    if (value.type != ::JsonValue::ARRAY) {
+        ::JsonValue list = ::JsonValue::makeArray();
+        if (value.type == ::JsonValue::STRING) {
+            // "COMT, BDNF" lists two genes
+            size_t begin = 0;
+            while (begin <= value.string_value.size()) {
+                size_t end = value.string_value.find(',', begin);
+                if (end == std::string::npos) end = value.string_value.size();
+                std::string item = trim(value.string_value.substr(begin, end - begin));
+                if (!item.empty()) list.array_value.push_back(::JsonValue::makeString(item));
+                begin = end + 1;
+            }
+        } else {
+            list.array_value.push_back(std::move(value));
+        }
+        value = std::move(list);
+    }
+    for (auto& item : value.array_value) item = coerce(field.item_type, field, std::move(item));
+    return value;
+}
+
+::JsonValue ParameterPlan::coerce(Type type, const Field& field, ::JsonValue value) {
+    switch (type) {
+        case Type::STRING:
+            if (value.type == ::JsonValue::NUMBER) {
+                value = ::JsonValue::makeString(format_number(value.number_value));
+            } else if (value.type == ::JsonValue::BOOL) {
+                value = ::JsonValue::makeString(value.bool_value ? "true" : "false");
+            } else if (value.type == ::JsonValue::ARRAY && value.array_value.size() == 1) {
+                value = ::JsonValue(std::move(value.array_value[0]));
+            }
+            break;
+        case Type::NUMBER:
+        case Type::INTEGER:
+            if (value.type == ::JsonValue::STRING) {
+                std::string text = trim(value.string_value);
+                char* end = nullptr;
+                double number = std::strtod(text.c_str(), &end);
+                if (!text.empty() && *end == '\0') value = ::JsonValue::makeNumber(number);
+            }
+            if (type == Type::INTEGER && value.type == ::JsonValue::NUMBER) {
+                value.number_value = std::trunc(value.number_value);
+            }
+            break;
+        case Type::BOOLEAN:
+            if (value.type == ::JsonValue::STRING) {
+                std::string text = trim(value.string_value);
+                for (char& c : text) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+                if (text == "true" || text == "yes" || text == "1") value = ::JsonValue::makeBool(true);
+                if (text == "false" || text == "no" || text == "0") value = ::JsonValue::makeBool(false);
+            } else if (value.type == ::JsonValue::NUMBER) {
+                value = ::JsonValue::makeBool(value.number_value != 0);
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (value.type == ::JsonValue::STRING) {
+        if (field.normalize != Case::KEEP) {
+            for (char& c : value.string_value) {
+                unsigned char u = static_cast<unsigned char>(c);
+                c = static_cast<char>(field.normalize == Case::UPPER ? std::toupper(u) : std::tolower(u));
+            }
+        }
+        auto mapped = field.mapping.find(value.string_value);
+        if (mapped != field.mapping.end()) value.string_value = mapped->second;
+    } else if (type == Type::ANY && value.type == ::JsonValue::ARRAY) {
+        for (auto& item : value.array_value) item = coerce(Type::ANY, field, std::move(item));
+    }
+    return value;
+}
+
+} // namespace qc::core
@@ -0,0 +1,71 @@
+#ifndef PARAMETER_PLAN_H
+#define PARAMETER_PLAN_H
+
+#include "json_logic.h"
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace qc::core {
+
+// How to turn a request's parameters into the ones an endpoint expects,
+// compiled from its parameter schema:
+//   {"properties": {"genes": {"$ref": "#/parameter_templates/gene_identifiers"},
+//                   "limit": {"type": "integer", "default": 50}}}
+// Each property is a canonical key. It takes its aliases, type, default,
+// value mapping and case normalization from its own definition, or from
+// the parameter template it references; its own fields override the
+// template's.
+//
+// Applying a plan is one pass over the input object. Each member is moved
+// into place under its canonical key, after a single hash lookup of its
+// name. A canonical key beats its aliases, members the plan does not know
+// pass through untouched, and defaults fill the keys still missing.
+class ParameterPlan {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    enum class Type { ANY, STRING, NUMBER, INTEGER, BOOLEAN, ARRAY, OBJECT };
+    enum class Case { KEEP, UPPER, LOWER };
+
+    struct Field {
+        std::string name;
+        Type type = Type::ANY;
+        Type item_type = Type::ANY; // For arrays
+        Case normalize = Case::KEEP;
+        std::map<std::string, std::string> mapping; // Synonyms to canonical values
+        ::JsonValue default_value;                   // Null when there is none
+    };
+
+    // `schema` holds "properties", or is the properties object itself.
+    // "$ref"s resolve in `templates`, and ${CONFIG:} placeholders in
+    // defaults resolve from `config`.
+    static std::shared_ptr<const ParameterPlan> compile(const ::JsonValue& schema,
+                                                        const ::JsonValue& templates = ::JsonValue(),
+                                                        const std::map<std::string, std::string>& config = {});
+
+    ::JsonValue apply(::JsonValue parameters) const;
+
+    const std::vector<Field>& fields() const { return fields_; }
+    // The field a canonical key or alias names
+    size_t find(const std::string& key) const;
+
+private:
+    struct Key {
+        size_t field;
+        bool canonical;
+    };
+
+    std::vector<Field> fields_;
+    std::unordered_map<std::string, Key> keys_;
+
+    ::JsonValue coerce(const Field& field, ::JsonValue value) const;
+    static ::JsonValue coerce(Type type, const Field& field, ::JsonValue value);
+};
+
+} // namespace qc::core
+
+#endif // PARAMETER_PLAN_H
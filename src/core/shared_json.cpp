@@ -0,0 +1,220 @@
+#include "shared_json.h"
+#include <variant>
+
+namespace qc::core {
+
+struct SharedJson::Node {
+    std::variant<bool, double, std::string, Array, Object> value;
+};
+
+namespace {
+
+// Object members merged one level down, or all the way
+SharedJson merge_objects(const SharedJson& base, const SharedJson& overlay, bool deep) {
+    if (base.type() != ::JsonValue::OBJECT || overlay.type() != ::JsonValue::OBJECT) return overlay;
+    if (base.members().empty()) return overlay;
+    if (overlay.members().empty()) return base;
+    SharedJson::Object members = base.members();
+    for (const auto& [key, value] : overlay.members()) {
+        auto it = members.find(key);
+        if (it == members.end()) {
+            members.emplace(key, value);
+        } else {
+            it->second = deep ? merge_objects(it->second, value, true) : value;
+        }
+    }
+    return SharedJson::object(std::move(members));
+}
+
+} // namespace
+
+template <typename T>
+const T* SharedJson::get() const {
+    return node_ ? std::get_if<T>(&node_->value) : nullptr;
+}
+
+SharedJson::SharedJson(const ::JsonValue& value) {
+    switch (value.type) {
+        case ::JsonValue::BOOL: *this = boolean(value.bool_value); break;
+        case ::JsonValue::NUMBER: *this = number(value.number_value); break;
+        case ::JsonValue::STRING: *this = string(value.string_value); break;
+        case ::JsonValue::ARRAY: {
+            Array items;
+            items.reserve(value.array_value.size());
+            for (const auto& item : value.array_value) items.emplace_back(item);
+            *this = array(std::move(items));
+            break;
+        }
+        case ::JsonValue::OBJECT: {
+            Object members;
+            for (const auto& [key, item] : value.object_value) members.emplace_hint(members.end(), key, SharedJson(item));
+            *this = object(std::move(members));
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+SharedJson::SharedJson(::JsonValue&& value) {
+    switch (value.type) {
+        case ::JsonValue::STRING: *this = string(std::move(value.string_value)); break;
+        case ::JsonValue::ARRAY: {
+            Array items;
+            items.reserve(value.array_value.size());
+            for (auto& item : value.array_value) items.emplace_back(std::move(item));
+            *this = array(std::move(items));
+            break;
+        }
+        case ::JsonValue::OBJECT: {
+            Object members;
+            auto& fields = value.object_value;
+            while (!fields.empty()) {
+                auto field = fields.extract(fields.begin());
+                members.emplace_hint(members.end(), std::move(field.key()), SharedJson(std::move(field.mapped())));
+            }
+            *this = object(std::move(members));
+            break;
+        }
+        default:
+            *this = SharedJson(static_cast<const ::JsonValue&>(value));
+            break;
+    }
+}
+
+SharedJson SharedJson::boolean(bool value) {
+    return SharedJson(std::make_shared<const Node>(Node{value}));
+}
+
+SharedJson SharedJson::number(double value) {
+    return SharedJson(std::make_shared<const Node>(Node{value}));
+}
+
+SharedJson SharedJson::string(std::string value) {
+    return SharedJson(std::make_shared<const Node>(Node{std::move(value)}));
+}
+
+SharedJson SharedJson::array(Array items) {
+    return SharedJson(std::make_shared<const Node>(Node{std::move(items)}));
+}
+
+SharedJson SharedJson::object(Object members) {
+    return SharedJson(std::make_shared<const Node>(Node{std::move(members)}));
+}
+
+::JsonValue::Type SharedJson::type() const {
+    if (!node_) return ::JsonValue::NIL;
+    switch (node_->value.index()) {
+        case 0: return ::JsonValue::BOOL;
+        case 1: return ::JsonValue::NUMBER;
+        case 2: return ::JsonValue::STRING;
+        case 3: return ::JsonValue::ARRAY;
+        default: return ::JsonValue::OBJECT;
+    }
+}
+
+bool SharedJson::as_bool() const {
+    const bool* value = get<bool>();
+    return value && *value;
+}
+
+double SharedJson::as_number() const {
+    const double* value = get<double>();
+    return value ? *value : 0;
+}
+
+const std::string& SharedJson::as_string() const {
+    static const std::string empty;
+    const std::string* value = get<std::string>();
+    return value ? *value : empty;
+}
+
+const SharedJson::Array& SharedJson::items() const {
+    static const Array empty;
+    const Array* value = get<Array>();
+    return value ? *value : empty;
+}
+
+const SharedJson::Object& SharedJson::members() const {
+    static const Object empty;
+    const Object* value = get<Object>();
+    return value ? *value : empty;
+}
+
+size_t SharedJson::size() const {
+    if (const Array* items = get<Array>()) return items->size();
+    if (const Object* members = get<Object>()) return members->size();
+    if (const std::string* text = get<std::string>()) return text->size();
+    return 0;
+}
+
+const SharedJson* SharedJson::find(const std::string& key) const {
+    const Object* members = get<Object>();
+    if (!members) return nullptr;
+    auto it = members->find(key);
+    return it == members->end() ? nullptr : &it->second;
+}
+
+const SharedJson* SharedJson::at(size_t index) const {
+    const Array* items = get<Array>();
+    return items && index < items->size() ? &(*items)[index] : nullptr;
+}
+
+SharedJson SharedJson::with(const std::string& key, SharedJson value) const {
+    Object copy = members();
+    copy[key] = std::move(value);
+    return object(std::move(copy));
+}
+
+SharedJson SharedJson::merge(const std::vector<SharedJson>& values, const std::string& strategy) {
+    if (strategy == "concat" || strategy == "append") {
+        Array items;
+        for (const auto& value : values) {
+            if (value.type() == ::JsonValue::ARRAY) {
+                items.insert(items.end(), value.items().begin(), value.items().end());
+            } else if (!value.is_null()) {
+                items.push_back(value);
+            }
+        }
+        return array(std::move(items));
+    }
+
+    bool deep = strategy != "shallow" && strategy != "override";
+    SharedJson merged;
+    for (const auto& value : values) {
+        if (value.is_null()) continue;
+        merged = merged.is_null() ? value : merge_objects(merged, value, deep);
+    }
+    return merged;
+}
+
+::JsonValue SharedJson::to_json() const {
+    switch (type()) {
+        case ::JsonValue::BOOL: return ::JsonValue::makeBool(as_bool());
+        case ::JsonValue::NUMBER: return ::JsonValue::makeNumber(as_number());
+        case ::JsonValue::STRING: return ::JsonValue::makeString(as_string());
+        case ::JsonValue::ARRAY: {
+            ::JsonValue result = ::JsonValue::makeArray();
+            result.array_value.reserve(items().size());
+            for (const auto& item : items()) result.array_value.push_back(item.to_json());
+            return result;
+        }
+        case ::JsonValue::OBJECT: {
+            ::JsonValue result = ::JsonValue::makeObject();
+            for (const auto& [key, item] : members()) {
+                result.object_value.emplace_hint(result.object_value.end(), key, item.to_json());
+            }
+            return result;
+        }
+        default:
+            return ::JsonValue::makeNull();
+    }
+}
+
+bool SharedJson::operator==(const SharedJson& other) const {
+    if (same(other)) return true;
+    if (!node_ || !other.node_) return false;
+    return node_->value == other.node_->value;
+}
+
+} // namespace qc::core
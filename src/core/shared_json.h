@@ -0,0 +1,84 @@
+#ifndef SHARED_JSON_H
+#define SHARED_JSON_H
+
+#include "json_logic.h"
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace qc::core {
+
+// JSON that is never modified once built, so it can share structure. A
+// SharedJson is a handle to a reference-counted node, and arrays and objects
+// hold handles to their elements, so copying any value is a pointer copy.
+// Building a changed value - with(), merge() - allocates nodes only along
+// the changed path; every other subtree is shared with the values it came
+// from. Handles may be read from any number of threads.
+//
+// Workflow contexts keep their input and outputs this way, so passing an
+// output on or merging several into a report costs the same however large
+// they are. Converting from or to ::JsonValue copies, and belongs at the
+// edges: data source results in, call parameters and final outputs out.
+class SharedJson {
+public:
+    using Type = ::JsonValue::Type;
+    using Array = std::vector<SharedJson>;
+    using Object = std::map<std::string, SharedJson>;
+
+    SharedJson() = default; // Null
+    explicit SharedJson(const ::JsonValue& value);
+    explicit SharedJson(::JsonValue&& value);
+
+    static SharedJson boolean(bool value);
+    static SharedJson number(double value);
+    static SharedJson string(std::string value);
+    static SharedJson array(Array items);
+    static SharedJson object(Object members);
+
+    Type type() const;
+    bool is_null() const { return !node_; }
+    // Defaults when the value has another type: false, 0, "", empty
+    bool as_bool() const;
+    double as_number() const;
+    const std::string& as_string() const;
+    const Array& items() const;
+    const Object& members() const;
+    // Elements, members or characters; 0 for anything else
+    size_t size() const;
+
+    // Points into this value; nullptr when missing
+    const SharedJson* find(const std::string& key) const;
+    const SharedJson* at(size_t index) const;
+
+    // This object with `key` set; anything but an object counts as empty
+    SharedJson with(const std::string& key, SharedJson value) const;
+
+    // Later values win; nulls are skipped. "deep_merge" merges objects member
+    // by member and otherwise takes the later value; "shallow" (or
+    // "override") replaces top-level members whole; "concat" (or "append")
+    // joins arrays into one, adding other values as elements. Unknown
+    // strategies deep-merge.
+    static SharedJson merge(const std::vector<SharedJson>& values, const std::string& strategy = "deep_merge");
+
+    ::JsonValue to_json() const; // Deep copy
+
+    // Whether both handles point at the same node, which implies equality
+    bool same(const SharedJson& other) const { return node_ == other.node_; }
+    bool operator==(const SharedJson& other) const;
+    bool operator!=(const SharedJson& other) const { return !(*this == other); }
+
+private:
+    struct Node;
+
+    explicit SharedJson(std::shared_ptr<const Node> node) : node_(std::move(node)) {}
+    template <typename T>
+    const T* get() const; // Null unless the node holds a T
+
+    std::shared_ptr<const Node> node_;
+};
+
+} // namespace qc::core
+
+#endif // SHARED_JSON_H
@@ -0,0 +1,331 @@
+#include "state_image.h"
+#include "digest.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+
+namespace qc::core {
+
+namespace {
+
+// Image layout:
+//   4 bytes magic "QCSI"
+//   u32 format version
+//   u32 section count
+//   u32 index size in bytes
+//   u64 nonce, so every written image has a distinct identity
+//   index, per section in name order: u32 name length, u32 crc32 of the
+//     payload, u64 payload offset from the file start, u64 payload length,
+//     name bytes
+//   payloads
+//
+// Payload values are a tag byte followed by:
+//   null, false, true: nothing
+//   number: 8-byte IEEE double
+//   string: u32 length, bytes
+//   array: u32 count, values
+//   object: u32 count, then per member u32 key length, key bytes, value
+const char MAGIC[4] = {'Q', 'C', 'S', 'I'};
+const uint32_t FORMAT_VERSION = 1;
+const size_t HEADER_SIZE = 24;
+const size_t INDEX_ENTRY_SIZE = 24;
+const size_t MAX_DEPTH = 512;
+
+enum Tag : unsigned char { TAG_NULL, TAG_FALSE, TAG_TRUE, TAG_NUMBER, TAG_STRING, TAG_ARRAY, TAG_OBJECT };
+
+void append_u32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out += static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+
+void append_u64(std::string& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) out += static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+
+uint32_t get_u32(const char* in) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    return v;
+}
+
+uint64_t get_u64(const char* in) {
+    return static_cast<uint64_t>(get_u32(in)) | static_cast<uint64_t>(get_u32(in + 4)) << 32;
+}
+
+void encode(std::string& out, const io::JsonValue& value) {
+    if (value.is_null()) {
+        out += static_cast<char>(TAG_NULL);
+    } else if (value.is_bool()) {
+        out += static_cast<char>(value.as_bool() ? TAG_TRUE : TAG_FALSE);
+    } else if (value.is_number()) {
+        out += static_cast<char>(TAG_NUMBER);
+        uint64_t bits;
+        double number = value.as_number();
+        std::memcpy(&bits, &number, sizeof(bits));
+        append_u64(out, bits);
+    } else if (value.is_string()) {
+        out += static_cast<char>(TAG_STRING);
+        append_u32(out, static_cast<uint32_t>(value.as_string().size()));
+        out += value.as_string();
+    } else if (value.is_array()) {
+        out += static_cast<char>(TAG_ARRAY);
+        append_u32(out, static_cast<uint32_t>(value.as_array().size()));
+        for (const auto& item : value.as_array()) encode(out, item);
+    } else {
+        out += static_cast<char>(TAG_OBJECT);
+        append_u32(out, static_cast<uint32_t>(value.as_object().size()));
+        for (const auto& [key, item] : value.as_object()) {
+            append_u32(out, static_cast<uint32_t>(key.size()));
+            out += key;
+            encode(out, item);
+        }
+    }
+}
+
+// Bounds-checked reader over one payload
+class Decoder {
+public:
+    explicit Decoder(std::string_view data) : data_(data) {}
+
+    bool decode(io::JsonValue& out, size_t depth = 0) {
+        if (depth > MAX_DEPTH || pos_ >= data_.size()) return false;
+        switch (static_cast<unsigned char>(data_[pos_++])) {
+        case TAG_NULL:
+            out.data = std::monostate{};
+            return true;
+        case TAG_FALSE:
+            out.data = false;
+            return true;
+        case TAG_TRUE:
+            out.data = true;
+            return true;
+        case TAG_NUMBER: {
+            if (!has(8)) return false;
+            uint64_t bits = get_u64(data_.data() + pos_);
+            pos_ += 8;
+            double number;
+            std::memcpy(&number, &bits, sizeof(number));
+            out.data = number;
+            return true;
+        }
+        case TAG_STRING: {
+            std::string_view text;
+            if (!read_string(text)) return false;
+            out.data = std::string(text);
+            return true;
+        }
+        case TAG_ARRAY: {
+            uint32_t count;
+            // Every value takes at least one byte, which caps a hostile count
+            if (!read_u32(count) || count > data_.size() - pos_) return false;
+            io::JsonArray array(count);
+            for (auto& item : array) {
+                if (!decode(item, depth + 1)) return false;
+            }
+            out.data = std::move(array);
+            return true;
+        }
+        case TAG_OBJECT: {
+            uint32_t count;
+            if (!read_u32(count)) return false;
+            io::JsonObject object;
+            auto hint = object.end();
+            for (uint32_t i = 0; i < count; ++i) {
+                std::string_view key;
+                if (!read_string(key)) return false;
+                // Keys were written in map order, so each one goes at the end
+                hint = object.emplace_hint(hint, std::string(key), io::JsonValue{});
+                if (!decode(hint->second, depth + 1)) return false;
+                hint = object.end();
+            }
+            out.data = std::move(object);
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    bool done() const { return pos_ == data_.size(); }
+
+private:
+    std::string_view data_;
+    size_t pos_ = 0;
+
+    bool has(size_t n) const { return data_.size() - pos_ >= n; }
+
+    bool read_u32(uint32_t& v) {
+        if (!has(4)) return false;
+        v = get_u32(data_.data() + pos_);
+        pos_ += 4;
+        return true;
+    }
+
+    bool read_string(std::string_view& text) {
+        uint32_t size;
+        if (!read_u32(size) || !has(size)) return false;
+        text = data_.substr(pos_, size);
+        pos_ += size;
+        return true;
+    }
+};
+
+uint64_t fresh_nonce() {
+    static std::mt19937_64 rng(std::random_device{}() ^
+                               static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    return rng();
+}
+
+} // namespace
+
+void StateImage::Writer::add(const std::string& name, const io::JsonValue& value) {
+    Pending& pending = sections_[name];
+    pending.payload.clear();
+    encode(pending.payload, value);
+    pending.crc = crc32(pending.payload.data(), pending.payload.size());
+}
+
+void StateImage::Writer::add_raw(const std::string& name, const StateImage& image) {
+    const Entry* entry = image.find(name);
+    if (!entry) return;
+    sections_[name] = Pending{std::string(entry->payload), entry->crc};
+}
+
+std::string StateImage::Writer::finish() {
+    size_t index_size = 0;
+    size_t payload_size = 0;
+    for (const auto& [name, pending] : sections_) {
+        index_size += INDEX_ENTRY_SIZE + name.size();
+        payload_size += pending.payload.size();
+    }
+
+    std::string out;
+    out.reserve(HEADER_SIZE + index_size + payload_size);
+    out.append(MAGIC, 4);
+    append_u32(out, FORMAT_VERSION);
+    append_u32(out, static_cast<uint32_t>(sections_.size()));
+    append_u32(out, static_cast<uint32_t>(index_size));
+    append_u64(out, fresh_nonce());
+
+    uint64_t offset = HEADER_SIZE + index_size;
+    for (const auto& [name, pending] : sections_) {
+        append_u32(out, static_cast<uint32_t>(name.size()));
+        append_u32(out, pending.crc);
+        append_u64(out, offset);
+        append_u64(out, pending.payload.size());
+        out += name;
+        offset += pending.payload.size();
+    }
+    for (const auto& [name, pending] : sections_) out += pending.payload;
+    sections_.clear();
+    return out;
+}
+
+bool StateImage::is_image(std::string_view bytes) {
+    return bytes.size() >= HEADER_SIZE && std::memcmp(bytes.data(), MAGIC, 4) == 0 &&
+           get_u32(bytes.data() + 4) == FORMAT_VERSION;
+}
+
+std::string_view StateImage::identity_of(std::string_view bytes) {
+    if (!is_image(bytes)) return {};
+    return bytes.substr(0, std::min<size_t>(bytes.size(), HEADER_SIZE + get_u32(bytes.data() + 12)));
+}
+
+std::shared_ptr<const StateImage> StateImage::open(const std::string& path) {
+    auto file = io::MappedFile::open(path);
+    if (!file || !is_image(file->view())) return nullptr;
+    std::shared_ptr<StateImage> image(new StateImage(std::move(*file)));
+    if (!image->parse_index()) return nullptr;
+    return image;
+}
+
+StateImage::StateImage(io::MappedFile file) : file_(std::move(file)) {}
+
+bool StateImage::parse_index() {
+    std::string_view data = file_.view();
+    uint32_t count = get_u32(data.data() + 8);
+    uint64_t index_size = get_u32(data.data() + 12);
+    if (index_size > data.size() - HEADER_SIZE || count > index_size / INDEX_ENTRY_SIZE) return false;
+    index_end_ = HEADER_SIZE + index_size;
+
+    entries_ = std::make_unique<Entry[]>(count);
+    size_t pos = HEADER_SIZE;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (index_end_ - pos < INDEX_ENTRY_SIZE) return false;
+        const char* at = data.data() + pos;
+        uint32_t name_size = get_u32(at);
+        uint64_t offset = get_u64(at + 8);
+        uint64_t size = get_u64(at + 16);
+        pos += INDEX_ENTRY_SIZE;
+        if (index_end_ - pos < name_size || offset < index_end_ || offset > data.size() ||
+            size > data.size() - offset) {
+            return false;
+        }
+        entries_[i].payload = data.substr(offset, size);
+        entries_[i].crc = get_u32(at + 4);
+        index_.emplace(std::string(data.substr(pos, name_size)), i);
+        pos += name_size;
+    }
+    return pos == index_end_;
+}
+
+const StateImage::Entry* StateImage::find(const std::string& name) const {
+    auto it = index_.find(name);
+    return it == index_.end() ? nullptr : &entries_[it->second];
+}
+
+std::vector<std::string> StateImage::names() const {
+    std::vector<std::string> names;
+    names.reserve(index_.size());
+    for (const auto& [name, i] : index_) names.push_back(name);
+    return names;
+}
+
+bool StateImage::contains(const std::string& name) const {
+    return find(name) != nullptr;
+}
+
+StateImage::Section StateImage::section(const std::string& name) const {
+    const Entry* entry = find(name);
+    if (!entry) return nullptr;
+    std::call_once(entry->once, [&] {
+        io::JsonValue value;
+        Decoder decoder(entry->payload);
+        bool ok = crc32(entry->payload.data(), entry->payload.size()) == entry->crc &&
+                  decoder.decode(value) && decoder.done();
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        if (ok) {
+            entry->decoded = std::make_shared<const io::JsonValue>(std::move(value));
+            decoded_++;
+        } else {
+            corrupt_++;
+        }
+    });
+    return entry->decoded;
+}
+
+io::JsonValue StateImage::to_json() const {
+    io::JsonObject object;
+    for (const auto& [name, i] : index_) {
+        if (Section value = section(name)) object.emplace_hint(object.end(), name, *value);
+    }
+    return io::JsonValue{std::move(object)};
+}
+
+std::string_view StateImage::identity() const {
+    return identity_of(file_.view());
+}
+
+size_t StateImage::decoded_sections() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return decoded_;
+}
+
+size_t StateImage::corrupt_sections() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return corrupt_;
+}
+
+} // namespace qc::core
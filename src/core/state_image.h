@@ -0,0 +1,92 @@
+#ifndef STATE_IMAGE_H
+#define STATE_IMAGE_H
+
+#include "../io/file_io.h"
+#include "../io/json_parser.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qc::core {
+
+// Binary snapshot of named state sections, read straight from a memory
+// mapping. Opening one reads only the header and section index; each section
+// is checked and decoded the first time it is asked for, and shared from
+// then on. Restoring a large state therefore costs next to nothing up front,
+// and sections nobody touches are never paged in.
+//
+// Sections hold a compact tagged encoding of io::JsonValue, which decodes far
+// faster than JSON text. Everything is little endian.
+class StateImage {
+public:
+    using Section = std::shared_ptr<const io::JsonValue>;
+
+    // Assembles an image; sections come out sorted by name
+    class Writer {
+    public:
+        void add(const std::string& name, const io::JsonValue& value);
+        // Reuse a section of an existing image without decoding it
+        void add_raw(const std::string& name, const StateImage& image);
+        std::string finish();
+
+    private:
+        struct Pending {
+            std::string payload;
+            uint32_t crc = 0;
+        };
+        std::map<std::string, Pending> sections_;
+    };
+
+    // Null if `path` is missing or is not a well-formed image
+    static std::shared_ptr<const StateImage> open(const std::string& path);
+    static bool is_image(std::string_view bytes);
+    // identity() of the image held in `bytes`
+    static std::string_view identity_of(std::string_view bytes);
+
+    StateImage(const StateImage&) = delete;
+    StateImage& operator=(const StateImage&) = delete;
+
+    std::vector<std::string> names() const;
+    bool contains(const std::string& name) const;
+    // Decoded on first use; null if absent or corrupt
+    Section section(const std::string& name) const;
+    // Everything, decoded
+    io::JsonValue to_json() const;
+
+    // Header and index bytes, unique to each written image; tells a journal
+    // which image it extends without hashing the whole file
+    std::string_view identity() const;
+    uint64_t size() const { return file_.size(); }
+    size_t decoded_sections() const;
+    size_t corrupt_sections() const;
+
+private:
+    struct Entry {
+        std::string_view payload;
+        uint32_t crc = 0;
+        mutable std::once_flag once;
+        mutable Section decoded;
+    };
+
+    explicit StateImage(io::MappedFile file);
+    bool parse_index();
+
+    io::MappedFile file_;
+    size_t index_end_ = 0;
+    std::unique_ptr<Entry[]> entries_;
+    std::map<std::string, size_t, std::less<>> index_;
+    mutable std::mutex stats_mutex_;
+    mutable size_t decoded_ = 0;
+    mutable size_t corrupt_ = 0;
+
+    const Entry* find(const std::string& name) const;
+};
+
+} // namespace qc::core
+
+#endif // STATE_IMAGE_H
@@ -0,0 +1,109 @@
+#include "state_journal.h"
+#include "digest.h"
+#include "../io/file_io.h"
+#include "../io/json_diff.h"
+#include "../io/json_emitter.h"
+#include <cstdio>
+#include <filesystem>
+
+namespace qc::core {
+
+StateJournal::StateJournal(const std::string& path, bool durable) : path_(path), durable_(durable) {}
+
+StateJournal::~StateJournal() {
+    close_fd();
+}
+
+void StateJournal::close_fd() {
+    io::FileIO::close_fd(fd_);
+    fd_ = -1;
+}
+
+bool StateJournal::open_for_append() {
+    if (fd_ >= 0) return true;
+    fd_ = io::FileIO::open_fd(path_, io::FileIO::Open::APPEND);
+    return fd_ >= 0;
+}
+
+std::string StateJournal::frame(const io::JsonValue& record) {
+    std::string json = io::JsonEmitter::emit(record);
+    char crc[9];
+    std::snprintf(crc, sizeof(crc), "%08x", crc32(json.data(), json.size()));
+    std::string line;
+    line.reserve(json.size() + 10);
+    line.append(crc, 8);
+    line += ' ';
+    line += json;
+    line += '\n';
+    return line;
+}
+
+io::JsonValue StateJournal::header_for(std::string_view snapshot) {
+    return io::JsonValue{io::JsonObject{
+        {"snapshot", io::JsonValue{hex_encode(digest128(snapshot))}},
+        {"size", io::JsonValue{static_cast<double>(snapshot.size())}},
+    }};
+}
+
+bool StateJournal::reset(std::string_view snapshot) {
+    close_fd();
+    size_ = 0;
+    appendable_ = io::FileIO::write_atomic(path_, frame(header_for(snapshot)), durable_);
+    return appendable_;
+}
+
+bool StateJournal::append(const io::JsonValue& record) {
+    if (!appendable_ || !open_for_append()) return false;
+    std::string line = frame(record);
+    if (!io::FileIO::append(fd_, line.data(), line.size())) {
+        appendable_ = false; // A partial line fails its checksum on replay, ending it there
+        return false;
+    }
+    if (durable_ && !io::FileIO::sync_fd(fd_)) return false;
+    size_ += line.size();
+    return true;
+}
+
+std::vector<io::JsonValue> StateJournal::replay(std::string_view snapshot) {
+    close_fd();
+    size_ = 0;
+    appendable_ = false;
+    std::vector<io::JsonValue> records;
+    auto file = io::MappedFile::open(path_);
+    if (!file) return records;
+
+    std::string_view data = file->view();
+    size_t pos = 0;
+    bool header_seen = false;
+    while (pos < data.size()) {
+        size_t end = data.find('\n', pos);
+        if (end == std::string_view::npos || end - pos < 10 || data[pos + 8] != ' ') break;
+        std::string json(data.substr(pos + 9, end - pos - 9));
+        unsigned crc = 0;
+        if (std::sscanf(std::string(data.substr(pos, 8)).c_str(), "%8x", &crc) != 1 ||
+            crc != crc32(json.data(), json.size())) {
+            break;
+        }
+        auto parsed = io::JsonParser::parse(json);
+        if (!std::holds_alternative<io::JsonValue>(parsed)) break;
+
+        if (!header_seen) {
+            // Records for some other snapshot are useless; leave the file for reset()
+            if (!io::JsonDiff::equal(std::get<io::JsonValue>(parsed), header_for(snapshot))) return records;
+            header_seen = true;
+        } else {
+            records.push_back(std::move(std::get<io::JsonValue>(parsed)));
+            size_ += end + 1 - pos;
+        }
+        pos = end + 1;
+    }
+
+    if (!header_seen) return records;
+    // Drop a torn tail so later appends start on a clean line
+    std::error_code ec;
+    if (pos < data.size()) std::filesystem::resize_file(path_, pos, ec);
+    appendable_ = !ec;
+    return records;
+}
+
+} // namespace qc::core
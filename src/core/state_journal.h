@@ -0,0 +1,57 @@
+#ifndef STATE_JOURNAL_H
+#define STATE_JOURNAL_H
+
+#include "../io/json_parser.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qc::core {
+
+// Append-only journal of JSON records that extend one particular snapshot.
+// The first record identifies that snapshot by digest and size, so a journal
+// left over from an older snapshot (say, after a crash between writing the
+// snapshot and resetting the journal) is never replayed on a newer one.
+//
+// Each record is one line, "<crc32 hex> <compact json>\n". Replay stops at the
+// first line that is incomplete or fails its checksum and cuts the file
+// there, so a torn append costs only the record being written. POSIX I/O.
+class StateJournal {
+public:
+    StateJournal(const std::string& path, bool durable);
+    ~StateJournal();
+
+    StateJournal(const StateJournal&) = delete;
+    StateJournal& operator=(const StateJournal&) = delete;
+
+    // Atomically replace the journal with an empty one extending `snapshot`
+    bool reset(std::string_view snapshot);
+
+    // False without writing when the journal on disk does not extend the
+    // current snapshot (nothing replayed or reset yet); reset() first
+    bool append(const io::JsonValue& record);
+
+    // The records extending `snapshot`, oldest first; none if the journal
+    // belongs to a different snapshot or does not exist
+    std::vector<io::JsonValue> replay(std::string_view snapshot);
+
+    // Bytes of records appended since the header
+    uint64_t size() const { return size_; }
+
+private:
+    std::string path_;
+    bool durable_;
+    int fd_ = -1;
+    uint64_t size_ = 0;
+    bool appendable_ = false;
+
+    void close_fd();
+    bool open_for_append();
+    static std::string frame(const io::JsonValue& record);
+    static io::JsonValue header_for(std::string_view snapshot);
+};
+
+} // namespace qc::core
+
+#endif // STATE_JOURNAL_H
@@ -1,52 +1,424 @@
 #include "state_manager.h"
-#include <fstream>
-#include <iostream>
+#include "../io/file_io.h"
+#include "../io/json_diff.h"
+#include "../io/json_emitter.h"
+#include <algorithm>
 
 namespace qc::core {
 
-StateManager::StateManager(const std::string& state_file) : state_file(state_file) {}
+StateManager::StateManager(const std::string& state_file) : StateManager(state_file, Options{}) {}
+
+StateManager::StateManager(const std::string& state_file, const Options& options)
+    : state_file(state_file), options(options), journal(state_file + ".journal", options.durable) {}
 
 StateManager::~StateManager() {
     stop_autosave();
 }
 
+namespace {
+
+StateStore::Snapshot split_sections(io::JsonObject object) {
+    auto sections = std::make_shared<StateStore::Sections>();
+    for (auto& [name, value] : object) {
+        (*sections)[name] = std::make_shared<const io::JsonValue>(std::move(value));
+    }
+    return {0, std::move(sections), nullptr};
+}
+
+// Same bytes JsonEmitter produces for the equivalent object
+std::string emit_sections(const StateStore::Snapshot& snapshot) {
+    std::string out = "{";
+    for (const auto& name : snapshot.names()) {
+        if (out.size() > 1) out += ',';
+        io::JsonEmitter::emit_to(out, io::JsonValue{name});
+        out += ':';
+        io::JsonEmitter::emit_to(out, *snapshot.get(name));
+    }
+    out += '}';
+    return out;
+}
+
+io::JsonValue path_op(const char* kind, const std::string& name) {
+    return io::JsonValue{io::JsonObject{{kind, io::JsonValue{io::JsonArray{io::JsonValue{name}}}}}};
+}
+
+// Sections still shared with `before` are unchanged and skipped without a
+// look; over a common image, only sections set since are even visited
+io::JsonArray diff_sections(const StateStore::Snapshot& before, const StateStore::Snapshot& after) {
+    std::vector<std::string> names;
+    if (before.image == after.image) {
+        for (const auto* sections : {before.sections.get(), after.sections.get()}) {
+            for (const auto& [name, section] : *sections) names.push_back(name);
+        }
+    } else {
+        names = before.names();
+        std::vector<std::string> added = after.names();
+        names.insert(names.end(), added.begin(), added.end());
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    io::JsonArray ops;
+    for (const auto& name : names) {
+        StateStore::Section old_section = before.get(name);
+        StateStore::Section new_section = after.get(name);
+        if (old_section == new_section) continue;
+        if (!new_section) {
+            ops.push_back(path_op("remove", name));
+        } else if (!old_section) {
+            io::JsonValue op = path_op("set", name);
+            std::get<io::JsonObject>(op.data)["value"] = *new_section;
+            ops.push_back(std::move(op));
+        } else {
+            io::JsonArray changed = io::JsonDiff::diff(*old_section, *new_section, io::JsonArray{io::JsonValue{name}});
+            ops.insert(ops.end(), std::make_move_iterator(changed.begin()), std::make_move_iterator(changed.end()));
+        }
+    }
+    return ops;
+}
+
+const io::JsonArray* ops_of(const io::JsonValue& record) {
+    if (!record.is_object() || !record.as_object().count("ops")) return nullptr;
+    const io::JsonValue& ops = record.as_object().at("ops");
+    return ops.is_array() ? &ops.as_array() : nullptr;
+}
+
+// The section an op touches, or null for an op on the whole state
+const std::string* op_section(const io::JsonValue& op, const io::JsonArray*& path) {
+    if (!op.is_object()) return nullptr;
+    for (const char* kind : {"set", "remove"}) {
+        auto it = op.as_object().find(kind);
+        if (it == op.as_object().end()) continue;
+        if (!it->second.is_array() || it->second.as_array().empty()) return nullptr;
+        path = &it->second.as_array();
+        const io::JsonValue& name = path->front();
+        return name.is_string() ? &name.as_string() : nullptr;
+    }
+    return nullptr;
+}
+
+} // namespace
+
 void StateManager::save_immediate(const io::JsonValue& state) {
-    std::lock_guard<std::mutex> lock(state_mutex);
-    std::ofstream f(state_file);
-    f << "{ \"state\": \"saved\" }"; // Placeholder serialization
+    if (state.is_object()) {
+        save_sections(split_sections(state.as_object()));
+        return;
+    }
+    // Only objects split into sections; anything else is always written whole
+    std::lock_guard<std::mutex> lock(save_mutex);
+    std::string bytes = io::JsonEmitter::emit(state);
+    if (write_snapshot_bytes(bytes, bytes)) baseline.reset();
+}
+
+void StateManager::save_snapshot(const StateStore::Snapshot& snapshot) {
+    StateStore::Snapshot copy = snapshot;
+    if (!copy.sections) copy.sections = std::make_shared<const StateStore::Sections>();
+    save_sections(std::move(copy));
+}
+
+void StateManager::compact() {
+    std::lock_guard<std::mutex> lock(save_mutex);
+    if (baseline) write_snapshot(*baseline);
+}
+
+void StateManager::save_sections(StateStore::Snapshot snapshot) {
+    std::lock_guard<std::mutex> lock(save_mutex);
+    if (!baseline) {
+        if (write_snapshot(snapshot)) baseline = std::move(snapshot);
+        return;
+    }
+
+    io::JsonArray ops = diff_sections(*baseline, snapshot);
+    if (ops.empty()) {
+        std::lock_guard<std::mutex> counters_lock(state_mutex);
+        counters.skipped_saves++;
+        baseline = std::move(snapshot); // Keeps sharing with the newest version
+        return;
+    }
+
+    uint64_t threshold = std::max<uint64_t>(options.compaction_min_bytes,
+                                            static_cast<uint64_t>(options.compaction_ratio * snapshot_bytes));
+    uint64_t before = journal.size();
+    if (before >= threshold || !journal.append(io::JsonValue{io::JsonObject{{"ops", io::JsonValue{ops}}}})) {
+        if (write_snapshot(snapshot)) baseline = std::move(snapshot);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> counters_lock(state_mutex);
+        counters.journal_records++;
+        counters.bytes_written += journal.size() - before;
+    }
+    baseline = std::move(snapshot);
+}
+
+// Caller must hold save_mutex
+bool StateManager::write_snapshot(const StateStore::Snapshot& snapshot) {
+    if (options.format == Format::JSON) {
+        std::string bytes = emit_sections(snapshot);
+        return write_snapshot_bytes(bytes, bytes);
+    }
+
+    // Sections still backed by an image are copied over without decoding
+    StateImage::Writer writer;
+    for (const auto& name : snapshot.names()) {
+        if (snapshot.image && !snapshot.sections->count(name)) {
+            writer.add_raw(name, *snapshot.image);
+        } else {
+            writer.add(name, *snapshot.get(name));
+        }
+    }
+    std::string bytes = writer.finish();
+    return write_snapshot_bytes(bytes, StateImage::identity_of(bytes));
+}
+
+// Caller must hold save_mutex
+bool StateManager::write_snapshot_bytes(const std::string& bytes, std::string_view identity) {
+    if (!io::FileIO::write_atomic(state_file, bytes, options.durable)) return false;
+    // Until the reset lands, the old journal names the old snapshot and is ignored
+    journal.reset(identity);
+    snapshot_bytes = bytes.size();
+    std::lock_guard<std::mutex> counters_lock(state_mutex);
+    counters.snapshots++;
+    counters.bytes_written += bytes.size();
+    return true;
+}
+
+// Caller must hold save_mutex
+std::optional<io::JsonValue> StateManager::read_state() {
+    auto file = io::MappedFile::open(state_file);
+    if (!file) return std::nullopt;
+
+    io::JsonValue state;
+    std::string_view identity = file->view();
+    std::shared_ptr<const StateImage> image;
+    if (StateImage::is_image(file->view())) {
+        image = StateImage::open(state_file);
+        if (!image) return std::nullopt;
+        state = image->to_json();
+        identity = image->identity();
+    } else {
+        auto res = io::JsonParser::parse(std::string(file->view()));
+        if (!std::holds_alternative<io::JsonValue>(res)) return std::nullopt;
+        state = std::move(std::get<io::JsonValue>(res));
+    }
+
+    for (const auto& record : journal.replay(identity)) {
+        if (const io::JsonArray* ops = ops_of(record)) io::JsonDiff::apply(state, *ops);
+    }
+    snapshot_bytes = file->size();
+    return state;
 }
 
 std::optional<io::JsonValue> StateManager::load() {
-    std::lock_guard<std::mutex> lock(state_mutex);
-    std::ifstream f(state_file);
-    if (!f.is_open()) return std::nullopt;
-    
-    std::string content((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
-    auto res = io::JsonParser::parse(content);
-    if (std::holds_alternative<io::JsonValue>(res)) {
-        return std::get<io::JsonValue>(res);
+    std::lock_guard<std::mutex> lock(save_mutex);
+    auto state = read_state();
+    if (state && state->is_object()) {
+        baseline = split_sections(state->as_object());
+    } else {
+        baseline.reset();
+    }
+    return state;
+}
+
+bool StateManager::restore(StateStore& store) {
+    std::lock_guard<std::mutex> lock(save_mutex);
+    auto image = StateImage::open(state_file);
+    if (!image) {
+        auto state = read_state();
+        if (!state || !state->is_object()) {
+            baseline.reset();
+            return false;
+        }
+        StateStore::Snapshot snapshot = split_sections(std::move(std::get<io::JsonObject>(state->data)));
+        store.replace_all(*snapshot.sections); // Same section pointers, so the next save diffs nothing it loaded
+        baseline = store.snapshot();
+        return true;
+    }
+
+    // Replay the journal onto just the sections it touches
+    std::vector<io::JsonValue> records = journal.replay(image->identity());
+    std::map<std::string, std::optional<io::JsonValue>> touched; // Empty once removed
+    for (const auto& record : records) {
+        const io::JsonArray* ops = ops_of(record);
+        if (!ops) continue;
+        for (const auto& op : *ops) {
+            const io::JsonArray* path = nullptr;
+            const std::string* name = op_section(op, path);
+            if (!name) {
+                // Replaces the whole state; rare enough to take the slow path
+                io::JsonValue state = image->to_json();
+                for (const auto& all : records) {
+                    if (const io::JsonArray* all_ops = ops_of(all)) io::JsonDiff::apply(state, *all_ops);
+                }
+                if (!state.is_object()) {
+                    baseline.reset();
+                    return false;
+                }
+                StateStore::Snapshot snapshot = split_sections(std::move(std::get<io::JsonObject>(state.data)));
+                store.replace_all(*snapshot.sections);
+                baseline = store.snapshot();
+                snapshot_bytes = image->size();
+                return true;
+            }
+
+            auto [it, inserted] = touched.try_emplace(*name);
+            if (path->size() == 1) {
+                // Replaces or drops the section outright, no need to decode it
+                auto value = op.as_object().find("value");
+                if (op.as_object().count("set") && value != op.as_object().end()) {
+                    it->second = value->second;
+                } else {
+                    it->second.reset();
+                }
+                continue;
+            }
+            if (inserted) {
+                if (StateStore::Section section = image->section(*name)) it->second = *section;
+            }
+            if (!it->second) continue; // Nothing left to change
+            io::JsonValue holder{io::JsonObject{{*name, std::move(*it->second)}}};
+            io::JsonDiff::apply(holder, io::JsonArray{op});
+            it->second = std::move(std::get<io::JsonObject>(holder.data).at(*name));
+        }
+    }
+
+    StateStore::Sections sections;
+    for (auto& [name, value] : touched) {
+        if (value) {
+            sections[name] = std::make_shared<const io::JsonValue>(std::move(*value));
+        } else if (image->contains(name)) {
+            sections[name] = nullptr;
+        }
     }
-    return std::nullopt;
+    store.replace_all(std::move(sections), image);
+    baseline = store.snapshot();
+    snapshot_bytes = image->size();
+    return true;
+}
+
+StateManager::Stats StateManager::stats() const {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return counters;
+}
+
+void StateManager::start_autosave(const AutosaveOptions& timing, std::function<io::JsonValue()> state_provider) {
+    Schedule schedule;
+    schedule.timing = timing;
+    schedule.save = [this, state_provider = std::move(state_provider)] { save_immediate(state_provider()); };
+    start_schedule(std::move(schedule));
 }
 
 void StateManager::start_autosave(int interval_ms, std::function<io::JsonValue()> state_provider) {
-    if (autosave_running) return;
-    autosave_running = true;
-    autosave_thread = std::thread([this, interval_ms, state_provider]() {
-        while (autosave_running) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
-            if (autosave_running) {
-                save_immediate(state_provider());
+    // Without a version, unchanged state is still caught by the empty diff
+    start_autosave(interval_ms, nullptr, std::move(state_provider));
+}
+
+void StateManager::start_autosave(int interval_ms, std::function<uint64_t()> version,
+                                  std::function<io::JsonValue()> state_provider) {
+    Schedule schedule;
+    schedule.poll_interval = std::chrono::milliseconds(std::max(interval_ms, 1));
+    schedule.version = std::move(version);
+    schedule.save = [this, state_provider = std::move(state_provider)] { save_immediate(state_provider()); };
+    start_schedule(std::move(schedule));
+}
+
+void StateManager::start_autosave(const AutosaveOptions& timing, const StateStore& store) {
+    Schedule schedule;
+    schedule.timing = timing;
+    schedule.version = [&store] { return store.version(); };
+    schedule.save = [this, &store] { save_snapshot(store.snapshot()); };
+    start_schedule(std::move(schedule));
+}
+
+void StateManager::start_autosave(int interval_ms, const StateStore& store) {
+    Schedule schedule;
+    schedule.poll_interval = std::chrono::milliseconds(std::max(interval_ms, 1));
+    schedule.version = [&store] { return store.version(); };
+    schedule.save = [this, &store] { save_snapshot(store.snapshot()); };
+    start_schedule(std::move(schedule));
+}
+
+void StateManager::start_schedule(Schedule schedule) {
+    if (autosave_running.exchange(true)) return;
+    {
+        std::lock_guard<std::mutex> lock(schedule_mutex);
+        stop_requested = false;
+        dirty = false;
+        last_save = Clock::now();
+    }
+    autosave_thread = std::thread([this, schedule = std::move(schedule)]() { autosave_loop(schedule); });
+}
+
+void StateManager::notify_changed() {
+    std::lock_guard<std::mutex> lock(schedule_mutex);
+    Clock::time_point now = Clock::now();
+    last_change = now;
+    if (!dirty) {
+        // Later changes only push the deadline back, so only this one needs a wakeup
+        dirty = true;
+        first_change = now;
+        schedule_cv.notify_one();
+    }
+}
+
+void StateManager::autosave_loop(const Schedule& schedule) {
+    std::optional<uint64_t> saved_version;
+    auto save = [&] {
+        if (schedule.version) {
+            uint64_t current = schedule.version();
+            if (saved_version == current) {
+                std::lock_guard<std::mutex> lock(state_mutex);
+                counters.skipped_saves++;
+                return;
             }
+            saved_version = current;
+        }
+        schedule.save();
+    };
+
+    const bool polling = schedule.poll_interval.count() > 0;
+    std::unique_lock<std::mutex> lock(schedule_mutex);
+    Clock::time_point next_poll = Clock::now() + schedule.poll_interval;
+    while (true) {
+        Clock::time_point now = Clock::now();
+        Clock::time_point change_due = Clock::time_point::max();
+        if (dirty) {
+            change_due = std::min(last_change + schedule.timing.debounce, first_change + schedule.timing.max_delay);
+            change_due = std::max(change_due, last_save + schedule.timing.min_interval);
         }
-    });
+        Clock::time_point wake = polling ? std::min(change_due, next_poll) : change_due;
+
+        if (stop_requested || now >= wake) {
+            bool final_save = stop_requested;
+            if (final_save && !dirty && !polling) break;
+            if (polling && now >= next_poll) next_poll = now + schedule.poll_interval;
+            dirty = false;
+            lock.unlock();
+            save(); // Changes notified from here on start a new round
+            lock.lock();
+            last_save = Clock::now();
+            if (final_save) break;
+            continue;
+        }
+
+        if (wake == Clock::time_point::max()) {
+            schedule_cv.wait(lock);
+        } else {
+            schedule_cv.wait_until(lock, wake);
+        }
+    }
 }
 
 void StateManager::stop_autosave() {
-    autosave_running = false;
+    {
+        std::lock_guard<std::mutex> lock(schedule_mutex);
+        stop_requested = true;
+    }
+    schedule_cv.notify_all();
     if (autosave_thread.joinable()) {
         autosave_thread.join();
     }
+    autosave_running = false;
 }
 
 } // namespace qc::core
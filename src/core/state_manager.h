@@ -2,31 +2,139 @@
 #define STATE_MANAGER_V2_H
 
 #include "../io/json_parser.h"
+#include "state_journal.h"
+#include "state_store.h"
 #include <string>
 #include <functional>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <optional>
 #include <thread>
 
 #include <mutex>
 
 namespace qc::core {
 
+// Persists application state as a full snapshot (state_file) plus a journal
+// of deltas against it (state_file + ".journal"). Snapshots are StateImages
+// by default, so restore() maps the file and decodes sections only as they
+// are read; plain JSON snapshots are still read, and written on request. A save writes only
+// what changed since the previous save; once the journal outgrows the
+// snapshot, the next save writes a fresh snapshot and empties the journal.
+// Snapshots are replaced atomically and journal records are checksummed, so a
+// crash loses at most the save in progress.
+//
+// Autosave runs on one background thread driven by a condition variable: it
+// sleeps until a change notification or poll tick is due, and stop_autosave()
+// wakes it at once for a final save of anything still pending.
+//
+// State kept in a StateStore is captured in O(1) and diffed section by
+// section, skipping sections still shared with the last save. Saves are
+// serialized on their own mutex, so diffing and file I/O never block the
+// application thread or stats().
 class StateManager {
 public:
+    enum class Format { IMAGE, JSON };
+
+    struct Options {
+        Format format = Format::IMAGE;        // For snapshots; loading accepts either
+        bool durable = true;                  // fdatasync snapshots and journal appends
+        double compaction_ratio = 1.0;        // Journal bytes / snapshot bytes that trigger a snapshot
+        uint64_t compaction_min_bytes = 64 * 1024;
+    };
+
+    // Event-driven autosave timing. A save happens once changes have been
+    // quiet for `debounce`, but no later than `max_delay` after the first
+    // unsaved change, and never sooner than `min_interval` after the previous
+    // save (which wins over max_delay if larger).
+    struct AutosaveOptions {
+        std::chrono::milliseconds debounce{100};
+        std::chrono::milliseconds max_delay{1000};
+        std::chrono::milliseconds min_interval{0};
+    };
+
+    struct Stats {
+        size_t snapshots = 0;
+        size_t journal_records = 0;
+        size_t skipped_saves = 0;  // Nothing had changed
+        uint64_t bytes_written = 0;
+    };
+
     StateManager(const std::string& state_file = "app_state.json");
+    StateManager(const std::string& state_file, const Options& options);
     ~StateManager();
 
+    // Save after notify_changed(), coalescing bursts of changes
+    void start_autosave(const AutosaveOptions& timing, std::function<io::JsonValue()> state_provider);
+    void notify_changed();
+
+    // Poll every interval_ms instead
     void start_autosave(int interval_ms, std::function<io::JsonValue()> state_provider);
+    // `version` must change whenever the state does; the state is only
+    // built and saved when it differs from the last saved version
+    void start_autosave(int interval_ms, std::function<uint64_t()> version,
+                        std::function<io::JsonValue()> state_provider);
+
+    // Save snapshots of `store`, which must outlive the autosave thread
+    void start_autosave(const AutosaveOptions& timing, const StateStore& store);
+    void start_autosave(int interval_ms, const StateStore& store);
+
+    // Returns promptly; pending changes are saved first
     void stop_autosave();
-    
+
     void save_immediate(const io::JsonValue& state);
+    void save_snapshot(const StateStore::Snapshot& snapshot);
+    // Write a full snapshot now and empty the journal
+    void compact();
     std::optional<io::JsonValue> load();
+    // Load into `store`, whose sections then count as saved; false if
+    // nothing was saved or the saved state is not an object. Image sections
+    // are left encoded until the store reads them, unless the journal
+    // changed them
+    bool restore(StateStore& store);
+
+    Stats stats() const;
 
 private:
     std::string state_file;
+    Options options;
+    using Clock = std::chrono::steady_clock;
+
+    struct Schedule {
+        AutosaveOptions timing;
+        std::chrono::milliseconds poll_interval{0}; // 0 = event-driven only
+        std::function<uint64_t()> version;
+        std::function<void()> save;
+    };
+
     std::atomic<bool> autosave_running{false};
     std::thread autosave_thread;
-    mutable std::mutex state_mutex;
+    mutable std::mutex state_mutex; // Guards counters only
+    std::mutex save_mutex;          // Serializes saves and loads; guards the journal and baseline
+
+    std::mutex schedule_mutex; // Guards the fields below
+    std::condition_variable schedule_cv;
+    bool stop_requested = false;
+    bool dirty = false;
+    Clock::time_point first_change;
+    Clock::time_point last_change;
+    Clock::time_point last_save;
+
+    StateJournal journal;
+    // Sections as of the last save or load; empty before the first save or
+    // when the saved state is not an object
+    std::optional<StateStore::Snapshot> baseline;
+    uint64_t snapshot_bytes = 0;
+    Stats counters;
+
+    void start_schedule(Schedule schedule);
+    void autosave_loop(const Schedule& schedule);
+    void save_sections(StateStore::Snapshot snapshot);
+    bool write_snapshot(const StateStore::Snapshot& snapshot);
+    bool write_snapshot_bytes(const std::string& bytes, std::string_view identity);
+    std::optional<io::JsonValue> read_state();
 };
 
 } // namespace qc::core
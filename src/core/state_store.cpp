@@ -0,0 +1,108 @@
+#include "state_store.h"
+#include <algorithm>
+
+namespace qc::core {
+
+StateStore::Section StateStore::Snapshot::get(const std::string& name) const {
+    if (sections) {
+        auto it = sections->find(name);
+        if (it != sections->end()) return it->second;
+    }
+    return image ? image->section(name) : nullptr;
+}
+
+std::vector<std::string> StateStore::Snapshot::names() const {
+    std::vector<std::string> names;
+    if (image) {
+        for (auto& name : image->names()) {
+            if (!sections || !sections->count(name)) names.push_back(std::move(name));
+        }
+    }
+    if (sections) {
+        for (const auto& [name, section] : *sections) {
+            if (section) names.push_back(name);
+        }
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+io::JsonValue StateStore::Snapshot::to_json() const {
+    io::JsonObject object;
+    for (const auto& name : names()) {
+        if (Section section = get(name)) object.emplace_hint(object.end(), name, *section);
+    }
+    return io::JsonValue{std::move(object)};
+}
+
+StateStore::StateStore() : sections_(std::make_shared<const Sections>()) {}
+
+void StateStore::publish(std::shared_ptr<const Sections> sections) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sections_ = std::move(sections);
+    version_++;
+}
+
+void StateStore::set(const std::string& name, io::JsonValue value) {
+    set(name, std::make_shared<const io::JsonValue>(std::move(value)));
+}
+
+void StateStore::set(const std::string& name, Section value) {
+    std::lock_guard<std::mutex> write_lock(write_mutex_);
+    auto next = std::make_shared<Sections>(*snapshot().sections); // Copies pointers, not values
+    (*next)[name] = std::move(value);
+    publish(std::move(next));
+}
+
+void StateStore::update(const std::string& name, const std::function<void(io::JsonValue&)>& mutate) {
+    std::lock_guard<std::mutex> write_lock(write_mutex_);
+    Snapshot current = snapshot();
+    Section section = current.get(name);
+    io::JsonValue value = section ? *section : io::JsonValue{};
+    mutate(value);
+
+    auto next = std::make_shared<Sections>(*current.sections);
+    (*next)[name] = std::make_shared<const io::JsonValue>(std::move(value));
+    publish(std::move(next));
+}
+
+bool StateStore::erase(const std::string& name) {
+    std::lock_guard<std::mutex> write_lock(write_mutex_);
+    Snapshot current = snapshot();
+    bool in_image = current.image && current.image->contains(name);
+    auto it = current.sections->find(name);
+    if (it == current.sections->end() ? !in_image : !it->second) return false;
+
+    auto next = std::make_shared<Sections>(*current.sections);
+    if (in_image) {
+        (*next)[name] = nullptr;
+    } else {
+        next->erase(name);
+    }
+    publish(std::move(next));
+    return true;
+}
+
+void StateStore::replace_all(Sections sections, std::shared_ptr<const StateImage> image) {
+    std::lock_guard<std::mutex> write_lock(write_mutex_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    sections_ = std::make_shared<const Sections>(std::move(sections));
+    image_ = std::move(image);
+    version_++;
+}
+
+StateStore::Section StateStore::get(const std::string& name) const {
+    return snapshot().get(name);
+}
+
+StateStore::Snapshot StateStore::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {version_, sections_, image_};
+}
+
+uint64_t StateStore::version() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return version_;
+}
+
+} // namespace qc::core
@@ -0,0 +1,66 @@
+#ifndef STATE_STORE_H
+#define STATE_STORE_H
+
+#include "../io/json_parser.h"
+#include "state_image.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace qc::core {
+
+// Application state as named sections of immutable JSON, published by
+// pointer. An update builds a new version of one section and swaps it in, so
+// taking a snapshot is O(1): it just holds on to the current section map, and
+// unchanged sections stay shared between versions. Readers and snapshots
+// never wait for a writer to finish building its value.
+//
+// The sections may sit on top of a StateImage, as after a restore. Sections
+// not set since then are decoded from the image when first read.
+class StateStore {
+public:
+    using Section = std::shared_ptr<const io::JsonValue>;
+    // With an image underneath, a null section hides the image's one
+    using Sections = std::map<std::string, Section>;
+
+    // Immutable view of every section at one version; cheap to copy and keep
+    struct Snapshot {
+        uint64_t version = 0;
+        std::shared_ptr<const Sections> sections;
+        std::shared_ptr<const StateImage> image;
+
+        Section get(const std::string& name) const;
+        std::vector<std::string> names() const;
+        io::JsonValue to_json() const; // Deep copy as one object
+    };
+
+    StateStore();
+
+    void set(const std::string& name, io::JsonValue value);
+    void set(const std::string& name, Section value);
+    // Copy one section (null if absent), let `mutate` edit the copy, then publish it
+    void update(const std::string& name, const std::function<void(io::JsonValue&)>& mutate);
+    bool erase(const std::string& name);
+    void replace_all(Sections sections, std::shared_ptr<const StateImage> image = nullptr);
+
+    Section get(const std::string& name) const;
+    Snapshot snapshot() const;
+    uint64_t version() const;
+
+private:
+    mutable std::mutex mutex_;  // Held only to read or swap the pointers
+    std::mutex write_mutex_;    // Serializes writers so updates are not lost
+    std::shared_ptr<const Sections> sections_;
+    std::shared_ptr<const StateImage> image_;
+    uint64_t version_ = 0;
+
+    void publish(std::shared_ptr<const Sections> sections); // Caller holds write_mutex_
+};
+
+} // namespace qc::core
+
+#endif // STATE_STORE_H
@@ -0,0 +1,83 @@
+#ifndef THREAD_BUFFERS_H
+#define THREAD_BUFFERS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace qc::core {
+
+// One T for each thread that writes, for records many threads add to and a
+// reader collects now and then: messages, trace spans. A thread finds its
+// own T through a one-entry thread-local cache, so only its first write
+// takes the shared lock. Each T has a lock of its own, which only a
+// collecting reader ever contends for.
+template <typename T>
+class ThreadBuffers {
+public:
+    ThreadBuffers() : id_(next_id()) {}
+    ThreadBuffers(const ThreadBuffers&) = delete;
+    ThreadBuffers& operator=(const ThreadBuffers&) = delete;
+
+    // f(T&) on the calling thread's buffer
+    template <typename F>
+    decltype(auto) with_local(F&& f) {
+        Buffer& buffer = local();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        return f(buffer.value);
+    }
+
+    // f(T&) on every buffer, in the order their threads first wrote, with
+    // all of them locked so nothing is added in between
+    template <typename F>
+    void with_all(F&& f) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::unique_lock<std::mutex>> held;
+        held.reserve(buffers_.size());
+        for (auto& entry : buffers_) held.emplace_back(entry.second->mutex);
+        for (auto& entry : buffers_) f(entry.second->value);
+    }
+
+private:
+    struct Buffer {
+        std::mutex mutex;
+        T value{};
+    };
+
+    static uint64_t next_id() {
+        static std::atomic<uint64_t> next{1};
+        return next++;
+    }
+
+    Buffer& local() {
+        thread_local uint64_t cached_owner = 0;
+        thread_local Buffer* cached_buffer = nullptr;
+        if (cached_owner == id_) return *cached_buffer;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::thread::id thread = std::this_thread::get_id();
+        Buffer* buffer = nullptr;
+        for (auto& entry : buffers_) {
+            if (entry.first == thread) buffer = entry.second.get();
+        }
+        if (!buffer) {
+            buffers_.emplace_back(thread, std::make_unique<Buffer>());
+            buffer = buffers_.back().second.get();
+        }
+        cached_owner = id_;
+        cached_buffer = buffer;
+        return *buffer;
+    }
+
+    const uint64_t id_; // Never reused, so a stale cache entry cannot match
+    std::mutex mutex_;
+    std::vector<std::pair<std::thread::id, std::unique_ptr<Buffer>>> buffers_;
+};
+
+} // namespace qc::core
+
+#endif // THREAD_BUFFERS_H
@@ -0,0 +1,48 @@
+#include "timer_wheel.h"
+#include <algorithm>
+
+namespace qc::core {
+
+TimerWheel::TimerWheel(int64_t now, size_t slot_count) : slots_(std::max<size_t>(slot_count, 1)), cursor_(now) {}
+
+std::vector<TimerWheel::Timer>& TimerWheel::slot_for(int64_t second) {
+    return slots_[static_cast<uint64_t>(second) % slots_.size()];
+}
+
+void TimerWheel::schedule(const std::string& key, int64_t deadline) {
+    // Deadlines already passed go in the next slot to be visited
+    slot_for(std::max(deadline, cursor_)).push_back({key, deadline});
+    size_++;
+}
+
+std::vector<std::string> TimerWheel::advance(int64_t now, size_t max_keys) {
+    std::vector<std::string> due;
+    size_t visited = 0;
+    while (cursor_ <= now && visited < slots_.size()) {
+        // Timers for later revolutions share the slot and stay put
+        std::vector<Timer>& slot = slot_for(cursor_);
+        size_t kept = 0;
+        for (auto& timer : slot) {
+            if (timer.deadline <= now && due.size() < max_keys) {
+                due.push_back(std::move(timer.key));
+            } else {
+                slot[kept++] = std::move(timer);
+            }
+        }
+        slot.resize(kept);
+        if (due.size() >= max_keys) break; // Revisit this slot next time
+        ++cursor_;
+        ++visited;
+    }
+    // After a long pause one revolution has checked every timer
+    if (visited == slots_.size()) cursor_ = now + 1;
+    size_ -= due.size();
+    return due;
+}
+
+void TimerWheel::clear() {
+    for (auto& slot : slots_) slot.clear();
+    size_ = 0;
+}
+
+} // namespace qc::core
@@ -0,0 +1,44 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace qc::core {
+
+// Hashed timing wheel of per-key deadlines with one-second slots. advance()
+// visits only the slots that came due since the last call, so expiring keys
+// costs time proportional to the keys found rather than to the key count.
+// Rescheduling a key leaves the old timer in place; callers re-check the real
+// deadline of each key returned. Not thread-safe.
+class TimerWheel {
+public:
+    explicit TimerWheel(int64_t now, size_t slot_count = 4096);
+
+    void schedule(const std::string& key, int64_t deadline);
+
+    // Keys whose deadline is at or before `now`, at most about `max_keys` of
+    // them; the rest are returned by later calls
+    std::vector<std::string> advance(int64_t now, size_t max_keys);
+
+    size_t size() const { return size_; }
+    void clear();
+
+private:
+    struct Timer {
+        std::string key;
+        int64_t deadline;
+    };
+
+    std::vector<std::vector<Timer>> slots_;
+    int64_t cursor_; // Next second whose slot has not been visited
+    size_t size_ = 0;
+
+    std::vector<Timer>& slot_for(int64_t second);
+};
+
+} // namespace qc::core
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,201 @@
+#include "trace_recorder.h"
+#include "json_bridge.h"
+#include "workflow_plan.h"
+#include "../io/json_emitter.h"
+#include <algorithm>
+#include <mutex>
+
+namespace qc::core {
+
+namespace {
+
+double microseconds(TraceRecorder::Clock::duration duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+::JsonValue number(double value) {
+    return ::JsonValue::makeNumber(value);
+}
+
+} // namespace
+
+const char* TraceRecorder::category_name(Category category) {
+    switch (category) {
+        case Category::WORKFLOW: return "workflow";
+        case Category::STEP: return "step";
+        case Category::OPERATION: return "operation";
+        case Category::DATA_SOURCE: return "data_source";
+        case Category::CACHE: return "cache";
+        case Category::FALLBACK: return "fallback";
+    }
+    return "";
+}
+
+void TraceRecorder::record(Category category, std::string name, Clock::time_point start, Clock::time_point end,
+                           std::string detail, size_t node) {
+    Span span;
+    span.category = category;
+    span.name = std::move(name);
+    span.detail = std::move(detail);
+    span.start_us = microseconds(start - epoch_);
+    span.duration_us = std::max(0.0, microseconds(end - start));
+    span.node = node;
+    buffers_.with_local([&](std::vector<Span>& spans) { spans.push_back(std::move(span)); });
+}
+
+void TraceRecorder::set_plan(std::shared_ptr<const WorkflowPlan> plan) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    plan_ = std::move(plan);
+}
+
+std::vector<TraceRecorder::Span> TraceRecorder::spans() const {
+    std::vector<Span> all;
+    size_t thread = 0;
+    buffers_.with_all([&](std::vector<Span>& spans) {
+        for (const auto& span : spans) {
+            all.push_back(span);
+            all.back().thread = thread;
+        }
+        ++thread;
+    });
+    std::stable_sort(all.begin(), all.end(), [](const Span& a, const Span& b) { return a.start_us < b.start_us; });
+    return all;
+}
+
+// Complete ("X") events on one process, one track per recording thread
+::JsonValue TraceRecorder::chrome_trace() const {
+    std::vector<Span> all = spans();
+    ::JsonValue events = ::JsonValue::makeArray();
+    size_t threads = 0;
+    for (const auto& span : all) {
+        threads = std::max(threads, span.thread + 1);
+        ::JsonValue event = ::JsonValue::makeObject();
+        event.object_value["name"] = ::JsonValue::makeString(span.name);
+        event.object_value["cat"] = ::JsonValue::makeString(category_name(span.category));
+        event.object_value["ph"] = ::JsonValue::makeString("X");
+        event.object_value["ts"] = number(span.start_us);
+        event.object_value["dur"] = number(span.duration_us);
+        event.object_value["pid"] = number(1);
+        event.object_value["tid"] = number(static_cast<double>(span.thread));
+        if (!span.detail.empty()) {
+            ::JsonValue args = ::JsonValue::makeObject();
+            args.object_value["detail"] = ::JsonValue::makeString(span.detail);
+            event.object_value["args"] = std::move(args);
+        }
+        events.array_value.push_back(std::move(event));
+    }
+    for (size_t thread = 0; thread < threads; ++thread) {
+        ::JsonValue event = ::JsonValue::makeObject();
+        event.object_value["name"] = ::JsonValue::makeString("thread_name");
+        event.object_value["ph"] = ::JsonValue::makeString("M");
+        event.object_value["pid"] = number(1);
+        event.object_value["tid"] = number(static_cast<double>(thread));
+        ::JsonValue args = ::JsonValue::makeObject();
+        args.object_value["name"] = ::JsonValue::makeString("thread " + std::to_string(thread));
+        event.object_value["args"] = std::move(args);
+        events.array_value.push_back(std::move(event));
+    }
+
+    ::JsonValue trace = ::JsonValue::makeObject();
+    trace.object_value["traceEvents"] = std::move(events);
+    trace.object_value["displayTimeUnit"] = ::JsonValue::makeString("ms");
+    return trace;
+}
+
+std::string TraceRecorder::chrome_trace_text() const {
+    return io::JsonEmitter::emit(to_io(chrome_trace()));
+}
+
+TraceRecorder::Summary TraceRecorder::summary() const {
+    std::shared_ptr<const WorkflowPlan> plan;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        plan = plan_;
+    }
+
+    Summary summary;
+    std::vector<const Span*> operations; // By plan node
+    const Span* last = nullptr;
+    std::vector<Span> all = spans();
+    for (const auto& span : all) {
+        switch (span.category) {
+            case Category::WORKFLOW:
+                summary.total_ms = std::max(summary.total_ms, span.duration_us / 1000);
+                break;
+            case Category::DATA_SOURCE: {
+                Summary::Source& source = summary.sources[span.name];
+                ++source.calls;
+                source.ms += span.duration_us / 1000;
+                break;
+            }
+            case Category::CACHE:
+                ++(span.detail == "hit" ? summary.cache_hits : summary.cache_misses);
+                break;
+            case Category::FALLBACK:
+                ++summary.fallbacks;
+                break;
+            case Category::OPERATION:
+                if (span.node != npos) {
+                    if (span.node >= operations.size()) operations.resize(span.node + 1, nullptr);
+                    operations[span.node] = &span;
+                }
+                if (!last || span.start_us + span.duration_us > last->start_us + last->duration_us) last = &span;
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Without a plan the path is just the operation that finished last
+    std::vector<const Span*> path;
+    for (const Span* span = last; span;) {
+        path.push_back(span);
+        const Span* next = nullptr;
+        if (plan && span->node < plan->nodes().size()) {
+            for (size_t dependency : plan->nodes()[span->node].dependencies) {
+                const Span* candidate = dependency < operations.size() ? operations[dependency] : nullptr;
+                if (candidate && (!next || candidate->start_us + candidate->duration_us >
+                                               next->start_us + next->duration_us)) {
+                    next = candidate;
+                }
+            }
+        }
+        span = next;
+    }
+    std::reverse(path.begin(), path.end());
+    for (const Span* span : path) summary.critical_path.push_back({span->name, span->duration_us / 1000});
+    if (!path.empty()) {
+        summary.critical_path_ms = (last->start_us + last->duration_us - path.front()->start_us) / 1000;
+    }
+    return summary;
+}
+
+::JsonValue TraceRecorder::Summary::to_json() const {
+    ::JsonValue result = ::JsonValue::makeObject();
+    result.object_value["total_ms"] = number(total_ms);
+
+    ::JsonValue path = ::JsonValue::makeArray();
+    for (const auto& step : critical_path) {
+        ::JsonValue entry = ::JsonValue::makeObject();
+        entry.object_value["operation"] = ::JsonValue::makeString(step.operation);
+        entry.object_value["ms"] = number(step.ms);
+        path.array_value.push_back(std::move(entry));
+    }
+    result.object_value["critical_path"] = std::move(path);
+    result.object_value["critical_path_ms"] = number(critical_path_ms);
+
+    ::JsonValue by_source = ::JsonValue::makeObject();
+    for (const auto& [name, source] : sources) {
+        ::JsonValue entry = ::JsonValue::makeObject();
+        entry.object_value["calls"] = number(static_cast<double>(source.calls));
+        entry.object_value["ms"] = number(source.ms);
+        by_source.object_value[name] = std::move(entry);
+    }
+    result.object_value["sources"] = std::move(by_source);
+    result.object_value["cache_hits"] = number(static_cast<double>(cache_hits));
+    result.object_value["cache_misses"] = number(static_cast<double>(cache_misses));
+    result.object_value["fallbacks"] = number(static_cast<double>(fallbacks));
+    return result;
+}
+
+} // namespace qc::core
@@ -0,0 +1,97 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include "json_logic.h"
+#include "thread_buffers.h"
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace qc::core {
+
+class WorkflowPlan;
+
+// Where the time of one workflow run went. Hand a recorder to
+// WorkflowEngine::executeWorkflow and it records a span for the workflow,
+// each step, each operation, each data source call, each cache lookup and
+// each fallback; runs without one record nothing. Spans go to a buffer per
+// thread, so recording is a clock read and an append under a lock no other
+// writer takes.
+//
+// chrome_trace_text() exports the spans as Chrome trace events, which
+// chrome://tracing and ui.perfetto.dev open as a timeline with a track per
+// thread. summary() condenses them into the critical path and the time
+// spent in each data source.
+class TraceRecorder {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    enum class Category { WORKFLOW, STEP, OPERATION, DATA_SOURCE, CACHE, FALLBACK };
+
+    struct Span {
+        Category category = Category::OPERATION;
+        std::string name;   // Workflow, step, operation or data source
+        std::string detail; // Endpoint, "hit" or "miss", error
+        double start_us = 0; // Since the recorder was made
+        double duration_us = 0;
+        size_t node = npos;  // Plan node of an operation
+        size_t thread = 0;   // Order in which the recording threads first wrote
+    };
+
+    struct Summary {
+        struct Step {
+            std::string operation;
+            double ms = 0;
+        };
+        struct Source {
+            size_t calls = 0;
+            double ms = 0;
+        };
+
+        double total_ms = 0;
+        // From the operation that finished last back through, at each step,
+        // the dependency that finished last: what the run waited on
+        std::vector<Step> critical_path;
+        double critical_path_ms = 0; // First start to last end along the path
+        std::map<std::string, Source> sources;
+        size_t cache_hits = 0;
+        size_t cache_misses = 0;
+        size_t fallbacks = 0;
+
+        ::JsonValue to_json() const;
+    };
+
+    TraceRecorder() : epoch_(Clock::now()) {}
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    static const char* category_name(Category category);
+
+    void record(Category category, std::string name, Clock::time_point start, Clock::time_point end,
+                std::string detail = "", size_t node = npos);
+    // Lets summary() follow operation spans along their dependencies
+    void set_plan(std::shared_ptr<const WorkflowPlan> plan);
+
+    // Every span so far, by start time
+    std::vector<Span> spans() const;
+    // {"traceEvents": [...], "displayTimeUnit": "ms"}
+    ::JsonValue chrome_trace() const;
+    // The same as JSON text, for writing to a .json file. Timestamps keep
+    // every digit, so long runs stay in order.
+    std::string chrome_trace_text() const;
+    Summary summary() const;
+
+private:
+    const Clock::time_point epoch_;
+    mutable ThreadBuffers<std::vector<Span>> buffers_;
+    mutable std::mutex mutex_;
+    std::shared_ptr<const WorkflowPlan> plan_;
+};
+
+} // namespace qc::core
+
+#endif // TRACE_RECORDER_H
@@ -0,0 +1,98 @@
+#include "work_stealing_pool.h"
+#include <algorithm>
+
+namespace qc::core {
+
+namespace {
+
+// Lets submit() recognise calls from this pool's own workers
+thread_local const WorkStealingPool* current_pool = nullptr;
+thread_local size_t current_queue = 0;
+
+struct LessUrgent {
+    template <typename Entry>
+    bool operator()(const Entry& a, const Entry& b) const {
+        if (a.priority != b.priority) return a.priority < b.priority;
+        return a.sequence > b.sequence;
+    }
+};
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(size_t threads) {
+    size_t count = std::max<size_t>(1, threads);
+    for (size_t i = 0; i < count; ++i) queues_.push_back(std::make_unique<Queue>());
+    for (size_t i = 0; i < count; ++i) threads_.emplace_back([this, i] { worker_loop(i); });
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex_);
+        stopping_ = true;
+    }
+    idle_cv_.notify_all();
+    for (auto& thread : threads_) thread.join();
+}
+
+void WorkStealingPool::submit(Task task, double priority) {
+    size_t index = current_pool == this ? current_queue : next_queue_++ % queues_.size();
+    {
+        Queue& queue = *queues_[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.heap.push_back(Entry{priority, sequence_++, std::move(task)});
+        std::push_heap(queue.heap.begin(), queue.heap.end(), LessUrgent{});
+    }
+    {
+        // Counted under the idle lock so a worker about to sleep cannot miss it
+        std::lock_guard<std::mutex> lock(idle_mutex_);
+        queued_++;
+    }
+    idle_cv_.notify_one();
+}
+
+bool WorkStealingPool::pop(size_t index, Task& task) {
+    Queue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.heap.empty()) return false;
+    std::pop_heap(queue.heap.begin(), queue.heap.end(), LessUrgent{});
+    task = std::move(queue.heap.back().task);
+    queue.heap.pop_back();
+    queued_--;
+    return true;
+}
+
+void WorkStealingPool::worker_loop(size_t index) {
+    current_pool = this;
+    current_queue = index;
+    size_t count = queues_.size();
+    for (;;) {
+        Task task;
+        bool found = pop(index, task);
+        for (size_t step = 1; !found && step < count; ++step) {
+            found = pop((index + step) % count, task);
+            if (found) stolen_++;
+        }
+
+        if (found) {
+            try {
+                task();
+            } catch (...) {
+            }
+            executed_++;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(idle_mutex_);
+        if (stopping_ && queued_ == 0) return;
+        idle_cv_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+    }
+}
+
+WorkStealingPool::Stats WorkStealingPool::stats() const {
+    Stats stats;
+    stats.executed = executed_.load();
+    stats.stolen = stolen_.load();
+    return stats;
+}
+
+} // namespace qc::core
@@ -0,0 +1,79 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qc::core {
+
+// Fixed set of worker threads, each with its own queue of prioritized tasks.
+// A worker runs the most urgent task in its own queue and, once that is
+// empty, steals the most urgent task from another worker, so a burst of
+// tasks queued on one worker spreads across the pool without a shared queue
+// every thread contends on. Tasks submitted from a worker land in that
+// worker's queue, keeping follow-up work on the thread that produced its
+// inputs.
+//
+// Priority is a hint, not a global order: a worker prefers its own queue's
+// best task over a better one elsewhere.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    struct Stats {
+        uint64_t executed = 0;
+        uint64_t stolen = 0;
+    };
+
+    explicit WorkStealingPool(size_t threads);
+    ~WorkStealingPool(); // Runs the tasks still queued, then joins
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Higher priorities run first; equal priorities run in submission order.
+    // Exceptions escaping a task are swallowed.
+    void submit(Task task, double priority = 0);
+
+    size_t size() const { return threads_.size(); }
+    Stats stats() const;
+
+private:
+    struct Entry {
+        double priority;
+        uint64_t sequence;
+        Task task;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::vector<Entry> heap; // Max-heap on (priority, -sequence)
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex idle_mutex_;
+    std::condition_variable idle_cv_;
+    std::atomic<size_t> queued_{0};
+    bool stopping_ = false;
+
+    std::atomic<uint64_t> sequence_{0};
+    std::atomic<size_t> next_queue_{0};
+    std::atomic<uint64_t> executed_{0};
+    std::atomic<uint64_t> stolen_{0};
+
+    void worker_loop(size_t index);
+    bool pop(size_t queue, Task& task);
+};
+
+} // namespace qc::core
+
+#endif // WORK_STEALING_POOL_H
@@ -0,0 +1,921 @@
+#include "flexible_json_logic.h"
+#include "cache_manager.h"
+#include "cancellation.h"
+#include "compiled_template.h"
+#include "digest.h"
+#include "event_loop.h"
+#include "expression.h"
+#include "json_bridge.h"
+#include "trace_recorder.h"
+#include "work_stealing_pool.h"
+#include "workflow_plan.h"
+#include "../io/json_emitter.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace {
+
+const JsonValue* member(const JsonValue& object, const std::string& name) {
+    if (object.type != JsonValue::OBJECT) return nullptr;
+    auto it = object.object_value.find(name);
+    return it == object.object_value.end() ? nullptr : &it->second;
+}
+
+JsonValue string_array(const std::vector<std::string>& items) {
+    JsonValue array = JsonValue::makeArray();
+    for (const auto& item : items) array.array_value.push_back(JsonValue::makeString(item));
+    return array;
+}
+
+bool same_value(const JsonValue& a, const JsonValue& b) {
+    return a.type == b.type && a.serialize() == b.serialize();
+}
+
+// Path segments: "genes[0].symbol" -> genes, 0, symbol. A field applied to an
+// array maps over its elements, so "known_genes.gene_id" lists every gene id.
+// What comes back shares its nodes with `value`.
+qc::core::SharedJson descend(const qc::core::SharedJson& value, const std::string& path, size_t pos) {
+    while (pos < path.size() && path[pos] == '.') ++pos;
+    if (pos >= path.size()) return value;
+
+    if (path[pos] == '[') {
+        size_t close = path.find(']', pos);
+        if (close == std::string::npos) return qc::core::SharedJson();
+        const qc::core::SharedJson* item = value.at(std::strtoul(path.c_str() + pos + 1, nullptr, 10));
+        return item ? descend(*item, path, close + 1) : qc::core::SharedJson();
+    }
+
+    if (value.type() == JsonValue::ARRAY) {
+        qc::core::SharedJson::Array mapped;
+        for (const auto& item : value.items()) {
+            qc::core::SharedJson found = descend(item, path, pos);
+            if (!found.is_null()) mapped.push_back(std::move(found));
+        }
+        return qc::core::SharedJson::array(std::move(mapped));
+    }
+    size_t end = path.find_first_of(".[", pos);
+    if (end == std::string::npos) end = path.size();
+    const qc::core::SharedJson* field = value.find(path.substr(pos, end - pos));
+    return field ? descend(*field, path, end) : qc::core::SharedJson();
+}
+
+std::string render(const qc::core::SharedJson& value) {
+    if (value.type() == JsonValue::STRING) return value.as_string();
+    if (value.is_null()) return "";
+    return value.to_json().serialize();
+}
+
+bool matches_criteria(const JsonValue& item, const JsonValue* criteria) {
+    if (!criteria || criteria->type != JsonValue::OBJECT) return true;
+    for (const auto& [field, expected] : criteria->object_value) {
+        const JsonValue* actual = member(item, field);
+        // Criteria on fields the item does not carry, or that resolved to nothing, do not apply
+        if (!actual || expected.type == JsonValue::NIL) continue;
+        if (expected.type == JsonValue::ARRAY) {
+            bool any = std::any_of(expected.array_value.begin(), expected.array_value.end(),
+                                   [&](const JsonValue& option) { return same_value(option, *actual); });
+            if (!any) return false;
+        } else if (!same_value(expected, *actual)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::chrono::steady_clock::duration seconds(double value) {
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(value));
+}
+
+// What the exception being handled says about itself
+std::string exception_message() {
+    try {
+        throw;
+    } catch (const std::exception& e) {
+        return e.what();
+    } catch (...) {
+        return "unknown exception";
+    }
+}
+
+std::string format_seconds(double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%gs", value);
+    return text;
+}
+
+// Paths in conditions and calculations read straight from the context's slots
+class ContextScope : public qc::core::Expression::Scope {
+public:
+    explicit ContextScope(const WorkflowContext& context) : context_(context) {}
+    const qc::core::SharedJson* find(const std::string& root) const override {
+        return root == "INPUT" ? context_.findInput() : context_.findOutput(root);
+    }
+
+private:
+    const WorkflowContext& context_;
+};
+
+JsonValue collect_outputs(const std::vector<WorkflowOperation>& operations, const WorkflowContext& context) {
+    JsonValue outputs = JsonValue::makeObject();
+    for (const auto& operation : operations) {
+        if (!operation.output_key.empty() && context.hasOutput(operation.output_key)) {
+            outputs.object_value[operation.output_key] = context.output(operation.output_key).to_json();
+        }
+    }
+    return outputs;
+}
+
+} // namespace
+
+// Workflow execution context
+WorkflowContext::WorkflowContext(const std::vector<std::string>& output_keys) {
+    planned_.reserve(output_keys.size());
+    for (const auto& key : output_keys) planned_.try_emplace(key);
+}
+
+WorkflowContext::~WorkflowContext() {
+    release(input_);
+    for (auto& [key, slot] : planned_) release(slot);
+    for (auto& [key, slot] : unplanned_) release(slot);
+}
+
+void WorkflowContext::publish(Slot& slot, qc::core::SharedJson value) {
+    Cell* cell = new Cell{std::move(value), slot.head.load(std::memory_order_relaxed)};
+    while (!slot.head.compare_exchange_weak(cell->previous, cell, std::memory_order_release,
+                                            std::memory_order_relaxed)) {}
+}
+
+const qc::core::SharedJson* WorkflowContext::current(const Slot& slot) {
+    Cell* cell = slot.head.load(std::memory_order_acquire);
+    return cell ? &cell->value : nullptr;
+}
+
+void WorkflowContext::release(Slot& slot) {
+    for (Cell* cell = slot.head.exchange(nullptr); cell;) delete std::exchange(cell, cell->previous);
+}
+
+const WorkflowContext::Slot* WorkflowContext::findSlot(const std::string& key) const {
+    auto planned = planned_.find(key);
+    if (planned != planned_.end()) return &planned->second;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto unplanned = unplanned_.find(key);
+    return unplanned == unplanned_.end() ? nullptr : &unplanned->second;
+}
+
+qc::core::SharedJson WorkflowContext::input() const {
+    const qc::core::SharedJson* value = current(input_);
+    return value ? *value : qc::core::SharedJson();
+}
+
+JsonValue WorkflowContext::getVariable(const std::string& key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = variables_.find(key);
+    return it == variables_.end() ? JsonValue::makeNull() : it->second;
+}
+
+void WorkflowContext::setOutput(const std::string& key, qc::core::SharedJson value) {
+    auto planned = planned_.find(key);
+    if (planned != planned_.end()) {
+        publish(planned->second, std::move(value));
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    publish(unplanned_[key], std::move(value));
+}
+
+const qc::core::SharedJson* WorkflowContext::findOutput(const std::string& key) const {
+    const Slot* slot = findSlot(key);
+    return slot ? current(*slot) : nullptr;
+}
+
+qc::core::SharedJson WorkflowContext::output(const std::string& key) const {
+    const qc::core::SharedJson* value = findOutput(key);
+    return value ? *value : qc::core::SharedJson();
+}
+
+std::map<std::string, qc::core::SharedJson> WorkflowContext::outputs() const {
+    std::map<std::string, qc::core::SharedJson> values;
+    for (const auto& [key, slot] : planned_) {
+        if (const qc::core::SharedJson* value = current(slot)) values.emplace(key, *value);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [key, slot] : unplanned_) {
+        if (const qc::core::SharedJson* value = current(slot)) values.emplace(key, *value);
+    }
+    return values;
+}
+
+JsonValue WorkflowContext::getOutput(const std::string& key) const {
+    return output(key).to_json();
+}
+
+bool WorkflowContext::hasOutput(const std::string& key) const {
+    return findOutput(key) != nullptr;
+}
+
+JsonValue WorkflowContext::getAllOutputs() const {
+    return qc::core::SharedJson::object(outputs()).to_json();
+}
+
+// The sequence number is taken under the buffer's lock, and merging locks
+// every buffer at once, so nothing merged later can have been added earlier
+void WorkflowContext::addMessage(bool error, const std::string& text) {
+    pending_.with_local([&](std::vector<Message>& messages) {
+        messages.push_back(Message{sequence_++, error, text});
+    });
+    if (error) ++errors_added_;
+}
+
+void WorkflowContext::mergeMessages() const {
+    std::lock_guard<std::mutex> lock(messages_mutex_);
+    std::vector<Message> merged;
+    pending_.with_all([&](std::vector<Message>& messages) {
+        std::move(messages.begin(), messages.end(), std::back_inserter(merged));
+        messages.clear();
+    });
+    std::sort(merged.begin(), merged.end(),
+              [](const Message& a, const Message& b) { return a.sequence < b.sequence; });
+    for (auto& message : merged) (message.error ? errors_ : warnings_).push_back(std::move(message.text));
+}
+
+std::vector<std::string> WorkflowContext::getErrors() const {
+    mergeMessages();
+    std::lock_guard<std::mutex> lock(messages_mutex_);
+    return errors_;
+}
+
+std::vector<std::string> WorkflowContext::getWarnings() const {
+    mergeMessages();
+    std::lock_guard<std::mutex> lock(messages_mutex_);
+    return warnings_;
+}
+
+// Workflow execution engine
+struct WorkflowEngine::Run {
+    struct Operation {
+        std::atomic<size_t> waiting{0};
+        std::atomic<bool> settled{false};  // Completion, deadline and cancellation race to set this
+        std::atomic<bool> timed_out{false};
+        std::atomic<qc::core::EventLoop::TimerId> deadline{0};
+        std::chrono::steady_clock::time_point started;
+        std::chrono::steady_clock::time_point finished;
+        std::chrono::steady_clock::time_point called; // When the data source call went out
+        std::unique_ptr<qc::core::CancellationSource> cancel;
+        qc::core::SharedJson result;
+        bool from_cache = false;
+        bool issued = false; // Reached the processor or data source
+        std::string cache_key;
+    };
+
+    explicit Run(const qc::core::CancellationToken& parent) : cancel(parent) {}
+
+    Workflow workflow;
+    std::shared_ptr<const qc::core::WorkflowPlan> plan;
+    WorkflowContext* context = nullptr; // Only touched until the operation settles
+    qc::core::TraceRecorder* trace = nullptr;
+    qc::core::CancellationSource cancel;
+    std::vector<std::string> cost_keys;
+    std::vector<double> priority;
+    std::unique_ptr<Operation[]> operations;
+    std::unique_ptr<std::atomic<size_t>[]> step_remaining; // Operations of each step yet to finish
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t remaining = 0;
+
+    const WorkflowStep& step(size_t index) const { return workflow.steps[plan->nodes()[index].step]; }
+    const WorkflowOperation& operation(size_t index) const {
+        return step(index).operations[plan->nodes()[index].operation];
+    }
+    // True for the one caller that gets to finish the operation
+    bool claim(size_t index) { return !operations[index].settled.exchange(true); }
+};
+
+WorkflowEngine::WorkflowEngine(ConfigurationManager* config_manager, size_t worker_threads)
+    : config_manager_(config_manager),
+      pool_(std::make_unique<qc::core::WorkStealingPool>(
+          worker_threads > 0 ? worker_threads : std::max(1u, std::thread::hardware_concurrency()))),
+      loop_(std::make_unique<qc::core::EventLoop>()) {}
+
+WorkflowEngine::~WorkflowEngine() = default;
+
+JsonValue WorkflowEngine::executeWorkflow(const std::string& workflow_name, const JsonValue& input) {
+    return executeWorkflow(workflow_name, input, qc::core::CancellationToken());
+}
+
+JsonValue WorkflowEngine::executeWorkflow(const std::string& workflow_name, const JsonValue& input,
+                                          const qc::core::CancellationToken& cancel,
+                                          qc::core::TraceRecorder* trace) {
+    JsonValue result = JsonValue::makeObject();
+    result.object_value["workflow"] = JsonValue::makeString(workflow_name);
+
+    Workflow workflow = config_manager_->getWorkflow(workflow_name);
+    std::string error;
+    auto plan = workflow.plan ? workflow.plan : qc::core::WorkflowPlan::build(workflow, &error);
+    if (workflow.steps.empty() || !plan) {
+        result.object_value["success"] = JsonValue::makeBool(false);
+        result.object_value["errors"] = string_array(
+            {workflow.steps.empty() ? "Unknown workflow '" + workflow_name + "'" : error});
+        return result;
+    }
+
+    WorkflowContext context(plan->output_keys());
+    context.setInput(input);
+    if (trace) trace->set_plan(plan);
+    auto started = std::chrono::steady_clock::now();
+    runPlan(workflow, plan, context, cancel, trace);
+    auto ended = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = ended - started;
+
+    result.object_value["success"] = JsonValue::makeBool(!context.hasErrors());
+    result.object_value["outputs"] = context.getAllOutputs();
+    result.object_value["errors"] = string_array(context.getErrors());
+    result.object_value["warnings"] = string_array(context.getWarnings());
+    result.object_value["execution_time_ms"] = JsonValue::makeNumber(elapsed.count());
+    if (trace) {
+        trace->record(qc::core::TraceRecorder::Category::WORKFLOW, workflow_name, started, ended);
+        result.object_value["trace_summary"] = trace->summary().to_json();
+    }
+    return result;
+}
+
+JsonValue WorkflowEngine::executeWorkflowStep(const WorkflowStep& step, WorkflowContext& context) {
+    if (!conditionHolds(step.condition, context)) return JsonValue::makeObject();
+    runOperations(step.operations, step.execution_type, context);
+    return collect_outputs(step.operations, context);
+}
+
+JsonValue WorkflowEngine::executeOperation(const WorkflowOperation& operation, WorkflowContext& context) {
+    return runOperations({operation}, "sequential", context)[0];
+}
+
+JsonValue WorkflowEngine::executeSequential(const std::vector<WorkflowOperation>& operations,
+                                            WorkflowContext& context) {
+    runOperations(operations, "sequential", context);
+    return collect_outputs(operations, context);
+}
+
+// Independent operations run concurrently; ones referencing each other's
+// outputs still wait for them
+JsonValue WorkflowEngine::executeParallel(const std::vector<WorkflowOperation>& operations,
+                                          WorkflowContext& context) {
+    runOperations(operations, "parallel", context);
+    return collect_outputs(operations, context);
+}
+
+JsonValue WorkflowEngine::executeConditional(const std::vector<WorkflowOperation>& operations,
+                                             const std::string& condition,
+                                             WorkflowContext& context) {
+    if (!conditionHolds(condition, context)) return JsonValue::makeObject();
+    return executeSequential(operations, context);
+}
+
+std::vector<JsonValue> WorkflowEngine::runOperations(const std::vector<WorkflowOperation>& operations,
+                                                     const std::string& execution_type,
+                                                     WorkflowContext& context) {
+    Workflow workflow;
+    workflow.global_timeout = 0;
+    WorkflowStep step;
+    step.execution_type = execution_type;
+    step.operations = operations;
+    workflow.steps.push_back(std::move(step));
+
+    std::string error;
+    auto plan = qc::core::WorkflowPlan::build(workflow, &error);
+    if (!plan) {
+        context.addError(error);
+        return std::vector<JsonValue>(operations.size());
+    }
+    std::vector<JsonValue> results;
+    for (const auto& result : runPlan(workflow, plan, context, qc::core::CancellationToken())) {
+        results.push_back(result.to_json());
+    }
+    return results;
+}
+
+std::vector<qc::core::SharedJson> WorkflowEngine::runPlan(const Workflow& workflow,
+                                                          std::shared_ptr<const qc::core::WorkflowPlan> plan,
+                                                          WorkflowContext& context,
+                                                          const qc::core::CancellationToken& cancel,
+                                                          qc::core::TraceRecorder* trace) {
+    const auto& nodes = plan->nodes();
+    if (nodes.empty()) return {};
+
+    auto run = std::make_shared<Run>(cancel);
+    run->workflow = workflow;
+    run->plan = plan;
+    run->context = &context;
+    run->trace = trace;
+    for (size_t index = 0; index < nodes.size(); ++index) {
+        run->cost_keys.push_back(workflow.name + "/" + run->operation(index).name);
+    }
+    run->priority = plan->critical_path([&](size_t index) { return operationCost(run->cost_keys[index]); });
+    run->operations = std::make_unique<Run::Operation[]>(nodes.size());
+    for (size_t index = 0; index < nodes.size(); ++index) run->operations[index].waiting = nodes[index].dependencies.size();
+    run->step_remaining = std::make_unique<std::atomic<size_t>[]>(workflow.steps.size());
+    for (const auto& node : nodes) ++run->step_remaining[node.step];
+    run->remaining = nodes.size();
+
+    qc::core::EventLoop::TimerId global_deadline = 0;
+    if (workflow.global_timeout > 0) {
+        std::weak_ptr<Run> weak = run;
+        double timeout = workflow.global_timeout;
+        global_deadline = loop_->schedule_after(seconds(timeout), [weak, timeout] {
+            if (auto run = weak.lock()) run->cancel.cancel("workflow timed out after " + format_seconds(timeout));
+        });
+    }
+
+    for (size_t root : plan->roots()) scheduleOperation(run, root);
+    {
+        std::unique_lock<std::mutex> lock(run->mutex);
+        run->finished.wait(lock, [&] { return run->remaining == 0; });
+    }
+    loop_->cancel(global_deadline);
+
+    // A step spans its operations, which need not have run back to back
+    if (trace) {
+        for (size_t step = 0; step < workflow.steps.size(); ++step) {
+            std::chrono::steady_clock::time_point first = std::chrono::steady_clock::time_point::max(), last;
+            for (size_t index = 0; index < nodes.size(); ++index) {
+                if (nodes[index].step != step) continue;
+                first = std::min(first, run->operations[index].started);
+                last = std::max(last, run->operations[index].finished);
+            }
+            if (first <= last) {
+                trace->record(qc::core::TraceRecorder::Category::STEP, workflow.steps[step].name, first, last);
+            }
+        }
+    }
+
+    std::vector<qc::core::SharedJson> results;
+    for (size_t index = 0; index < nodes.size(); ++index) results.push_back(std::move(run->operations[index].result));
+    return results;
+}
+
+void WorkflowEngine::scheduleOperation(const std::shared_ptr<Run>& run, size_t index) {
+    pool_->submit([this, run, index] {
+        // Whatever escapes, the operation still finishes, so the run never
+        // waits on it forever
+        try {
+            startOperation(run, index);
+        } catch (...) {
+            if (run->claim(index)) finishOperation(run, index, qc::core::SharedJson(), "failed: " + exception_message(), false);
+        }
+    }, run->priority[index]);
+}
+
+// Everything up to issuing the call runs here on a worker; the call itself
+// completes through callbacks, so a worker is never parked on I/O. Callbacks
+// hold the run weakly and check `settled` first: once the run is over they
+// touch nothing.
+void WorkflowEngine::startOperation(const std::shared_ptr<Run>& run, size_t index) {
+    Run::Operation& state = run->operations[index];
+    const WorkflowStep& step = run->step(index);
+    const WorkflowOperation& operation = run->operation(index);
+    WorkflowContext& context = *run->context;
+    state.started = std::chrono::steady_clock::now();
+
+    qc::core::CancellationToken workflow_cancel = run->cancel.token();
+    if (workflow_cancel.cancelled()) {
+        if (run->claim(index)) finishOperation(run, index, qc::core::SharedJson(), "cancelled: " + workflow_cancel.reason(), false);
+        return;
+    }
+    if (!conditionHolds(step.condition, context) || !conditionHolds(operation.condition, context)) {
+        context.addWarning("Skipped '" + operation.name + "': condition not met");
+        if (run->claim(index)) finishOperation(run, index, qc::core::SharedJson(), "", false);
+        return;
+    }
+
+    // Merges only regroup outputs already in the context: their inputs are
+    // taken as handles, so the result shares them rather than copying, and
+    // there is nothing worth memoizing
+    if (operation.type == OperationType::MERGE) {
+        qc::core::SharedJson merged = mergeInputs(operation, context);
+        if (run->claim(index)) finishOperation(run, index, std::move(merged), "", false);
+        return;
+    }
+
+    JsonValue params = resolveValue(operation.parameters, context);
+    if (operation.type == OperationType::ENDPOINT_CALL) {
+        params = config_manager_->resolveParameters(operation.endpoint, std::move(params));
+    }
+    if (shouldUseCache(operation)) {
+        state.cache_key = generateCacheKey(operation, params);
+        auto looked_up = std::chrono::steady_clock::now();
+        JsonValue cached;
+        // A store that cannot be opened or read costs the operation its
+        // cache, not the run
+        try {
+            cached = getCacheValue(state.cache_key);
+        } catch (const std::exception& e) {
+            context.addWarning("Result cache unavailable for '" + operation.name + "' (" + e.what() + "); ran it uncached");
+            state.cache_key.clear();
+        }
+        if (run->trace) {
+            run->trace->record(qc::core::TraceRecorder::Category::CACHE, operation.name, looked_up,
+                               std::chrono::steady_clock::now(), cached.type != JsonValue::NIL ? "hit" : "miss");
+        }
+        if (cached.type != JsonValue::NIL) {
+            state.from_cache = true;
+            if (run->claim(index)) finishOperation(run, index, qc::core::SharedJson(std::move(cached)), "", false);
+            return;
+        }
+    }
+
+    if (operation.type != OperationType::ENDPOINT_CALL) {
+        JsonValue result;
+        std::string error;
+        state.issued = true;
+        try {
+            result = invokeOperation(operation, params);
+        } catch (...) {
+            error = exception_message();
+        }
+        if (run->claim(index)) finishOperation(run, index, qc::core::SharedJson(std::move(result)), error, true);
+        return;
+    }
+
+    DataSource* source = operation.data_source.empty() ? nullptr : config_manager_->getDataSource(operation.data_source);
+    if (!source) {
+        std::string error = operation.data_source.empty() ? "names no data source"
+                                                          : "unknown data source '" + operation.data_source + "'";
+        if (run->claim(index)) finishOperation(run, index, qc::core::SharedJson(), error, true);
+        return;
+    }
+
+    std::weak_ptr<Run> weak = run;
+    state.issued = true;
+    state.called = std::chrono::steady_clock::now();
+    state.cancel = std::make_unique<qc::core::CancellationSource>(workflow_cancel);
+    qc::core::CancellationToken cancel = state.cancel->token();
+    cancel.on_cancel([this, weak, index] {
+        auto run = weak.lock();
+        if (!run || !run->claim(index)) return;
+        Run::Operation& state = run->operations[index];
+        if (run->trace) {
+            const WorkflowOperation& operation = run->operation(index);
+            run->trace->record(qc::core::TraceRecorder::Category::DATA_SOURCE, operation.data_source, state.called,
+                               std::chrono::steady_clock::now(), operation.endpoint + " (cancelled)");
+        }
+        bool timed_out = state.timed_out.load();
+        std::string error = timed_out ? "timed out after " + format_seconds(run->operation(index).timeout_seconds)
+                                      : "cancelled: " + state.cancel->token().reason();
+        pool_->submit([this, run, index, error, timed_out] {
+            finishOperation(run, index, qc::core::SharedJson(), error, timed_out);
+        }, run->priority[index]);
+    });
+    if (cancel.cancelled()) return;
+
+    if (operation.timeout_seconds > 0) {
+        state.deadline = loop_->schedule_after(seconds(operation.timeout_seconds), [weak, index] {
+            auto run = weak.lock();
+            if (!run || run->operations[index].settled) return;
+            run->operations[index].timed_out = true;
+            run->operations[index].cancel->cancel("deadline");
+        });
+    }
+
+    source->executeAsync(operation.endpoint, params, cancel, [this, weak, index](JsonValue result) {
+        auto run = weak.lock();
+        if (!run || !run->claim(index)) return; // Timed out or cancelled first
+        if (run->trace) {
+            const WorkflowOperation& operation = run->operation(index);
+            run->trace->record(qc::core::TraceRecorder::Category::DATA_SOURCE, operation.data_source,
+                               run->operations[index].called, std::chrono::steady_clock::now(), operation.endpoint);
+        }
+        std::string error;
+        if (const JsonValue* message = member(result, "error")) {
+            error = message->type == JsonValue::STRING ? message->string_value : message->serialize();
+        }
+        pool_->submit([this, run, index, result = std::move(result), error]() mutable {
+            finishOperation(run, index, qc::core::SharedJson(std::move(result)), error, true);
+        }, run->priority[index]);
+    });
+}
+
+// Runs once per operation, on a worker, after the claim
+void WorkflowEngine::finishOperation(const std::shared_ptr<Run>& run, size_t index, qc::core::SharedJson result,
+                                     const std::string& error, bool allow_fallback) {
+    Run::Operation& state = run->operations[index];
+    const WorkflowOperation& operation = run->operation(index);
+    WorkflowContext& context = *run->context;
+    loop_->cancel(state.deadline);
+
+    // Failures here lose the result, never the bookkeeping below that lets
+    // dependents and the run move on
+    try {
+        if (!error.empty()) {
+            if (allow_fallback) {
+                auto failed = std::chrono::steady_clock::now();
+                result = qc::core::SharedJson(handleOperationError(operation, error, context));
+                if (run->trace) {
+                    run->trace->record(qc::core::TraceRecorder::Category::FALLBACK, operation.name, failed,
+                                       std::chrono::steady_clock::now(), error);
+                }
+            } else {
+                context.addError("Operation '" + operation.name + "' " + error);
+                result = qc::core::SharedJson();
+            }
+        } else if (!state.cache_key.empty() && !state.from_cache && !result.is_null()) {
+            try {
+                memoizeResult(operation, state.cache_key, result);
+            } catch (const std::exception& e) {
+                context.addWarning("Could not cache the result of '" + operation.name + "': " + e.what());
+            }
+        }
+        if (!result.is_null() && !operation.output_key.empty()) context.setOutput(operation.output_key, result);
+        state.result = std::move(result);
+
+        state.finished = std::chrono::steady_clock::now();
+        if (state.issued) {
+            std::chrono::duration<double, std::milli> elapsed = state.finished - state.started;
+            recordOperationCost(run->cost_keys[index], elapsed.count());
+        }
+        if (run->trace) {
+            run->trace->record(qc::core::TraceRecorder::Category::OPERATION, operation.name, state.started,
+                               state.finished, error, index);
+        }
+    } catch (...) {
+        state.finished = std::chrono::steady_clock::now();
+        context.addError("Operation '" + operation.name + "' failed: " + exception_message());
+    }
+
+    const qc::core::WorkflowPlan::Node& node = run->plan->nodes()[index];
+    if (run->step_remaining[node.step].fetch_sub(1) == 1) context.mergeMessages();
+    for (size_t dependent : node.dependents) {
+        if (run->operations[dependent].waiting.fetch_sub(1) == 1) scheduleOperation(run, dependent);
+    }
+    std::lock_guard<std::mutex> lock(run->mutex);
+    if (--run->remaining == 0) run->finished.notify_all();
+}
+
+JsonValue WorkflowEngine::invokeOperation(const WorkflowOperation& operation, const JsonValue& resolved_params) const {
+    switch (operation.type) {
+        case OperationType::ENDPOINT_CALL:
+            break; // Issued asynchronously by startOperation
+        case OperationType::CUSTOM_PROCESSOR: {
+            DataProcessor* processor = config_manager_->getProcessor(operation.processor);
+            if (!processor) throw std::runtime_error("Unknown processor '" + operation.processor + "'");
+            return processor->process(resolved_params, config_manager_->getProcessorConfig(operation.processor));
+        }
+        case OperationType::FILTER: {
+            const JsonValue* input = member(resolved_params, "input");
+            if (!input || input->type != JsonValue::ARRAY) throw std::runtime_error("Filter input is not an array");
+            const JsonValue* criteria = member(resolved_params, "criteria");
+            JsonValue kept = JsonValue::makeArray();
+            for (const auto& item : input->array_value) {
+                if (matches_criteria(item, criteria)) kept.array_value.push_back(item);
+            }
+            return kept;
+        }
+        case OperationType::MERGE:
+            break; // Resolved from handles by mergeInputs
+        case OperationType::TRANSFORM:
+            return resolved_params;
+    }
+    return JsonValue::makeNull();
+}
+
+// Inputs are keyed by output name; the default "structured_report" keeps
+// them that way, minus the ones that were never produced. Either way the
+// result is built from handles to the outputs, not copies of them.
+qc::core::SharedJson WorkflowEngine::mergeInputs(const WorkflowOperation& operation,
+                                                 const WorkflowContext& context) const {
+    qc::core::SharedJson::Object report;
+    std::vector<qc::core::SharedJson> values;
+    if (const JsonValue* inputs = member(operation.parameters, "inputs")) {
+        for (const auto& [key, input] : inputs->object_value) {
+            qc::core::SharedJson value = resolveShared(input, context);
+            if (value.is_null()) continue;
+            values.push_back(value);
+            report.emplace(key, std::move(value));
+        }
+    }
+    const JsonValue* strategy = member(operation.parameters, "strategy");
+    if (!strategy || strategy->type != JsonValue::STRING || strategy->string_value == "structured_report") {
+        return qc::core::SharedJson::object(std::move(report));
+    }
+    return qc::core::SharedJson::merge(values, strategy->string_value);
+}
+
+JsonValue WorkflowEngine::resolveValue(const JsonValue& value, const WorkflowContext& context) const {
+    switch (value.type) {
+        case JsonValue::STRING: {
+            if (value.string_value.find("${") == std::string::npos) return value;
+            auto compiled = qc::core::CompiledTemplate::get(value.string_value);
+            if (!compiled->has_placeholders()) return value;
+            const auto& segments = compiled->segments();
+            // A lone placeholder keeps the type of what it names
+            if (compiled->is_single_placeholder()) return resolvePlaceholder(segments.front().text, context).to_json();
+            std::string resolved;
+            for (const auto& segment : segments) {
+                if (segment.kind == qc::core::CompiledTemplate::Kind::LITERAL) {
+                    resolved += segment.text;
+                } else {
+                    resolved += render(resolvePlaceholder(segment.text, context));
+                }
+            }
+            return JsonValue::makeString(resolved);
+        }
+        case JsonValue::ARRAY: {
+            JsonValue items = JsonValue::makeArray();
+            for (const auto& item : value.array_value) items.array_value.push_back(resolveValue(item, context));
+            return items;
+        }
+        case JsonValue::OBJECT: {
+            JsonValue fields = JsonValue::makeObject();
+            for (const auto& [key, item] : value.object_value) fields.object_value[key] = resolveValue(item, context);
+            return fields;
+        }
+        default:
+            return value;
+    }
+}
+
+// Like resolveValue, but a lone placeholder comes back as a handle into the
+// context instead of a copy
+qc::core::SharedJson WorkflowEngine::resolveShared(const JsonValue& value, const WorkflowContext& context) const {
+    if (value.type == JsonValue::STRING && value.string_value.find("${") != std::string::npos) {
+        auto compiled = qc::core::CompiledTemplate::get(value.string_value);
+        if (compiled->is_single_placeholder()) return resolvePlaceholder(compiled->segments().front().text, context);
+    }
+    return qc::core::SharedJson(resolveValue(value, context));
+}
+
+// INPUT:path, REF:path, EXTRACT:path, LENGTH:path, EXISTS:path and MERGE:a,b
+// name values; paths start at an output key or at INPUT. CALC evaluates an
+// expression over the same values, and ENV and CONFIG go through the string
+// template resolver.
+qc::core::SharedJson WorkflowEngine::resolvePlaceholder(const std::string& placeholder,
+                                                        const WorkflowContext& context) const {
+    size_t colon = placeholder.find(':');
+    if (colon == std::string::npos) return qc::core::SharedJson::string("${" + placeholder + "}");
+    std::string kind = placeholder.substr(0, colon);
+    std::string argument = placeholder.substr(colon + 1);
+
+    auto reference = [&](const std::string& path) {
+        if (path.compare(0, 5, "INPUT") == 0 && (path.size() == 5 || path[5] == '.' || path[5] == '[')) {
+            return descend(context.input(), path, 5);
+        }
+        size_t end = path.find_first_of(".[");
+        if (end == std::string::npos) end = path.size();
+        return descend(context.output(path.substr(0, end)), path, end);
+    };
+
+    if (kind == "INPUT") return descend(context.input(), argument, 0);
+    if (kind == "REF" || kind == "OUTPUT" || kind == "EXTRACT") return reference(argument);
+    if (kind == "EXISTS") return qc::core::SharedJson::boolean(!reference(argument).is_null());
+    if (kind == "LENGTH") return qc::core::SharedJson::number(static_cast<double>(reference(argument).size()));
+    if (kind == "CALC") {
+        return qc::core::SharedJson(qc::core::Expression::get(argument)->evaluate(ContextScope(context)));
+    }
+    if (kind == "MERGE") {
+        qc::core::SharedJson::Array merged;
+        size_t begin = 0;
+        while (begin <= argument.size()) {
+            size_t end = argument.find(',', begin);
+            if (end == std::string::npos) end = argument.size();
+            std::string part = argument.substr(begin, end - begin);
+            qc::core::SharedJson value =
+                part.find(':') != std::string::npos ? resolvePlaceholder(part, context) : reference(part);
+            if (value.type() == JsonValue::ARRAY) {
+                merged.insert(merged.end(), value.items().begin(), value.items().end());
+            } else if (!value.is_null()) {
+                merged.push_back(std::move(value));
+            }
+            begin = end + 1;
+        }
+        return qc::core::SharedJson::array(std::move(merged));
+    }
+    return qc::core::SharedJson::string(FlexibleJsonValue().resolveTemplate("${" + placeholder + "}", {}));
+}
+
+bool WorkflowEngine::conditionHolds(const std::string& condition, const WorkflowContext& context) const {
+    return condition.empty() || qc::core::Expression::get(condition)->test(ContextScope(context));
+}
+
+JsonValue WorkflowEngine::handleOperationError(const WorkflowOperation& operation,
+                                               const std::string& error,
+                                               WorkflowContext& context) {
+    JsonValue fallback = applyFallback(operation, context);
+    if (fallback.type == JsonValue::NIL) {
+        context.addError("Operation '" + operation.name + "' failed: " + error);
+    } else {
+        context.addWarning("Operation '" + operation.name + "' failed (" + error + "); used its fallback");
+    }
+    return fallback;
+}
+
+// {"data_source": name} retries the endpoint there; {"value": v} substitutes v
+JsonValue WorkflowEngine::applyFallback(const WorkflowOperation& operation, WorkflowContext& context) const {
+    if (const JsonValue* value = member(operation.fallback_config, "value")) return *value;
+    const JsonValue* name = member(operation.fallback_config, "data_source");
+    if (!name || name->type != JsonValue::STRING) return JsonValue::makeNull();
+    DataSource* source = config_manager_->getDataSource(name->string_value);
+    if (!source) return JsonValue::makeNull();
+    try {
+        JsonValue result = source->execute(operation.endpoint, resolveValue(operation.parameters, context));
+        return member(result, "error") ? JsonValue::makeNull() : result;
+    } catch (const std::exception&) {
+        return JsonValue::makeNull();
+    }
+}
+
+void WorkflowEngine::setResultCache(std::shared_ptr<qc::core::CacheManager> cache) {
+    std::lock_guard<std::mutex> lock(results_mutex_);
+    results_ = std::move(cache);
+}
+
+qc::core::CacheManager& WorkflowEngine::resultCache() const {
+    std::lock_guard<std::mutex> lock(results_mutex_);
+    if (!results_) {
+        JsonValue caching = config_manager_->getCachingConfig();
+        std::string dir = "./cache";
+        if (const JsonValue* backends = member(caching, "cache_backends")) {
+            if (const JsonValue* file_system = member(*backends, "file_system")) {
+                const JsonValue* cache_dir = member(*file_system, "cache_dir");
+                if (cache_dir && cache_dir->type == JsonValue::STRING) dir = cache_dir->string_value;
+            }
+        }
+        qc::core::CacheManager::Options options;
+        const JsonValue* ttl = member(caching, "default_ttl");
+        if (ttl && ttl->type == JsonValue::NUMBER) options.ttl = std::chrono::seconds(static_cast<long long>(ttl->number_value));
+        results_ = std::make_shared<qc::core::CacheManager>(dir + "/workflow_results", options);
+    }
+    return *results_;
+}
+
+void WorkflowEngine::setCacheValue(const std::string& key, const JsonValue& value) {
+    resultCache().set(key, qc::core::to_io(value));
+}
+
+// Null on a miss; null results are never stored
+JsonValue WorkflowEngine::getCacheValue(const std::string& key) const {
+    auto hit = resultCache().get(key);
+    return hit ? qc::core::from_io(*hit) : JsonValue::makeNull();
+}
+
+bool WorkflowEngine::hasCacheValue(const std::string& key) const {
+    return resultCache().get(key).has_value();
+}
+
+void WorkflowEngine::clearCache() {
+    resultCache().clear();
+}
+
+void WorkflowEngine::memoizeResult(const WorkflowOperation& operation, const std::string& key,
+                                   const qc::core::SharedJson& value) {
+    const JsonValue* ttl = member(operation.cache_config, "ttl");
+    if (ttl && ttl->type == JsonValue::NUMBER && ttl->number_value > 0) {
+        resultCache().set(key, qc::core::to_io(value), std::chrono::seconds(static_cast<long long>(ttl->number_value)));
+    } else {
+        resultCache().set(key, qc::core::to_io(value));
+    }
+}
+
+// Everything that decides the result goes into the digest: what the
+// operation does, its resolved parameters, and the version of the data it
+// reads. Its name and output_key do not, so renamed operations and other
+// workflows asking the same question share entries.
+std::string WorkflowEngine::generateCacheKey(const WorkflowOperation& operation,
+                                             const JsonValue& resolved_params) const {
+    qc::io::JsonObject material;
+    material["type"] = qc::io::JsonValue{static_cast<double>(operation.type)};
+    material["endpoint"] = qc::io::JsonValue{operation.endpoint};
+    material["data_source"] = qc::io::JsonValue{operation.data_source};
+    material["params"] = qc::core::to_io(resolved_params);
+    if (DataSource* source = config_manager_->getDataSource(operation.data_source)) {
+        material["version"] = qc::io::JsonValue{source->getVersion()};
+    }
+    if (operation.type == OperationType::CUSTOM_PROCESSOR) {
+        material["processor"] = qc::io::JsonValue{operation.processor};
+        material["processor_config"] = qc::core::to_io(config_manager_->getProcessorConfig(operation.processor));
+    }
+    std::string digest = qc::core::digest128(qc::io::JsonEmitter::emit(qc::io::JsonValue{material}));
+    return "result:" + qc::core::hex_encode(digest);
+}
+
+bool WorkflowEngine::shouldUseCache(const WorkflowOperation& operation) const {
+    const JsonValue* enabled = member(operation.cache_config, "enabled");
+    return enabled && enabled->type == JsonValue::BOOL && enabled->bool_value;
+}
+
+// Unmeasured operations count as 1 ms until their first run
+double WorkflowEngine::operationCost(const std::string& key) const {
+    std::lock_guard<std::mutex> lock(costs_mutex_);
+    auto it = operation_costs_.find(key);
+    return it == operation_costs_.end() ? 1.0 : it->second;
+}
+
+void WorkflowEngine::recordOperationCost(const std::string& key, double milliseconds) {
+    std::lock_guard<std::mutex> lock(costs_mutex_);
+    auto [it, inserted] = operation_costs_.emplace(key, milliseconds);
+    if (!inserted) it->second = 0.7 * it->second + 0.3 * milliseconds;
+}
@@ -0,0 +1,161 @@
+#include "workflow_plan.h"
+#include "expression.h"
+#include "flexible_json_logic.h"
+#include <algorithm>
+#include <map>
+#include <set>
+
+namespace qc::core {
+
+namespace {
+
+void collect_references(const ::JsonValue& value, std::set<std::string>& names) {
+    switch (value.type) {
+        case ::JsonValue::STRING:
+            for (auto& name : WorkflowPlan::referenced_outputs(value.string_value)) names.insert(std::move(name));
+            break;
+        case ::JsonValue::ARRAY:
+            for (const auto& item : value.array_value) collect_references(item, names);
+            break;
+        case ::JsonValue::OBJECT:
+            for (const auto& [key, item] : value.object_value) collect_references(item, names);
+            break;
+        default:
+            break;
+    }
+}
+
+bool is_upper_word(const std::string& text) {
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](char c) { return c >= 'A' && c <= 'Z'; });
+}
+
+} // namespace
+
+std::vector<std::string> WorkflowPlan::referenced_outputs(const std::string& text) {
+    std::vector<std::string> names;
+    for (const std::string& placeholder : TemplateUtils::extractTemplateVariables(text)) {
+        size_t colon = placeholder.find(':');
+        if (colon == std::string::npos) continue;
+        std::string kind = placeholder.substr(0, colon);
+        if (kind == "INPUT" || kind == "ENV" || kind == "CONFIG") continue;
+        if (kind == "CALC") {
+            const auto& references = Expression::get(placeholder.substr(colon + 1))->references();
+            names.insert(names.end(), references.begin(), references.end());
+            continue;
+        }
+
+        // MERGE lists several paths, each optionally with its own KIND: prefix
+        size_t begin = colon + 1;
+        while (begin <= placeholder.size()) {
+            size_t end = placeholder.find(',', begin);
+            if (end == std::string::npos) end = placeholder.size();
+            std::string path = placeholder.substr(begin, end - begin);
+            size_t prefix = path.find(':');
+            if (prefix != std::string::npos && is_upper_word(path.substr(0, prefix))) path.erase(0, prefix + 1);
+
+            std::string name = path.substr(0, path.find_first_of(".["));
+            if (!name.empty() && name != "INPUT") names.push_back(name);
+            begin = end + 1;
+        }
+    }
+    return names;
+}
+
+std::shared_ptr<const WorkflowPlan> WorkflowPlan::build(const ::Workflow& workflow, std::string* error) {
+    auto fail = [&](const std::string& message) {
+        if (error) *error = message;
+        return std::shared_ptr<const WorkflowPlan>();
+    };
+
+    auto plan = std::make_shared<WorkflowPlan>();
+    std::map<std::string, size_t> producers;
+    for (size_t s = 0; s < workflow.steps.size(); ++s) {
+        const WorkflowStep& step = workflow.steps[s];
+        for (size_t o = 0; o < step.operations.size(); ++o) {
+            const WorkflowOperation& operation = step.operations[o];
+            Node node;
+            node.step = s;
+            node.operation = o;
+            if (!operation.output_key.empty() &&
+                !producers.emplace(operation.output_key, plan->nodes_.size()).second) {
+                return fail("Output '" + operation.output_key + "' is produced by more than one operation");
+            }
+            plan->nodes_.push_back(std::move(node));
+            plan->names_.push_back(operation.name);
+        }
+    }
+    for (const auto& producer : producers) plan->output_keys_.push_back(producer.first);
+
+    for (size_t index = 0; index < plan->nodes_.size(); ++index) {
+        Node& node = plan->nodes_[index];
+        const WorkflowStep& step = workflow.steps[node.step];
+        const WorkflowOperation& operation = step.operations[node.operation];
+
+        std::set<std::string> names;
+        collect_references(operation.parameters, names);
+        for (const std::string* condition : {&operation.condition, &step.condition}) {
+            if (condition->empty()) continue;
+            for (auto& name : referenced_outputs(*condition)) names.insert(std::move(name));
+            const auto& references = Expression::get(*condition)->references();
+            names.insert(references.begin(), references.end());
+        }
+
+        std::set<size_t> dependencies;
+        for (const std::string& name : names) {
+            auto producer = producers.find(name);
+            if (producer == producers.end()) continue; // Resolves to null at run time
+            if (producer->second == index) return fail("Operation '" + operation.name + "' references its own output");
+            dependencies.insert(producer->second);
+        }
+        if (step.execution_type == "sequential" && node.operation > 0) dependencies.insert(index - 1);
+        node.dependencies.assign(dependencies.begin(), dependencies.end());
+        for (size_t dependency : node.dependencies) plan->nodes_[dependency].dependents.push_back(index);
+    }
+
+    // Kahn's algorithm, taking ready nodes in declaration order
+    std::vector<size_t> waiting(plan->nodes_.size());
+    std::set<size_t> ready;
+    for (size_t index = 0; index < plan->nodes_.size(); ++index) {
+        waiting[index] = plan->nodes_[index].dependencies.size();
+        if (waiting[index] == 0) ready.insert(index);
+    }
+    while (!ready.empty()) {
+        size_t index = *ready.begin();
+        ready.erase(ready.begin());
+        plan->order_.push_back(index);
+        for (size_t dependent : plan->nodes_[index].dependents) {
+            if (--waiting[dependent] == 0) ready.insert(dependent);
+        }
+    }
+    if (plan->order_.size() != plan->nodes_.size()) {
+        for (size_t index = 0; index < waiting.size(); ++index) {
+            if (waiting[index] > 0) return fail("Operation '" + plan->names_[index] + "' is part of a dependency cycle");
+        }
+    }
+    return plan;
+}
+
+std::vector<size_t> WorkflowPlan::roots() const {
+    std::vector<size_t> roots;
+    for (size_t index = 0; index < nodes_.size(); ++index) {
+        if (nodes_[index].dependencies.empty()) roots.push_back(index);
+    }
+    return roots;
+}
+
+size_t WorkflowPlan::find(const std::string& operation_name) const {
+    auto it = std::find(names_.begin(), names_.end(), operation_name);
+    return it == names_.end() ? npos : static_cast<size_t>(it - names_.begin());
+}
+
+std::vector<double> WorkflowPlan::critical_path(const std::function<double(size_t)>& cost) const {
+    std::vector<double> remaining(nodes_.size(), 0.0);
+    for (auto it = order_.rbegin(); it != order_.rend(); ++it) {
+        double longest = 0.0;
+        for (size_t dependent : nodes_[*it].dependents) longest = std::max(longest, remaining[dependent]);
+        remaining[*it] = cost(*it) + longest;
+    }
+    return remaining;
+}
+
+} // namespace qc::core
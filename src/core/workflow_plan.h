@@ -0,0 +1,63 @@
+#ifndef WORKFLOW_PLAN_H
+#define WORKFLOW_PLAN_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct Workflow;
+
+namespace qc::core {
+
+// Dependency graph over the operations of a workflow. An operation depends
+// on every operation whose output_key it references: through ${EXTRACT:},
+// ${REF:}, ${LENGTH:}, ${EXISTS:}, ${MERGE:} or ${CALC:} placeholders in its
+// parameters, or through paths in its own condition or the condition of its
+// step. Operations in a "sequential" step additionally run in declaration
+// order. Everything else is free to run concurrently, whatever step it was
+// declared in.
+class WorkflowPlan {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    struct Node {
+        size_t step = 0;      // Indices into Workflow::steps and WorkflowStep::operations
+        size_t operation = 0;
+        std::vector<size_t> dependencies;
+        std::vector<size_t> dependents;
+    };
+
+    // Null, with `error` set, when an output_key is produced twice or the
+    // references form a cycle
+    static std::shared_ptr<const WorkflowPlan> build(const ::Workflow& workflow, std::string* error = nullptr);
+
+    // Output keys named by the placeholders in `text`; input paths and ENV
+    // and CONFIG placeholders are not outputs
+    static std::vector<std::string> referenced_outputs(const std::string& text);
+
+    // Nodes in declaration order
+    const std::vector<Node>& nodes() const { return nodes_; }
+    // Node indices such that every node follows its dependencies
+    const std::vector<size_t>& order() const { return order_; }
+    std::vector<size_t> roots() const;
+    size_t find(const std::string& operation_name) const;
+    // Every output_key some operation produces, sorted
+    const std::vector<std::string>& output_keys() const { return output_keys_; }
+
+    // For each node, the cost of the longest dependency chain starting at it,
+    // its own cost included. Scheduling the longest chains first bounds a
+    // run's latency by the critical path rather than by declaration order.
+    std::vector<double> critical_path(const std::function<double(size_t)>& cost) const;
+
+private:
+    std::vector<Node> nodes_;
+    std::vector<size_t> order_;
+    std::vector<std::string> names_;
+    std::vector<std::string> output_keys_;
+};
+
+} // namespace qc::core
+
+#endif // WORKFLOW_PLAN_H
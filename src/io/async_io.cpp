@@ -0,0 +1,497 @@
+#include "async_io.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+namespace qc::io {
+
+namespace {
+
+// Largest transfer one request makes; bigger ones come back short
+const size_t MAX_TRANSFER = 0x7ffff000;
+
+// Set on the threads that run callbacks, which must not wait for capacity
+// only they can free
+thread_local bool completion_thread = false;
+
+int64_t run_blocking(const AsyncIO::Request& request) {
+#ifdef _WIN32
+    (void)request;
+    return -ENOSYS;
+#else
+    ssize_t result = 0;
+    size_t size = std::min(request.size, MAX_TRANSFER);
+    do {
+        switch (request.op) {
+        case AsyncIO::Request::Op::READ:
+            result = ::pread(request.fd, request.data, size, static_cast<off_t>(request.offset));
+            break;
+        case AsyncIO::Request::Op::WRITE:
+            result = ::pwrite(request.fd, request.data, size, static_cast<off_t>(request.offset));
+            break;
+        case AsyncIO::Request::Op::FSYNC:
+            result = ::fsync(request.fd);
+            break;
+        case AsyncIO::Request::Op::FDATASYNC:
+#ifdef __APPLE__
+            result = ::fsync(request.fd);
+#else
+            result = ::fdatasync(request.fd);
+#endif
+            break;
+        }
+    } while (result < 0 && errno == EINTR);
+    return result < 0 ? -errno : result;
+#endif
+}
+
+// Whether a result should cancel the rest of a linked chain
+bool breaks_link(const AsyncIO::Request& request, int64_t result) {
+    if (result < 0) return true;
+    bool transfer = request.op == AsyncIO::Request::Op::READ || request.op == AsyncIO::Request::Op::WRITE;
+    return transfer && static_cast<size_t>(result) < std::min(request.size, MAX_TRANSFER);
+}
+
+#ifdef __linux__
+int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int io_uring_register(int fd, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+#endif
+
+} // namespace
+
+#ifdef __linux__
+struct AsyncIO::Ring {
+    int fd = -1;
+    void* sq_ring = MAP_FAILED;
+    size_t sq_ring_size = 0;
+    void* cq_ring = MAP_FAILED;
+    size_t cq_ring_size = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_size = 0;
+
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned sq_entries = 0;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    bool fixed_buffers = false;
+    std::mutex submit_mutex; // Guards the submission queue tail
+    // Requests reach the reaper through memory the kernel hands over; this
+    // release/acquire pair makes that handoff visible to the C++ memory model
+    std::atomic<uint64_t> published{0};
+
+    ~Ring() {
+        if (sqes != MAP_FAILED) ::munmap(sqes, sqes_size);
+        if (cq_ring != MAP_FAILED && cq_ring != sq_ring) ::munmap(cq_ring, cq_ring_size);
+        if (sq_ring != MAP_FAILED) ::munmap(sq_ring, sq_ring_size);
+        if (fd >= 0) ::close(fd);
+    }
+};
+#else
+struct AsyncIO::Ring {};
+#endif
+
+AsyncIO::AsyncIO() : AsyncIO(Options{}) {}
+
+AsyncIO::AsyncIO(const Options& options) : options_(options) {
+    if (options_.queue_depth == 0) options_.queue_depth = 1;
+    if (options_.registered_buffers > 0) {
+        buffer_memory_ = std::make_unique<char[]>(options_.registered_buffers * options_.buffer_size);
+        for (size_t i = options_.registered_buffers; i-- > 0;) free_buffers_.push_back(static_cast<int>(i));
+    }
+
+    if (!options_.force_thread_pool && setup_ring()) {
+        backend_ = Backend::IO_URING;
+        reaper_ = std::thread(&AsyncIO::reap_loop, this);
+        return;
+    }
+    ring_.reset();
+    backend_ = Backend::THREAD_POOL;
+    capacity_ = options_.queue_depth;
+    for (size_t i = 0; i < std::max<size_t>(options_.fallback_threads, 1); ++i) {
+        workers_.emplace_back(&AsyncIO::worker_loop, this);
+    }
+}
+
+AsyncIO::~AsyncIO() {
+    drain();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& worker : workers_) worker.join();
+
+#ifdef __linux__
+    if (ring_) {
+        // A no-op with no request behind it tells the reaper to exit
+        std::lock_guard<std::mutex> lock(ring_->submit_mutex);
+        unsigned tail = *ring_->sq_tail;
+        unsigned index = tail & ring_->sq_mask;
+        io_uring_sqe& sqe = ring_->sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_NOP;
+        ring_->sq_array[index] = index;
+        __atomic_store_n(ring_->sq_tail, tail + 1, __ATOMIC_RELEASE);
+        while (io_uring_enter(ring_->fd, 1, 0, 0) < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY)) {
+            std::this_thread::yield();
+        }
+    }
+#endif
+    if (reaper_.joinable()) reaper_.join();
+}
+
+bool AsyncIO::setup_ring() {
+#ifdef __linux__
+    auto ring = std::make_unique<Ring>();
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring->fd = io_uring_setup(options_.queue_depth, &params);
+    if (ring->fd < 0) return false;
+    // Plain READ/WRITE ops and no dropped completions arrived together in 5.6
+    if (!(params.features & IORING_FEAT_NODROP) || !(params.features & IORING_FEAT_RW_CUR_POS)) return false;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) ring->sq_ring_size = ring->cq_ring_size = std::max(ring->sq_ring_size, ring->cq_ring_size);
+
+    ring->sq_ring = ::mmap(nullptr, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) return false;
+    ring->cq_ring = single_mmap ? ring->sq_ring
+                                : ::mmap(nullptr, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                                         MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ring == MAP_FAILED) return false;
+    ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    ring->sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE,
+                                                   MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES));
+    if (ring->sqes == MAP_FAILED) return false;
+
+    char* sq = static_cast<char*>(ring->sq_ring);
+    char* cq = static_cast<char*>(ring->cq_ring);
+    ring->sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    ring->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring->sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring->sq_entries = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    ring->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    ring->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring->cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    if (buffer_memory_) {
+        // Pinning can fail under a low RLIMIT_MEMLOCK; the buffers then work as plain memory
+        std::vector<struct iovec> iov(options_.registered_buffers);
+        for (size_t i = 0; i < iov.size(); ++i) {
+            iov[i] = {buffer_memory_.get() + i * options_.buffer_size, options_.buffer_size};
+        }
+        ring->fixed_buffers = io_uring_register(ring->fd, IORING_REGISTER_BUFFERS, iov.data(),
+                                                static_cast<unsigned>(iov.size())) == 0;
+    }
+
+    capacity_ = params.cq_entries;
+    ring_ = std::move(ring);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AsyncIO::submit(std::vector<Request> batch) {
+    if (batch.empty()) return;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // Oversized batches go through once nothing else is in flight
+        if (!completion_thread) {
+            capacity_cv_.wait(lock, [&] { return in_flight_ == 0 || in_flight_ + batch.size() <= capacity_; });
+        }
+        in_flight_ += batch.size();
+        stats_.submitted += batch.size();
+    }
+
+    // A chain goes to the kernel in one submission, or a failure in its
+    // first part could not stop the rest
+    std::vector<Request> accepted;
+    std::vector<Request> rejected;
+    for (size_t begin = 0; begin < batch.size();) {
+        size_t end = begin + 1;
+        while (end < batch.size() && batch[end - 1].link) ++end;
+        auto& target = end - begin > options_.queue_depth ? rejected : accepted;
+        std::move(batch.begin() + begin, batch.begin() + end, std::back_inserter(target));
+        begin = end;
+    }
+    batch = std::move(accepted);
+
+    if (batch.empty()) {
+        // Nothing to hand over
+    } else if (backend_ == Backend::IO_URING) {
+        submit_ring(batch);
+    } else {
+        submit_pool(batch);
+    }
+    for (auto& request : rejected) complete(request, -EINVAL);
+}
+
+// The pool runs each linked chain in order on one worker
+void AsyncIO::submit_pool(std::vector<Request>& batch) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.submit_calls++;
+        std::vector<Request> chain;
+        for (auto& request : batch) {
+            bool link = request.link;
+            chain.push_back(std::move(request));
+            if (!link) {
+                work_.push_back(std::move(chain));
+                chain.clear();
+            }
+        }
+        if (!chain.empty()) work_.push_back(std::move(chain));
+    }
+    work_cv_.notify_all();
+}
+
+// Requests that fail to submit complete after the lock is dropped, since
+// their callbacks may submit again
+void AsyncIO::submit_ring(std::vector<Request>& batch) {
+#ifdef __linux__
+    std::unique_lock<std::mutex> lock(ring_->submit_mutex);
+    std::vector<std::pair<Request*, int>> failed; // With the errno to fail it with
+    size_t next = 0;
+    while (next < batch.size()) {
+        // Fill at most a queue's worth, ending on a chain boundary when possible
+        size_t end = std::min(batch.size(), next + ring_->sq_entries);
+        if (end < batch.size()) {
+            size_t cut = end;
+            while (cut > next && batch[cut - 1].link) cut--;
+            if (cut > next) end = cut;
+        }
+
+        unsigned tail = *ring_->sq_tail;
+        for (size_t i = next; i < end; ++i) {
+            auto* request = new Request(std::move(batch[i]));
+            unsigned index = (tail + static_cast<unsigned>(i - next)) & ring_->sq_mask;
+            io_uring_sqe& sqe = ring_->sqes[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.fd = request->fd;
+            sqe.user_data = reinterpret_cast<uint64_t>(request);
+            if (request->link && i + 1 < end) sqe.flags |= IOSQE_IO_LINK;
+            bool fixed = ring_->fixed_buffers && request->buffer >= 0;
+            switch (request->op) {
+            case Request::Op::READ:
+            case Request::Op::WRITE:
+                if (request->op == Request::Op::READ) {
+                    sqe.opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+                } else {
+                    sqe.opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+                }
+                sqe.off = request->offset;
+                sqe.addr = reinterpret_cast<uint64_t>(request->data);
+                sqe.len = static_cast<uint32_t>(std::min(request->size, MAX_TRANSFER));
+                if (fixed) sqe.buf_index = static_cast<uint16_t>(request->buffer);
+                break;
+            case Request::Op::FSYNC:
+            case Request::Op::FDATASYNC:
+                sqe.opcode = IORING_OP_FSYNC;
+                sqe.fsync_flags = request->op == Request::Op::FDATASYNC ? IORING_FSYNC_DATASYNC : 0;
+                break;
+            }
+            ring_->sq_array[index] = index;
+        }
+        unsigned count = static_cast<unsigned>(end - next);
+        ring_->published.fetch_add(1, std::memory_order_release);
+        __atomic_store_n(ring_->sq_tail, tail + count, __ATOMIC_RELEASE);
+
+        // Without SQPOLL the kernel consumes entries only inside io_uring_enter
+        unsigned left = count;
+        int error = 0;
+        while (left > 0) {
+            int submitted = io_uring_enter(ring_->fd, left, 0, 0);
+            if (submitted >= 0) {
+                left -= std::min<unsigned>(left, static_cast<unsigned>(submitted));
+                if (submitted == 0) std::this_thread::yield();
+            } else if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                std::this_thread::yield();
+            } else {
+                error = errno;
+                break;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> stats_lock(mutex_);
+            stats_.submit_calls++;
+        }
+        if (error != 0) {
+            // Take back what the kernel never saw and fail it
+            unsigned head = __atomic_load_n(ring_->sq_head, __ATOMIC_ACQUIRE);
+            __atomic_store_n(ring_->sq_tail, head, __ATOMIC_RELEASE);
+            for (unsigned i = head; i != tail + count; ++i) {
+                failed.emplace_back(reinterpret_cast<Request*>(ring_->sqes[i & ring_->sq_mask].user_data), error);
+            }
+        }
+        next = end;
+    }
+    lock.unlock();
+    for (auto& [request, error] : failed) {
+        complete(*request, -error);
+        delete request;
+    }
+#else
+    (void)batch;
+#endif
+}
+
+void AsyncIO::reap_loop() {
+#ifdef __linux__
+    completion_thread = true;
+    while (true) {
+        if (io_uring_enter(ring_->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            std::this_thread::yield();
+        }
+        unsigned head = *ring_->cq_head;
+        unsigned tail = __atomic_load_n(ring_->cq_tail, __ATOMIC_ACQUIRE);
+        ring_->published.load(std::memory_order_acquire);
+        while (head != tail) {
+            const io_uring_cqe& cqe = ring_->cqes[head & ring_->cq_mask];
+            auto* request = reinterpret_cast<Request*>(cqe.user_data);
+            int64_t result = cqe.res;
+            __atomic_store_n(ring_->cq_head, ++head, __ATOMIC_RELEASE);
+            if (!request) return; // Shutdown marker, queued after everything else drained
+            complete(*request, result);
+            delete request;
+        }
+    }
+#endif
+}
+
+void AsyncIO::worker_loop() {
+    completion_thread = true;
+    while (true) {
+        std::vector<Request> chain;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [&] { return stopping_ || !work_.empty(); });
+            if (work_.empty()) return;
+            chain = std::move(work_.front());
+            work_.pop_front();
+        }
+        bool cancelled = false;
+        for (auto& request : chain) {
+            int64_t result = cancelled ? -ECANCELED : run_blocking(request);
+            if (request.link && breaks_link(request, result)) cancelled = true;
+            complete(request, result);
+        }
+    }
+}
+
+void AsyncIO::complete(Request& request, int64_t result) {
+    if (request.done) request.done(result);
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_flight_--;
+    stats_.completed++;
+    capacity_cv_.notify_all();
+    if (in_flight_ == 0) drained_cv_.notify_all();
+}
+
+std::future<int64_t> AsyncIO::read(int fd, void* data, size_t size, uint64_t offset) {
+    auto promise = std::make_shared<std::promise<int64_t>>();
+    std::future<int64_t> result = promise->get_future();
+    Request request;
+    request.op = Request::Op::READ;
+    request.fd = fd;
+    request.data = data;
+    request.size = size;
+    request.offset = offset;
+    request.done = [promise](int64_t res) { promise->set_value(res); };
+    submit({std::move(request)});
+    return result;
+}
+
+std::future<int64_t> AsyncIO::write(int fd, const void* data, size_t size, uint64_t offset) {
+    auto promise = std::make_shared<std::promise<int64_t>>();
+    std::future<int64_t> result = promise->get_future();
+    Request request;
+    request.op = Request::Op::WRITE;
+    request.fd = fd;
+    request.data = const_cast<void*>(data); // Only read from for a write
+    request.size = size;
+    request.offset = offset;
+    request.done = [promise](int64_t res) { promise->set_value(res); };
+    submit({std::move(request)});
+    return result;
+}
+
+std::future<int64_t> AsyncIO::sync(int fd, bool data_only) {
+    auto promise = std::make_shared<std::promise<int64_t>>();
+    std::future<int64_t> result = promise->get_future();
+    Request request;
+    request.op = data_only ? Request::Op::FDATASYNC : Request::Op::FSYNC;
+    request.fd = fd;
+    request.done = [promise](int64_t res) { promise->set_value(res); };
+    submit({std::move(request)});
+    return result;
+}
+
+void AsyncIO::drain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    drained_cv_.wait(lock, [&] { return in_flight_ == 0; });
+}
+
+int AsyncIO::acquire_buffer() {
+    if (options_.registered_buffers == 0) return -1;
+    std::unique_lock<std::mutex> lock(mutex_);
+    buffer_cv_.wait(lock, [&] { return !free_buffers_.empty(); });
+    int index = free_buffers_.back();
+    free_buffers_.pop_back();
+    return index;
+}
+
+void AsyncIO::release_buffer(int index) {
+    if (index < 0 || static_cast<size_t>(index) >= options_.registered_buffers) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_buffers_.push_back(index);
+    }
+    buffer_cv_.notify_one();
+}
+
+char* AsyncIO::buffer_data(int index) const {
+    if (index < 0 || static_cast<size_t>(index) >= options_.registered_buffers) return nullptr;
+    return buffer_memory_.get() + static_cast<size_t>(index) * options_.buffer_size;
+}
+
+AsyncIO::Stats AsyncIO::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+} // namespace qc::io
@@ -0,0 +1,120 @@
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qc::io {
+
+// Asynchronous positional file I/O. On Linux it drives an io_uring through
+// the raw syscalls; where io_uring is unavailable (old kernels, seccomp
+// filters, other platforms) a small thread pool issues the same operations
+// with pread/pwrite/fsync.
+//
+// A batch goes to the kernel in a single submission, and completions are
+// reaped on one background thread that runs the callbacks, so callers can
+// queue I/O and carry on computing. Callbacks should be short; they may
+// submit follow-up requests.
+class AsyncIO {
+public:
+    enum class Backend { IO_URING, THREAD_POOL };
+
+    struct Options {
+        unsigned queue_depth = 256;    // Submission slots; also caps requests in flight
+        size_t fallback_threads = 4;
+        size_t registered_buffers = 0; // Buffers pinned with the kernel once, up front
+        size_t buffer_size = 64 * 1024;
+        bool force_thread_pool = false;
+    };
+
+    // Bytes transferred, 0 for syncs, or -errno
+    using Callback = std::function<void(int64_t result)>;
+
+    struct Request {
+        enum class Op { READ, WRITE, FSYNC, FDATASYNC };
+        Op op = Op::READ;
+        int fd = -1;
+        uint64_t offset = 0;
+        void* data = nullptr;   // Destination of a read, source of a write
+        size_t size = 0;
+        int buffer = -1;        // Registered buffer that `data` points into, if any
+        // Start the next request of the batch only once this one succeeds. A
+        // chain holds at most queue_depth requests; longer ones fail whole
+        // with -EINVAL.
+        bool link = false;
+        Callback done;
+    };
+
+    struct Stats {
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+        uint64_t submit_calls = 0; // Kernel submissions; batching keeps this below `submitted`
+    };
+
+    AsyncIO();
+    explicit AsyncIO(const Options& options);
+    ~AsyncIO(); // Waits for requests in flight
+
+    AsyncIO(const AsyncIO&) = delete;
+    AsyncIO& operator=(const AsyncIO&) = delete;
+
+    Backend backend() const { return backend_; }
+
+    void submit(std::vector<Request> batch);
+    std::future<int64_t> read(int fd, void* data, size_t size, uint64_t offset);
+    std::future<int64_t> write(int fd, const void* data, size_t size, uint64_t offset);
+    std::future<int64_t> sync(int fd, bool data_only = true);
+
+    // Blocks until everything submitted so far has completed
+    void drain();
+
+    // Waits for a free registered buffer; -1 if none were configured
+    int acquire_buffer();
+    void release_buffer(int index);
+    char* buffer_data(int index) const;
+    size_t buffer_size() const { return options_.buffer_size; }
+
+    Stats stats() const;
+
+private:
+    struct Ring; // io_uring mappings, kept out of this header
+
+    Options options_;
+    Backend backend_ = Backend::THREAD_POOL;
+    std::unique_ptr<Ring> ring_;
+    std::thread reaper_;               // io_uring completions
+    std::vector<std::thread> workers_; // Thread pool backend
+
+    mutable std::mutex mutex_;
+    std::condition_variable capacity_cv_; // Room for more requests in flight
+    std::condition_variable drained_cv_;
+    std::condition_variable work_cv_;
+    std::deque<std::vector<Request>> work_; // Chains of linked requests for the pool
+    size_t in_flight_ = 0;
+    size_t capacity_ = 0;
+    bool stopping_ = false;
+    Stats stats_;
+
+    std::unique_ptr<char[]> buffer_memory_;
+    std::vector<int> free_buffers_;
+    std::condition_variable buffer_cv_;
+
+    bool setup_ring();
+    void submit_ring(std::vector<Request>& batch);
+    void submit_pool(std::vector<Request>& batch);
+    void reap_loop();
+    void worker_loop();
+    void complete(Request& request, int64_t result);
+};
+
+} // namespace qc::io
+
+#endif // ASYNC_IO_H
@@ -1,6 +1,7 @@
 #ifndef BMP_EXPORTER_H
 #define BMP_EXPORTER_H
 
+#include "file_io.h"
 #include <vector>
 #include <string>
 #include <fstream>
@@ -61,6 +62,12 @@ public:
         return true;
     }
 
+    // Encodes here, then writes through `io` while the caller moves on
+    static std::future<bool> export_to_file(AsyncIO& io, const std::string& filename, int width, int height, const std::vector<Color>& pixels) {
+        auto buffer = export_to_buffer(width, height, pixels);
+        return FileIO::write_atomic_async(io, filename, std::string(buffer.begin(), buffer.end()));
+    }
+
 private:
     static void write_u32(std::vector<uint8_t>& b, uint32_t v) {
         b.push_back(static_cast<uint8_t>(v & 0xFF));
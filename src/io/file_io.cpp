@@ -0,0 +1,442 @@
+#include "file_io.h"
+#include "async_io.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#include <sys/stat.h>
+#include <windows.h>
+#else
+#include <climits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace qc::io {
+
+// --- MappedFile ---
+
+std::optional<MappedFile> MappedFile::open(const std::string& path) {
+    MappedFile file;
+#ifdef _WIN32
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return std::nullopt;
+    std::streamsize size = in.tellg();
+    in.seekg(0);
+    file.fallback_.resize(static_cast<size_t>(size));
+    if (size > 0 && !in.read(&file.fallback_[0], size)) return std::nullopt;
+    file.data_ = file.fallback_.data();
+    file.size_ = file.fallback_.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return std::nullopt;
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return std::nullopt;
+    }
+    file.size_ = static_cast<size_t>(st.st_size);
+    if (file.size_ == 0) {
+        ::close(fd);
+        file.data_ = file.fallback_.data();
+        return file;
+    }
+    void* addr = ::mmap(nullptr, file.size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps the file referenced
+    if (addr == MAP_FAILED) return std::nullopt;
+    ::madvise(addr, file.size_, MADV_SEQUENTIAL);
+    file.data_ = static_cast<const char*>(addr);
+    file.mapped_ = true;
+#endif
+    return file;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this == &other) return *this;
+    release();
+    mapped_ = other.mapped_;
+    size_ = other.size_;
+    fallback_ = std::move(other.fallback_);
+    data_ = mapped_ ? other.data_ : fallback_.data();
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.mapped_ = false;
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    release();
+}
+
+void MappedFile::release() {
+#ifndef _WIN32
+    if (mapped_ && data_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+}
+
+// --- FileIO ---
+
+// Unique sibling of the target, so the final rename stays on one filesystem
+static std::string temp_path_for(const std::string& path) {
+    static std::atomic<unsigned long> counter{0};
+#ifdef _WIN32
+    long pid = _getpid();
+#else
+    long pid = ::getpid();
+#endif
+    return path + ".tmp." + std::to_string(pid) + "." + std::to_string(counter++);
+}
+
+// Persist the directory entry so a rename itself survives a crash
+static void sync_parent_dir(const std::string& path) {
+#ifndef _WIN32
+    std::string dir = std::filesystem::path(path).parent_path().string();
+    int dir_fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+#else
+    (void)path;
+#endif
+}
+
+bool FileIO::write_atomic(const std::string& path, std::string_view data, bool durable) {
+    return write_atomic(path, std::vector<std::string_view>{data}, durable);
+}
+
+bool FileIO::write_atomic(const std::string& path, const std::vector<std::string_view>& chunks, bool durable) {
+    const std::string tmp = temp_path_for(path);
+
+#ifdef _WIN32
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        for (const auto& chunk : chunks) out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        out.flush();
+        if (!out) {
+            out.close();
+            std::remove(tmp.c_str());
+            return false;
+        }
+    }
+    (void)durable;
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+#else
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    std::vector<struct iovec> iov;
+    iov.reserve(chunks.size());
+    for (const auto& chunk : chunks) {
+        if (!chunk.empty()) iov.push_back({const_cast<char*>(chunk.data()), chunk.size()});
+    }
+
+    // Gather-write everything, resuming after partial writes
+    bool ok = true;
+    size_t next = 0;
+    while (ok && next < iov.size()) {
+        int count = static_cast<int>(std::min<size_t>(iov.size() - next, IOV_MAX));
+        ssize_t written = ::writev(fd, &iov[next], count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+        size_t remaining = static_cast<size_t>(written);
+        while (next < iov.size() && remaining >= iov[next].iov_len) {
+            remaining -= iov[next].iov_len;
+            next++;
+        }
+        if (remaining > 0) {
+            iov[next].iov_base = static_cast<char*>(iov[next].iov_base) + remaining;
+            iov[next].iov_len -= remaining;
+        }
+    }
+
+    if (ok && durable && ::fdatasync(fd) != 0) ok = false;
+    if (::close(fd) != 0) ok = false;
+    if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+
+    if (durable) sync_parent_dir(path);
+    return true;
+#endif
+}
+
+int FileIO::open_fd(const std::string& path, Open mode) {
+#ifdef _WIN32
+    int flags = _O_BINARY | _O_NOINHERIT;
+    if (mode == Open::EXISTING) flags |= _O_RDWR;
+    if (mode == Open::CREATE) flags |= _O_RDWR | _O_CREAT | _O_TRUNC;
+    if (mode == Open::APPEND) flags |= _O_WRONLY | _O_APPEND;
+    return ::_open(path.c_str(), flags, _S_IREAD | _S_IWRITE);
+#else
+    int flags = O_CLOEXEC;
+    if (mode == Open::EXISTING) flags |= O_RDWR;
+    if (mode == Open::CREATE) flags |= O_RDWR | O_CREAT | O_TRUNC;
+    if (mode == Open::APPEND) flags |= O_WRONLY | O_APPEND;
+    return ::open(path.c_str(), flags, 0644);
+#endif
+}
+
+void FileIO::close_fd(int fd) {
+    if (fd < 0) return;
+#ifdef _WIN32
+    ::_close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+// Windows has no pread or pwrite; an OVERLAPPED offset does the same
+bool FileIO::read_at(int fd, char* data, size_t size, uint64_t offset) {
+    while (size > 0) {
+#ifdef _WIN32
+        OVERLAPPED at{};
+        at.Offset = static_cast<DWORD>(offset);
+        at.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD n = 0;
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+        if (!::ReadFile(reinterpret_cast<HANDLE>(::_get_osfhandle(fd)), data, chunk, &n, &at) || n == 0) return false;
+#else
+        ssize_t n = ::pread(fd, data, size, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+#endif
+        data += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+bool FileIO::write_at(int fd, const char* data, size_t size, uint64_t offset) {
+    while (size > 0) {
+#ifdef _WIN32
+        OVERLAPPED at{};
+        at.Offset = static_cast<DWORD>(offset);
+        at.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD n = 0;
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+        if (!::WriteFile(reinterpret_cast<HANDLE>(::_get_osfhandle(fd)), data, chunk, &n, &at)) return false;
+#else
+        ssize_t n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return false;
+#endif
+        data += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+bool FileIO::append(int fd, const char* data, size_t size) {
+    while (size > 0) {
+#ifdef _WIN32
+        int n = ::_write(fd, data, static_cast<unsigned>(std::min<size_t>(size, 1u << 30)));
+#else
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+#endif
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool FileIO::truncate_fd(int fd, uint64_t size) {
+#ifdef _WIN32
+    return ::_chsize_s(fd, static_cast<long long>(size)) == 0;
+#else
+    return ::ftruncate(fd, static_cast<off_t>(size)) == 0;
+#endif
+}
+
+bool FileIO::sync_fd(int fd) {
+#ifdef _WIN32
+    return ::_commit(fd) == 0;
+#else
+    return ::fdatasync(fd) == 0;
+#endif
+}
+
+// Requests larger than this are split; the kernel caps one transfer near 2GB
+static const size_t ASYNC_CHUNK = size_t{1} << 30;
+
+std::future<bool> FileIO::write_atomic_async(AsyncIO& io, const std::string& path, std::string data, bool durable) {
+    std::promise<bool> ready;
+#ifdef _WIN32
+    ready.set_value(write_atomic(path, data, durable));
+    (void)io;
+    return ready.get_future();
+#else
+    struct Pending {
+        std::string path;
+        std::string tmp;
+        std::string data;
+        int fd = -1;
+        bool durable = false;
+        bool failed = false;
+        std::promise<bool> done;
+    };
+    auto pending = std::make_shared<Pending>();
+    pending->path = path;
+    pending->tmp = temp_path_for(path);
+    pending->data = std::move(data);
+    pending->durable = durable;
+    std::future<bool> result = pending->done.get_future();
+
+    pending->fd = ::open(pending->tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (pending->fd < 0) {
+        pending->done.set_value(false);
+        return result;
+    }
+
+    // One linked chain, so each request starts only after the previous one
+    // succeeded and the last completion settles the outcome
+    std::vector<AsyncIO::Request> batch;
+    for (size_t offset = 0; offset < pending->data.size(); offset += ASYNC_CHUNK) {
+        AsyncIO::Request write;
+        write.op = AsyncIO::Request::Op::WRITE;
+        write.fd = pending->fd;
+        write.offset = offset;
+        write.data = &pending->data[offset];
+        write.size = std::min(ASYNC_CHUNK, pending->data.size() - offset);
+        write.link = true;
+        size_t expected = write.size;
+        write.done = [pending, expected](int64_t written) {
+            if (written < 0 || static_cast<size_t>(written) != expected) pending->failed = true;
+        };
+        batch.push_back(std::move(write));
+    }
+    if (durable) {
+        AsyncIO::Request sync;
+        sync.op = AsyncIO::Request::Op::FDATASYNC;
+        sync.fd = pending->fd;
+        sync.done = [pending](int64_t res) {
+            if (res < 0) pending->failed = true;
+        };
+        batch.push_back(std::move(sync));
+    }
+
+    auto finish = [pending] {
+        bool ok = !pending->failed;
+        if (::close(pending->fd) != 0) ok = false;
+        if (!ok || ::rename(pending->tmp.c_str(), pending->path.c_str()) != 0) {
+            ::unlink(pending->tmp.c_str());
+            ok = false;
+        }
+        if (ok && pending->durable) sync_parent_dir(pending->path);
+        pending->done.set_value(ok);
+    };
+    if (batch.empty()) { // Nothing to write or sync
+        finish();
+        return result;
+    }
+    batch.back().link = false;
+    AsyncIO::Callback last = std::move(batch.back().done);
+    batch.back().done = [last, finish](int64_t res) {
+        last(res);
+        finish();
+    };
+    io.submit(std::move(batch));
+    return result;
+#endif
+}
+
+std::future<std::optional<std::string>> FileIO::read_async(AsyncIO& io, const std::string& path) {
+    std::promise<std::optional<std::string>> ready;
+    std::future<std::optional<std::string>> result = ready.get_future();
+#ifdef _WIN32
+    (void)io;
+    auto file = MappedFile::open(path);
+    ready.set_value(file ? std::optional<std::string>(std::string(file->view())) : std::nullopt);
+    return result;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0) {
+        if (fd >= 0) ::close(fd);
+        ready.set_value(std::nullopt);
+        return result;
+    }
+    if (st.st_size == 0) {
+        ::close(fd);
+        ready.set_value(std::string());
+        return result;
+    }
+
+    struct Pending {
+        int fd = -1;
+        std::string data;
+        std::atomic<size_t> remaining{0};
+        std::atomic<bool> failed{false};
+        std::promise<std::optional<std::string>> done;
+    };
+    auto pending = std::make_shared<Pending>();
+    pending->fd = fd;
+    pending->data.resize(static_cast<size_t>(st.st_size));
+    pending->done = std::move(ready);
+
+    // Chunks are independent, so they may complete in any order
+    std::vector<AsyncIO::Request> batch;
+    for (size_t offset = 0; offset < pending->data.size(); offset += ASYNC_CHUNK) {
+        AsyncIO::Request read;
+        read.op = AsyncIO::Request::Op::READ;
+        read.fd = fd;
+        read.offset = offset;
+        read.data = &pending->data[offset];
+        read.size = std::min(ASYNC_CHUNK, pending->data.size() - offset);
+        size_t expected = read.size;
+        read.done = [pending, expected](int64_t got) {
+            if (got < 0 || static_cast<size_t>(got) != expected) pending->failed = true;
+            if (--pending->remaining > 0) return;
+            ::close(pending->fd);
+            if (pending->failed) {
+                pending->done.set_value(std::nullopt);
+            } else {
+                pending->done.set_value(std::move(pending->data));
+            }
+        };
+        batch.push_back(std::move(read));
+    }
+    pending->remaining = batch.size();
+    io.submit(std::move(batch));
+    return result;
+#endif
+}
+
+} // namespace qc::io
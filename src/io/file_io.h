@@ -0,0 +1,83 @@
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qc::io {
+
+class AsyncIO;
+
+// Read-only view of a whole file. Uses mmap where available so the
+// contents are paged in on demand instead of copied up front.
+class MappedFile {
+public:
+    static std::optional<MappedFile> open(const std::string& path);
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return {data_, size_}; }
+
+private:
+    MappedFile() = default;
+    void release();
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::string fallback_; // Holds the contents when mapping is unavailable
+};
+
+class FileIO {
+public:
+    // Replace `path` atomically: the data goes to a temporary file in the same
+    // directory which is then renamed over the target, so readers see either
+    // the old or the new contents and never a truncated file. With `durable`
+    // the data (and the rename) are synced to disk before returning.
+    static bool write_atomic(const std::string& path, std::string_view data, bool durable = false);
+    // Same, gathering the chunks with a single vectored write where possible
+    static bool write_atomic(const std::string& path, const std::vector<std::string_view>& chunks, bool durable = false);
+
+    // The same through `io`, so the caller can keep working while the data
+    // is written. The rename runs on the completion thread once the write
+    // (and sync) succeed.
+    static std::future<bool> write_atomic_async(AsyncIO& io, const std::string& path, std::string data,
+                                                bool durable = false);
+    // Whole-file read through `io`; empty on any error
+    static std::future<std::optional<std::string>> read_async(AsyncIO& io, const std::string& path);
+
+    // Plain descriptors, for stores that keep a file open across calls, on
+    // POSIX and Windows alike. open_fd returns -1 on failure.
+    enum class Open {
+        EXISTING, // Read and write
+        CREATE,   // Read and write, emptied if it exists
+        APPEND    // Write only, always at the end
+    };
+    static int open_fd(const std::string& path, Open mode);
+    static void close_fd(int fd);
+    // Whole transfers at an absolute offset, which neither moves nor depends
+    // on a file position, so threads can share a descriptor. False on error
+    // or a read past the end.
+    static bool read_at(int fd, char* data, size_t size, uint64_t offset);
+    static bool write_at(int fd, const char* data, size_t size, uint64_t offset);
+    // Whole write at the end of a descriptor opened with Open::APPEND
+    static bool append(int fd, const char* data, size_t size);
+    static bool truncate_fd(int fd, uint64_t size);
+    // Data to stable storage; metadata too where there is no cheaper call
+    static bool sync_fd(int fd);
+};
+
+} // namespace qc::io
+
+#endif // FILE_IO_H
@@ -0,0 +1,105 @@
+#include "json_diff.h"
+
+namespace qc::io {
+
+bool JsonDiff::equal(const JsonValue& a, const JsonValue& b) {
+    if (a.data.index() != b.data.index()) return false;
+    if (a.is_null()) return true;
+    if (a.is_bool()) return a.as_bool() == b.as_bool();
+    if (a.is_number()) return a.as_number() == b.as_number();
+    if (a.is_string()) return a.as_string() == b.as_string();
+    if (a.is_array()) {
+        const JsonArray& x = a.as_array();
+        const JsonArray& y = b.as_array();
+        if (x.size() != y.size()) return false;
+        for (size_t i = 0; i < x.size(); ++i) {
+            if (!equal(x[i], y[i])) return false;
+        }
+        return true;
+    }
+    const JsonObject& x = a.as_object();
+    const JsonObject& y = b.as_object();
+    if (x.size() != y.size()) return false;
+    for (auto i = x.begin(), j = y.begin(); i != x.end(); ++i, ++j) {
+        if (i->first != j->first || !equal(i->second, j->second)) return false;
+    }
+    return true;
+}
+
+JsonArray JsonDiff::diff(const JsonValue& before, const JsonValue& after) {
+    return diff(before, after, JsonArray{});
+}
+
+JsonArray JsonDiff::diff(const JsonValue& before, const JsonValue& after, const JsonArray& at) {
+    JsonArray path = at;
+    JsonArray ops;
+    diff_into(before, after, path, ops);
+    return ops;
+}
+
+void JsonDiff::diff_into(const JsonValue& before, const JsonValue& after, JsonArray& path, JsonArray& ops) {
+    if (!before.is_object() || !after.is_object()) {
+        if (!equal(before, after)) ops.push_back(JsonValue{JsonObject{{"set", JsonValue{path}}, {"value", after}}});
+        return;
+    }
+
+    const JsonObject& old_members = before.as_object();
+    const JsonObject& new_members = after.as_object();
+    for (const auto& [key, value] : old_members) {
+        if (new_members.count(key)) continue;
+        path.push_back(JsonValue{key});
+        ops.push_back(JsonValue{JsonObject{{"remove", JsonValue{path}}}});
+        path.pop_back();
+    }
+    for (const auto& [key, value] : new_members) {
+        path.push_back(JsonValue{key});
+        auto old = old_members.find(key);
+        if (old == old_members.end()) {
+            ops.push_back(JsonValue{JsonObject{{"set", JsonValue{path}}, {"value", value}}});
+        } else {
+            diff_into(old->second, value, path, ops);
+        }
+        path.pop_back();
+    }
+}
+
+bool JsonDiff::apply(JsonValue& target, const JsonArray& ops) {
+    for (const auto& op : ops) {
+        if (!op.is_object()) return false;
+        const JsonObject& fields = op.as_object();
+        auto set = fields.find("set");
+        auto remove = fields.find("remove");
+        const JsonValue* path_value = set != fields.end() ? &set->second
+                                    : remove != fields.end() ? &remove->second : nullptr;
+        if (!path_value || !path_value->is_array()) return false;
+        const JsonArray& path = path_value->as_array();
+
+        if (path.empty()) {
+            if (set == fields.end() || !fields.count("value")) return false;
+            target = fields.at("value");
+            continue;
+        }
+
+        // Walk to the parent object of the last path component
+        JsonValue* node = &target;
+        for (size_t i = 0; i + 1 < path.size(); ++i) {
+            if (!path[i].is_string() || !node->is_object()) return false;
+            auto& members = std::get<JsonObject>(node->data);
+            auto child = members.find(path[i].as_string());
+            if (child == members.end()) return false;
+            node = &child->second;
+        }
+        if (!path.back().is_string() || !node->is_object()) return false;
+        auto& members = std::get<JsonObject>(node->data);
+        if (set != fields.end()) {
+            auto value = fields.find("value");
+            if (value == fields.end()) return false;
+            members[path.back().as_string()] = value->second;
+        } else {
+            members.erase(path.back().as_string());
+        }
+    }
+    return true;
+}
+
+} // namespace qc::io
@@ -0,0 +1,30 @@
+#ifndef JSON_DIFF_H
+#define JSON_DIFF_H
+
+#include "json_parser.h"
+
+namespace qc::io {
+
+// Structural diff and patch of JsonValue trees. A diff is an array of
+// operations, each addressed by a path of object member names from the root:
+//   {"set": [path...], "value": v}   create or replace the value at path
+//   {"remove": [path...]}            delete the member at path
+// Objects are diffed member by member; any other change replaces the value.
+class JsonDiff {
+public:
+    static JsonArray diff(const JsonValue& before, const JsonValue& after);
+    // Same, for values that sit at `at` inside a larger document
+    static JsonArray diff(const JsonValue& before, const JsonValue& after, const JsonArray& at);
+
+    // Applies `ops` in order; false if an operation does not fit `target`
+    static bool apply(JsonValue& target, const JsonArray& ops);
+
+    static bool equal(const JsonValue& a, const JsonValue& b);
+
+private:
+    static void diff_into(const JsonValue& before, const JsonValue& after, JsonArray& path, JsonArray& ops);
+};
+
+} // namespace qc::io
+
+#endif // JSON_DIFF_H
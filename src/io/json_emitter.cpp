@@ -0,0 +1,81 @@
+#include "json_emitter.h"
+#include <charconv>
+#include <cmath>
+
+namespace qc::io {
+
+std::string JsonEmitter::emit(const JsonValue& value) {
+    std::string out;
+    emit_to(out, value);
+    return out;
+}
+
+void JsonEmitter::emit_to(std::string& out, const JsonValue& value) {
+    if (value.is_null()) {
+        out += "null";
+    } else if (value.is_bool()) {
+        out += value.as_bool() ? "true" : "false";
+    } else if (value.is_number()) {
+        emit_number(out, value.as_number());
+    } else if (value.is_string()) {
+        emit_string(out, value.as_string());
+    } else if (value.is_array()) {
+        out += '[';
+        bool first = true;
+        for (const auto& item : value.as_array()) {
+            if (!first) out += ',';
+            first = false;
+            emit_to(out, item);
+        }
+        out += ']';
+    } else {
+        out += '{';
+        bool first = true;
+        for (const auto& [key, item] : value.as_object()) {
+            if (!first) out += ',';
+            first = false;
+            emit_string(out, key);
+            out += ':';
+            emit_to(out, item);
+        }
+        out += '}';
+    }
+}
+
+void JsonEmitter::emit_string(std::string& out, const std::string& s) {
+    static const char* HEX = "0123456789abcdef";
+    out += '"';
+    for (char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out += "\\u00";
+                    out += HEX[(c >> 4) & 0xF];
+                    out += HEX[c & 0xF];
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+void JsonEmitter::emit_number(std::string& out, double d) {
+    // JSON has no representation for NaN or infinity
+    if (!std::isfinite(d)) {
+        out += "null";
+        return;
+    }
+    char buf[32];
+    auto res = std::to_chars(buf, buf + sizeof(buf), d);
+    out.append(buf, res.ptr);
+}
+
+} // namespace qc::io
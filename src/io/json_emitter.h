@@ -0,0 +1,22 @@
+#ifndef JSON_EMITTER_H
+#define JSON_EMITTER_H
+
+#include "json_parser.h"
+#include <string>
+
+namespace qc::io {
+
+// Compact serialization of JsonValue; the output round-trips through JsonParser
+class JsonEmitter {
+public:
+    static std::string emit(const JsonValue& value);
+    static void emit_to(std::string& out, const JsonValue& value);
+
+private:
+    static void emit_string(std::string& out, const std::string& s);
+    static void emit_number(std::string& out, double d);
+};
+
+} // namespace qc::io
+
+#endif // JSON_EMITTER_H
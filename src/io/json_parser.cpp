@@ -146,6 +146,27 @@ std::variant<std::string, ParseError> JsonParser::parse_string(State& state) {
                 case 'n': s += '\n'; break;
                 case 'r': s += '\r'; break;
                 case 't': s += '\t'; break;
+                case 'u': {
+                    if (state.pos + 4 > state.input.size()) return state.error("Unexpected EOF in unicode escape");
+                    unsigned code = 0;
+                    auto res = std::from_chars(state.input.data() + state.pos, state.input.data() + state.pos + 4, code, 16);
+                    if (res.ec != std::errc{} || res.ptr != state.input.data() + state.pos + 4) {
+                        return state.error("Invalid unicode escape");
+                    }
+                    for (int i = 0; i < 4; ++i) state.consume();
+                    // Encode the code unit as UTF-8
+                    if (code < 0x80) {
+                        s += static_cast<char>(code);
+                    } else if (code < 0x800) {
+                        s += static_cast<char>(0xC0 | (code >> 6));
+                        s += static_cast<char>(0x80 | (code & 0x3F));
+                    } else {
+                        s += static_cast<char>(0xE0 | (code >> 12));
+                        s += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                        s += static_cast<char>(0x80 | (code & 0x3F));
+                    }
+                    break;
+                }
                 default: return state.error("Invalid escape sequence");
             }
         } else {
@@ -0,0 +1,170 @@
+#include "lz_codec.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace qc::io {
+
+namespace {
+
+const size_t MIN_MATCH = 4;
+const size_t MAX_OFFSET = 65535;
+const int HASH_BITS = 14;
+
+uint32_t read_u32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint32_t hash_sequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void put_varint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out += static_cast<char>((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    out += static_cast<char>(v);
+}
+
+bool get_varint(std::string_view in, size_t& pos, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size()) return false;
+        uint8_t byte = static_cast<uint8_t>(in[pos++]);
+        v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+void put_length(std::string& out, size_t extra) {
+    while (extra >= 255) {
+        out += static_cast<char>(255);
+        extra -= 255;
+    }
+    out += static_cast<char>(extra);
+}
+
+bool get_length(std::string_view in, size_t& pos, size_t& length) {
+    uint8_t byte;
+    do {
+        if (pos >= in.size()) return false;
+        byte = static_cast<uint8_t>(in[pos++]);
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+void emit_sequence(std::string& out, std::string_view literals, size_t offset, size_t match_length) {
+    size_t literal_nibble = literals.size() < 15 ? literals.size() : 15;
+    size_t match_code = match_length - MIN_MATCH;
+    size_t match_nibble = match_code < 15 ? match_code : 15;
+    out += static_cast<char>(literal_nibble << 4 | match_nibble);
+    if (literal_nibble == 15) put_length(out, literals.size() - 15);
+    out.append(literals.data(), literals.size());
+    out += static_cast<char>(offset & 0xFF);
+    out += static_cast<char>(offset >> 8);
+    if (match_nibble == 15) put_length(out, match_code - 15);
+}
+
+void emit_last_literals(std::string& out, std::string_view literals) {
+    size_t literal_nibble = literals.size() < 15 ? literals.size() : 15;
+    out += static_cast<char>(literal_nibble << 4);
+    if (literal_nibble == 15) put_length(out, literals.size() - 15);
+    out.append(literals.data(), literals.size());
+}
+
+} // namespace
+
+std::string LzCodec::compress(std::string_view input) {
+    std::string out;
+    out.reserve(input.size() / 2 + 16);
+    put_varint(out, input.size());
+    if (input.empty()) return out;
+
+    const char* data = input.data();
+    const size_t size = input.size();
+    std::vector<uint32_t> table(size_t{1} << HASH_BITS, 0); // Position + 1; 0 = empty
+    size_t anchor = 0;
+    size_t pos = 0;
+    size_t misses = 0;
+
+    while (pos + MIN_MATCH <= size) {
+        uint32_t sequence = read_u32(data + pos);
+        uint32_t& slot = table[hash_sequence(sequence)];
+        size_t candidate = slot;
+        slot = static_cast<uint32_t>(pos + 1);
+
+        if (candidate != 0 && pos - (candidate - 1) <= MAX_OFFSET && read_u32(data + candidate - 1) == sequence) {
+            size_t match = candidate - 1;
+            size_t length = MIN_MATCH;
+            while (pos + length < size && data[match + length] == data[pos + length]) ++length;
+
+            emit_sequence(out, input.substr(anchor, pos - anchor), pos - match, length);
+            pos += length;
+            anchor = pos;
+            misses = 0;
+            // Seed the table just before the resume point so runs chain
+            if (pos >= 2 && pos + MIN_MATCH <= size + 2) {
+                table[hash_sequence(read_u32(data + pos - 2))] = static_cast<uint32_t>(pos - 1);
+            }
+        } else {
+            // Step faster through incompressible stretches
+            pos += 1 + (misses++ >> 5);
+        }
+    }
+
+    emit_last_literals(out, input.substr(anchor));
+    return out;
+}
+
+std::optional<size_t> LzCodec::decompressed_size(std::string_view input) {
+    size_t pos = 0;
+    uint64_t size;
+    if (!get_varint(input, pos, size)) return std::nullopt;
+    return static_cast<size_t>(size);
+}
+
+std::optional<std::string> LzCodec::decompress(std::string_view input) {
+    size_t pos = 0;
+    uint64_t expected;
+    if (!get_varint(input, pos, expected)) return std::nullopt;
+    // Each input byte expands to at most 255 output bytes; reject sizes no
+    // stream of this length could produce before reserving for them
+    if (expected / 256 > input.size()) return std::nullopt;
+
+    std::string out;
+    out.reserve(expected);
+    while (pos < input.size()) {
+        uint8_t token = static_cast<uint8_t>(input[pos++]);
+        size_t literals = token >> 4;
+        if (literals == 15 && !get_length(input, pos, literals)) return std::nullopt;
+        if (literals > input.size() - pos || out.size() + literals > expected) return std::nullopt;
+        out.append(input.data() + pos, literals);
+        pos += literals;
+        if (pos == input.size()) break;
+
+        if (input.size() - pos < 2) return std::nullopt;
+        size_t offset = static_cast<uint8_t>(input[pos]) | static_cast<size_t>(static_cast<uint8_t>(input[pos + 1])) << 8;
+        pos += 2;
+        size_t length = token & 0x0F;
+        if (length == 15 && !get_length(input, pos, length)) return std::nullopt;
+        length += MIN_MATCH;
+        if (offset == 0 || offset > out.size() || out.size() + length > expected) return std::nullopt;
+
+        size_t from = out.size() - offset;
+        if (offset >= length) {
+            out.append(out, from, length);
+        } else {
+            // Overlapping copy repeats the last `offset` bytes
+            for (size_t i = 0; i < length; ++i) out += out[from + i];
+        }
+    }
+    if (out.size() != expected) return std::nullopt;
+    return out;
+}
+
+} // namespace qc::io
@@ -0,0 +1,33 @@
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace qc::io {
+
+// Byte-oriented LZ77 compression in the style of LZ4: greedy matching through
+// a small hash table, no entropy coding, so both directions run at memory
+// speed. Works well on JSON, where keys and ontology terms repeat.
+//
+// Format: LEB128 uncompressed size, then sequences of
+//   token (literal length << 4 | match length - 4), extra length bytes,
+//   literals, u16 little-endian match offset, extra match length bytes.
+// A length nibble of 15 continues in bytes of 255 until a smaller one. The
+// last sequence has literals only.
+class LzCodec {
+public:
+    static std::string compress(std::string_view input);
+
+    // nullopt if `input` is truncated or malformed
+    static std::optional<std::string> decompress(std::string_view input);
+
+    // Uncompressed size recorded in the header, without decoding
+    static std::optional<size_t> decompressed_size(std::string_view input);
+};
+
+} // namespace qc::io
+
+#endif // LZ_CODEC_H
@@ -1,6 +1,7 @@
 #ifndef MIDI_EXPORTER_H
 #define MIDI_EXPORTER_H
 
+#include "file_io.h"
 #include <vector>
 #include <string>
 #include <fstream>
@@ -67,6 +68,11 @@ public:
         return true;
     }
 
+    static std::future<bool> export_to_file(AsyncIO& io, const std::string& filename, const std::vector<MidiNote>& notes) {
+        auto buffer = export_to_buffer(notes);
+        return FileIO::write_atomic_async(io, filename, std::string(buffer.begin(), buffer.end()));
+    }
+
 private:
     static void write_u32_be(std::vector<uint8_t>& b, uint32_t v) {
         b.push_back((v >> 24) & 0xFF);
@@ -1,6 +1,7 @@
 #ifndef SVG_EXPORTER_H
 #define SVG_EXPORTER_H
 
+#include "file_io.h"
 #include <string>
 #include <vector>
 #include <sstream>
@@ -42,6 +43,10 @@ public:
         f << export_to_string(width, height, circles, lines);
         return true;
     }
+
+    static std::future<bool> export_to_file(AsyncIO& io, const std::string& filename, int width, int height, const std::vector<SvgCircle>& circles, const std::vector<SvgLine>& lines) {
+        return FileIO::write_atomic_async(io, filename, export_to_string(width, height, circles, lines));
+    }
 };
 
 } // namespace qc::io
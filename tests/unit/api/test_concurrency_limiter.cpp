@@ -0,0 +1,64 @@
+#include "api/concurrency_limiter.h"
+#include "utils/testing_framework.h"
+#include <vector>
+
+TEST_CASE(ConcurrencyLimiter, RejectsBeyondLimit) {
+    ConcurrencyLimiter::Config cfg;
+    cfg.initial_limit = 2;
+    ConcurrencyLimiter limiter(cfg);
+
+    auto p1 = limiter.try_acquire();
+    auto p2 = limiter.try_acquire();
+    auto p3 = limiter.try_acquire();
+    ASSERT_TRUE(p1.granted);
+    ASSERT_TRUE(p2.granted);
+    ASSERT_FALSE(p3.granted);
+    ASSERT_EQUAL(limiter.in_flight(), 2);
+
+    limiter.release(p1, ConcurrencyLimiter::Outcome::IGNORED);
+    limiter.release(p3, ConcurrencyLimiter::Outcome::IGNORED); // Not granted, no effect
+    ASSERT_EQUAL(limiter.in_flight(), 1);
+    ASSERT_TRUE(limiter.try_acquire().granted);
+}
+
+TEST_CASE(ConcurrencyLimiter, GrowsWhileLatencyIsStable) {
+    ConcurrencyLimiter::Config cfg;
+    cfg.initial_limit = 4;
+    ConcurrencyLimiter limiter(cfg);
+
+    for (int round = 0; round < 20; ++round) {
+        std::vector<ConcurrencyLimiter::Permit> permits;
+        for (int i = 0; i < limiter.limit(); ++i) permits.push_back(limiter.try_acquire());
+        for (const auto& p : permits) limiter.release(p, ConcurrencyLimiter::Outcome::SUCCESS, 10.0);
+    }
+    ASSERT_TRUE(limiter.limit() > 4);
+}
+
+TEST_CASE(ConcurrencyLimiter, ShrinksWhenLatencyInflates) {
+    ConcurrencyLimiter::Config cfg;
+    cfg.initial_limit = 20;
+    ConcurrencyLimiter limiter(cfg);
+
+    // Establish a baseline, then let latency climb well past the tolerance
+    auto warm = limiter.try_acquire();
+    limiter.release(warm, ConcurrencyLimiter::Outcome::SUCCESS, 10.0);
+    for (int round = 0; round < 10; ++round) {
+        std::vector<ConcurrencyLimiter::Permit> permits;
+        for (int i = 0; i < limiter.limit(); ++i) permits.push_back(limiter.try_acquire());
+        for (const auto& p : permits) limiter.release(p, ConcurrencyLimiter::Outcome::SUCCESS, 100.0);
+    }
+    ASSERT_TRUE(limiter.limit() < 20);
+}
+
+TEST_CASE(ConcurrencyLimiter, BacksOffOnDrops) {
+    ConcurrencyLimiter::Config cfg;
+    cfg.initial_limit = 10;
+    cfg.min_limit = 2;
+    ConcurrencyLimiter limiter(cfg);
+
+    for (int i = 0; i < 50; ++i) {
+        auto p = limiter.try_acquire();
+        limiter.release(p, ConcurrencyLimiter::Outcome::DROPPED);
+    }
+    ASSERT_EQUAL(limiter.limit(), 2);
+}
@@ -0,0 +1,111 @@
+#include "api/api_logic.h"
+#include "api/micro_batcher.h"
+#include "api/request_scheduler.h"
+#include "utils/testing_framework.h"
+#include <future>
+#include <vector>
+
+static JsonValue make_model_request(const std::string& model, const std::string& prompt) {
+    ApiConfig cfg{};
+    cfg.model = model;
+    cfg.prompt = prompt;
+    cfg.context = {{"system", "You are a neuroscience research assistant."},
+                   {"user", "We are investigating hippocampal LTP."}};
+    return build_request(cfg);
+}
+
+TEST_CASE(MicroBatcher, BatchMatchesIndividualCalls) {
+    std::vector<JsonValue> requests = {make_model_request("m", "first"), make_model_request("m", "second")};
+    requests[1].object_value["context"].array_value.pop_back();
+
+    std::vector<JsonValue> batched = simulate_api_batch(requests);
+    ASSERT_EQUAL(batched.size(), 2);
+    for (size_t i = 0; i < requests.size(); ++i) {
+        JsonValue single = simulate_api_call(requests[i]);
+        ASSERT_EQUAL(batched[i].serialize(), single.serialize());
+    }
+    ASSERT_EQUAL(batched[0].object_value["context_tokens"].number_value, 11);
+    ASSERT_EQUAL(batched[1].object_value["context_tokens"].number_value, 6);
+}
+
+TEST_CASE(MicroBatcher, AnswersMalformedRequestsAlone) {
+    JsonValue no_prompt = make_model_request("m", "dropped");
+    no_prompt.object_value.erase("prompt");
+    JsonValue wrong_prompt = make_model_request("m", "wrong");
+    wrong_prompt.object_value["prompt"] = JsonValue::makeNumber(7);
+    std::vector<JsonValue> requests = {make_model_request("m", "first"), no_prompt, wrong_prompt,
+                                       JsonValue::makeString("not a request"), make_model_request("m", "last")};
+
+    std::vector<JsonValue> responses = simulate_api_batch(requests);
+    ASSERT_EQUAL(responses.size(), 5);
+    for (size_t i : {1, 2, 3}) {
+        ASSERT_FALSE(responses[i].object_value["success"].bool_value);
+        ASSERT_EQUAL(responses[i].object_value["error"].object_value["code"].number_value, 400);
+    }
+    ASSERT_EQUAL(responses[0].serialize(), simulate_api_call(requests[0]).serialize());
+    ASSERT_EQUAL(responses[4].serialize(), simulate_api_call(requests[4]).serialize());
+
+    // Through the batcher, only the malformed request fails
+    MicroBatcher batcher;
+    auto good = batcher.submit(requests[0]);
+    auto bad = batcher.submit(no_prompt);
+    ASSERT_TRUE(good.get().object_value["success"].bool_value);
+    ASSERT_EQUAL(bad.get().object_value["error"].object_value["code"].number_value, 400);
+}
+
+TEST_CASE(MicroBatcher, GroupsRequestsByModel) {
+    std::mutex seen_mutex;
+    std::vector<size_t> batch_sizes;
+    bool mixed_models = false;
+
+    MicroBatcher::Config cfg;
+    cfg.max_batch_size = 4;
+    cfg.max_wait = std::chrono::milliseconds(50);
+    MicroBatcher batcher(cfg, [&](const std::vector<JsonValue>& batch) {
+        std::lock_guard<std::mutex> lock(seen_mutex);
+        batch_sizes.push_back(batch.size());
+        for (const auto& r : batch) {
+            if (r.object_value.at("model").string_value != batch.front().object_value.at("model").string_value) {
+                mixed_models = true;
+            }
+        }
+        return simulate_api_batch(batch);
+    });
+
+    std::vector<std::future<JsonValue>> results;
+    for (int i = 0; i < 3; ++i) {
+        results.push_back(batcher.submit(make_model_request("a", "a" + std::to_string(i))));
+        results.push_back(batcher.submit(make_model_request("b", "b" + std::to_string(i))));
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        JsonValue a = results[2 * i].get();
+        JsonValue b = results[2 * i + 1].get();
+        ASSERT_EQUAL(a.object_value["response"].string_value, "[SIMULATED RESPONSE] Based on prompt: a" + std::to_string(i));
+        ASSERT_EQUAL(b.object_value["response"].string_value, "[SIMULATED RESPONSE] Based on prompt: b" + std::to_string(i));
+    }
+
+    ASSERT_FALSE(mixed_models);
+    ASSERT_EQUAL(batcher.stats().requests, 6);
+    ASSERT_TRUE(batcher.stats().batches < 6);
+}
+
+TEST_CASE(MicroBatcher, RunsBatchesOnTheScheduler) {
+    RequestScheduler scheduler;
+    MicroBatcher::Config cfg;
+    cfg.scheduler = &scheduler;
+    MicroBatcher batcher(cfg);
+    JsonValue request = make_model_request("m", "scheduled");
+    ASSERT_EQUAL(batcher.submit(request).get().serialize(), simulate_api_call(request).serialize());
+
+    // A scheduler with no room answers every request of the batch with its 503
+    RequestScheduler::Config full;
+    full.interactive_capacity = 0;
+    RequestScheduler refusing(full);
+    cfg.scheduler = &refusing;
+    MicroBatcher refused(cfg);
+    auto first = refused.submit(request);
+    auto second = refused.submit(make_model_request("m", "other"));
+    ASSERT_EQUAL(first.get().object_value["error"].object_value["code"].number_value, 503);
+    ASSERT_EQUAL(second.get().object_value["error"].object_value["code"].number_value, 503);
+}
@@ -0,0 +1,101 @@
+#include "api/api_logic.h"
+#include "api/prefix_cache.h"
+#include "utils/testing_framework.h"
+
+static JsonValue make_message(const std::string& role, const std::string& content) {
+    JsonValue msg = JsonValue::makeObject();
+    msg.object_value["role"] = JsonValue::makeString(role);
+    msg.object_value["content"] = JsonValue::makeString(content);
+    return msg;
+}
+
+TEST_CASE(PrefixCache, ReusesLongestCachedPrefix) {
+    PrefixCache cache;
+    std::vector<JsonValue> context = {
+        make_message("system", "You are a neuroscience research assistant."),
+        make_message("user", "We are investigating hippocampal LTP.")
+    };
+
+    JsonValue first = cache.process(context);
+    JsonValue again = cache.process(context);
+    ASSERT_EQUAL(first.serialize(), again.serialize());
+    ASSERT_EQUAL(first.object_value["tokens"].number_value, 11);
+
+    context.push_back(make_message("user", "Focus on BDNF."));
+    JsonValue extended = cache.process(context);
+    ASSERT_EQUAL(extended.object_value["messages"].number_value, 3);
+    ASSERT_EQUAL(extended.object_value["tokens"].number_value, 14);
+
+    PrefixCache::Stats stats = cache.stats();
+    ASSERT_EQUAL(stats.misses, 1);
+    ASSERT_EQUAL(stats.hits, 1);
+    ASSERT_EQUAL(stats.partial_hits, 1);
+    ASSERT_EQUAL(stats.entries, 2);
+}
+
+TEST_CASE(PrefixCache, EvictsLeastRecentlyUsedUnderBudget) {
+    std::vector<JsonValue> a = {make_message("system", "alpha")};
+    std::vector<JsonValue> b = {make_message("system", "beta")};
+    std::vector<JsonValue> c = {make_message("system", "gamma")};
+
+    PrefixCache probe;
+    probe.process(a);
+    size_t entry_bytes = probe.stats().bytes;
+
+    PrefixCache cache(entry_bytes * 2);
+    cache.process(a);
+    cache.process(b);
+    cache.process(a); // a becomes most recently used
+    cache.process(c); // evicts b
+
+    ASSERT_EQUAL(cache.stats().evictions, 1);
+    ASSERT_TRUE(cache.stats().bytes <= entry_bytes * 2);
+    cache.process(a);
+    ASSERT_EQUAL(cache.stats().hits, 2);
+    cache.process(b);
+    ASSERT_EQUAL(cache.stats().misses, 4);
+}
+
+TEST_CASE(PrefixCache, CachedCallsMatchUncached) {
+    PrefixCache cache;
+    ApiConfig cfg{};
+    cfg.model = "m";
+    cfg.prompt = "Describe LTP.";
+    cfg.context = {{"system", "You are a research assistant."}, {"user", "Hippocampus."}};
+    JsonValue request = build_request(cfg);
+
+    std::string expected = simulate_api_call(request).serialize();
+    ASSERT_EQUAL(simulate_api_call(request, &cache).serialize(), expected);
+    ASSERT_EQUAL(simulate_api_call(request, &cache).serialize(), expected);
+    ASSERT_EQUAL(cache.stats().hits, 1);
+}
+
+TEST_CASE(PrefixCache, CountsOneLookupPerContextInABatch) {
+    PrefixCache cache;
+    std::vector<JsonValue> requests;
+    for (const char* question : {"Focus on BDNF.", "Focus on COMT.", "Focus on DRD2."}) {
+        ApiConfig cfg{};
+        cfg.model = "m";
+        cfg.prompt = question;
+        cfg.context = {{"system", "You are a research assistant."}, {"user", "Hippocampus."}, {"user", question}};
+        requests.push_back(build_request(cfg));
+    }
+
+    // The first context computes the shared prefix and keeps it; the
+    // others reuse it. Three contexts, three lookups.
+    std::vector<JsonValue> batched = simulate_api_batch(requests, &cache);
+    PrefixCache::Stats stats = cache.stats();
+    ASSERT_EQUAL(stats.misses, 1);
+    ASSERT_EQUAL(stats.partial_hits, 2);
+    ASSERT_EQUAL(stats.hits, 0);
+    ASSERT_EQUAL(stats.entries, 4);
+    for (size_t i = 0; i < requests.size(); ++i) {
+        ASSERT_EQUAL(batched[i].serialize(), simulate_api_call(requests[i]).serialize());
+    }
+
+    simulate_api_batch(requests, &cache);
+    stats = cache.stats();
+    ASSERT_EQUAL(stats.hits, 3);
+    ASSERT_EQUAL(stats.misses + stats.partial_hits, 3);
+    ASSERT_EQUAL(stats.entries, 4);
+}
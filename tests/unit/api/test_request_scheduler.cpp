@@ -0,0 +1,108 @@
+#include "api/api_handler.h"
+#include "api/request_scheduler.h"
+#include "utils/testing_framework.h"
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <vector>
+
+TEST_CASE(RequestScheduler, ClassifiesEndpoints) {
+    ASSERT_TRUE(classify_request("getGene") == RequestClass::INTERACTIVE);
+    ASSERT_TRUE(classify_request("getGeneSummary") == RequestClass::INTERACTIVE);
+    ASSERT_TRUE(classify_request("getResearchAssociations") == RequestClass::BULK);
+    ASSERT_TRUE(classify_request("getPolygeneticRiskScores") == RequestClass::BULK);
+}
+
+TEST_CASE(RequestScheduler, InteractiveOvertakesQueuedBulk) {
+    std::promise<void> gate;
+    std::shared_future<void> gate_open = gate.get_future().share();
+    std::mutex order_mutex;
+    std::vector<std::string> order;
+
+    RequestScheduler::Config cfg;
+    cfg.worker_count = 2;
+    RequestScheduler scheduler(cfg, [&](const std::string& endpoint, const JsonValue&) {
+        if (endpoint == "getPolygeneticRiskScores") gate_open.wait();
+        std::lock_guard<std::mutex> lock(order_mutex);
+        order.push_back(endpoint);
+        return JsonValue::makeBool(true);
+    });
+
+    auto blocker = scheduler.submit("getPolygeneticRiskScores", JsonValue::makeObject());
+    while (scheduler.queued(RequestClass::BULK) != 0) std::this_thread::yield();
+
+    // The lookup runs while the only bulk slot is held and bulk work queues
+    auto bulk1 = scheduler.submit("getResearchAssociations", JsonValue::makeObject());
+    auto bulk2 = scheduler.submit("getDrugGeneInteractions", JsonValue::makeObject());
+    auto lookup = scheduler.submit("getGene", JsonValue::makeObject());
+    ASSERT_TRUE(lookup.get().bool_value);
+    ASSERT_EQUAL(scheduler.queued(RequestClass::BULK), 2);
+    gate.set_value();
+
+    blocker.get(); bulk1.get(); bulk2.get();
+    ASSERT_EQUAL(order.size(), 4);
+    ASSERT_EQUAL(order[0], "getGene");
+    ASSERT_EQUAL(order[1], "getPolygeneticRiskScores");
+}
+
+TEST_CASE(RequestScheduler, KeepsAWorkerForInteractiveRequests) {
+    std::promise<void> gate;
+    std::shared_future<void> gate_open = gate.get_future().share();
+
+    // Neither a single worker nor a bulk cap at the worker count lets bulk
+    // work take every worker
+    RequestScheduler::Config cfg;
+    cfg.worker_count = 1;
+    cfg.max_bulk_workers = 1;
+    RequestScheduler scheduler(cfg, [&](const std::string& endpoint, const JsonValue&) {
+        if (is_broad_search_endpoint(endpoint)) gate_open.wait();
+        return JsonValue::makeBool(true);
+    });
+
+    auto bulk1 = scheduler.submit("getResearchAssociations", JsonValue::makeObject());
+    auto bulk2 = scheduler.submit("getPolygeneticRiskScores", JsonValue::makeObject());
+    auto lookup = scheduler.submit("getGene", JsonValue::makeObject());
+    ASSERT_TRUE(lookup.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    ASSERT_TRUE(lookup.get().bool_value);
+
+    // Work that is not an endpoint request queues the same way
+    auto other = scheduler.submit(RequestClass::INTERACTIVE, [] { return JsonValue::makeString("done"); });
+    ASSERT_EQUAL(other.get().string_value, "done");
+
+    gate.set_value();
+    ASSERT_TRUE(bulk1.get().bool_value);
+    ASSERT_TRUE(bulk2.get().bool_value);
+}
+
+TEST_CASE(RequestScheduler, RejectsWhenQueueIsFull) {
+    std::promise<void> gate;
+    std::shared_future<void> gate_open = gate.get_future().share();
+
+    RequestScheduler::Config cfg;
+    cfg.worker_count = 1;
+    cfg.bulk_capacity = 1;
+    RequestScheduler scheduler(cfg, [&](const std::string&, const JsonValue&) {
+        gate_open.wait();
+        return JsonValue::makeBool(true);
+    });
+
+    auto running = scheduler.submit("getResearchAssociations", JsonValue::makeObject());
+    while (scheduler.queued(RequestClass::BULK) != 0) std::this_thread::yield();
+    auto queued = scheduler.submit("getResearchAssociations", JsonValue::makeObject());
+    auto rejected = scheduler.submit("getResearchAssociations", JsonValue::makeObject());
+
+    JsonValue response = rejected.get();
+    ASSERT_EQUAL(response.object_value["success"].bool_value, false);
+    ASSERT_EQUAL(response.object_value["error"].object_value["code"].number_value, 503);
+
+    gate.set_value();
+    ASSERT_TRUE(running.get().bool_value);
+    ASSERT_TRUE(queued.get().bool_value);
+}
+
+TEST_CASE(RequestScheduler, SchedulesApiRequests) {
+    JsonValue response = schedule_api_request("getGene", JsonValue::makeObject()).get();
+    ASSERT_TRUE(response.object_value["success"].bool_value);
+    JsonValue refused = schedule_api_request("getResearchAssociations", JsonValue::makeObject()).get();
+    ASSERT_EQUAL(refused.object_value["error"].object_value["code"].number_value, 400);
+}
@@ -0,0 +1,198 @@
+#include "core/cache_manager.h"
+#include "core/memory_cache.h"
+#include "utils/testing_framework.h"
+#include <atomic>
+#include <filesystem>
+
+using namespace qc::core;
+namespace fs = std::filesystem;
+
+static std::string fresh_cache_dir(const std::string& name) {
+    fs::path dir = fs::temp_directory_path() / name;
+    fs::remove_all(dir);
+    return dir.string();
+}
+
+static qc::io::JsonValue gene_record(const std::string& gene, double score) {
+    qc::io::JsonObject obj;
+    obj["gene"] = qc::io::JsonValue{gene};
+    obj["score"] = qc::io::JsonValue{score};
+    return qc::io::JsonValue{obj};
+}
+
+TEST_CASE(CacheManager, RoundTripsJsonValues) {
+    std::string dir = fresh_cache_dir("qc_cache_manager");
+    CacheManager cache(dir);
+    cache.set("getGene:COMT", gene_record("COMT", 0.75));
+
+    auto hit = cache.get("getGene:COMT");
+    ASSERT_TRUE(hit.has_value());
+    ASSERT_EQUAL(hit->as_object().at("gene").as_string(), "COMT");
+    ASSERT_EQUAL(hit->as_object().at("score").as_number(), 0.75);
+    ASSERT_FALSE(cache.get("missing").has_value());
+    fs::remove_all(dir);
+}
+
+TEST_CASE(CacheManager, WriteBehindCoalescesAndFlushes) {
+    std::string dir = fresh_cache_dir("qc_cache_write_behind");
+    CacheManager::Options options;
+    options.flush_interval = std::chrono::milliseconds(10000); // Only flush() writes
+    {
+        CacheManager cache(dir, options);
+        for (int i = 0; i < 100; ++i) cache.set("COMT", gene_record("COMT", i));
+        cache.set("HTR2A", gene_record("HTR2A", 1));
+        cache.remove("HTR2A");
+
+        ASSERT_EQUAL(cache.get("COMT")->as_object().at("score").as_number(), 99.0);
+        ASSERT_FALSE(cache.get("HTR2A").has_value());
+        ASSERT_EQUAL(cache.stats().disk.keys, 0);
+
+        cache.flush();
+        CacheManager::Stats stats = cache.stats();
+        ASSERT_EQUAL(stats.disk.keys, 1);
+        ASSERT_EQUAL(stats.pending_writes, 0);
+        ASSERT_EQUAL(stats.coalesced_writes, 100);
+
+        cache.set("BDNF", gene_record("BDNF", 2)); // Persisted by the destructor
+    }
+
+    CacheManager reopened(dir);
+    ASSERT_EQUAL(reopened.get("COMT")->as_object().at("score").as_number(), 99.0);
+    ASSERT_EQUAL(reopened.get("BDNF")->as_object().at("gene").as_string(), "BDNF");
+    ASSERT_FALSE(reopened.get("HTR2A").has_value());
+    fs::remove_all(dir);
+}
+
+TEST_CASE(CacheManager, ServesEvictedKeysFromDisk) {
+    std::string dir = fresh_cache_dir("qc_cache_two_tier");
+    CacheManager::Options options;
+    options.memory_budget_bytes = 4096;
+    options.memory_shards = 1;
+    CacheManager cache(dir, options);
+    for (int i = 0; i < 200; ++i) cache.set("gene" + std::to_string(i), gene_record("G", i));
+
+    // Early keys fell out of memory but are still served from pending writes or disk
+    ASSERT_EQUAL(cache.get("gene0")->as_object().at("score").as_number(), 0.0);
+    cache.flush();
+    ASSERT_EQUAL(cache.get("gene1")->as_object().at("score").as_number(), 1.0);
+    ASSERT_TRUE(cache.stats().memory.evictions > 0);
+    ASSERT_TRUE(cache.stats().memory.bytes <= 4096);
+    fs::remove_all(dir);
+}
+
+TEST_CASE(CacheManager, RemoveChecksPresenceWithoutReading) {
+    std::string dir = fresh_cache_dir("qc_cache_remove");
+    {
+        CacheManager cache(dir);
+        cache.set("COMT", gene_record("COMT", 1));
+        cache.set("BDNF", gene_record("BDNF", 2));
+    }
+
+    CacheManager cache(dir);
+    ASSERT_TRUE(cache.remove("COMT")); // Only on disk
+    ASSERT_FALSE(cache.remove("COMT")); // Removal still pending
+    ASSERT_FALSE(cache.remove("HTR2A"));
+    cache.set("DRD2", gene_record("DRD2", 3));
+    ASSERT_TRUE(cache.remove("DRD2"));
+
+    // Nothing was read from disk into memory, or counted as a lookup
+    MemoryCache::Stats memory = cache.stats().memory;
+    ASSERT_EQUAL(memory.entries, 0);
+    ASSERT_EQUAL(memory.hits + memory.misses, 0);
+    ASSERT_EQUAL(cache.get("BDNF")->as_object().at("score").as_number(), 2.0);
+    fs::remove_all(dir);
+}
+
+TEST_CASE(MemoryCache, EvictsLeastRecentlyUsed) {
+    auto value = std::make_shared<const qc::io::JsonValue>(qc::io::JsonValue{std::string("x")});
+    size_t entry = 1 + MemoryCache::estimate_size(*value) + 64;
+    MemoryCache cache(entry * 2, 1);
+    cache.put("a", value);
+    cache.put("b", value);
+    ASSERT_TRUE(cache.get("a") != nullptr); // a becomes most recently used
+    cache.put("c", value);
+
+    ASSERT_TRUE(cache.get("a") != nullptr);
+    ASSERT_TRUE(cache.get("b") == nullptr);
+    ASSERT_TRUE(cache.get("c") != nullptr);
+    ASSERT_EQUAL(cache.stats().evictions, 1);
+}
+
+TEST_CASE(CacheManager, ExpiresEntriesByTtl) {
+    std::string dir = fresh_cache_dir("qc_cache_ttl");
+    auto clock = std::make_shared<std::atomic<int64_t>>(1000);
+    CacheManager::Options options;
+    options.ttl = std::chrono::seconds(60);
+    options.clock = [clock] { return clock->load(); };
+    {
+        CacheManager cache(dir, options);
+        cache.set("COMT", gene_record("COMT", 1));
+        cache.set("HTR2A", gene_record("HTR2A", 2), std::chrono::seconds(0)); // Never expires
+        cache.flush();
+
+        *clock = 1059;
+        ASSERT_TRUE(cache.get("COMT").has_value());
+        *clock = 1060;
+        ASSERT_FALSE(cache.get("COMT").has_value());
+
+        cache.sweep();
+        CacheManager::Stats stats = cache.stats();
+        ASSERT_EQUAL(stats.expired_entries, 1);
+        ASSERT_EQUAL(stats.disk.keys, 1);
+        ASSERT_TRUE(cache.get("HTR2A").has_value());
+        cache.set("BDNF", gene_record("BDNF", 3)); // Expires at 1120
+    }
+
+    // Expiry times are stored with the records
+    CacheManager reopened(dir, options);
+    ASSERT_TRUE(reopened.get("BDNF").has_value());
+    *clock = 1200;
+    ASSERT_FALSE(reopened.get("BDNF").has_value());
+    reopened.sweep();
+    ASSERT_EQUAL(reopened.stats().disk.keys, 1);
+    ASSERT_TRUE(reopened.get("HTR2A").has_value());
+    fs::remove_all(dir);
+}
+
+TEST_CASE(CacheManager, EvictsLeastRecentlyUsedOverDiskBudget) {
+    std::string dir = fresh_cache_dir("qc_cache_budget");
+    CacheManager::Options options;
+    options.max_disk_bytes = 400;
+    CacheManager cache(dir, options);
+    for (int i = 0; i < 20; ++i) {
+        cache.set("gene" + std::to_string(i), gene_record("G", i));
+        if (i >= 1) cache.get("gene0"); // Keep gene0 hot
+        cache.flush();
+    }
+    cache.sweep();
+
+    CacheManager::Stats stats = cache.stats();
+    ASSERT_TRUE(stats.tracked_bytes <= 400);
+    ASSERT_TRUE(stats.evicted_entries > 0);
+    ASSERT_TRUE(cache.get("gene0").has_value());
+    ASSERT_TRUE(cache.get("gene19").has_value());
+    ASSERT_FALSE(cache.get("gene1").has_value());
+    fs::remove_all(dir);
+}
+
+TEST_CASE(CacheManager, ParsesSizes) {
+    ASSERT_EQUAL(*CacheManager::parse_size("1GB"), 1073741824ull);
+    ASSERT_EQUAL(*CacheManager::parse_size("500 MB"), 524288000ull);
+    ASSERT_EQUAL(*CacheManager::parse_size("1.5kb"), 1536ull);
+    ASSERT_EQUAL(*CacheManager::parse_size("4096"), 4096ull);
+    ASSERT_FALSE(CacheManager::parse_size("lots").has_value());
+    ASSERT_FALSE(CacheManager::parse_size("10 parsecs").has_value());
+}
+
+TEST_CASE(CacheManager, DeduplicatesIdenticalResponses) {
+    std::string dir = fresh_cache_dir("qc_cache_dedup");
+    CacheManager cache(dir);
+    for (int i = 0; i < 20; ++i) cache.set("getGene:COMT:" + std::to_string(i), gene_record("COMT", 0.5));
+    cache.flush();
+
+    CacheManager::Stats stats = cache.stats();
+    ASSERT_EQUAL(stats.disk.keys, 20);
+    ASSERT_EQUAL(stats.disk.blobs, 1);
+    ASSERT_EQUAL(cache.get("getGene:COMT:13")->as_object().at("gene").as_string(), "COMT");
+    fs::remove_all(dir);
+}
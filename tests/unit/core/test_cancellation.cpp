@@ -0,0 +1,47 @@
+#include "core/cancellation.h"
+#include "utils/testing_framework.h"
+
+using namespace qc::core;
+
+TEST_CASE(Cancellation, RunsCallbacksOnce) {
+    CancellationSource source;
+    CancellationToken token = source.token();
+    int calls = 0;
+    uint64_t removed = token.on_cancel([&] { calls += 100; });
+    token.on_cancel([&] { calls++; });
+    token.remove_callback(removed);
+    ASSERT_FALSE(token.cancelled());
+
+    ASSERT_TRUE(source.cancel("stop"));
+    ASSERT_FALSE(source.cancel("again"));
+    ASSERT_EQUAL(calls, 1);
+    ASSERT_TRUE(token.cancelled());
+    ASSERT_EQUAL(token.reason(), "stop");
+
+    // Registering late runs the callback immediately
+    ASSERT_EQUAL(token.on_cancel([&] { calls++; }), 0);
+    ASSERT_EQUAL(calls, 2);
+    ASSERT_FALSE(CancellationToken().cancelled());
+}
+
+TEST_CASE(Cancellation, PropagatesFromParentToChildren) {
+    CancellationSource workflow;
+    CancellationSource operation(workflow.token());
+    int calls = 0;
+    operation.token().on_cancel([&] { calls++; });
+    {
+        CancellationSource finished(workflow.token()); // Unregisters when destroyed
+        finished.token().on_cancel([&] { calls += 100; });
+    }
+
+    // Cancelling a child leaves the parent alone
+    CancellationSource other(workflow.token());
+    other.cancel("deadline");
+    ASSERT_FALSE(workflow.token().cancelled());
+
+    workflow.cancel("workflow timed out");
+    ASSERT_EQUAL(calls, 1);
+    ASSERT_EQUAL(operation.token().reason(), "workflow timed out");
+    ASSERT_EQUAL(other.token().reason(), "deadline");
+    ASSERT_TRUE(CancellationSource(workflow.token()).token().cancelled());
+}
@@ -0,0 +1,57 @@
+#include "core/compiled_template.h"
+#include "core/flexible_json_logic.h"
+#include "utils/testing_framework.h"
+#include <cstdlib>
+
+using namespace qc::core;
+
+TEST_CASE(CompiledTemplate, SplitsIntoSegments) {
+    CompiledTemplate compiled("genes for ${INPUT:condition} (${CONFIG:limit|10}) ${EXTRACT:a.b}${}${plain} ${open");
+    const auto& segments = compiled.segments();
+    ASSERT_EQUAL(segments.size(), 7);
+    ASSERT_TRUE(segments[0].kind == CompiledTemplate::Kind::LITERAL);
+    ASSERT_EQUAL(segments[0].text, "genes for ");
+    ASSERT_TRUE(segments[1].kind == CompiledTemplate::Kind::INPUT);
+    ASSERT_EQUAL(segments[1].name, "condition");
+    ASSERT_TRUE(segments[3].kind == CompiledTemplate::Kind::CONFIG);
+    ASSERT_EQUAL(segments[3].name, "limit");
+    ASSERT_EQUAL(segments[3].fallback, "10");
+    ASSERT_TRUE(segments[5].kind == CompiledTemplate::Kind::OTHER);
+    ASSERT_EQUAL(segments[5].text, "EXTRACT:a.b");
+    // Text that is not a placeholder stays literal, merged into one segment
+    ASSERT_EQUAL(segments[6].text, "${}${plain} ${open");
+
+    ASSERT_TRUE(CompiledTemplate("${REF:genes}").is_single_placeholder());
+    ASSERT_FALSE(CompiledTemplate("${REF:genes}s").is_single_placeholder());
+    ASSERT_FALSE(CompiledTemplate("no placeholders").has_placeholders());
+}
+
+TEST_CASE(CompiledTemplate, ResolvesInOnePass) {
+    FlexibleJsonValue resolver;
+    std::map<std::string, std::string> context{{"condition", "${INPUT:condition}"}, {"limit", "25"}};
+    ASSERT_EQUAL(resolver.resolveTemplate("${INPUT:condition}/${CONFIG:limit|10}/${CONFIG:page|1}", context),
+                 "${INPUT:condition}/25/1"); // Substituted text is not resolved again
+    ASSERT_EQUAL(resolver.resolveTemplate("${INPUT:missing}${EXTRACT:a}${CALC:1+1}.", context), "2.");
+    ASSERT_EQUAL(resolver.resolveTemplate("${plain}", context), "${plain}");
+
+    std::string many;
+    for (int i = 0; i < 2000; ++i) many += "${CONFIG:limit}";
+    ASSERT_EQUAL(resolver.resolveTemplate(many, context).size(), 4000);
+}
+
+TEST_CASE(CompiledTemplate, CachesTemplatesAndEnvironment) {
+    CompiledTemplate::clear_cache();
+    setenv("QC_TEMPLATE_TEST", "first", 1);
+    auto compiled = CompiledTemplate::get("key=${ENV:QC_TEMPLATE_TEST}${ENV:QC_TEMPLATE_UNSET}");
+    ASSERT_TRUE(CompiledTemplate::get("key=${ENV:QC_TEMPLATE_TEST}${ENV:QC_TEMPLATE_UNSET}") == compiled);
+    ASSERT_EQUAL(CompiledTemplate::cached_templates(), 1);
+    ASSERT_EQUAL(compiled->render({}), "key=first");
+
+    // Later templates share the cached variable until the cache is cleared
+    setenv("QC_TEMPLATE_TEST", "second", 1);
+    ASSERT_EQUAL(CompiledTemplate::get("${ENV:QC_TEMPLATE_TEST}")->render({}), "first");
+    CompiledTemplate::clear_cache();
+    ASSERT_EQUAL(CompiledTemplate::get("${ENV:QC_TEMPLATE_TEST}")->render({}), "second");
+    ASSERT_EQUAL(compiled->render({}), "key=first"); // Still usable after being dropped
+    unsetenv("QC_TEMPLATE_TEST");
+}
@@ -0,0 +1,149 @@
+#include "core/connection_pool.h"
+#include "utils/testing_framework.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace qc::core;
+using namespace std::chrono_literals;
+
+namespace {
+
+struct Connection {
+    int id = 0;
+    bool healthy = true;
+};
+
+// Opens numbered connections and counts the checks they get
+struct Server {
+    std::atomic<int> opened{0};
+    std::atomic<int> checks{0};
+    std::atomic<bool> down{false};
+
+    ConnectionPool<Connection>::Open open() {
+        return [this]() -> std::unique_ptr<Connection> {
+            if (down) return nullptr;
+            auto connection = std::make_unique<Connection>();
+            connection->id = ++opened;
+            return connection;
+        };
+    }
+    ConnectionPool<Connection>::Check check() {
+        return [this](Connection& connection) {
+            ++checks;
+            return connection.healthy;
+        };
+    }
+};
+
+} // namespace
+
+TEST_CASE(ConnectionPool, ReusesConnectionsWithinBounds) {
+    Server server;
+    ConnectionPool<Connection>::Options options;
+    options.min_connections = 2;
+    options.max_connections = 3;
+    options.acquire_timeout = 50ms;
+    ConnectionPool<Connection> pool(server.open(), server.check(), options);
+    ASSERT_EQUAL(server.opened.load(), 2);
+    ASSERT_EQUAL(pool.stats().idle, 2);
+
+    // The one returned last goes out first, and recently used ones are not checked
+    int id = 0;
+    {
+        auto lease = pool.acquire();
+        ASSERT_TRUE(static_cast<bool>(lease));
+        id = lease->id;
+    }
+    ASSERT_EQUAL(pool.acquire()->id, id);
+    ASSERT_EQUAL(server.checks.load(), 0);
+
+    {
+        auto a = pool.acquire();
+        auto b = pool.acquire();
+        auto c = pool.acquire();
+        ASSERT_EQUAL(server.opened.load(), 3);
+        ASSERT_EQUAL(pool.stats().open, 3);
+        ASSERT_FALSE(static_cast<bool>(pool.try_acquire())); // Does not wait
+        auto started = std::chrono::steady_clock::now();
+        ASSERT_FALSE(static_cast<bool>(pool.acquire())); // At the bound, and nothing comes back
+        ASSERT_TRUE(std::chrono::steady_clock::now() - started >= 50ms);
+    }
+    ASSERT_EQUAL(pool.stats().idle, 3);
+
+    // A waiting caller gets the next connection returned
+    ConnectionPool<Connection>::Options patient = options;
+    patient.max_connections = 1;
+    patient.acquire_timeout = 5s;
+    ConnectionPool<Connection> small(server.open(), server.check(), patient);
+    auto held = small.acquire();
+    int held_id = held->id;
+    std::thread returner([&] {
+        std::this_thread::sleep_for(20ms);
+        held = ConnectionPool<Connection>::Lease();
+    });
+    auto next = small.acquire();
+    returner.join();
+    ASSERT_TRUE(static_cast<bool>(next));
+    ASSERT_EQUAL(next->id, held_id);
+}
+
+TEST_CASE(ConnectionPool, ReplacesBrokenConnections) {
+    Server server;
+    ConnectionPool<Connection>::Options options;
+    options.min_connections = 1;
+    options.max_connections = 2;
+    options.check_after = 0ms; // Check on every reuse
+    ConnectionPool<Connection> pool(server.open(), server.check(), options);
+
+    {
+        auto lease = pool.acquire();
+        ASSERT_EQUAL(server.checks.load(), 1);
+        lease->healthy = false;
+    }
+    auto lease = pool.acquire(); // The broken one fails its check and is replaced
+    ASSERT_EQUAL(lease->id, 2);
+    ASSERT_EQUAL(pool.stats().discarded, 1);
+    ASSERT_EQUAL(pool.stats().open, 1);
+
+    lease.discard();
+    ASSERT_FALSE(static_cast<bool>(lease));
+    ASSERT_EQUAL(pool.stats().open, 0);
+    ASSERT_EQUAL(pool.stats().discarded, 2);
+
+    server.down = true;
+    ASSERT_FALSE(static_cast<bool>(pool.acquire()));
+    ASSERT_EQUAL(pool.stats().open, 0);
+    server.down = false;
+    ASSERT_EQUAL(pool.acquire()->id, 3);
+}
+
+TEST_CASE(ConnectionPool, SharesConnectionsAcrossThreads) {
+    Server server;
+    ConnectionPool<Connection>::Options options;
+    options.min_connections = 0;
+    options.max_connections = 3;
+    ConnectionPool<Connection> pool(server.open(), server.check(), options);
+
+    std::atomic<int> in_use{0};
+    std::atomic<int> peak{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 50; ++i) {
+                auto lease = pool.acquire();
+                if (!lease) continue;
+                int now = ++in_use;
+                for (int seen = peak; now > seen && !peak.compare_exchange_weak(seen, now);) {}
+                std::this_thread::yield();
+                --in_use;
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    ASSERT_TRUE(peak.load() <= 3);
+    ASSERT_TRUE(server.opened.load() <= 3);
+    ASSERT_EQUAL(pool.stats().idle, pool.stats().open);
+}
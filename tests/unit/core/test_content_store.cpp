@@ -0,0 +1,130 @@
+#include "core/content_store.h"
+#include "core/digest.h"
+#include "utils/testing_framework.h"
+#include <filesystem>
+
+using namespace qc::core;
+namespace fs = std::filesystem;
+
+static std::string fresh_store_dir(const std::string& name) {
+    fs::path dir = fs::temp_directory_path() / name;
+    fs::remove_all(dir);
+    return dir.string();
+}
+
+static std::string ontology_terms() {
+    std::string terms;
+    for (int i = 0; i < 500; ++i) terms += "GO:00" + std::to_string(40000 + i) + " synaptic signaling;";
+    return terms;
+}
+
+TEST_CASE(ContentStore, StoresIdenticalValuesOnce) {
+    std::string dir = fresh_store_dir("qc_content_store_dedup");
+    std::string terms = ontology_terms();
+    {
+        ContentStore store(dir);
+        for (int i = 0; i < 50; ++i) ASSERT_TRUE(store.put("gene" + std::to_string(i), terms));
+        ASSERT_TRUE(store.put("other", "unique"));
+
+        ContentStore::Stats stats = store.stats();
+        ASSERT_EQUAL(stats.keys, 51);
+        ASSERT_EQUAL(stats.blobs, 2);
+        ASSERT_EQUAL(stats.deduplicated_writes, 49);
+        ASSERT_TRUE(stats.stored_bytes * 50 < stats.logical_bytes);
+        ASSERT_EQUAL(*store.get("gene7", 0), terms);
+    }
+
+    ContentStore reopened(dir);
+    ASSERT_EQUAL(reopened.stats().blobs, 2);
+    ASSERT_EQUAL(*reopened.get("gene49", 0), terms);
+    fs::remove_all(dir);
+}
+
+TEST_CASE(ContentStore, ReleasesBlobsWithLastReference) {
+    std::string dir = fresh_store_dir("qc_content_store_refs");
+    ContentStore store(dir);
+    store.put("a", "shared value");
+    store.put("b", "shared value");
+    store.remove("a");
+    ASSERT_EQUAL(store.stats().blobs, 1);
+    ASSERT_EQUAL(*store.get("b", 0), "shared value");
+
+    store.put("b", "new value"); // Overwrite drops the last reference
+    ASSERT_EQUAL(store.stats().blobs, 1);
+    store.put("c", "expiring", 100);
+    ASSERT_EQUAL(store.expire({"b", "c"}, 100).size(), 1);
+    ASSERT_EQUAL(store.stats().blobs, 1);
+    ASSERT_FALSE(store.get("c", 0).has_value());
+    store.remove("b");
+    ASSERT_EQUAL(store.stats().blobs, 0);
+    ASSERT_EQUAL(store.stored_bytes(), 0);
+    fs::remove_all(dir);
+}
+
+TEST_CASE(ContentStore, DropsDanglingRecordsOnOpen) {
+    std::string dir = fresh_store_dir("qc_content_store_dangling");
+    {
+        LogStore log(dir);
+        log.put("legacy-key", "{}");                              // Pre-content-addressing entry
+        log.put("k/orphan", std::string(ContentStore::DIGEST_SIZE, 'x')); // Blob never written
+        log.put("b/" + ContentStore::digest("lost"), std::string("\0lost", 5)); // No key refers to it
+    }
+    {
+        ContentStore store(dir);
+        ContentStore::Stats stats = store.stats();
+        ASSERT_EQUAL(stats.keys, 0);
+        ASSERT_EQUAL(stats.blobs, 0);
+    }
+    ASSERT_EQUAL(LogStore(dir).stats().keys, 0);
+    fs::remove_all(dir);
+}
+
+TEST_CASE(ContentStore, WorksOverFilePerKeyBackend) {
+    std::string dir = fresh_store_dir("qc_content_store_files");
+    ContentStore::Options options;
+    options.backend = ContentStore::Options::Backend::FILE_PER_KEY;
+    {
+        ContentStore store(dir, options);
+        store.put("getGene:COMT", "catechol");
+        store.put("getGene:COMT/alias", "catechol");
+        ASSERT_EQUAL(store.stats().blobs, 1);
+    }
+    ContentStore reopened(dir, options);
+    ASSERT_EQUAL(*reopened.get("getGene:COMT/alias", 0), "catechol");
+    ASSERT_EQUAL(reopened.stats().keys, 2);
+    fs::remove_all(dir);
+}
+
+TEST_CASE(ContentStore, RefusesValuesThatOnlyShareADigest) {
+    std::string dir = fresh_store_dir("qc_content_store_collision");
+    std::string id = ContentStore::digest("catechol");
+    {
+        // Stand-ins for colliding values: stored under the digest of another
+        LogStore log(dir);
+        log.put("b/" + id, std::string("\0catecho!", 9));
+        log.put("k/same-size", id);
+    }
+    {
+        ContentStore store(dir);
+        ASSERT_FALSE(store.put("getGene:COMT", "catechol"));
+        ASSERT_FALSE(store.put("same-size", "catechol"));
+        ASSERT_EQUAL(*store.get("same-size", 0), "catecho!");
+        ASSERT_FALSE(store.get("getGene:COMT", 0).has_value());
+        ASSERT_EQUAL(store.stats().deduplicated_writes, 0);
+        store.clear();
+    }
+    {
+        LogStore log(dir);
+        log.put("b/" + id, std::string("\0dopamine!", 10));
+        log.put("k/longer", id);
+    }
+    ContentStore store(dir);
+    ASSERT_FALSE(store.put("getGene:COMT", "catechol"));
+    ASSERT_EQUAL(*store.get("longer", 0), "dopamine!");
+    fs::remove_all(dir);
+}
+
+TEST_CASE(ContentStore, DigestsAreTheSameOnEveryHost) {
+    // Blob records are named by digest, so a store must open on any host
+    ASSERT_EQUAL(hex_encode(ContentStore::digest("catechol-O-methyltransferase")), "5733749adf91d6f112e6b1d5cd2f541a");
+}
@@ -0,0 +1,253 @@
+#include "core/flexible_json_logic.h"
+#include "core/database.h"
+#include "core/json_bridge.h"
+#include "io/json_parser.h"
+#include "utils/testing_framework.h"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace qc::core;
+
+namespace {
+
+JsonValue parse(const char* text) {
+    return from_io(std::get<qc::io::JsonValue>(qc::io::JsonParser::parse(text)));
+}
+
+// An in-process stand-in for the genomics database: one table of genes
+// keyed by symbol, and counts of what the driver was asked to do
+struct GenomicsDb {
+    std::map<std::string, std::string> genes{{"COMT", "22q11.21"}, {"BDNF", "11p14.1"}, {"DRD2", "11q23.2"}};
+    std::atomic<int> connects{0};
+    std::atomic<int> prepares{0};
+    std::atomic<int> executions{0};
+    std::atomic<int> bound{0};
+    std::atomic<int> nulls{0};
+    std::atomic<bool> stalled{false}; // Executions wait until it clears
+    std::atomic<int> waiting{0};
+    std::atomic<bool> drop_next{false}; // The next execution loses its connection
+};
+
+class StandInConnection : public DatabaseConnection {
+public:
+    explicit StandInConnection(GenomicsDb& db) : db_(db) { ++db_.connects; }
+
+    class Select : public Statement {
+    public:
+        Select(GenomicsDb& db, StandInConnection& connection) : db_(db), connection_(connection) {}
+
+        JsonValue execute(const std::vector<std::vector<Value>>& batch, std::chrono::milliseconds) override {
+            ++db_.executions;
+            if (db_.stalled) {
+                ++db_.waiting;
+                while (db_.stalled) std::this_thread::yield();
+                --db_.waiting;
+            }
+            if (db_.drop_next.exchange(false)) {
+                connection_.alive_ = false;
+                throw std::runtime_error("connection lost");
+            }
+            JsonValue rows = JsonValue::makeArray();
+            for (const auto& parameters : batch) {
+                ++db_.bound;
+                if (!parameters.at(0)) {
+                    ++db_.nulls;
+                    continue;
+                }
+                auto gene = db_.genes.find(*parameters.at(0));
+                if (gene == db_.genes.end()) continue;
+                JsonValue row = JsonValue::makeObject();
+                row.object_value["symbol"] = JsonValue::makeString(gene->first);
+                row.object_value["location"] = JsonValue::makeString(gene->second);
+                rows.array_value.push_back(row);
+            }
+            return rows;
+        }
+
+    private:
+        GenomicsDb& db_;
+        StandInConnection& connection_;
+    };
+
+    std::unique_ptr<Statement> prepare(const std::string& sql) override {
+        if (sql.rfind("SELECT", 0) != 0) throw std::runtime_error("syntax error near '" + sql + "'");
+        ++db_.prepares;
+        return std::make_unique<Select>(db_, *this);
+    }
+    bool ping() override { return alive_; }
+
+private:
+    GenomicsDb& db_;
+    bool alive_ = true;
+};
+
+DatabaseDataSource::Connector connector(GenomicsDb& db) {
+    return [&db](const std::string& target) -> std::unique_ptr<DatabaseConnection> {
+        if (target != "./data/genomics.db") return nullptr;
+        return std::make_unique<StandInConnection>(db);
+    };
+}
+
+const char* CONFIG = R"({
+  "type": "sqlite",
+  "connection_string": "./data/genomics.db",
+  "connection_pool": {"min_connections": 1, "max_connections": 2, "connection_timeout": 1},
+  "query_timeout": 60,
+  "statement_cache_size": 2,
+  "queries": {
+    "getGene": {"sql": "SELECT * FROM genes WHERE symbol = ?", "parameters": ["gene"]},
+    "getGenes": {"sql": "SELECT * FROM genes WHERE symbol = ? AND build = ?", "parameters": ["genes", "build"]},
+    "getGeneAgain": {"sql": "SELECT symbol, location FROM genes WHERE symbol = ?", "parameters": ["gene"]},
+    "getGeneOnceMore": {"sql": "SELECT location FROM genes WHERE symbol = ?", "parameters": ["gene"]},
+    "broken": "DROP TABLE genes"
+  }
+})";
+
+} // namespace
+
+TEST_CASE(StatementCache, KeepsTheMostRecentlyUsed) {
+    GenomicsDb db;
+    StandInConnection connection(db);
+    StatementCache cache(2);
+    auto& first = cache.get(connection, "SELECT 1");
+    ASSERT_TRUE(&cache.get(connection, "SELECT 1") == &first);
+    cache.get(connection, "SELECT 2");
+    cache.get(connection, "SELECT 1");
+    cache.get(connection, "SELECT 3"); // Closes SELECT 2, the least recently used
+    ASSERT_EQUAL(cache.size(), 2);
+    ASSERT_EQUAL(cache.prepared(), 3);
+    ASSERT_TRUE(&cache.get(connection, "SELECT 1") == &first);
+    cache.get(connection, "SELECT 2");
+    ASSERT_EQUAL(db.prepares.load(), 4);
+
+    bool threw = false;
+    try {
+        cache.get(connection, "DELETE FROM genes");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+    ASSERT_EQUAL(cache.size(), 2);
+}
+
+TEST_CASE(DatabaseDataSource, PoolsConnectionsAndStatements) {
+    GenomicsDb db;
+    DatabaseDataSource source(parse(CONFIG), connector(db));
+    ASSERT_TRUE(source.isAvailable());
+    ASSERT_TRUE(source.healthCheck());
+    ASSERT_EQUAL(db.connects.load(), 1);
+
+    // Repeated queries pay for neither a connection nor a prepare
+    for (int i = 0; i < 5; ++i) {
+        JsonValue rows = source.execute("getGene", parse(R"({"gene": "COMT"})"));
+        ASSERT_EQUAL(rows.array_value.size(), 1);
+        ASSERT_EQUAL(rows.array_value[0].object_value["location"].string_value, "22q11.21");
+    }
+    ASSERT_EQUAL(db.connects.load(), 1);
+    ASSERT_EQUAL(db.prepares.load(), 1);
+    ASSERT_EQUAL(db.executions.load(), 5);
+
+    // A gene list binds one run per gene in a single execution; scalars repeat
+    JsonValue rows = source.execute("getGenes", parse(R"({"genes": ["COMT", "BDNF", "HTR2A", "DRD2"], "build": 38})"));
+    ASSERT_EQUAL(rows.array_value.size(), 3);
+    ASSERT_EQUAL(rows.array_value[1].object_value["symbol"].string_value, "BDNF");
+    ASSERT_EQUAL(db.executions.load(), 6);
+    ASSERT_EQUAL(db.bound.load(), 9);
+    ASSERT_EQUAL(source.execute("getGenes", parse(R"({"genes": [], "build": 38})")).array_value.size(), 0);
+    ASSERT_EQUAL(db.executions.load(), 6);
+
+    // Past statement_cache_size the least recently used statement is prepared again
+    source.execute("getGeneAgain", parse(R"({"gene": "COMT"})"));
+    source.execute("getGeneOnceMore", parse(R"({"gene": "COMT"})"));
+    source.execute("getGene", parse(R"({"gene": "COMT"})"));
+    ASSERT_EQUAL(db.prepares.load(), 5);
+
+    JsonValue info = source.getConnectionInfo();
+    ASSERT_EQUAL(info.object_value["open_connections"].number_value, 1);
+    ASSERT_EQUAL(info.object_value["statement_cache_size"].number_value, 2);
+}
+
+TEST_CASE(DatabaseDataSource, ReportsFailuresAndReconnects) {
+    GenomicsDb db;
+    DatabaseDataSource source(parse(CONFIG), connector(db));
+
+    ASSERT_TRUE(source.execute("getNothing", JsonValue::makeObject()).object_value.count("error") == 1);
+    JsonValue rejected = source.execute("broken", JsonValue::makeObject());
+    ASSERT_TRUE(rejected.object_value["error"].string_value.find("syntax error") != std::string::npos);
+    JsonValue mismatched = source.execute("getGenes", parse(R"({"genes": ["COMT"], "build": [37, 38]})"));
+    ASSERT_TRUE(mismatched.object_value.count("error") == 1);
+    ASSERT_EQUAL(db.connects.load(), 1); // Rejected SQL leaves the connection in the pool
+
+    // A query that breaks its connection fails alone; the next one reconnects
+    db.drop_next = true;
+    ASSERT_EQUAL(source.execute("getGene", parse(R"({"gene": "BDNF"})")).object_value["error"].string_value,
+                 "connection lost");
+    ASSERT_EQUAL(source.execute("getGene", parse(R"({"gene": "BDNF"})")).array_value.size(), 1);
+    ASSERT_EQUAL(db.connects.load(), 2);
+
+    // Concurrent callers share at most max_connections
+    std::vector<std::thread> threads;
+    std::atomic<int> found{0};
+    for (int t = 0; t < 6; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 20; ++i) found += source.execute("getGene", parse(R"({"gene": "DRD2"})")).array_value.size();
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    ASSERT_EQUAL(found.load(), 120);
+    ASSERT_TRUE(db.connects.load() <= 3);
+
+    // Without a driver, or a reachable database, the source says so
+    DatabaseDataSource unconnected(parse(CONFIG));
+    ASSERT_FALSE(unconnected.isAvailable());
+    ASSERT_TRUE(unconnected.execute("getGene", parse(R"({"gene": "COMT"})")).object_value.count("error") == 1);
+    DatabaseDataSource elsewhere(parse(R"({"connection_string": "./missing.db", "queries": {"q": "SELECT 1"}})"),
+                                 connector(db));
+    ASSERT_FALSE(elsewhere.healthCheck());
+    ASSERT_TRUE(elsewhere.execute("q", JsonValue::makeObject()).object_value.count("error") == 1);
+}
+
+TEST_CASE(DatabaseDataSource, BindsNullAndRequiresDeclaredParameters) {
+    GenomicsDb db;
+    DatabaseDataSource source(parse(CONFIG), connector(db));
+
+    JsonValue missing = source.execute("getGene", JsonValue::makeObject());
+    ASSERT_EQUAL(missing.object_value["error"].string_value, "Missing parameter 'gene' for query 'getGene'");
+    ASSERT_EQUAL(db.executions.load(), 0);
+
+    // JSON null binds NULL, not an empty string
+    ASSERT_EQUAL(source.execute("getGene", parse(R"({"gene": null})")).array_value.size(), 0);
+    ASSERT_EQUAL(source.execute("getGene", parse(R"({"gene": ""})")).array_value.size(), 0);
+    ASSERT_EQUAL(db.bound.load(), 2);
+    ASSERT_EQUAL(db.nulls.load(), 1);
+}
+
+TEST_CASE(DatabaseDataSource, ChecksHealthWithoutWaitingForAConnection) {
+    GenomicsDb db;
+    DatabaseDataSource source(parse(R"({
+      "connection_string": "./data/genomics.db",
+      "connection_pool": {"min_connections": 1, "max_connections": 1, "connection_timeout": 30},
+      "queries": {"getGene": {"sql": "SELECT * FROM genes WHERE symbol = ?", "parameters": ["gene"]}}
+    })"), connector(db));
+
+    db.stalled = true;
+    std::thread query([&] { source.execute("getGene", parse(R"({"gene": "COMT"})")); });
+    while (db.waiting.load() == 0) std::this_thread::yield();
+
+    // The only connection is lent out and was just lent: healthy, without
+    // waiting out the 30s connection timeout
+    auto started = std::chrono::steady_clock::now();
+    ASSERT_TRUE(source.healthCheck());
+    ASSERT_TRUE(std::chrono::steady_clock::now() - started < std::chrono::seconds(10));
+
+    db.stalled = false;
+    query.join();
+    ASSERT_TRUE(source.healthCheck());
+    ASSERT_EQUAL(db.connects.load(), 1);
+}
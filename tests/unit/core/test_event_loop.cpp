@@ -0,0 +1,48 @@
+#include "core/event_loop.h"
+#include "utils/testing_framework.h"
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <vector>
+
+using namespace qc::core;
+using namespace std::chrono_literals;
+
+TEST_CASE(EventLoop, FiresTimersInDeadlineOrder) {
+    std::vector<int> fired;
+    std::mutex mutex;
+    std::promise<void> last;
+    EventLoop loop;
+    auto record = [&](int value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        fired.push_back(value);
+    };
+    loop.schedule_after(30ms, [&] { record(3); last.set_value(); });
+    loop.schedule_after(10ms, [&] { record(1); });
+    EventLoop::TimerId cancelled = loop.schedule_after(20ms, [&] { record(99); });
+    loop.schedule_after(20ms, [&] { record(2); });
+    loop.post([&] { record(0); });
+    ASSERT_TRUE(loop.cancel(cancelled));
+    ASSERT_FALSE(loop.cancel(cancelled));
+
+    last.get_future().wait();
+    ASSERT_EQUAL(fired.size(), 4);
+    for (int i = 0; i < 4; ++i) ASSERT_EQUAL(fired[i], i);
+    ASSERT_EQUAL(loop.pending_timers(), 0);
+}
+
+TEST_CASE(EventLoop, HoldsManyTimersOnOneThread) {
+    std::atomic<int> fired{0};
+    std::promise<void> done;
+    {
+        EventLoop loop;
+        for (int i = 0; i < 5000; ++i) {
+            loop.schedule_after(std::chrono::microseconds(i * 4), [&] {
+                if (++fired == 5000) done.set_value();
+            });
+        }
+        loop.schedule_after(1h, [&] { fired += 1000000; }); // Dropped on destruction
+        ASSERT_TRUE(done.get_future().wait_for(2s) == std::future_status::ready);
+    }
+    ASSERT_EQUAL(fired.load(), 5000);
+}
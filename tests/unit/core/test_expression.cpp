@@ -0,0 +1,99 @@
+#include "core/expression.h"
+#include "core/flexible_json_logic.h"
+#include "io/json_parser.h"
+#include "core/json_bridge.h"
+#include "utils/testing_framework.h"
+#include <ctime>
+#include <string>
+
+using namespace qc::core;
+
+static JsonValue parse(const std::string& text) {
+    return from_io(std::get<qc::io::JsonValue>(qc::io::JsonParser::parse(text)));
+}
+
+static std::map<std::string, JsonValue> analysis_values() {
+    return {
+        {"INPUT", parse(R"({"analysis_depth": "comprehensive", "limit": "5",
+                            "patient_variants": [{"gene": "BDNF"}, {"gene": "SLC6A4"}]})")},
+        {"known_genes", parse(R"([{"gene_id": "BDNF", "score": 0.9}, {"gene_id": "COMT", "score": 0.4},
+                                 {"gene_id": "SLC6A4", "score": 0.7}])")},
+    };
+}
+
+static bool holds(const std::string& text) {
+    auto values = analysis_values();
+    return Expression(text).test(Expression::MapScope(values));
+}
+
+TEST_CASE(Expression, EvaluatesConditions) {
+    ASSERT_TRUE(holds("${INPUT:analysis_depth} != 'basic'"));
+    ASSERT_TRUE(holds("${EXISTS:INPUT.patient_variants} AND ${LENGTH:INPUT.patient_variants} > 0"));
+    ASSERT_FALSE(holds("${LENGTH:known_genes} > 5"));
+    ASSERT_TRUE(holds("${INPUT:analysis_depth} == 'comprehensive' OR ${INPUT:analysis_depth} == 'research'"));
+    ASSERT_TRUE(holds("INPUT.analysis_depth in ['deep', \"comprehensive\"] && !exists(INPUT.missing)"));
+    ASSERT_TRUE(holds("'COMT' in known_genes.gene_id and 'APOE' not in known_genes.gene_id"));
+    ASSERT_TRUE(holds("INPUT.patient_variants[1].gene == known_genes[2].gene_id"));
+    ASSERT_TRUE(holds("known_genes[0].score * 10 - 4 >= INPUT.limit")); // Numeric strings compare as numbers
+    ASSERT_TRUE(holds("INPUT.analysis_depth in [known_genes[0].gene_id, 'comprehensive']"));
+    ASSERT_TRUE(holds("'prehens' in INPUT.analysis_depth and 'gene' in INPUT.patient_variants[0]"));
+    ASSERT_TRUE(holds("not (len(known_genes) == 3) or 7 % 4 == 3 and -2 < -1"));
+    ASSERT_FALSE(holds("missing.field or 1 / 0 or INPUT.nothing > 2"));
+    ASSERT_TRUE(holds("${CALC:len(known_genes) + 1} == 4"));
+}
+
+TEST_CASE(Expression, FoldsConstantsAndTracksReferences) {
+    Expression folded("(2 + 3) * 4 == 20 and ['a', 'b'] != []");
+    ASSERT_TRUE(folded.valid());
+    ASSERT_EQUAL(folded.size(), 1);
+
+    // A constant operand of AND or OR decides it or leaves only the other side
+    ASSERT_EQUAL(Expression("false and ${LENGTH:known_genes} > 1").size(), 1);
+    ASSERT_EQUAL(Expression("true and known_genes").size(), 2);
+
+    Expression reads("${LENGTH:known_genes} > 5 and INPUT.x or variants[0].gene == ${REF:genes.symbol}");
+    ASSERT_EQUAL(reads.references().size(), 3);
+    ASSERT_EQUAL(reads.references()[0], "known_genes");
+    ASSERT_EQUAL(reads.references()[2], "genes");
+}
+
+TEST_CASE(Expression, ReportsErrors) {
+    for (const char* text : {"", "1 +", "(a", "a not b", "'open", "${MERGE:a,b} > 1", "a == [b, 1]", "${nokind}",
+                             "a[x] > 1", "@"}) {
+        Expression expression(text);
+        ASSERT_FALSE(expression.valid());
+        ASSERT_FALSE(expression.error().empty());
+        ASSERT_FALSE(expression.test(Expression::MapScope(analysis_values())));
+    }
+    std::string deep(500, '(');
+    ASSERT_FALSE(Expression(deep + "1" + std::string(500, ')')).valid());
+}
+
+TEST_CASE(Expression, Calculates) {
+    std::time_t now = std::time(nullptr);
+    std::tm local = *std::localtime(&now);
+    std::string year = std::to_string(local.tm_year + 1900);
+    ASSERT_EQUAL(TemplateUtils::resolveCalculation("current_year"), year);
+    ASSERT_EQUAL(TemplateUtils::resolveCalculation("current_year - 3"), std::to_string(local.tm_year + 1897));
+    ASSERT_EQUAL(TemplateUtils::resolveCalculation("7 / 2"), "3.5");
+    ASSERT_EQUAL(TemplateUtils::resolveCalculation("1 < 2"), "true");
+    ASSERT_EQUAL(TemplateUtils::resolveCalculation("1 +"), "");
+    ASSERT_EQUAL(FlexibleJsonValue().resolveTemplate("${CALC:current_year - 1}-${CALC:current_year}", {}),
+                 std::to_string(local.tm_year + 1899) + "-" + year);
+
+    auto values = analysis_values();
+    JsonValue sum = Expression("known_genes[0].score + known_genes[2].score").evaluate(Expression::MapScope(values));
+    ASSERT_EQUAL(sum.type, JsonValue::NUMBER);
+    ASSERT_TRUE(sum.number_value > 1.59 && sum.number_value < 1.61);
+    JsonValue ids = Expression("known_genes.gene_id").evaluate(Expression::MapScope(values));
+    ASSERT_EQUAL(ids.array_value.size(), 3);
+}
+
+TEST_CASE(Expression, EvaluatesConditionsFromFlexibleJsonValue) {
+    auto values = analysis_values();
+    FlexibleJsonValue evaluator;
+    ASSERT_TRUE(evaluator.evaluateCondition("${LENGTH:known_genes} == 3", values));
+    ASSERT_FALSE(evaluator.evaluateCondition("${LENGTH:known_genes} > 5", values));
+    ASSERT_FALSE(evaluator.evaluateCondition("not valid (", values));
+    ASSERT_TRUE(Expression::get("1 == 1") == Expression::get("1 == 1"));
+}
@@ -0,0 +1,94 @@
+#include "core/file_store.h"
+#include "utils/testing_framework.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+using namespace qc::core;
+namespace fs = std::filesystem;
+
+static std::string fresh_file_store_dir(const std::string& name) {
+    fs::path dir = fs::temp_directory_path() / name;
+    fs::remove_all(dir);
+    return dir.string();
+}
+
+TEST_CASE(FileStore, HashesAwkwardKeysIntoShardedPaths) {
+    std::string dir = fresh_file_store_dir("qc_file_store_paths");
+    FileStore store(dir);
+    std::string slashed = "getGene:../../etc/passwd";
+    std::string long_key(5000, 'k');
+    ASSERT_TRUE(store.put(slashed, "a"));
+    ASSERT_TRUE(store.put(long_key, "b"));
+    ASSERT_EQUAL(*store.get(slashed, 0), "a");
+    ASSERT_EQUAL(*store.get(long_key, 0), "b");
+
+    fs::path path = store.path_for(slashed);
+    ASSERT_EQUAL(path.filename().string().size(), 32 + 6); // Hex digest plus ".entry"
+    ASSERT_EQUAL(path.parent_path().parent_path().parent_path().string(), dir);
+    ASSERT_TRUE(fs::exists(path));
+
+    ASSERT_TRUE(store.remove(slashed));
+    ASSERT_FALSE(store.get(slashed, 0).has_value());
+    fs::remove_all(dir);
+}
+
+TEST_CASE(FileStore, VerifiesHeaderAndExpiry) {
+    std::string dir = fresh_file_store_dir("qc_file_store_verify");
+    FileStore store(dir);
+    store.put("COMT", "value", 500);
+    ASSERT_TRUE(store.get("COMT", 499).has_value());
+    ASSERT_FALSE(store.get("COMT", 500).has_value());
+    ASSERT_TRUE(store.expire({"COMT"}, 499).empty());
+    ASSERT_EQUAL(store.expire({"COMT"}, 500).size(), 1);
+
+    // A file whose stored key does not match is not served
+    store.put("BDNF", "value");
+    fs::create_directories(fs::path(store.path_for("HTR2A")).parent_path());
+    fs::copy_file(store.path_for("BDNF"), store.path_for("HTR2A"));
+    ASSERT_FALSE(store.get("HTR2A", 0).has_value());
+
+    // Nor is one with a flipped byte
+    std::fstream(store.path_for("BDNF"), std::ios::in | std::ios::out | std::ios::binary).seekp(-1, std::ios::end).put('X');
+    ASSERT_FALSE(store.get("BDNF", 0).has_value());
+
+    // Or one whose expiry was changed
+    store.put("DRD2", "value", 500);
+    std::fstream(store.path_for("DRD2"), std::ios::in | std::ios::out | std::ios::binary).seekp(13).put('\x7f');
+    ASSERT_FALSE(store.get("DRD2", 0).has_value());
+    fs::remove_all(dir);
+}
+
+TEST_CASE(FileStore, ScanVisitsEveryEntry) {
+    std::string dir = fresh_file_store_dir("qc_file_store_scan");
+    FileStore store(dir);
+    for (int i = 0; i < 100; ++i) store.put("gene" + std::to_string(i), std::to_string(i));
+    // Temp files of a writer that exited, of this process, and of a writer
+    // that is long overdue
+    std::string exited = store.path_for("gene0") + ".tmp.4194305.0"; // Above any pid_max
+    std::string in_flight = store.path_for("gene1") + ".tmp." + std::to_string(getpid()) + ".0";
+    std::string abandoned = store.path_for("gene2") + ".tmp." + std::to_string(getpid()) + ".1";
+    std::ofstream(exited) << "partial";
+    std::ofstream(in_flight) << "partial";
+    std::ofstream(abandoned) << "partial";
+    fs::last_write_time(abandoned, fs::file_time_type::clock::now() - std::chrono::hours(2));
+
+    size_t seen = 0;
+    store.scan([&](const std::string& key, std::string_view value, int64_t) {
+        if (key == "gene" + std::string(value)) seen++;
+    });
+    ASSERT_EQUAL(seen, 100);
+    ASSERT_FALSE(fs::exists(exited));
+    ASSERT_TRUE(fs::exists(in_flight));
+    ASSERT_FALSE(fs::exists(abandoned));
+
+    store.clear();
+    ASSERT_FALSE(store.get("gene5", 0).has_value());
+    fs::remove_all(dir);
+}
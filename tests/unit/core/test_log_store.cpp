@@ -0,0 +1,142 @@
+#include "core/log_store.h"
+#include "utils/testing_framework.h"
+#include <filesystem>
+#include <fstream>
+
+using namespace qc::core;
+namespace fs = std::filesystem;
+
+static std::string fresh_dir(const std::string& name) {
+    fs::path dir = fs::temp_directory_path() / name;
+    fs::remove_all(dir);
+    return dir.string();
+}
+
+TEST_CASE(LogStore, PutGetRemoveAndReopen) {
+    std::string dir = fresh_dir("qc_log_store_basic");
+    {
+        LogStore store(dir);
+        ASSERT_TRUE(store.put("COMT", "v1"));
+        ASSERT_TRUE(store.put("COMT", "v2"));
+        ASSERT_TRUE(store.put("HTR2A", "serotonin"));
+        ASSERT_TRUE(store.put("BDNF", "temp"));
+        ASSERT_TRUE(store.remove("BDNF"));
+        ASSERT_EQUAL(*store.get("COMT"), "v2");
+        ASSERT_FALSE(store.get("BDNF").has_value());
+    }
+
+    LogStore reopened(dir);
+    ASSERT_EQUAL(*reopened.get("COMT"), "v2");
+    ASSERT_EQUAL(*reopened.get("HTR2A"), "serotonin");
+    ASSERT_FALSE(reopened.contains("BDNF"));
+    ASSERT_EQUAL(reopened.stats().keys, 2);
+    fs::remove_all(dir);
+}
+
+TEST_CASE(LogStore, RecoversFromTornTail) {
+    std::string dir = fresh_dir("qc_log_store_torn");
+    {
+        LogStore store(dir);
+        store.put("a", "alpha");
+        store.put("b", "beta");
+    }
+    // Simulate a crash halfway through appending a record
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        std::ofstream(entry.path(), std::ios::app | std::ios::binary) << "\x12\x34garbage";
+    }
+
+    LogStore store(dir);
+    ASSERT_EQUAL(*store.get("a"), "alpha");
+    ASSERT_EQUAL(*store.get("b"), "beta");
+    ASSERT_EQUAL(store.stats().corrupt_records, 1);
+    ASSERT_TRUE(store.put("c", "gamma"));
+    ASSERT_EQUAL(*store.get("c"), "gamma");
+    fs::remove_all(dir);
+}
+
+TEST_CASE(LogStore, KeepsRecordsAfterACorruptOneInASealedSegment) {
+    std::string dir = fresh_dir("qc_log_store_sealed");
+    LogStore::Options options;
+    options.max_segment_bytes = 64;
+    options.background_compaction = false;
+    {
+        LogStore store(dir, options);
+        for (int i = 0; i < 9; ++i) store.put("gene" + std::to_string(i), "value");
+        ASSERT_TRUE(store.stats().segments > 1);
+    }
+    fs::path sealed = fs::path(dir) / "segment-0000000001.log";
+    auto size = fs::file_size(sealed);
+    std::fstream(sealed, std::ios::in | std::ios::out | std::ios::binary).seekp(2).put('X'); // gene0's checksum
+
+    LogStore store(dir, options);
+    ASSERT_FALSE(store.get("gene0").has_value());
+    ASSERT_EQUAL(*store.get("gene1"), "value"); // After the bad record, same segment
+    ASSERT_EQUAL(*store.get("gene8"), "value");
+    ASSERT_EQUAL(store.stats().corrupt_records, 1);
+    ASSERT_EQUAL(fs::file_size(sealed), size);
+    fs::remove_all(dir);
+}
+
+TEST_CASE(LogStore, CompactionKeepsDeletesOfPinnedSegments) {
+    std::string dir = fresh_dir("qc_log_store_pinned");
+    LogStore::Options options;
+    options.max_segment_bytes = 40;
+    options.background_compaction = false;
+    {
+        LogStore store(dir, options);
+        store.put("doomed", "x"); // 20 bytes
+        store.put("pin", "y");    // 17 bytes, same segment
+        store.remove("doomed");   // Its tombstone rolls over to the next segment
+        ASSERT_EQUAL(store.stats().segments, 2);
+
+        // "pin" cannot be copied, so its segment, with the old "doomed", stays
+        std::fstream(fs::path(dir) / "segment-0000000001.log", std::ios::in | std::ios::out | std::ios::binary)
+            .seekp(36).put('Z');
+        store.compact();
+        ASSERT_EQUAL(store.stats().compactions, 1);
+        ASSERT_FALSE(fs::exists(fs::path(dir) / "segment-0000000002.log"));
+    }
+
+    LogStore reopened(dir, options);
+    ASSERT_FALSE(reopened.contains("doomed"));
+    fs::remove_all(dir);
+}
+
+TEST_CASE(LogStore, CompactionReclaimsDeadRecords) {
+    std::string dir = fresh_dir("qc_log_store_compact");
+    LogStore::Options options;
+    options.max_segment_bytes = 256;
+    options.background_compaction = false;
+    {
+        LogStore store(dir, options);
+        for (int i = 0; i < 50; ++i) {
+            store.put("gene" + std::to_string(i % 5), "value" + std::to_string(i));
+        }
+        LogStore::Stats before = store.stats();
+        ASSERT_TRUE(before.segments > 1);
+
+        store.compact();
+        LogStore::Stats after = store.stats();
+        ASSERT_EQUAL(after.compactions, 1);
+        ASSERT_TRUE(after.total_bytes < before.total_bytes);
+        ASSERT_EQUAL(after.live_bytes, before.live_bytes);
+        ASSERT_EQUAL(*store.get("gene4"), "value49");
+        store.put("gene0", "after");
+    }
+
+    LogStore reopened(dir, options);
+    ASSERT_EQUAL(*reopened.get("gene0"), "after");
+    ASSERT_EQUAL(*reopened.get("gene3"), "value48");
+    fs::remove_all(dir);
+}
+
+TEST_CASE(LogStore, ClearDropsSegments) {
+    std::string dir = fresh_dir("qc_log_store_clear");
+    LogStore store(dir);
+    store.put("x", "1");
+    store.clear();
+    ASSERT_FALSE(store.contains("x"));
+    ASSERT_EQUAL(store.stats().segments, 1);
+    ASSERT_EQUAL(store.stats().total_bytes, 0);
+    fs::remove_all(dir);
+}
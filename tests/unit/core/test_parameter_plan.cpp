@@ -0,0 +1,130 @@
+#include "core/flexible_json_logic.h"
+#include "core/json_bridge.h"
+#include "core/parameter_plan.h"
+#include "io/json_parser.h"
+#include "utils/testing_framework.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace qc::core;
+
+static JsonValue parse(const std::string& text) {
+    return from_io(std::get<qc::io::JsonValue>(qc::io::JsonParser::parse(text)));
+}
+
+// Trimmed from parameter_templates in flexible_config_example.json
+static const char* TEMPLATES = R"({
+    "gene_identifiers": {"type": "array", "items": {"type": "string"},
+        "aliases": ["gene", "geneId", "gene_ids", "symbols", "gene_list"],
+        "transformation": {"normalize_case": "upper", "resolve_aliases": true}},
+    "mental_health_conditions": {"type": "array", "items": {"type": "string"},
+        "aliases": ["condition", "conditions", "disorder", "disorders"],
+        "transformation": {"normalize": "lowercase"}},
+    "confidence_levels": {"type": "string", "default": "${CONFIG:default_confidence_level|medium}",
+        "aliases": ["confidence", "evidence_level", "quality"],
+        "mapping": {"strong": "high", "moderate": "medium", "weak": "low", "any": "all"}}
+})";
+
+static const char* SCHEMA = R"({"properties": {
+    "genes": {"$ref": "#/parameter_templates/gene_identifiers"},
+    "conditions": {"$ref": "#/parameter_templates/mental_health_conditions", "aliases": ["condition", "disorder"]},
+    "confidence_level": {"$ref": "#/parameter_templates/confidence_levels"},
+    "limit": {"type": "integer", "default": "50"},
+    "include_pathways": {"type": "boolean"}
+}})";
+
+TEST_CASE(ParameterPlan, AppliesAliasesCoercionsAndDefaults) {
+    auto plan = ParameterPlan::compile(parse(SCHEMA), parse(TEMPLATES), {{"default_confidence_level", "low"}});
+    ASSERT_EQUAL(plan->fields().size(), 5);
+    ASSERT_EQUAL(plan->fields()[plan->find("geneId")].name, "genes");
+    ASSERT_EQUAL(plan->find("disorders"), ParameterPlan::npos); // The property's own aliases replace the template's
+    ASSERT_EQUAL(plan->find("unknown"), ParameterPlan::npos);
+
+    JsonValue resolved = plan->apply(parse(R"({"gene_ids": ["comt", "Htr2a"], "disorder": "Depression",
+        "confidence": "strong", "include_pathways": "yes", "format": "json", "empty": null})"));
+    auto& fields = resolved.object_value;
+    ASSERT_EQUAL(fields.size(), 7);
+    ASSERT_EQUAL(fields["genes"].array_value[1].string_value, "HTR2A");
+    ASSERT_EQUAL(fields["conditions"].array_value.size(), 1);
+    ASSERT_EQUAL(fields["conditions"].array_value[0].string_value, "depression");
+    ASSERT_EQUAL(fields["confidence_level"].string_value, "high");
+    ASSERT_EQUAL(fields["limit"].number_value, 50);
+    ASSERT_TRUE(fields["include_pathways"].bool_value);
+    ASSERT_EQUAL(fields["format"].string_value, "json"); // Unknown members pass through
+    ASSERT_EQUAL(fields["empty"].type, JsonValue::NIL);
+
+    // Defaults come from the config; a canonical key wins over its aliases
+    resolved = plan->apply(parse(R"({"gene": "comt, bdnf", "genes": ["DRD2"], "symbols": "APOE", "limit": 12.7})"));
+    ASSERT_EQUAL(resolved.object_value["genes"].array_value.size(), 1);
+    ASSERT_EQUAL(resolved.object_value["genes"].array_value[0].string_value, "DRD2");
+    ASSERT_EQUAL(resolved.object_value["confidence_level"].string_value, "low");
+    ASSERT_EQUAL(resolved.object_value["limit"].number_value, 12);
+    ASSERT_EQUAL(plan->apply(parse(R"({"gene": "comt, bdnf"})")).object_value["genes"].array_value[1].string_value, "BDNF");
+}
+
+TEST_CASE(ParameterPlan, ResolvesEndpointParametersFromConfig) {
+    ConfigurationManager manager;
+    JsonValue config = parse(std::string(R"({"default_confidence_level": "medium", "parameter_templates": )") + TEMPLATES +
+        R"(, "endpoints": [{"name": "getGene", "parameters": {"type": "object", "properties": {
+            "gene": {"type": "string", "aliases": ["symbol", "gene_id"], "default": null}}}}]})");
+    config.object_value["endpoints"].array_value.push_back(parse(std::string(R"({"name": "getMentalHealthGenes", "parameters": )") + SCHEMA + "}"));
+    ASSERT_TRUE(manager.loadConfigurationFromJson(config));
+
+    JsonValue gene = manager.resolveParameters("getGene", parse(R"({"symbol": ["COMT"]})"));
+    ASSERT_EQUAL(gene.object_value["gene"].string_value, "COMT");
+    ASSERT_EQUAL(gene.object_value.size(), 1);
+    JsonValue genes = manager.resolveParameters("getMentalHealthGenes", parse(R"({"geneId": 1312, "quality": "any"})"));
+    ASSERT_EQUAL(genes.object_value["genes"].array_value[0].string_value, "1312");
+    ASSERT_EQUAL(genes.object_value["confidence_level"].string_value, "all");
+    JsonValue untouched = manager.resolveParameters("unknown", parse(R"({"symbol": "x"})"));
+    ASSERT_EQUAL(untouched.object_value.count("symbol"), 1);
+
+    JsonValue adhoc = manager.transformParameters(parse(R"({"geneId": "comt"})"),
+                                                  parse(R"({"genes": {"$ref": "#/parameter_templates/gene_identifiers"}})"));
+    ASSERT_EQUAL(adhoc.object_value["genes"].array_value[0].string_value, "COMT");
+}
+
+TEST_CASE(ParameterPlan, AppliesTemplatesToTheExampleConfig) {
+    std::filesystem::path example = std::filesystem::path(__FILE__).parent_path() / "../../../json/flexible_config_example.json";
+    std::ifstream file(example);
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    JsonValue config = parse(text);
+    ASSERT_EQUAL(config.type, JsonValue::OBJECT);
+    std::filesystem::path cache = std::filesystem::temp_directory_path() / "qc_parameter_plan_cache";
+    config.object_value["data_sources"].object_value["pubmed_cache"].object_value["cache_path"] =
+        JsonValue::makeString(cache.string()); // Not under the working directory
+    ConfigurationManager manager;
+    ASSERT_TRUE(manager.loadConfigurationFromJson(config));
+
+    // A database query's parameter
+    JsonValue gene = manager.resolveParameters("getGene", parse(R"({"geneId": "comt"})"));
+    ASSERT_EQUAL(gene.object_value.size(), 1);
+    ASSERT_EQUAL(gene.object_value["gene"].array_value[0].string_value, "COMT");
+
+    // Workflow operations' parameters
+    JsonValue drugs = manager.resolveParameters("getDrugGeneInteractions",
+                                                parse(R"({"symbols": "drd2, htr2a", "quality": "strong"})"));
+    ASSERT_EQUAL(drugs.object_value["gene_ids"].array_value[1].string_value, "HTR2A");
+    ASSERT_EQUAL(drugs.object_value["evidence_level"].string_value, "high");
+    ASSERT_EQUAL(drugs.object_value.count("symbols"), 0);
+    JsonValue defaulted = manager.resolveParameters("getDrugGeneInteractions", parse(R"({"gene_ids": ["DRD2"]})"));
+    ASSERT_EQUAL(defaulted.object_value["evidence_level"].string_value, "medium");
+    JsonValue genes = manager.resolveParameters("getMentalHealthGenes", parse(R"({"disorder": "ADHD"})"));
+    ASSERT_EQUAL(genes.object_value["condition"].array_value[0].string_value, "adhd");
+    std::filesystem::remove_all(cache);
+}
+
+TEST_CASE(ParameterPlan, BacksFlexibleJsonValueTransforms) {
+    FlexibleJsonValue params;
+    static_cast<JsonValue&>(params) = parse(R"({"gene": "COMT", "disorder": "adhd", "limit": "5"})");
+    JsonValue renamed = params.resolveAliases(parse(R"({"genes": ["gene", "gene_ids"], "condition": "disorder"})"));
+    ASSERT_EQUAL(renamed.object_value["genes"].string_value, "COMT");
+    ASSERT_EQUAL(renamed.object_value["condition"].string_value, "adhd");
+    ASSERT_EQUAL(renamed.object_value.count("gene"), 0);
+
+    JsonValue typed = params.transformParameters(parse(R"({"limit": {"type": "number"}, "page": {"default": 1}})"));
+    ASSERT_EQUAL(typed.object_value["limit"].type, JsonValue::NUMBER);
+    ASSERT_EQUAL(typed.object_value["page"].number_value, 1);
+}
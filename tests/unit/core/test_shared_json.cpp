@@ -0,0 +1,78 @@
+#include "core/flexible_json_logic.h"
+#include "core/json_bridge.h"
+#include "core/shared_json.h"
+#include "io/json_parser.h"
+#include "utils/testing_framework.h"
+#include <string>
+
+using namespace qc::core;
+
+static JsonValue parse(const std::string& text) {
+    return from_io(std::get<qc::io::JsonValue>(qc::io::JsonParser::parse(text)));
+}
+
+static SharedJson shared(const std::string& text) {
+    return SharedJson(parse(text));
+}
+
+TEST_CASE(SharedJson, ConvertsAndCopiesByHandle) {
+    JsonValue legacy = parse(R"({"genes": [{"gene_id": "COMT", "score": 0.9}, {"gene_id": "BDNF"}], "ok": true})");
+    SharedJson value(legacy);
+    ASSERT_EQUAL(value.type(), JsonValue::OBJECT);
+    ASSERT_EQUAL(value.size(), 2);
+    ASSERT_EQUAL(value.find("genes")->at(0)->find("gene_id")->as_string(), "COMT");
+    ASSERT_EQUAL(value.find("genes")->at(0)->find("score")->as_number(), 0.9);
+    ASSERT_TRUE(value.find("ok")->as_bool());
+    ASSERT_TRUE(value.find("missing") == nullptr);
+    ASSERT_TRUE(value.find("genes")->at(2) == nullptr);
+    ASSERT_EQUAL(value.to_json().serialize(), legacy.serialize());
+
+    SharedJson copy = value;
+    ASSERT_TRUE(copy.same(value));
+    ASSERT_TRUE(copy == shared(legacy.serialize()));
+    ASSERT_FALSE(copy.same(shared(legacy.serialize())));
+    ASSERT_TRUE(SharedJson().is_null());
+    ASSERT_EQUAL(SharedJson().to_json().type, JsonValue::NIL);
+
+    // Moving a value in takes its strings instead of copying them
+    SharedJson moved(std::move(legacy));
+    ASSERT_TRUE(moved == value);
+}
+
+TEST_CASE(SharedJson, ChangesShareUnchangedSubtrees) {
+    SharedJson report = shared(R"({"known_genes": [{"gene_id": "COMT"}], "pathways": {"count": 3}})");
+    SharedJson updated = report.with("pathways", shared(R"({"count": 4})"));
+    ASSERT_EQUAL(report.find("pathways")->find("count")->as_number(), 3); // The original is untouched
+    ASSERT_EQUAL(updated.find("pathways")->find("count")->as_number(), 4);
+    ASSERT_TRUE(updated.find("known_genes")->same(*report.find("known_genes")));
+
+    SharedJson overlay = shared(R"({"pathways": {"source": "kegg"}, "drugs": ["sertraline"]})");
+    SharedJson merged = SharedJson::merge({report, overlay});
+    ASSERT_EQUAL(merged.find("pathways")->find("count")->as_number(), 3);
+    ASSERT_EQUAL(merged.find("pathways")->find("source")->as_string(), "kegg");
+    ASSERT_TRUE(merged.find("known_genes")->same(*report.find("known_genes")));
+    ASSERT_TRUE(merged.find("drugs")->same(*overlay.find("drugs")));
+    ASSERT_TRUE(SharedJson::merge({report, SharedJson()}).same(report));
+
+    SharedJson shallow = SharedJson::merge({report, overlay}, "shallow");
+    ASSERT_TRUE(shallow.find("pathways")->same(*overlay.find("pathways")));
+
+    SharedJson joined = SharedJson::merge({shared(R"([1, 2])"), shared("3"), SharedJson(), shared("[4]")}, "concat");
+    ASSERT_EQUAL(joined.to_json().serialize(), "[1,2,3,4]");
+
+    // The legacy entry point merges the same way, through copies
+    JsonValue legacy = FlexibleJsonValue::merge({report.to_json(), overlay.to_json()});
+    ASSERT_TRUE(SharedJson(legacy) == merged);
+}
+
+TEST_CASE(SharedJson, WorkflowContextHandsOutHandles) {
+    WorkflowContext context;
+    context.setInput(parse(R"({"condition": "depression"})"));
+    context.setOutput("known_genes", parse(R"([{"gene_id": "COMT"}, {"gene_id": "BDNF"}])"));
+    ASSERT_TRUE(context.output("known_genes").same(context.output("known_genes")));
+    ASSERT_TRUE(context.outputs().at("known_genes").same(context.output("known_genes")));
+    ASSERT_TRUE(context.output("missing").is_null());
+    ASSERT_EQUAL(context.input().find("condition")->as_string(), "depression");
+    ASSERT_EQUAL(context.getOutput("known_genes").array_value[1].object_value["gene_id"].string_value, "BDNF");
+    ASSERT_EQUAL(context.getAllOutputs().object_value.size(), 1);
+}
@@ -0,0 +1,76 @@
+#include "core/state_image.h"
+#include "io/file_io.h"
+#include "io/json_diff.h"
+#include "utils/testing_framework.h"
+#include <filesystem>
+
+using namespace qc::core;
+using namespace qc::io;
+namespace fs = std::filesystem;
+
+static JsonValue sample_section() {
+    return JsonValue{JsonObject{
+        {"name", JsonValue{std::string("COMT")}},
+        {"score", JsonValue{-0.125}},
+        {"flags", JsonValue{JsonArray{JsonValue{true}, JsonValue{false}, JsonValue{}}}},
+        {"empty", JsonValue{JsonObject{}}},
+    }};
+}
+
+static std::string write_image(const std::string& name, StateImage::Writer& writer) {
+    std::string path = (fs::temp_directory_path() / name).string();
+    return FileIO::write_atomic(path, writer.finish()) ? path : std::string();
+}
+
+TEST_CASE(StateImage, DecodesSectionsOnDemand) {
+    StateImage::Writer writer;
+    writer.add("genes", sample_section());
+    writer.add("model", JsonValue{std::string("local.gguf")});
+    writer.add("big", JsonValue{JsonArray(1000, JsonValue{std::string(100, 'x')})});
+    std::string path = write_image("qc_state_image.bin", writer);
+
+    auto image = StateImage::open(path);
+    ASSERT_TRUE(image != nullptr);
+    ASSERT_EQUAL(image->names().size(), 3);
+    ASSERT_EQUAL(image->decoded_sections(), 0);
+
+    auto genes = image->section("genes");
+    ASSERT_TRUE(JsonDiff::equal(*genes, sample_section()));
+    ASSERT_TRUE(image->section("genes") == genes); // Decoded once, then shared
+    ASSERT_EQUAL(image->decoded_sections(), 1);
+    ASSERT_TRUE(image->section("missing") == nullptr);
+
+    // Sections carried over raw need no decoding and read back the same
+    StateImage::Writer copy;
+    copy.add_raw("big", *image);
+    copy.add("extra", JsonValue{1.0});
+    auto copied = StateImage::open(write_image("qc_state_image_copy.bin", copy));
+    ASSERT_EQUAL(image->decoded_sections(), 1);
+    ASSERT_EQUAL(copied->section("big")->as_array().size(), 1000);
+    ASSERT_TRUE(copied->identity() != image->identity());
+    fs::remove(path);
+}
+
+TEST_CASE(StateImage, RejectsCorruption) {
+    StateImage::Writer writer;
+    writer.add("a", sample_section());
+    writer.add("b", JsonValue{std::string("intact")});
+    std::string bytes = writer.finish();
+    std::string path = (fs::temp_directory_path() / "qc_state_image_corrupt.bin").string();
+
+    // A damaged payload costs only its own section
+    std::string damaged = bytes;
+    damaged[damaged.find("COMT")] ^= 0x20;
+    ASSERT_TRUE(FileIO::write_atomic(path, damaged));
+    auto image = StateImage::open(path);
+    ASSERT_TRUE(image->section("a") == nullptr);
+    ASSERT_EQUAL(image->corrupt_sections(), 1);
+    ASSERT_EQUAL(image->section("b")->as_string(), "intact");
+
+    // A truncated index is not an image at all
+    ASSERT_TRUE(FileIO::write_atomic(path, bytes.substr(0, 30)));
+    ASSERT_TRUE(StateImage::open(path) == nullptr);
+    ASSERT_TRUE(FileIO::write_atomic(path, "{\"a\":1}"));
+    ASSERT_TRUE(StateImage::open(path) == nullptr);
+    fs::remove(path);
+}
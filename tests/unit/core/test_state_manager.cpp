@@ -0,0 +1,232 @@
+#include "core/state_manager.h"
+#include "io/json_diff.h"
+#include "utils/testing_framework.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using namespace qc::core;
+using namespace qc::io;
+namespace fs = std::filesystem;
+
+static std::string fresh_state_file(const std::string& name) {
+    fs::path path = fs::temp_directory_path() / name;
+    fs::remove(path);
+    fs::remove(path.string() + ".journal");
+    return path.string();
+}
+
+static JsonValue session_state(int turns) {
+    JsonObject history;
+    for (int i = 0; i < turns; ++i) history["turn" + std::to_string(i)] = JsonValue{std::string(200, 'x')};
+    return JsonValue{JsonObject{{"model", JsonValue{std::string("local.gguf")}}, {"history", JsonValue{history}}}};
+}
+
+TEST_CASE(StateManager, JournalsDeltasBetweenSnapshots) {
+    std::string file = fresh_state_file("qc_state_journal.json");
+    {
+        StateManager manager(file);
+        manager.save_immediate(session_state(50));
+        uint64_t snapshot = fs::file_size(file);
+        manager.save_immediate(session_state(51));
+        manager.save_immediate(session_state(51)); // Unchanged
+
+        StateManager::Stats stats = manager.stats();
+        ASSERT_EQUAL(stats.snapshots, 1);
+        ASSERT_EQUAL(stats.journal_records, 1);
+        ASSERT_EQUAL(stats.skipped_saves, 1);
+        ASSERT_TRUE(stats.bytes_written < snapshot + 400);
+        ASSERT_EQUAL(fs::file_size(file), snapshot);
+    }
+
+    StateManager restored(file);
+    auto state = restored.load();
+    ASSERT_TRUE(state.has_value());
+    ASSERT_TRUE(JsonDiff::equal(*state, session_state(51)));
+
+    // Continuing from a load appends to the same journal
+    restored.save_immediate(session_state(52));
+    ASSERT_EQUAL(restored.stats().journal_records, 1);
+    ASSERT_TRUE(JsonDiff::equal(*StateManager(file).load(), session_state(52)));
+}
+
+TEST_CASE(StateManager, CompactsOnceJournalOutgrowsSnapshot) {
+    std::string file = fresh_state_file("qc_state_compact.json");
+    StateManager::Options options;
+    options.compaction_min_bytes = 0;
+    StateManager manager(file, options);
+    manager.save_immediate(session_state(2));
+    for (int turns = 3; turns < 12; ++turns) manager.save_immediate(session_state(turns));
+
+    ASSERT_TRUE(manager.stats().snapshots > 1);
+    ASSERT_TRUE(fs::file_size(file + ".journal") <= fs::file_size(file) + 100);
+    ASSERT_TRUE(JsonDiff::equal(*StateManager(file).load(), session_state(11)));
+}
+
+TEST_CASE(StateManager, IgnoresTornAndForeignJournals) {
+    std::string file = fresh_state_file("qc_state_torn.json");
+    {
+        StateManager manager(file);
+        manager.save_immediate(session_state(1));
+        manager.save_immediate(session_state(2));
+    }
+    std::ofstream(file + ".journal", std::ios::app) << "0badc0de {\"ops\":[";
+    ASSERT_TRUE(JsonDiff::equal(*StateManager(file).load(), session_state(2)));
+
+    // A snapshot replaced behind the journal's back makes the journal stale
+    std::ofstream(file, std::ios::trunc) << R"({"model":"other"})";
+    auto state = StateManager(file).load();
+    ASSERT_EQUAL(state->as_object().size(), 1);
+    ASSERT_EQUAL(state->as_object().at("model").as_string(), "other");
+}
+
+TEST_CASE(StateManager, AutosaveSkipsUnchangedVersions) {
+    std::string file = fresh_state_file("qc_state_autosave.json");
+    std::atomic<uint64_t> version{1};
+    std::atomic<int> builds{0};
+    StateManager manager(file);
+    manager.start_autosave(5, [&] { return version.load(); }, [&] {
+        builds++;
+        return session_state(static_cast<int>(version.load()));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    ASSERT_EQUAL(builds.load(), 1);
+
+    version = 2;
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    manager.stop_autosave();
+    ASSERT_EQUAL(builds.load(), 2);
+    ASSERT_TRUE(JsonDiff::equal(*StateManager(file).load(), session_state(2)));
+}
+
+TEST_CASE(StateManager, StopIsImmediateAndFlushesPendingChanges) {
+    std::string file = fresh_state_file("qc_state_stop.json");
+    std::atomic<int> turns{1};
+    StateManager manager(file);
+    StateManager::AutosaveOptions timing;
+    timing.debounce = std::chrono::milliseconds(10000);
+    timing.max_delay = std::chrono::milliseconds(10000);
+    manager.start_autosave(timing, [&] { return session_state(turns.load()); });
+
+    turns = 3;
+    manager.notify_changed();
+    auto started = std::chrono::steady_clock::now();
+    manager.stop_autosave();
+    ASSERT_TRUE(std::chrono::steady_clock::now() - started < std::chrono::seconds(1));
+    ASSERT_TRUE(JsonDiff::equal(*StateManager(file).load(), session_state(3)));
+
+    // Polling mode stops just as fast
+    manager.start_autosave(10000, [&] { return session_state(turns.load()); });
+    started = std::chrono::steady_clock::now();
+    manager.stop_autosave();
+    ASSERT_TRUE(std::chrono::steady_clock::now() - started < std::chrono::seconds(1));
+}
+
+TEST_CASE(StateManager, DebouncesBurstsOfChanges) {
+    std::string file = fresh_state_file("qc_state_debounce.json");
+    std::atomic<int> turns{0};
+    std::atomic<int> builds{0};
+    StateManager manager(file);
+    StateManager::AutosaveOptions timing;
+    timing.debounce = std::chrono::milliseconds(30);
+    timing.max_delay = std::chrono::milliseconds(80);
+    manager.start_autosave(timing, [&] {
+        builds++;
+        return session_state(turns.load());
+    });
+
+    for (int i = 0; i < 20; ++i) { // A burst well inside the debounce window
+        turns++;
+        manager.notify_changed();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    ASSERT_EQUAL(builds.load(), 1);
+
+    // Steady changes still get saved every max_delay
+    for (int i = 0; i < 30; ++i) {
+        turns++;
+        manager.notify_changed();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(builds.load() >= 3);
+    manager.stop_autosave();
+    ASSERT_TRUE(JsonDiff::equal(*StateManager(file).load(), session_state(turns.load())));
+}
+
+TEST_CASE(StateManager, SavesStoreSnapshotsBySection) {
+    std::string file = fresh_state_file("qc_state_store.json");
+    StateStore store;
+    store.set("model", JsonValue{std::string("local.gguf")});
+    store.set("history", session_state(40));
+    {
+        StateManager manager(file);
+        manager.save_snapshot(store.snapshot());
+        store.set("cursor", JsonValue{3.0});
+        manager.save_snapshot(store.snapshot());
+        manager.save_snapshot(store.snapshot()); // Every section still shared
+
+        StateManager::Stats stats = manager.stats();
+        ASSERT_EQUAL(stats.snapshots, 1);
+        ASSERT_EQUAL(stats.journal_records, 1);
+        ASSERT_EQUAL(stats.skipped_saves, 1);
+    }
+
+    StateStore restored;
+    StateManager manager(file);
+    ASSERT_TRUE(manager.restore(restored));
+    ASSERT_TRUE(JsonDiff::equal(restored.snapshot().to_json(), store.snapshot().to_json()));
+    manager.save_snapshot(restored.snapshot());
+    ASSERT_EQUAL(manager.stats().skipped_saves, 1);
+
+    // Autosave captures the store without blocking its writers
+    manager.start_autosave(StateManager::AutosaveOptions{}, restored);
+    restored.erase("cursor");
+    manager.notify_changed();
+    manager.stop_autosave();
+    ASSERT_TRUE(JsonDiff::equal(*StateManager(file).load(), restored.snapshot().to_json()));
+}
+
+TEST_CASE(StateManager, RestoresImageSectionsLazily) {
+    std::string file = fresh_state_file("qc_state_lazy.json");
+    StateStore store;
+    for (int i = 0; i < 50; ++i) store.set("section" + std::to_string(i), session_state(5));
+    {
+        StateManager manager(file);
+        manager.save_snapshot(store.snapshot());
+        store.update("section7", [](JsonValue& section) {
+            std::get<JsonObject>(section.data)["model"] = JsonValue{std::string("changed")};
+        });
+        store.erase("section8");
+        manager.save_snapshot(store.snapshot());
+        ASSERT_EQUAL(manager.stats().journal_records, 1);
+    }
+
+    StateStore restored;
+    StateManager manager(file);
+    ASSERT_TRUE(manager.restore(restored));
+    auto image = restored.snapshot().image;
+    ASSERT_TRUE(image != nullptr);
+    ASSERT_EQUAL(image->decoded_sections(), 1); // Only the section the journal changed
+    ASSERT_TRUE(restored.get("section8") == nullptr);
+    ASSERT_TRUE(JsonDiff::equal(*restored.get("section3"), session_state(5)));
+    ASSERT_EQUAL(image->decoded_sections(), 2);
+    ASSERT_TRUE(JsonDiff::equal(restored.snapshot().to_json(), store.snapshot().to_json()));
+
+    // Compaction carries untouched sections over still encoded
+    restored.set("section9", JsonValue{9.0});
+    manager.save_snapshot(restored.snapshot());
+    manager.compact();
+    ASSERT_TRUE(JsonDiff::equal(*StateManager(file).load(), restored.snapshot().to_json()));
+
+    // Plain JSON snapshots restore too
+    StateManager::Options options;
+    options.format = StateManager::Format::JSON;
+    std::string json_file = fresh_state_file("qc_state_lazy_json.json");
+    StateManager(json_file, options).save_snapshot(restored.snapshot());
+    StateStore from_json;
+    ASSERT_TRUE(StateManager(json_file).restore(from_json));
+    ASSERT_TRUE(from_json.snapshot().image == nullptr);
+    ASSERT_TRUE(JsonDiff::equal(from_json.snapshot().to_json(), restored.snapshot().to_json()));
+}
@@ -0,0 +1,57 @@
+#include "core/state_store.h"
+#include "io/json_diff.h"
+#include "utils/testing_framework.h"
+#include <atomic>
+#include <thread>
+
+using namespace qc::core;
+using namespace qc::io;
+
+TEST_CASE(StateStore, SnapshotsAreImmutableAndShareUnchangedSections) {
+    StateStore store;
+    store.set("model", JsonValue{std::string("local.gguf")});
+    store.set("history", JsonValue{JsonArray{JsonValue{1.0}}});
+    StateStore::Snapshot before = store.snapshot();
+
+    store.update("history", [](JsonValue& history) {
+        std::get<JsonArray>(history.data).push_back(JsonValue{2.0});
+    });
+    StateStore::Snapshot after = store.snapshot();
+
+    ASSERT_EQUAL(before.get("history")->as_array().size(), 1);
+    ASSERT_EQUAL(after.get("history")->as_array().size(), 2);
+    ASSERT_TRUE(before.get("model") == after.get("model"));
+    ASSERT_TRUE(after.version > before.version);
+
+    ASSERT_TRUE(store.erase("model"));
+    ASSERT_FALSE(store.erase("model"));
+    ASSERT_TRUE(before.get("model") != nullptr);
+    ASSERT_TRUE(JsonDiff::equal(store.snapshot().to_json(),
+                                JsonValue{JsonObject{{"history", JsonValue{JsonArray{JsonValue{1.0}, JsonValue{2.0}}}}}}));
+}
+
+TEST_CASE(StateStore, ConcurrentUpdatesAreNotLost) {
+    StateStore store;
+    store.set("count", JsonValue{0.0});
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::thread reader([&] {
+        while (!done) {
+            if (!store.snapshot().get("count")->is_number()) torn++;
+        }
+    });
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([&] {
+            for (int i = 0; i < 250; ++i) {
+                store.update("count", [](JsonValue& count) { count = JsonValue{count.as_number() + 1}; });
+            }
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    done = true;
+    reader.join();
+    ASSERT_EQUAL(torn.load(), 0);
+    ASSERT_EQUAL(store.get("count")->as_number(), 1000.0);
+}
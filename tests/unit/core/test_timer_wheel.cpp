@@ -0,0 +1,33 @@
+#include "core/timer_wheel.h"
+#include "utils/testing_framework.h"
+#include <algorithm>
+
+using namespace qc::core;
+
+TEST_CASE(TimerWheel, ReturnsDueKeysOnly) {
+    TimerWheel wheel(100, 8);
+    wheel.schedule("a", 101);
+    wheel.schedule("b", 103);
+    wheel.schedule("c", 111); // Same slot as "b", one revolution later
+    wheel.schedule("late", 50); // Already due
+
+    auto due = wheel.advance(103, 100);
+    std::sort(due.begin(), due.end());
+    ASSERT_EQUAL(due.size(), 3);
+    ASSERT_EQUAL(due[0], "a");
+    ASSERT_EQUAL(due[1], "b");
+    ASSERT_EQUAL(due[2], "late");
+    ASSERT_EQUAL(wheel.size(), 1);
+
+    ASSERT_TRUE(wheel.advance(110, 100).empty());
+    ASSERT_EQUAL(wheel.advance(111, 100).size(), 1);
+}
+
+TEST_CASE(TimerWheel, AdvancesIncrementally) {
+    TimerWheel wheel(0, 16);
+    for (int i = 0; i < 10; ++i) wheel.schedule("k" + std::to_string(i), 5);
+    ASSERT_EQUAL(wheel.advance(1000, 4).size(), 4);
+    ASSERT_EQUAL(wheel.advance(1000, 4).size(), 4);
+    ASSERT_EQUAL(wheel.advance(1000, 4).size(), 2);
+    ASSERT_EQUAL(wheel.size(), 0);
+}
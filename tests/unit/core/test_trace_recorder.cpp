@@ -0,0 +1,88 @@
+#include "core/trace_recorder.h"
+#include "io/json_parser.h"
+#include "utils/testing_framework.h"
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace qc::core;
+using namespace std::chrono_literals;
+
+TEST_CASE(TraceRecorder, ExportsChromeTraceEvents) {
+    TraceRecorder trace;
+    auto t0 = TraceRecorder::Clock::now();
+    trace.record(TraceRecorder::Category::WORKFLOW, "analysis", t0, t0 + 30ms);
+    std::thread worker([&] {
+        trace.record(TraceRecorder::Category::DATA_SOURCE, "ncbi", t0 + 1ms, t0 + 11ms, "getGenes");
+        trace.record(TraceRecorder::Category::DATA_SOURCE, "ncbi", t0 + 12ms, t0 + 17ms, "getPathways");
+    });
+    worker.join();
+    trace.record(TraceRecorder::Category::CACHE, "genes", t0, t0 + 1ms, "miss");
+
+    auto spans = trace.spans();
+    ASSERT_EQUAL(spans.size(), 4);
+    ASSERT_EQUAL(spans[1].name, "genes"); // By start time, then in the order recorded
+    ASSERT_EQUAL(spans[2].detail, "getGenes");
+    ASSERT_TRUE(spans[0].thread != spans[2].thread);
+    ASSERT_TRUE(spans[2].duration_us > 9000 && spans[2].duration_us < 11000);
+
+    JsonValue chrome = trace.chrome_trace();
+    ASSERT_EQUAL(chrome.object_value["displayTimeUnit"].string_value, "ms");
+    const auto& events = chrome.object_value["traceEvents"].array_value;
+    ASSERT_EQUAL(events.size(), 6); // Four spans, then a name for each of two threads
+    const JsonValue& call = events[2];
+    ASSERT_EQUAL(call.object_value.at("ph").string_value, "X");
+    ASSERT_EQUAL(call.object_value.at("cat").string_value, "data_source");
+    ASSERT_EQUAL(call.object_value.at("tid").number_value, static_cast<double>(spans[2].thread));
+    ASSERT_EQUAL(call.object_value.at("args").object_value.at("detail").string_value, "getGenes");
+    ASSERT_EQUAL(events[0].object_value.count("args"), 0);
+    ASSERT_EQUAL(events[5].object_value.at("ph").string_value, "M");
+}
+
+TEST_CASE(TraceRecorder, WritesTraceTextThatParsesBack) {
+    TraceRecorder trace;
+    auto t0 = TraceRecorder::Clock::now();
+    trace.record(TraceRecorder::Category::OPERATION, "early", t0, t0 + 1ms);
+    trace.record(TraceRecorder::Category::DATA_SOURCE, "ncbi", t0 + 12345678us, t0 + 12345679us,
+                 "timeout\nafter \"12s\"");
+    auto spans = trace.spans();
+
+    auto parsed = qc::io::JsonParser::parse(trace.chrome_trace_text());
+    ASSERT_TRUE(std::holds_alternative<qc::io::JsonValue>(parsed));
+    const auto& events = std::get<qc::io::JsonValue>(parsed).as_object().at("traceEvents").as_array();
+    const auto& late = events[1].as_object();
+    ASSERT_EQUAL(late.at("ts").as_number(), spans[1].start_us); // Every digit, not 1.23457e+07
+    ASSERT_TRUE(late.at("ts").as_number() > 12345678);
+    ASSERT_EQUAL(late.at("args").as_object().at("detail").as_string(), "timeout\nafter \"12s\"");
+}
+
+TEST_CASE(TraceRecorder, SummarizesSourcesAndCache) {
+    TraceRecorder trace;
+    auto t0 = TraceRecorder::Clock::now();
+    trace.record(TraceRecorder::Category::WORKFLOW, "analysis", t0, t0 + 40ms);
+    trace.record(TraceRecorder::Category::DATA_SOURCE, "ncbi", t0, t0 + 10ms, "getGenes");
+    trace.record(TraceRecorder::Category::DATA_SOURCE, "ncbi", t0, t0 + 20ms, "getPathways");
+    trace.record(TraceRecorder::Category::DATA_SOURCE, "ensembl", t0, t0 + 5ms, "lookup");
+    trace.record(TraceRecorder::Category::CACHE, "a", t0, t0, "hit");
+    trace.record(TraceRecorder::Category::CACHE, "b", t0, t0, "miss");
+    trace.record(TraceRecorder::Category::CACHE, "c", t0, t0, "hit");
+    trace.record(TraceRecorder::Category::FALLBACK, "b", t0, t0 + 1ms, "unavailable");
+    trace.record(TraceRecorder::Category::OPERATION, "b", t0, t0 + 25ms, "", 1);
+    trace.record(TraceRecorder::Category::OPERATION, "a", t0, t0 + 30ms, "", 0);
+
+    TraceRecorder::Summary summary = trace.summary();
+    ASSERT_TRUE(summary.total_ms > 39.9 && summary.total_ms < 40.1);
+    ASSERT_EQUAL(summary.sources.size(), 2);
+    ASSERT_EQUAL(summary.sources["ncbi"].calls, 2);
+    ASSERT_TRUE(summary.sources["ncbi"].ms > 29.9 && summary.sources["ncbi"].ms < 30.1);
+    ASSERT_EQUAL(summary.cache_hits, 2);
+    ASSERT_EQUAL(summary.cache_misses, 1);
+    ASSERT_EQUAL(summary.fallbacks, 1);
+    // Without a plan there are no dependencies to follow
+    ASSERT_EQUAL(summary.critical_path.size(), 1);
+    ASSERT_EQUAL(summary.critical_path[0].operation, "a");
+
+    JsonValue json = summary.to_json();
+    ASSERT_EQUAL(json.object_value["sources"].object_value["ensembl"].object_value["calls"].number_value, 1);
+    ASSERT_EQUAL(json.object_value["critical_path"].array_value.size(), 1);
+}
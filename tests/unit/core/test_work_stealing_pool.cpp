@@ -0,0 +1,63 @@
+#include "core/work_stealing_pool.h"
+#include "utils/testing_framework.h"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <vector>
+
+using namespace qc::core;
+
+TEST_CASE(WorkStealingPool, RunsMostUrgentTaskFirst) {
+    std::vector<int> order;
+    std::mutex mutex;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    {
+        WorkStealingPool pool(1);
+        pool.submit([released] { released.wait(); }); // Hold the only worker while the queue fills
+        for (int priority : {1, 5, 3, 5, 0}) {
+            pool.submit([&, priority] {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(priority);
+            }, priority);
+        }
+        release.set_value();
+    }
+    ASSERT_EQUAL(order.size(), 5);
+    ASSERT_EQUAL(order[0], 5);
+    ASSERT_EQUAL(order[1], 5);
+    ASSERT_EQUAL(order[2], 3);
+    ASSERT_EQUAL(order[3], 1);
+    ASSERT_EQUAL(order[4], 0);
+}
+
+TEST_CASE(WorkStealingPool, IdleWorkersStealQueuedWork) {
+    std::atomic<int> done{0};
+    WorkStealingPool pool(4);
+    std::promise<void> all_done;
+    // Follow-up tasks land on the submitting worker's queue; the others must steal them
+    pool.submit([&] {
+        for (int i = 0; i < 8; ++i) {
+            pool.submit([&] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                if (++done == 8) all_done.set_value();
+            });
+        }
+    });
+
+    auto started = std::chrono::steady_clock::now();
+    all_done.get_future().wait();
+    ASSERT_TRUE(std::chrono::steady_clock::now() - started < std::chrono::milliseconds(120));
+    ASSERT_TRUE(pool.stats().stolen > 0);
+}
+
+TEST_CASE(WorkStealingPool, DrainsQueueOnDestruction) {
+    std::atomic<int> done{0};
+    {
+        WorkStealingPool pool(2);
+        for (int i = 0; i < 100; ++i) pool.submit([&] { done++; });
+        pool.submit([] { throw std::runtime_error("ignored"); });
+    }
+    ASSERT_EQUAL(done.load(), 100);
+}
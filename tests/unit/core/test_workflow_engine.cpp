@@ -0,0 +1,740 @@
+#include "core/flexible_json_logic.h"
+#include "core/cache_manager.h"
+#include "core/cancellation.h"
+#include "core/event_loop.h"
+#include "core/json_bridge.h"
+#include "core/trace_recorder.h"
+#include "core/workflow_plan.h"
+#include "utils/testing_framework.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace qc::core;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Answers every endpoint after a fixed delay, tracking how many calls overlap
+class SlowSource : public DataSource {
+public:
+    explicit SlowSource(int delay_ms, bool broken = false) : delay_ms_(delay_ms), broken_(broken) {}
+
+    JsonValue execute(const std::string& operation, const JsonValue& parameters) override {
+        int now = ++active_;
+        for (int seen = peak_; now > seen && !peak_.compare_exchange_weak(seen, now);) {}
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms_));
+        --active_;
+        calls_++;
+
+        if (broken_ || operation == "fail") {
+            JsonValue error = JsonValue::makeObject();
+            error.object_value["error"] = JsonValue::makeString("unavailable");
+            return error;
+        }
+        JsonValue result = JsonValue::makeArray();
+        if (operation == "getMentalHealthGenes") {
+            for (const char* gene : {"COMT", "HTR2A", "BDNF", "SLC6A4", "DRD2", "MAOA"}) {
+                JsonValue row = JsonValue::makeObject();
+                row.object_value["gene_id"] = JsonValue::makeString(gene);
+                result.array_value.push_back(row);
+            }
+        } else {
+            JsonValue row = JsonValue::makeObject();
+            row.object_value["endpoint"] = JsonValue::makeString(operation);
+            row.object_value["parameters"] = parameters;
+            result.array_value.push_back(row);
+        }
+        return result;
+    }
+    bool isAvailable() const override { return true; }
+    std::string getType() const override { return "test"; }
+    std::string getName() const override { return "slow"; }
+    JsonValue getConnectionInfo() const override { return JsonValue::makeObject(); }
+
+    std::string getVersion() const override {
+        std::lock_guard<std::mutex> lock(version_mutex_);
+        return version_;
+    }
+    void setVersion(const std::string& version) {
+        std::lock_guard<std::mutex> lock(version_mutex_);
+        version_ = version;
+    }
+
+    int peak() const { return peak_; }
+    int calls() const { return calls_; }
+
+private:
+    mutable std::mutex version_mutex_;
+    std::string version_ = "1";
+    int delay_ms_;
+    bool broken_;
+    std::atomic<int> active_{0};
+    std::atomic<int> peak_{0};
+    std::atomic<int> calls_{0};
+};
+
+class SlowAnnotator : public DataProcessor {
+public:
+    JsonValue process(const JsonValue& input, const JsonValue&) const override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        JsonValue annotated = JsonValue::makeArray();
+        for (const auto& variant : input.object_value.at("variants").array_value) {
+            JsonValue row = variant;
+            row.object_value["clinical_significance"] = JsonValue::makeString(
+                variant.object_value.at("gene_id").string_value == "COMT" ? "pathogenic" : "benign");
+            annotated.array_value.push_back(row);
+        }
+        return annotated;
+    }
+    std::string getType() const override { return "vcf_annotator"; }
+};
+
+// Throws what no std::exception handler catches
+class ThrowingProcessor : public DataProcessor {
+public:
+    JsonValue process(const JsonValue&, const JsonValue&) const override { throw 42; }
+    std::string getType() const override { return "throwing"; }
+};
+
+class ThrowingSource : public DataSource {
+public:
+    JsonValue execute(const std::string&, const JsonValue&) override { throw 42; }
+    void executeAsync(const std::string&, const JsonValue&, const CancellationToken&, Completion) override {
+        throw "refused";
+    }
+    bool isAvailable() const override { return true; }
+    std::string getType() const override { return "test"; }
+    std::string getName() const override { return "throwing"; }
+    JsonValue getConnectionInfo() const override { return JsonValue::makeObject(); }
+};
+
+// Blocks in execute(), and notes a call that outlived it
+class LingeringSource : public DataSource {
+public:
+    struct State {
+        std::atomic<bool> destroyed{false};
+        std::atomic<bool> outlived{false};
+        std::atomic<int> finished{0};
+    };
+
+    explicit LingeringSource(std::shared_ptr<State> state) : state_(std::move(state)) {}
+    ~LingeringSource() override { state_->destroyed = true; }
+
+    JsonValue execute(const std::string&, const JsonValue&) override {
+        std::this_thread::sleep_for(100ms);
+        if (state_->destroyed) state_->outlived = true;
+        state_->finished++;
+        return JsonValue::makeObject();
+    }
+    bool isAvailable() const override { return true; }
+    std::string getType() const override { return "test"; }
+    std::string getName() const override { return "lingering"; }
+    JsonValue getConnectionInfo() const override { return JsonValue::makeObject(); }
+
+private:
+    std::shared_ptr<State> state_;
+};
+
+// Blocks in execute() until released, like a call to a server that hung
+class HangingSource : public DataSource {
+public:
+    JsonValue execute(const std::string&, const JsonValue&) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++hung_;
+        released_cv_.wait(lock, [&] { return released_; });
+        return JsonValue::makeObject();
+    }
+    bool isAvailable() const override { return true; }
+    std::string getType() const override { return "test"; }
+    std::string getName() const override { return "hanging"; }
+    JsonValue getConnectionInfo() const override { return JsonValue::makeObject(); }
+
+    int hung() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return hung_;
+    }
+    void release() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        released_ = true;
+        released_cv_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable released_cv_;
+    int hung_ = 0;
+    bool released_ = false;
+};
+
+// Completes every call from its own event loop after a delay, without a
+// thread per call; "hang" only ever completes by being cancelled. With
+// `hold_until`, no call completes before that many are in flight at once.
+class AsyncSource : public DataSource {
+public:
+    explicit AsyncSource(std::chrono::milliseconds delay = 20ms, int hold_until = 0)
+        : delay_(delay), hold_until_(hold_until) {}
+
+    JsonValue execute(const std::string&, const JsonValue&) override { return JsonValue::makeObject(); }
+
+    void executeAsync(const std::string& operation, const JsonValue& parameters,
+                      const CancellationToken& cancel, Completion done) override {
+        int now = ++in_flight_;
+        for (int seen = peak_; now > seen && !peak_.compare_exchange_weak(seen, now);) {}
+        auto finished = std::make_shared<std::atomic<bool>>(false);
+        auto finish = [this, finished, done = std::move(done)](JsonValue result) {
+            if (finished->exchange(true)) return;
+            --in_flight_;
+            done(std::move(result));
+        };
+        cancel.on_cancel([this, finish] {
+            cancelled_++;
+            JsonValue error = JsonValue::makeObject();
+            error.object_value["error"] = JsonValue::makeString("cancelled");
+            finish(error);
+        });
+        if (operation == "hang") return;
+        if (hold_until_ > 0) {
+            std::lock_guard<std::mutex> lock(held_mutex_);
+            held_.push_back([finish, parameters] { finish(parameters); });
+            if (static_cast<int>(held_.size()) < hold_until_) return;
+            for (auto& call : held_) loop_.schedule_after(delay_, std::move(call));
+            held_.clear();
+            return;
+        }
+        loop_.schedule_after(delay_, [finish, parameters] { finish(parameters); });
+    }
+    bool isAvailable() const override { return true; }
+    std::string getType() const override { return "test"; }
+    std::string getName() const override { return "async"; }
+    JsonValue getConnectionInfo() const override { return JsonValue::makeObject(); }
+
+    // A run can end before the source's own cancel callback has run
+    void settle() const {
+        for (int i = 0; i < 100 && in_flight_ > 0; ++i) std::this_thread::sleep_for(1ms);
+    }
+
+    int peak() const { return peak_; }
+    int in_flight() const { return in_flight_; }
+    int cancelled() const { return cancelled_; }
+
+private:
+    std::chrono::milliseconds delay_;
+    int hold_until_;
+    std::mutex held_mutex_;
+    std::vector<std::function<void()>> held_;
+    EventLoop loop_;
+    std::atomic<int> in_flight_{0};
+    std::atomic<int> peak_{0};
+    std::atomic<int> cancelled_{0};
+};
+
+// The shape of comprehensive_mental_health_analysis in flexible_config_example.json
+const char* ANALYSIS = R"({
+  "steps": [
+    {"name": "gene_discovery", "type": "parallel", "operations": [
+      {"name": "get_known_genes", "endpoint": "getMentalHealthGenes", "data_source": "ncbi",
+       "parameters": {"condition": "${INPUT:condition}"}, "output_key": "known_genes"},
+      {"name": "literature_search", "endpoint": "getResearchAssociations", "data_source": "broken",
+       "parameters": {"terms": ["${INPUT:condition}"]}, "output_key": "recent_literature",
+       "fallback": {"data_source": "ncbi"}}]},
+    {"name": "variant_analysis", "type": "conditional",
+     "condition": "${EXISTS:INPUT.patient_variants} AND ${LENGTH:INPUT.patient_variants} > 0", "operations": [
+      {"name": "annotate_variants", "type": "custom", "processor": "vcf_annotator",
+       "parameters": {"variants": "${INPUT:patient_variants}"}, "output_key": "annotated_variants"},
+      {"name": "filter_relevant_variants", "type": "filter", "input": "annotated_variants",
+       "criteria": {"clinical_significance": ["pathogenic"], "gene_id": "${EXTRACT:known_genes.gene_id}"},
+       "output_key": "relevant_variants"}]},
+    {"name": "pathway_analysis", "type": "sequential", "condition": "${LENGTH:known_genes} > 5", "operations": [
+      {"name": "enrichment_analysis", "endpoint": "getPathwayAnalysis", "data_source": "ncbi",
+       "parameters": {"gene_list": "${EXTRACT:known_genes.gene_id}"}, "output_key": "pathway_results"},
+      {"name": "network_analysis", "endpoint": "getProteinInteractions", "data_source": "ncbi",
+       "parameters": {"gene_ids": "${EXTRACT:known_genes.gene_id}"}, "output_key": "interaction_network"}]},
+    {"name": "pharmacogenomics", "type": "conditional", "operations": [
+      {"name": "drug_interactions", "endpoint": "getDrugGeneInteractions", "data_source": "ncbi",
+       "parameters": {"gene_ids": "${MERGE:known_genes.gene_id,EXTRACT:relevant_variants.gene_id}"},
+       "output_key": "drug_interactions"},
+      {"name": "polypharmacy_check", "endpoint": "getPolypharmacyAdvisory", "data_source": "ncbi",
+       "parameters": {"drug_list": "${EXTRACT:drug_interactions.endpoint}",
+                      "note": "${LENGTH:relevant_variants} relevant of ${LENGTH:INPUT.patient_variants}"},
+       "output_key": "polypharmacy_warnings"}]},
+    {"name": "report_generation", "type": "sequential", "operations": [
+      {"name": "compile_results", "type": "merge", "merge_strategy": "structured_report",
+       "inputs": ["known_genes", "recent_literature", "relevant_variants", "pathway_results",
+                  "interaction_network", "drug_interactions", "polypharmacy_warnings"],
+       "output_key": "comprehensive_report"}]}
+  ]
+})";
+
+JsonValue parse(const char* text) {
+    return from_io(std::get<qc::io::JsonValue>(qc::io::JsonParser::parse(text)));
+}
+
+JsonValue patient_input() {
+    return parse(R"({"condition": "depression", "patient_variants": [
+        {"variant_id": "rs4680", "gene_id": "COMT"}, {"variant_id": "rs6265", "gene_id": "BDNF"}]})");
+}
+
+} // namespace
+
+TEST_CASE(WorkflowEngine, RunsIndependentOperationsConcurrently) {
+    ConfigurationManager manager;
+    auto source = std::make_unique<SlowSource>(50);
+    SlowSource* ncbi = source.get();
+    manager.registerDataSource("ncbi", std::move(source));
+    manager.registerDataSource("broken", std::make_unique<SlowSource>(0, true));
+    manager.registerProcessor("vcf_annotator", std::make_unique<SlowAnnotator>());
+    ASSERT_TRUE(manager.loadWorkflow("analysis", parse(ANALYSIS)));
+    ASSERT_TRUE(manager.getWorkflow("analysis").plan != nullptr);
+
+    WorkflowEngine engine(&manager, 8);
+    JsonValue result = engine.executeWorkflow("analysis", patient_input());
+
+    // Independent calls overlapped rather than running one after another
+    ASSERT_TRUE(result.object_value["success"].bool_value);
+    ASSERT_TRUE(ncbi->peak() >= 2);
+    ASSERT_EQUAL(ncbi->calls(), 6); // Five operations, plus the literature fallback
+
+    const JsonValue& outputs = result.object_value["outputs"];
+    ASSERT_EQUAL(outputs.object_value.size(), 9);
+    const JsonValue& relevant = outputs.object_value.at("relevant_variants");
+    ASSERT_EQUAL(relevant.array_value.size(), 1);
+    ASSERT_EQUAL(relevant.array_value[0].object_value.at("variant_id").string_value, "rs4680");
+
+    const JsonValue& drugs = outputs.object_value.at("drug_interactions").array_value[0];
+    ASSERT_EQUAL(drugs.object_value.at("parameters").object_value.at("gene_ids").array_value.size(), 7);
+    const JsonValue& advisory = outputs.object_value.at("polypharmacy_warnings").array_value[0];
+    ASSERT_EQUAL(advisory.object_value.at("parameters").object_value.at("note").string_value, "1 relevant of 2");
+    ASSERT_EQUAL(outputs.object_value.at("comprehensive_report").object_value.size(), 7);
+    ASSERT_EQUAL(result.object_value["warnings"].array_value.size(), 1); // The fallback
+
+    // A failure without a fallback is reported, and its dependents still run
+    manager.registerDataSource("ncbi", std::make_unique<SlowSource>(0));
+    JsonValue def = parse(R"({"steps": [{"name": "s", "type": "parallel", "operations": [
+        {"name": "a", "endpoint": "fail", "data_source": "ncbi", "output_key": "x"},
+        {"name": "b", "endpoint": "echo", "data_source": "ncbi", "parameters": {"x": "${REF:x}"}, "output_key": "y"}]}]})");
+    ASSERT_TRUE(manager.loadWorkflow("partial", def));
+    result = engine.executeWorkflow("partial", JsonValue::makeObject());
+    ASSERT_FALSE(result.object_value["success"].bool_value);
+    ASSERT_EQUAL(result.object_value["errors"].array_value.size(), 1);
+    ASSERT_EQUAL(result.object_value["outputs"].object_value.size(), 1);
+}
+
+TEST_CASE(WorkflowEngine, GatesOnConditions) {
+    ConfigurationManager manager;
+    manager.registerDataSource("ncbi", std::make_unique<SlowSource>(0));
+    ASSERT_TRUE(manager.loadWorkflow("gated", parse(R"({"steps": [
+        {"name": "s", "type": "parallel", "operations": [
+            {"name": "genes", "endpoint": "getMentalHealthGenes", "data_source": "ncbi", "output_key": "genes"},
+            {"name": "check", "endpoint": "echo", "data_source": "ncbi", "condition": "len(genes) == 6", "output_key": "check"}]},
+        {"name": "deep", "condition": "${LENGTH:genes} > 10", "endpoint": "getPathwayAnalysis", "data_source": "ncbi",
+         "output_key": "pathways"},
+        {"name": "focused", "condition": "'BDNF' in genes.gene_id and INPUT.depth != 'basic'",
+         "endpoint": "getProteinInteractions", "data_source": "ncbi",
+         "parameters": {"since": "${CALC:current_year - 3}"}, "output_key": "interactions"}]})")));
+    ASSERT_FALSE(manager.loadWorkflow("unparsable", parse(R"({"steps": [
+        {"name": "a", "endpoint": "e", "condition": "${LENGTH:genes} >"}]})")));
+
+    WorkflowEngine engine(&manager, 2);
+    JsonValue result = engine.executeWorkflow("gated", parse(R"({"depth": "full"})"));
+    JsonValue& outputs = result.object_value["outputs"];
+    ASSERT_EQUAL(outputs.object_value.size(), 3);
+    ASSERT_EQUAL(outputs.object_value.count("pathways"), 0);
+    ASSERT_EQUAL(outputs.object_value.count("check"), 1); // Waited for genes through its condition
+    ASSERT_EQUAL(result.object_value["warnings"].array_value.size(), 1);
+    std::time_t now = std::time(nullptr);
+    std::tm local = *std::localtime(&now);
+    const JsonValue& since = outputs.object_value["interactions"].array_value[0].object_value.at("parameters").object_value.at("since");
+    ASSERT_EQUAL(since.type, JsonValue::NUMBER);
+    ASSERT_EQUAL(since.number_value, local.tm_year + 1897);
+
+    result = engine.executeWorkflow("gated", parse(R"({"depth": "basic"})"));
+    ASSERT_EQUAL(result.object_value["outputs"].object_value.count("interactions"), 0);
+}
+
+TEST_CASE(WorkflowEngine, MergesOutputsWithoutCopyingThem) {
+    ConfigurationManager manager;
+    WorkflowEngine engine(&manager, 1);
+    WorkflowContext context;
+    context.setOutput("known_genes", parse(R"([{"gene_id": "COMT"}, {"gene_id": "BDNF"}])"));
+    context.setOutput("pathways", parse(R"({"summary": {"count": 3}})"));
+    context.setOutput("network", parse(R"({"summary": {"edges": 12}, "source": "string-db"})"));
+
+    WorkflowOperation report;
+    report.name = "compile_results";
+    report.type = OperationType::MERGE;
+    report.parameters = parse(R"({"inputs": {"known_genes": "${REF:known_genes}", "pathways": "${REF:pathways}",
+                                             "missing": "${REF:never_produced}"}})");
+    report.output_key = "report";
+    engine.executeOperation(report, context);
+    SharedJson compiled = context.output("report");
+    ASSERT_EQUAL(compiled.size(), 2);
+    ASSERT_TRUE(compiled.find("known_genes")->same(context.output("known_genes")));
+    ASSERT_TRUE(compiled.find("pathways")->same(context.output("pathways")));
+
+    WorkflowOperation combined = report;
+    combined.parameters = parse(R"({"inputs": {"a": "${REF:pathways}", "b": "${REF:network}"}, "strategy": "deep_merge"})");
+    combined.output_key = "combined";
+    engine.executeOperation(combined, context);
+    SharedJson merged = context.output("combined");
+    ASSERT_EQUAL(merged.find("summary")->size(), 2);
+    ASSERT_TRUE(merged.find("source")->same(*context.output("network").find("source")));
+}
+
+TEST_CASE(WorkflowEngine, ContextTakesConcurrentWriters) {
+    std::vector<std::string> keys;
+    for (int i = 0; i < 8; ++i) keys.push_back("out" + std::to_string(i));
+    WorkflowContext context(keys);
+    context.setInput(parse(R"({"condition": "depression"})"));
+
+    std::atomic<bool> done{false};
+    std::atomic<int> seen{0};
+    std::thread reader([&] {
+        while (!done) {
+            for (const auto& key : keys) seen += context.findOutput(key) != nullptr;
+        }
+    });
+    std::vector<std::thread> writers;
+    for (int i = 0; i < 8; ++i) {
+        writers.emplace_back([&, i] {
+            for (int n = 0; n < 50; ++n) {
+                context.setOutput(keys[i], SharedJson::number(n));
+                context.addWarning("w" + std::to_string(i) + ":" + std::to_string(n));
+            }
+            context.setOutput("extra" + std::to_string(i), SharedJson::boolean(true)); // Not planned
+            context.addError("e" + std::to_string(i));
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    done = true;
+    reader.join();
+
+    ASSERT_TRUE(context.hasErrors());
+    ASSERT_EQUAL(context.outputs().size(), 16);
+    ASSERT_EQUAL(context.output("out3").as_number(), 49);
+    ASSERT_EQUAL(context.getErrors().size(), 8);
+    std::vector<std::string> warnings = context.getWarnings();
+    ASSERT_EQUAL(warnings.size(), 400);
+    // Each thread's messages stay in the order it added them
+    std::vector<int> last(8, -1);
+    bool ordered = true;
+    for (const auto& warning : warnings) {
+        int thread = warning[1] - '0';
+        int n = std::stoi(warning.substr(3));
+        ordered = ordered && n == last[thread] + 1;
+        last[thread] = n;
+    }
+    ASSERT_TRUE(ordered);
+
+    // A value read before a rewrite stays readable
+    const SharedJson* before = context.findOutput("out0");
+    context.setOutput("out0", SharedJson::string("rewritten"));
+    ASSERT_EQUAL(before->as_number(), 49);
+    ASSERT_EQUAL(context.output("out0").as_string(), "rewritten");
+    ASSERT_EQUAL(context.findInput()->find("condition")->as_string(), "depression");
+}
+
+TEST_CASE(WorkflowEngine, TracesRunsWhenAsked) {
+    ConfigurationManager manager;
+    manager.registerDataSource("ncbi", std::make_unique<SlowSource>(20));
+    manager.registerDataSource("broken", std::make_unique<SlowSource>(0, true));
+    ASSERT_TRUE(manager.loadWorkflow("traced", parse(R"({"steps": [
+        {"name": "discovery", "type": "parallel", "operations": [
+          {"name": "genes", "endpoint": "getMentalHealthGenes", "data_source": "ncbi", "output_key": "genes"},
+          {"name": "papers", "endpoint": "search", "data_source": "broken", "fallback": {"value": []},
+           "output_key": "papers"}]},
+        {"name": "follow_up", "type": "sequential", "operations": [
+          {"name": "pathways", "endpoint": "getPathwayAnalysis", "data_source": "ncbi",
+           "parameters": {"genes": "${EXTRACT:genes.gene_id}"}, "output_key": "pathways"},
+          {"name": "report", "type": "merge", "inputs": ["genes", "pathways", "papers"], "output_key": "report"}]}]})")));
+
+    WorkflowEngine engine(&manager, 4);
+    JsonValue untraced = engine.executeWorkflow("traced", JsonValue::makeObject());
+    ASSERT_TRUE(untraced.object_value["success"].bool_value);
+    ASSERT_EQUAL(untraced.object_value.count("trace_summary"), 0);
+
+    TraceRecorder trace;
+    JsonValue result = engine.executeWorkflow("traced", JsonValue::makeObject(), CancellationToken(), &trace);
+    ASSERT_TRUE(result.object_value["success"].bool_value);
+
+    size_t counts[6] = {};
+    for (const auto& span : trace.spans()) ++counts[static_cast<int>(span.category)];
+    ASSERT_EQUAL(counts[static_cast<int>(TraceRecorder::Category::WORKFLOW)], 1);
+    ASSERT_EQUAL(counts[static_cast<int>(TraceRecorder::Category::STEP)], 2);
+    ASSERT_EQUAL(counts[static_cast<int>(TraceRecorder::Category::OPERATION)], 4);
+    ASSERT_EQUAL(counts[static_cast<int>(TraceRecorder::Category::DATA_SOURCE)], 3);
+    ASSERT_EQUAL(counts[static_cast<int>(TraceRecorder::Category::FALLBACK)], 1);
+
+    // The report waited on pathways, which waited on genes
+    TraceRecorder::Summary summary = trace.summary();
+    ASSERT_EQUAL(summary.critical_path.size(), 3);
+    ASSERT_EQUAL(summary.critical_path[0].operation, "genes");
+    ASSERT_EQUAL(summary.critical_path[2].operation, "report");
+    ASSERT_TRUE(summary.critical_path_ms >= 40 && summary.critical_path_ms <= summary.total_ms);
+    ASSERT_EQUAL(summary.sources["ncbi"].calls, 2);
+    ASSERT_TRUE(summary.sources["ncbi"].ms >= 40);
+    ASSERT_EQUAL(summary.fallbacks, 1);
+
+    const JsonValue& reported = result.object_value["trace_summary"];
+    ASSERT_EQUAL(reported.object_value.at("critical_path").array_value.size(), 3);
+    ASSERT_EQUAL(reported.object_value.at("sources").object_value.at("broken").object_value.at("calls").number_value, 1);
+}
+
+TEST_CASE(WorkflowEngine, LoadsWorkflowDefinitions) {
+    ConfigurationManager manager;
+    ASSERT_TRUE(manager.loadWorkflow("quick", parse(R"({"steps": [{"name": "gene_info", "endpoint": "getGene",
+        "data_source": "db", "parameters": {"gene": "${INPUT:genes[0]}"}, "output_key": "gene_info"}], "timeout": 10})")));
+    Workflow quick = manager.getWorkflow("quick");
+    ASSERT_EQUAL(quick.global_timeout, 10);
+    ASSERT_EQUAL(quick.steps.size(), 1);
+    ASSERT_EQUAL(quick.steps[0].operations[0].name, "gene_info");
+
+    // Cycles, duplicate names and unknown operation types are rejected
+    ASSERT_FALSE(manager.loadWorkflow("cyclic", parse(R"({"steps": [{"name": "s", "type": "parallel", "operations": [
+        {"name": "a", "endpoint": "e", "parameters": {"v": "${REF:y}"}, "output_key": "x"},
+        {"name": "b", "endpoint": "e", "parameters": {"v": "${REF:x}"}, "output_key": "y"}]}]})")));
+    ASSERT_FALSE(manager.loadWorkflow("twice", parse(R"({"steps": [
+        {"name": "a", "endpoint": "e"}, {"name": "a", "endpoint": "e"}]})")));
+    ASSERT_FALSE(manager.loadWorkflow("odd", parse(R"({"steps": [{"name": "a", "type": "teleport"}]})")));
+    ASSERT_EQUAL(manager.getAvailableWorkflows().size(), 1);
+
+    ConfigurationManager empty;
+    WorkflowEngine engine(&empty, 1);
+    ASSERT_FALSE(engine.executeWorkflow("missing", JsonValue::makeObject()).object_value["success"].bool_value);
+}
+
+TEST_CASE(WorkflowEngine, KeepsThousandsOfCallsInFlightOnFewThreads) {
+    ConfigurationManager manager;
+    // No call completes until all 2000 are in flight, so a run that kept
+    // fewer waiting would only end at the workflow's timeout
+    auto owned = std::make_unique<AsyncSource>(1ms, 2000);
+    AsyncSource* source = owned.get();
+    manager.registerDataSource("async", std::move(owned));
+
+    JsonValue operations = JsonValue::makeArray();
+    for (int i = 0; i < 2000; ++i) {
+        JsonValue operation = JsonValue::makeObject();
+        operation.object_value["name"] = JsonValue::makeString("lookup" + std::to_string(i));
+        operation.object_value["endpoint"] = JsonValue::makeString("getGene");
+        operation.object_value["data_source"] = JsonValue::makeString("async");
+        operation.object_value["output_key"] = JsonValue::makeString("gene" + std::to_string(i));
+        operations.array_value.push_back(operation);
+    }
+    JsonValue step = JsonValue::makeObject();
+    step.object_value["name"] = JsonValue::makeString("fan_out");
+    step.object_value["type"] = JsonValue::makeString("parallel");
+    step.object_value["operations"] = operations;
+    JsonValue def = JsonValue::makeObject();
+    def.object_value["steps"] = JsonValue::makeArray();
+    def.object_value["steps"].array_value.push_back(step);
+    def.object_value["timeout"] = JsonValue::makeNumber(60);
+    ASSERT_TRUE(manager.loadWorkflow("fan_out", def));
+
+    WorkflowEngine engine(&manager, 2);
+    JsonValue result = engine.executeWorkflow("fan_out", JsonValue::makeObject());
+    ASSERT_TRUE(result.object_value["success"].bool_value);
+    ASSERT_EQUAL(result.object_value["outputs"].object_value.size(), 2000);
+    ASSERT_EQUAL(source->peak(), 2000);
+}
+
+TEST_CASE(WorkflowEngine, EnforcesDeadlinesByCancelling) {
+    ConfigurationManager manager;
+    auto owned = std::make_unique<AsyncSource>();
+    AsyncSource* source = owned.get();
+    manager.registerDataSource("async", std::move(owned));
+    ASSERT_TRUE(manager.loadWorkflow("deadlines", parse(R"({"steps": [{"name": "s", "type": "parallel", "operations": [
+        {"name": "slow", "endpoint": "hang", "data_source": "async", "timeout": 0.05,
+         "fallback": {"value": "stale"}, "output_key": "a"},
+        {"name": "slower", "endpoint": "hang", "data_source": "async", "timeout": 0.05, "output_key": "b"},
+        {"name": "fast", "endpoint": "get", "data_source": "async", "parameters": {"b": "${REF:b}"}, "output_key": "c"}]}]})")));
+    // No per-operation deadline, so only the global timeout ends it
+    ASSERT_TRUE(manager.loadWorkflow("global", parse(R"({"steps": [
+        {"name": "stuck", "endpoint": "hang", "data_source": "async", "timeout": 0, "output_key": "x"},
+        {"name": "after", "endpoint": "get", "data_source": "async", "parameters": {"x": "${REF:x}"}, "output_key": "y"}],
+        "timeout": 0.1})")));
+
+    // "hang" ends only when cancelled, so the runs finishing at all shows the
+    // deadlines fired; the bounds only catch a run that waited far too long
+    WorkflowEngine engine(&manager, 2);
+    auto started = std::chrono::steady_clock::now();
+    JsonValue result = engine.executeWorkflow("deadlines", JsonValue::makeObject());
+    ASSERT_TRUE(std::chrono::steady_clock::now() - started < 30s);
+    JsonValue& outputs = result.object_value["outputs"];
+    ASSERT_EQUAL(outputs.object_value["a"].string_value, "stale");
+    ASSERT_EQUAL(outputs.object_value.count("b"), 0);
+    ASSERT_EQUAL(outputs.object_value.count("c"), 1); // Dependents run on with what is available
+    ASSERT_EQUAL(result.object_value["errors"].array_value.size(), 1);
+    ASSERT_TRUE(result.object_value["errors"].array_value[0].string_value.find("timed out") != std::string::npos);
+    source->settle();
+    ASSERT_EQUAL(source->cancelled(), 2);
+
+    started = std::chrono::steady_clock::now();
+    result = engine.executeWorkflow("global", JsonValue::makeObject());
+    ASSERT_TRUE(std::chrono::steady_clock::now() - started < 30s);
+    ASSERT_EQUAL(result.object_value["errors"].array_value.size(), 2); // The stuck call and the one waiting on it
+    source->settle();
+    ASSERT_EQUAL(source->cancelled(), 3);
+    ASSERT_EQUAL(source->in_flight(), 0);
+
+    // A caller's token cancels the run the same way
+    CancellationSource caller;
+    std::thread canceller([&] {
+        std::this_thread::sleep_for(50ms);
+        caller.cancel("user abort");
+    });
+    manager.loadWorkflow("patient", parse(R"({"steps": [{"name": "stuck", "endpoint": "hang", "data_source": "async",
+        "timeout": 0, "output_key": "x"}], "timeout": 0})"));
+    result = engine.executeWorkflow("patient", JsonValue::makeObject(), caller.token());
+    canceller.join();
+    ASSERT_TRUE(result.object_value["errors"].array_value[0].string_value.find("user abort") != std::string::npos);
+    ASSERT_EQUAL(source->in_flight(), 0);
+}
+
+TEST_CASE(WorkflowEngine, MemoizesResultsAcrossRunsAndProcesses) {
+    std::string dir = (std::filesystem::temp_directory_path() / "qc_workflow_memo").string();
+    std::filesystem::remove_all(dir);
+    auto clock = std::make_shared<std::atomic<int64_t>>(1000000);
+    CacheManager::Options options;
+    options.clock = [clock] { return clock->load(); };
+
+    ConfigurationManager manager;
+    auto owned = std::make_unique<SlowSource>(0);
+    SlowSource* source = owned.get();
+    manager.registerDataSource("ncbi", std::move(owned));
+    ASSERT_TRUE(manager.loadWorkflow("lookup", parse(R"({"steps": [
+        {"name": "genes", "endpoint": "getMentalHealthGenes", "data_source": "ncbi",
+         "parameters": {"condition": "${INPUT:condition}"}, "output_key": "genes", "cache": {"enabled": true, "ttl": 60}},
+        {"name": "pathways", "endpoint": "getPathwayAnalysis", "data_source": "ncbi",
+         "parameters": {"gene_list": "${EXTRACT:genes.gene_id}"}, "output_key": "pathways", "cache": {"enabled": true}},
+        {"name": "uncached", "endpoint": "getPathwayAnalysis", "data_source": "ncbi",
+         "parameters": {"gene_list": "${EXTRACT:genes.gene_id}"}, "output_key": "uncached"}]})")));
+    JsonValue depression = parse(R"({"condition": "depression"})");
+
+    {
+        WorkflowEngine engine(&manager, 2);
+        engine.setResultCache(std::make_shared<CacheManager>(dir, options));
+        engine.executeWorkflow("lookup", depression);
+        ASSERT_EQUAL(source->calls(), 3);
+        JsonValue again = engine.executeWorkflow("lookup", depression);
+        ASSERT_EQUAL(source->calls(), 4); // Only the uncached operation
+        ASSERT_EQUAL(again.object_value["outputs"].object_value["genes"].array_value.size(), 6);
+
+        // A different cohort with the same genes reuses the pathway analysis
+        TraceRecorder trace;
+        engine.executeWorkflow("lookup", parse(R"({"condition": "anxiety"})"), CancellationToken(), &trace);
+        ASSERT_EQUAL(source->calls(), 6);
+        ASSERT_EQUAL(trace.summary().cache_hits, 1);
+        ASSERT_EQUAL(trace.summary().cache_misses, 1);
+    }
+
+    // A fresh engine and store over the same directory, as in a new process
+    WorkflowEngine engine(&manager, 2);
+    engine.setResultCache(std::make_shared<CacheManager>(dir, options));
+    engine.executeWorkflow("lookup", depression);
+    ASSERT_EQUAL(source->calls(), 7);
+
+    // New data behind the source invalidates what was read from it
+    source->setVersion("2");
+    engine.executeWorkflow("lookup", depression);
+    ASSERT_EQUAL(source->calls(), 10);
+    engine.executeWorkflow("lookup", depression);
+    ASSERT_EQUAL(source->calls(), 11);
+
+    // Past its ttl the gene lookup runs again; the pathways entry never expires
+    clock->fetch_add(61);
+    engine.executeWorkflow("lookup", depression);
+    ASSERT_EQUAL(source->calls(), 13);
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE(WorkflowEngine, RunsUncachedWhenTheResultStoreFails) {
+    ConfigurationManager manager;
+    ASSERT_TRUE(manager.loadConfigurationFromJson(parse(R"({"caching": {"cache_backends": {
+        "file_system": {"cache_dir": "/proc/self/nope"}}}})")));
+    manager.registerDataSource("ncbi", std::make_unique<SlowSource>(0));
+    ASSERT_TRUE(manager.loadWorkflow("lookup", parse(R"({"steps": [
+        {"name": "genes", "endpoint": "getMentalHealthGenes", "data_source": "ncbi", "output_key": "genes",
+         "cache": {"enabled": true}}]})")));
+
+    WorkflowEngine engine(&manager, 2);
+    JsonValue result = engine.executeWorkflow("lookup", JsonValue::makeObject());
+    ASSERT_TRUE(result.object_value["success"].bool_value);
+    ASSERT_EQUAL(result.object_value["outputs"].object_value["genes"].array_value.size(), 6);
+    const auto& warnings = result.object_value["warnings"].array_value;
+    ASSERT_EQUAL(warnings.size(), 1);
+    ASSERT_TRUE(warnings[0].string_value.find("uncached") != std::string::npos);
+}
+
+TEST_CASE(WorkflowEngine, FinishesOperationsThatThrowAnything) {
+    ConfigurationManager manager;
+    manager.registerProcessor("throwing", std::make_unique<ThrowingProcessor>());
+    manager.registerDataSource("throwing", std::make_unique<ThrowingSource>());
+    manager.registerDataSource("ncbi", std::make_unique<SlowSource>(0));
+    ASSERT_TRUE(manager.loadWorkflow("throws", parse(R"({"steps": [{"name": "s", "type": "parallel", "operations": [
+        {"name": "process", "type": "custom", "processor": "throwing", "output_key": "a", "fallback": {"value": 1}},
+        {"name": "call", "endpoint": "get", "data_source": "throwing", "output_key": "b"},
+        {"name": "after", "endpoint": "echo", "data_source": "ncbi",
+         "parameters": {"a": "${REF:a}", "b": "${REF:b}"}, "output_key": "c"}]}]})")));
+
+    WorkflowEngine engine(&manager, 2);
+    JsonValue result = engine.executeWorkflow("throws", JsonValue::makeObject());
+    ASSERT_FALSE(result.object_value["success"].bool_value);
+    JsonValue& outputs = result.object_value["outputs"];
+    ASSERT_EQUAL(outputs.object_value["a"].number_value, 1); // A processor's failure still takes its fallback
+    ASSERT_EQUAL(outputs.object_value.count("b"), 0);
+    ASSERT_EQUAL(outputs.object_value.count("c"), 1);
+    const auto& errors = result.object_value["errors"].array_value;
+    ASSERT_EQUAL(errors.size(), 1);
+    ASSERT_TRUE(errors[0].string_value.find("unknown exception") != std::string::npos);
+}
+
+TEST_CASE(WorkflowEngine, ClosesSourcesBeforeAbandonedCallsFinish) {
+    auto state = std::make_shared<LingeringSource::State>();
+    {
+        ConfigurationManager manager;
+        manager.registerDataSource("slow", std::make_unique<LingeringSource>(state));
+        ASSERT_TRUE(manager.loadWorkflow("abandon", parse(R"({"steps": [
+            {"name": "slow", "endpoint": "get", "data_source": "slow", "timeout": 0.02, "output_key": "x"}]})")));
+        WorkflowEngine engine(&manager, 1);
+        JsonValue result = engine.executeWorkflow("abandon", JsonValue::makeObject());
+        ASSERT_FALSE(result.object_value["success"].bool_value);
+        ASSERT_EQUAL(state->finished.load(), 0); // The run is over; its call is not
+    }
+    // Destroying the manager waited for the call rather than freeing the source under it
+    ASSERT_EQUAL(state->finished.load(), 1);
+    ASSERT_FALSE(state->outlived.load());
+}
+
+TEST_CASE(WorkflowEngine, RunsBlockingCallsPastOnesThatHang) {
+    HangingSource hanging;
+    std::atomic<int> returned{0};
+    for (int i = 0; i < 16; ++i) {
+        hanging.executeAsync("get", JsonValue::makeObject(), CancellationToken(), [&](JsonValue) { ++returned; });
+    }
+    for (int i = 0; i < 10000 && hanging.hung() < 16; ++i) std::this_thread::sleep_for(1ms);
+    ASSERT_EQUAL(hanging.hung(), 16);
+
+    // The 17th blocking call gets a thread of its own
+    SlowSource quick(0);
+    std::promise<JsonValue> answered;
+    quick.executeAsync("get", parse(R"({"n": 17})"), CancellationToken(),
+                       [&](JsonValue result) { answered.set_value(std::move(result)); });
+    auto answer = answered.get_future();
+    ASSERT_TRUE(answer.wait_for(10s) == std::future_status::ready);
+    ASSERT_EQUAL(returned.load(), 0);
+
+    hanging.release();
+    hanging.closeBlockingCalls();
+    quick.closeBlockingCalls();
+    for (int i = 0; i < 10000 && returned < 16; ++i) std::this_thread::sleep_for(1ms);
+    ASSERT_EQUAL(returned.load(), 16);
+}
@@ -0,0 +1,78 @@
+#include "core/flexible_json_logic.h"
+#include "core/workflow_plan.h"
+#include "utils/testing_framework.h"
+#include <algorithm>
+
+using namespace qc::core;
+
+static WorkflowOperation operation(const std::string& name, const std::string& output_key,
+                                   const std::string& reference = "") {
+    WorkflowOperation op;
+    op.name = name;
+    op.endpoint = name;
+    op.output_key = output_key;
+    op.parameters = JsonValue::makeObject();
+    if (!reference.empty()) op.parameters.object_value["ref"] = JsonValue::makeString(reference);
+    return op;
+}
+
+static WorkflowStep step(const std::string& type, std::vector<WorkflowOperation> operations,
+                         const std::string& condition = "") {
+    WorkflowStep s;
+    s.execution_type = type;
+    s.condition = condition;
+    s.operations = std::move(operations);
+    return s;
+}
+
+TEST_CASE(WorkflowPlan, FindsOutputReferences) {
+    auto names = WorkflowPlan::referenced_outputs(
+        "${MERGE:known_genes.gene_id,EXTRACT:relevant_variants.gene_id} ${INPUT:genes[0]} "
+        "${EXISTS:INPUT.patient_variants} ${LENGTH:known_genes} > 5 ${ENV:HOME} ${REF:network}");
+    ASSERT_EQUAL(names.size(), 4);
+    ASSERT_EQUAL(names[0], "known_genes");
+    ASSERT_EQUAL(names[1], "relevant_variants");
+    ASSERT_EQUAL(names[2], "known_genes");
+    ASSERT_EQUAL(names[3], "network");
+}
+
+TEST_CASE(WorkflowPlan, InfersDependenciesAcrossSteps) {
+    Workflow workflow;
+    workflow.steps.push_back(step("parallel", {operation("genes", "known_genes"), operation("papers", "literature")}));
+    workflow.steps.push_back(step("sequential", {operation("enrich", "pathways", "${EXTRACT:known_genes.gene_id}"),
+                                                 operation("network", "interactions", "${EXTRACT:known_genes.gene_id}")},
+                                  "${LENGTH:known_genes} > 5"));
+    workflow.steps.push_back(step("parallel", {operation("report", "report", "${REF:literature} ${REF:interactions}")}));
+
+    std::string error;
+    auto plan = WorkflowPlan::build(workflow, &error);
+    ASSERT_TRUE(plan != nullptr);
+    ASSERT_EQUAL(plan->roots().size(), 2);
+
+    const auto& nodes = plan->nodes();
+    ASSERT_EQUAL(nodes[plan->find("enrich")].dependencies.size(), 1);
+    ASSERT_EQUAL(nodes[plan->find("network")].dependencies.size(), 2); // Known genes, and enrich before it
+    ASSERT_EQUAL(nodes[plan->find("report")].dependencies.size(), 2);
+    ASSERT_TRUE(plan->find("missing") == WorkflowPlan::npos);
+
+    // genes -> enrich -> network -> report is the longest chain
+    auto lengths = plan->critical_path([](size_t) { return 1.0; });
+    ASSERT_EQUAL(lengths[plan->find("genes")], 4.0);
+    ASSERT_EQUAL(lengths[plan->find("papers")], 2.0);
+    const auto& order = plan->order();
+    ASSERT_TRUE(std::find(order.begin(), order.end(), plan->find("network")) >
+                std::find(order.begin(), order.end(), plan->find("enrich")));
+}
+
+TEST_CASE(WorkflowPlan, RejectsCyclesAndDuplicateOutputs) {
+    Workflow cyclic;
+    cyclic.steps.push_back(step("parallel", {operation("a", "x", "${REF:y}"), operation("b", "y", "${REF:x}")}));
+    std::string error;
+    ASSERT_TRUE(WorkflowPlan::build(cyclic, &error) == nullptr);
+    ASSERT_TRUE(error.find("cycle") != std::string::npos);
+
+    Workflow duplicate;
+    duplicate.steps.push_back(step("parallel", {operation("a", "x"), operation("b", "x")}));
+    ASSERT_TRUE(WorkflowPlan::build(duplicate, &error) == nullptr);
+    ASSERT_TRUE(error.find("more than one") != std::string::npos);
+}
@@ -0,0 +1,138 @@
+#include "io/async_io.h"
+#include "io/file_io.h"
+#include "utils/testing_framework.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <vector>
+
+using namespace qc::io;
+namespace fs = std::filesystem;
+
+TEST_CASE(AsyncIO, BatchesReadsAndWritesOnEitherBackend) {
+    AsyncIO::Options options;
+    options.queue_depth = 32; // Smaller than the batch, which is then split
+    options.registered_buffers = 2;
+    options.buffer_size = 4096;
+    for (bool force_pool : {false, true}) {
+        options.force_thread_pool = force_pool;
+        AsyncIO io(options);
+        if (force_pool) ASSERT_TRUE(io.backend() == AsyncIO::Backend::THREAD_POOL);
+        std::string name = force_pool ? "qc_async_io_pool.bin" : "qc_async_io_default.bin";
+
+        std::string path = (fs::temp_directory_path() / name).string();
+        int fd = FileIO::open_fd(path, FileIO::Open::CREATE);
+        ASSERT_TRUE(fd >= 0);
+
+        // One batch of 64 writes, each reported through its callback
+        std::vector<std::string> blocks;
+        for (int i = 0; i < 64; ++i) blocks.push_back(std::string(512, static_cast<char>('a' + i % 26)));
+        std::atomic<int> written{0};
+        std::vector<AsyncIO::Request> batch;
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            AsyncIO::Request request;
+            request.op = AsyncIO::Request::Op::WRITE;
+            request.fd = fd;
+            request.offset = i * 512;
+            request.data = &blocks[i][0];
+            request.size = 512;
+            request.done = [&](int64_t res) { if (res == 512) written++; };
+            batch.push_back(std::move(request));
+        }
+        io.submit(std::move(batch));
+        io.drain();
+        ASSERT_EQUAL(written.load(), 64);
+        ASSERT_EQUAL(io.sync(fd).get(), 0);
+
+        std::string back(512, '\0');
+        ASSERT_EQUAL(io.read(fd, &back[0], 512, 3 * 512).get(), 512);
+        ASSERT_EQUAL(back, blocks[3]);
+        ASSERT_EQUAL(io.read(fd, &back[0], 512, 64 * 512).get(), 0); // Past the end
+
+        // Registered buffers carry data both ways
+        int buffer = io.acquire_buffer();
+        ASSERT_TRUE(buffer >= 0);
+        std::memcpy(io.buffer_data(buffer), "registered", 10);
+        AsyncIO::Request fixed;
+        fixed.op = AsyncIO::Request::Op::WRITE;
+        fixed.fd = fd;
+        fixed.data = io.buffer_data(buffer);
+        fixed.size = 10;
+        fixed.buffer = buffer;
+        std::promise<int64_t> fixed_done;
+        fixed.done = [&](int64_t res) { fixed_done.set_value(res); };
+        io.submit({std::move(fixed)});
+        ASSERT_EQUAL(fixed_done.get_future().get(), 10);
+        io.release_buffer(buffer);
+        ASSERT_EQUAL(io.read(fd, &back[0], 10, 0).get(), 10);
+        ASSERT_EQUAL(back.substr(0, 10), "registered");
+
+        // A failed request cancels the rest of its chain
+        std::atomic<int64_t> first{0};
+        std::atomic<int64_t> second{0};
+        AsyncIO::Request bad;
+        bad.op = AsyncIO::Request::Op::WRITE;
+        bad.fd = -1;
+        bad.data = &blocks[0][0];
+        bad.size = 1;
+        bad.link = true;
+        bad.done = [&](int64_t res) { first = res; };
+        AsyncIO::Request after;
+        after.op = AsyncIO::Request::Op::FSYNC;
+        after.fd = fd;
+        after.done = [&](int64_t res) { second = res; };
+        io.submit({std::move(bad), std::move(after)});
+        io.drain();
+        ASSERT_EQUAL(first.load(), -EBADF);
+        ASSERT_EQUAL(second.load(), -ECANCELED);
+
+        // A chain longer than the queue fails whole, and its callbacks may submit again
+        std::atomic<int> rejected{0};
+        std::promise<int64_t> follow_up;
+        std::vector<AsyncIO::Request> chain(33);
+        for (auto& request : chain) {
+            request.op = AsyncIO::Request::Op::FSYNC;
+            request.fd = fd;
+            request.link = true;
+            request.done = [&](int64_t res) { if (res == -EINVAL) rejected++; };
+        }
+        chain.back().link = false;
+        chain.back().done = [&](int64_t res) {
+            if (res == -EINVAL) rejected++;
+            AsyncIO::Request sync;
+            sync.op = AsyncIO::Request::Op::FSYNC;
+            sync.fd = fd;
+            sync.done = [&](int64_t synced) { follow_up.set_value(synced); };
+            io.submit({std::move(sync)});
+        };
+        io.submit(std::move(chain));
+        ASSERT_EQUAL(follow_up.get_future().get(), 0);
+        ASSERT_EQUAL(rejected.load(), 33);
+
+        FileIO::close_fd(fd);
+        fs::remove(path);
+
+        AsyncIO::Stats stats = io.stats();
+        ASSERT_EQUAL(stats.completed, stats.submitted);
+        ASSERT_TRUE(stats.submit_calls < stats.submitted);
+    }
+}
+
+TEST_CASE(AsyncIO, WritesAndReadsWholeFiles) {
+    AsyncIO io;
+    std::string path = (fs::temp_directory_path() / "qc_async_io_file.json").string();
+    std::string payload(100000, 'g');
+    auto written = FileIO::write_atomic_async(io, path, payload, true);
+    ASSERT_TRUE(written.get());
+    auto read = FileIO::read_async(io, path).get();
+    ASSERT_TRUE(read.has_value());
+    ASSERT_EQUAL(*read, payload);
+
+    ASSERT_TRUE(FileIO::write_atomic_async(io, path, "").get());
+    ASSERT_EQUAL(*FileIO::read_async(io, path).get(), "");
+    ASSERT_FALSE(FileIO::write_atomic_async(io, "/nonexistent_dir/x.json", "x").get());
+    ASSERT_FALSE(FileIO::read_async(io, "/nonexistent_dir/x.json").get().has_value());
+    fs::remove(path);
+}
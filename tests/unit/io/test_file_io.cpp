@@ -0,0 +1,36 @@
+#include "io/file_io.h"
+#include "utils/testing_framework.h"
+#include <filesystem>
+
+using namespace qc::io;
+namespace fs = std::filesystem;
+
+TEST_CASE(FileIO, WritesAtomicallyAndMapsBack) {
+    fs::path dir = fs::temp_directory_path() / "qc_file_io_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    std::string path = (dir / "data.json").string();
+
+    ASSERT_TRUE(FileIO::write_atomic(path, "{\"old\":true}"));
+    ASSERT_TRUE(FileIO::write_atomic(path, std::vector<std::string_view>{"{\"gene\":", "\"COMT\"", "}"}, true));
+
+    auto mapped = MappedFile::open(path);
+    ASSERT_TRUE(mapped.has_value());
+    ASSERT_EQUAL(std::string(mapped->view()), "{\"gene\":\"COMT\"}");
+
+    // Only the target remains; the temporary file was renamed into place
+    size_t entries = std::distance(fs::directory_iterator(dir), fs::directory_iterator());
+    ASSERT_EQUAL(entries, 1);
+    fs::remove_all(dir);
+}
+
+TEST_CASE(FileIO, MapsEmptyAndMissingFiles) {
+    fs::path path = fs::temp_directory_path() / "qc_file_io_empty";
+    ASSERT_TRUE(FileIO::write_atomic(path.string(), ""));
+    auto empty = MappedFile::open(path.string());
+    ASSERT_TRUE(empty.has_value());
+    ASSERT_EQUAL(empty->size(), 0);
+    fs::remove(path);
+
+    ASSERT_FALSE(MappedFile::open(path.string()).has_value());
+}
@@ -0,0 +1,35 @@
+#include "io/json_diff.h"
+#include "utils/testing_framework.h"
+
+using namespace qc::io;
+
+static JsonValue parse_json(const std::string& text) {
+    return std::get<JsonValue>(JsonParser::parse(text));
+}
+
+TEST_CASE(JsonDiff, DiffsObjectsMemberByMember) {
+    JsonValue before = parse_json(R"({"session":{"model":"a","temperature":0.7},"history":[1,2],"stale":true})");
+    JsonValue after = parse_json(R"({"session":{"model":"a","temperature":0.9},"history":[1,2,3],"new":null})");
+
+    JsonArray ops = JsonDiff::diff(before, after);
+    ASSERT_EQUAL(ops.size(), 4); // remove stale, set history, set new, set session.temperature
+
+    JsonValue patched = before;
+    ASSERT_TRUE(JsonDiff::apply(patched, ops));
+    ASSERT_TRUE(JsonDiff::equal(patched, after));
+    ASSERT_TRUE(JsonDiff::diff(after, after).empty());
+}
+
+TEST_CASE(JsonDiff, ReplacesNonObjectRoots) {
+    JsonValue before = parse_json("[1,2]");
+    JsonValue after = parse_json(R"({"a":1})");
+    JsonValue patched = before;
+    ASSERT_TRUE(JsonDiff::apply(patched, JsonDiff::diff(before, after)));
+    ASSERT_TRUE(JsonDiff::equal(patched, after));
+}
+
+TEST_CASE(JsonDiff, RejectsOpsThatDoNotFit) {
+    JsonValue target = parse_json(R"({"a":1})");
+    JsonArray ops = parse_json(R"([{"set":["missing","child"],"value":2}])").as_array();
+    ASSERT_FALSE(JsonDiff::apply(target, ops));
+}
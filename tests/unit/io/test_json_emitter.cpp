@@ -0,0 +1,26 @@
+#include "io/json_emitter.h"
+#include "utils/testing_framework.h"
+
+using namespace qc::io;
+
+TEST_CASE(JsonEmitter, EmitsCompactJson) {
+    JsonObject obj;
+    obj["id"] = JsonValue{std::string("rs4680")};
+    obj["impact"] = JsonValue{0.5};
+    obj["tags"] = JsonValue{JsonArray{JsonValue{true}, JsonValue{}}};
+    ASSERT_EQUAL(JsonEmitter::emit(JsonValue{obj}), "{\"id\":\"rs4680\",\"impact\":0.5,\"tags\":[true,null]}");
+}
+
+TEST_CASE(JsonEmitter, RoundTripsThroughParser) {
+    JsonObject obj;
+    obj["text"] = JsonValue{std::string("line\n\"quoted\"\t\\ \x01")};
+    obj["big"] = JsonValue{19963748.0};
+    obj["small"] = JsonValue{-0.000123};
+
+    auto res = JsonParser::parse(JsonEmitter::emit(JsonValue{obj}));
+    ASSERT_TRUE(std::holds_alternative<JsonValue>(res));
+    const auto& parsed = std::get<JsonValue>(res).as_object();
+    ASSERT_EQUAL(parsed.at("text").as_string(), obj["text"].as_string());
+    ASSERT_EQUAL(parsed.at("big").as_number(), 19963748.0);
+    ASSERT_EQUAL(parsed.at("small").as_number(), -0.000123);
+}
@@ -0,0 +1,41 @@
+#include "io/lz_codec.h"
+#include "utils/testing_framework.h"
+
+using namespace qc::io;
+
+static std::string annotation_json(int copies) {
+    std::string s = "[";
+    for (int i = 0; i < copies; ++i) {
+        s += "{\"gene\":\"COMT\",\"go_terms\":[\"GO:0006584\",\"GO:0042417\"],\"rank\":" + std::to_string(i) + "},";
+    }
+    return s + "]";
+}
+
+TEST_CASE(LzCodec, RoundTripsAndShrinksRepetitiveInput) {
+    std::string input = annotation_json(200);
+    std::string packed = LzCodec::compress(input);
+    ASSERT_TRUE(packed.size() * 5 < input.size());
+    ASSERT_EQUAL(*LzCodec::decompressed_size(packed), input.size());
+    ASSERT_EQUAL(*LzCodec::decompress(packed), input);
+}
+
+TEST_CASE(LzCodec, RoundTripsEdgeCases) {
+    std::string incompressible;
+    uint32_t x = 12345;
+    for (int i = 0; i < 5000; ++i) {
+        x = x * 1103515245u + 12345u;
+        incompressible += static_cast<char>(x >> 24);
+    }
+    const std::string inputs[] = {"", "a", "abcd", std::string(100000, 'z'), "abababababababababab", incompressible};
+    for (const auto& input : inputs) {
+        ASSERT_EQUAL(*LzCodec::decompress(LzCodec::compress(input)), input);
+    }
+}
+
+TEST_CASE(LzCodec, RejectsMalformedInput) {
+    std::string packed = LzCodec::compress(annotation_json(20));
+    ASSERT_FALSE(LzCodec::decompress(packed.substr(0, packed.size() / 2)).has_value());
+    ASSERT_FALSE(LzCodec::decompress("").has_value());
+    ASSERT_FALSE(LzCodec::decompress(std::string("\x05\x00\x01\x00", 4)).has_value()); // Offset past start
+    ASSERT_FALSE(LzCodec::decompress(std::string("\xff\xff\xff\xff\x0f", 5)).has_value()); // Absurd size
+}